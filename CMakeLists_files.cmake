@@ -37,12 +37,15 @@ list (APPEND MAIN_SOURCE_FILES
 	opm/core/grid/cpgpreprocess/geometry.c
 	opm/core/grid/cpgpreprocess/preprocess.c
 	opm/core/grid/cpgpreprocess/uniquepoints.c
+	opm/core/io/AsyncOutputWriter.cpp
+	opm/core/io/StateFile.cpp
 	opm/core/io/eclipse/BlackoilEclipseOutputWriter.cpp
 	opm/core/io/eclipse/EclipseGridInspector.cpp
 	opm/core/io/eclipse/EclipseGridParser.cpp
 	opm/core/io/eclipse/writeECLData.cpp
 	opm/core/io/vag/vag.cpp
 	opm/core/io/vtk/writeVtkData.cpp
+	opm/core/linalg/LinearSolverAmg.cpp
 	opm/core/linalg/LinearSolverFactory.cpp
 	opm/core/linalg/LinearSolverInterface.cpp
 	opm/core/linalg/LinearSolverIstl.cpp
@@ -67,6 +70,7 @@ list (APPEND MAIN_SOURCE_FILES
 	opm/core/pressure/msmfem/ifsh_ms.c
 	opm/core/pressure/msmfem/partition.c
 	opm/core/pressure/tpfa/cfs_tpfa.c
+	opm/core/pressure/tpfa/cfs_tpfa_dense.c
 	opm/core/pressure/tpfa/cfs_tpfa_residual.c
 	opm/core/pressure/tpfa/compr_bc.c
 	opm/core/pressure/tpfa/compr_quant.c
@@ -95,6 +99,7 @@ list (APPEND MAIN_SOURCE_FILES
 	opm/core/props/satfunc/SatFuncStone2.cpp
 	opm/core/props/satfunc/SaturationPropsBasic.cpp
 	opm/core/props/satfunc/SaturationPropsFromDeck.cpp
+	opm/core/simulator/AdaptiveTimeStepControl.cpp
 	opm/core/simulator/SimulatorCompressibleTwophase.cpp
 	opm/core/simulator/SimulatorIncompTwophase.cpp
 	opm/core/simulator/SimulatorReport.cpp
@@ -102,6 +107,7 @@ list (APPEND MAIN_SOURCE_FILES
 	opm/core/tof/DGBasis.cpp
 	opm/core/tof/TofReorder.cpp
 	opm/core/tof/TofDiscGalReorder.cpp
+	opm/core/tof/StreamlineTracer.cpp
 	opm/core/transport/TransportSolverTwophaseInterface.cpp
 	opm/core/transport/implicit/TransportSolverTwophaseImplicit.cpp
 	opm/core/transport/implicit/transport_source.c
@@ -114,6 +120,7 @@ list (APPEND MAIN_SOURCE_FILES
 	opm/core/transport/reorder/tarjan.c
 	opm/core/utility/Event.cpp
 	opm/core/utility/MonotCubicInterpolator.cpp
+	opm/core/utility/Profiler.cpp
 	opm/core/utility/StopWatch.cpp
 	opm/core/utility/VelocityInterpolation.cpp
 	opm/core/utility/WachspressCoord.cpp
@@ -152,10 +159,23 @@ list (APPEND TEST_SOURCE_FILES
 	tests/test_sparsetable.cpp
 	tests/test_velocityinterpolation.cpp
 	tests/test_quadratures.cpp
+	tests/test_reorder.cpp
 	tests/test_uniformtablelinear.cpp
 	tests/test_wells.cpp
+	tests/test_tof.cpp
+	tests/test_streamline.cpp
+	tests/test_equil.cpp
+	tests/test_msmfem.cpp
+	tests/test_linearsolver.cpp
+	tests/test_ifs_tpfa.cpp
+	tests/test_cfs_tpfa_dense.cpp
+	tests/test_asyncoutputwriter.cpp
+	tests/test_statefile.cpp
+	tests/test_adaptivetimestepcontrol.cpp
+	tests/test_profiler.cpp
 	tests/test_wachspresscoord.cpp
 	tests/test_column_extract.cpp
+	tests/test_cornerpointchopper.cpp
 	tests/test_geom2d.cpp
 	tests/test_param.cpp
 	tests/test_blackoilfluid.cpp
@@ -170,6 +190,7 @@ list (APPEND TEST_DATA_FILES
 	tests/extratestdata.xml
 	tests/testdata.xml
 	tests/testFluid.DATA
+	tests/testEquil.DATA
         tests/testBlackoilState1.DATA
         tests/testBlackoilState2.DATA
 	)
@@ -177,6 +198,7 @@ list (APPEND TEST_DATA_FILES
 # originally generated with the command:
 # find tutorials examples -name '*.c*' -printf '\t%p\n' | sort
 list (APPEND EXAMPLE_SOURCE_FILES
+	examples/benchmark_kernels.cpp
 	examples/compute_tof.cpp
 	examples/compute_tof_from_files.cpp
 	examples/import_rewrite.cpp
@@ -228,6 +250,8 @@ list (APPEND PUBLIC_HEADER_FILES
 	opm/core/grid/cpgpreprocess/grdecl.h
 	opm/core/grid/cpgpreprocess/preprocess.h
 	opm/core/grid/cpgpreprocess/uniquepoints.h
+	opm/core/io/AsyncOutputWriter.hpp
+	opm/core/io/StateFile.hpp
 	opm/core/io/eclipse/BlackoilEclipseOutputWriter.hpp
 	opm/core/io/eclipse/CornerpointChopper.hpp
 	opm/core/io/eclipse/EclipseGridInspector.hpp
@@ -238,6 +262,7 @@ list (APPEND PUBLIC_HEADER_FILES
 	opm/core/io/eclipse/writeECLData.hpp
 	opm/core/io/vag/vag.hpp
 	opm/core/io/vtk/writeVtkData.hpp
+	opm/core/linalg/LinearSolverAmg.hpp
 	opm/core/linalg/LinearSolverFactory.hpp
 	opm/core/linalg/LinearSolverInterface.hpp
 	opm/core/linalg/LinearSolverIstl.hpp
@@ -264,6 +289,7 @@ list (APPEND PUBLIC_HEADER_FILES
 	opm/core/pressure/msmfem/ifsh_ms.h
 	opm/core/pressure/msmfem/partition.h
 	opm/core/pressure/tpfa/cfs_tpfa.h
+	opm/core/pressure/tpfa/cfs_tpfa_dense.h
 	opm/core/pressure/tpfa/cfs_tpfa_residual.h
 	opm/core/pressure/tpfa/compr_bc.h
 	opm/core/pressure/tpfa/compr_quant.h
@@ -300,6 +326,7 @@ list (APPEND PUBLIC_HEADER_FILES
 	opm/core/props/satfunc/SaturationPropsFromDeck.hpp
 	opm/core/props/satfunc/SaturationPropsFromDeck_impl.hpp
 	opm/core/props/satfunc/SaturationPropsInterface.hpp
+	opm/core/simulator/AdaptiveTimeStepControl.hpp
 	opm/core/simulator/BlackoilState.hpp
 	opm/core/simulator/SimulatorCompressibleTwophase.hpp
 	opm/core/simulator/SimulatorIncompTwophase.hpp
@@ -312,6 +339,7 @@ list (APPEND PUBLIC_HEADER_FILES
 	opm/core/tof/DGBasis.hpp
 	opm/core/tof/TofReorder.hpp
 	opm/core/tof/TofDiscGalReorder.hpp
+	opm/core/tof/StreamlineTracer.hpp
 	opm/core/transport/TransportSolverTwophaseInterface.hpp
 	opm/core/transport/implicit/CSRMatrixBlockAssembler.hpp
 	opm/core/transport/implicit/CSRMatrixUmfpackSolver.hpp
@@ -343,6 +371,7 @@ list (APPEND PUBLIC_HEADER_FILES
 	opm/core/utility/NonuniformTableLinear.hpp
 	opm/core/utility/NullStream.hpp
 	opm/core/utility/PolynomialUtils.hpp
+	opm/core/utility/Profiler.hpp
 	opm/core/utility/RootFinders.hpp
 	opm/core/utility/SparseTable.hpp
 	opm/core/utility/SparseVector.hpp
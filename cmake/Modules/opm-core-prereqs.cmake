@@ -5,6 +5,7 @@
 set (opm-core_CONFIG_VAR
 	HAVE_ERT
 	HAVE_SUITESPARSE_UMFPACK_H
+	HAVE_ZLIB
 	)
 
 # dependencies
@@ -25,6 +26,8 @@ set (opm-core_DEPS
 	"SuperLU"
 	# xml processing (for config parsing)
 	"TinyXML"
+	# compression of binary state output
+	"ZLIB"
 	# Ensembles-based Reservoir Tools (ERT)
 	"ERT"
 	# DUNE dependency
@@ -0,0 +1,612 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Times the core kernels on synthetic Cartesian problems of several
+// sizes, and optionally on a deck, and writes the results as JSON
+// (or CSV) so that they can be compared between commits. The
+// problems are fully deterministic: a quarter five-spot like source
+// and sink in opposite corners of an n x n x n grid, with default
+// rock and fluid properties. The same problems are also run end to end
+// with the two-phase simulators. Run with "make benchmark", or directly:
+//
+//     benchmark_kernels sizes=10,20,40 repeats=5 label=<commit> output=bench.json
+//
+// Parameters:
+//     sizes ("10,20,40")       grid sizes n, each giving an n^3 grid
+//     repeats (5)              number of timed runs of each kernel
+//     label ("")               free text stored with the results,
+//                              such as a commit id
+//     output ("benchmark.json") result file, CSV if it ends with .csv
+//     dg_degree (1)            degree of the discontinuous Galerkin
+//                              time-of-flight solver
+//     sim_steps (5)            number of 10 day steps of the simulator runs
+//     deck_filename            optional deck, for timing the parser and
+//                              the property evaluation of its grid
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <opm/core/grid.h>
+#include <opm/core/grid/cart_grid.h>
+#include <opm/core/grid/GridManager.hpp>
+#include <opm/core/io/eclipse/EclipseGridParser.hpp>
+#include <opm/core/linalg/LinearSolverFactory.hpp>
+#include <opm/core/linalg/sparse_sys.h>
+#include <opm/core/pressure/FlowBCManager.hpp>
+#include <opm/core/pressure/IncompTpfa.hpp>
+#include <opm/core/pressure/tpfa/ifs_tpfa.h>
+#include <opm/core/pressure/tpfa/trans_tpfa.h>
+#include <opm/core/props/BlackoilPropertiesBasic.hpp>
+#include <opm/core/props/BlackoilPropertiesFromDeck.hpp>
+#include <opm/core/props/IncompPropertiesBasic.hpp>
+#include <opm/core/simulator/BlackoilState.hpp>
+#include <opm/core/simulator/SimulatorCompressibleTwophase.hpp>
+#include <opm/core/simulator/SimulatorIncompTwophase.hpp>
+#include <opm/core/simulator/SimulatorReport.hpp>
+#include <opm/core/simulator/SimulatorTimer.hpp>
+#include <opm/core/simulator/TwophaseState.hpp>
+#include <opm/core/simulator/WellState.hpp>
+#include <opm/core/simulator/initState.hpp>
+#include <opm/core/tof/TofDiscGalReorder.hpp>
+#include <opm/core/tof/TofReorder.hpp>
+#include <opm/core/transport/reorder/TransportSolverTwophaseReorder.hpp>
+#include <opm/core/utility/ErrorMacros.hpp>
+#include <opm/core/utility/StopWatch.hpp>
+#include <opm/core/utility/Units.hpp>
+#include <opm/core/utility/miscUtilities.hpp>
+#include <opm/core/utility/parameters/ParameterGroup.hpp>
+#include <opm/core/wells.h>
+#include <opm/core/wells/WellsManager.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+
+    struct Result
+    {
+        std::string kernel;
+        std::string problem;
+        int cells;
+        std::vector<double> seconds;
+
+        double min() const { return *std::min_element(seconds.begin(), seconds.end()); }
+        double mean() const { return std::accumulate(seconds.begin(), seconds.end(), 0.0)/seconds.size(); }
+        double median() const
+        {
+            std::vector<double> s(seconds);
+            std::sort(s.begin(), s.end());
+            const int n = s.size();
+            return n % 2 ? s[n/2] : 0.5*(s[n/2 - 1] + s[n/2]);
+        }
+    };
+
+
+    // Collects the timings of the repeated runs of one kernel.
+    class Timing
+    {
+    public:
+        Timing(std::vector<Result>& results, const std::string& kernel,
+               const std::string& problem, const int cells)
+            : results_(results)
+        {
+            res_.kernel = kernel;
+            res_.problem = problem;
+            res_.cells = cells;
+        }
+        ~Timing()
+        {
+            if (!res_.seconds.empty()) {
+                std::cout << std::left << std::setw(28) << res_.kernel
+                          << std::setw(14) << res_.problem
+                          << std::right << std::setw(10) << res_.cells
+                          << std::setw(14) << res_.min()
+                          << std::setw(14) << res_.median() << std::endl;
+                results_.push_back(res_);
+            }
+        }
+        void start() { clock_.start(); }
+        void stop()
+        {
+            clock_.stop();
+            res_.seconds.push_back(clock_.secsSinceStart());
+        }
+    private:
+        std::vector<Result>& results_;
+        Result res_;
+        Opm::time::StopWatch clock_;
+    };
+
+
+    std::vector<int> parseSizes(const std::string& s)
+    {
+        std::vector<int> sizes;
+        std::istringstream is(s);
+        std::string item;
+        while (std::getline(is, item, ',')) {
+            const int n = std::atoi(item.c_str());
+            if (n <= 0) {
+                OPM_THROW(std::runtime_error, "Invalid grid size in sizes: " << item);
+            }
+            sizes.push_back(n);
+        }
+        return sizes;
+    }
+
+
+    std::vector<std::string> linearSolvers()
+    {
+        std::vector<std::string> solvers(1, "amg");
+#if HAVE_DUNE_ISTL
+        solvers.push_back("istl");
+#endif
+#if HAVE_SUITESPARSE_UMFPACK_H
+        solvers.push_back("umfpack");
+#endif
+        return solvers;
+    }
+
+
+    // An empty parameter group, giving the default of every parameter.
+    Opm::parameter::ParameterGroup quietDefaults()
+    {
+        Opm::parameter::ParameterGroup param;
+        param.disableOutput();
+        return param;
+    }
+
+
+    void benchmarkGrids(const int n, const int repeats, std::vector<Result>& results)
+    {
+        std::ostringstream problem;
+        problem << "cart" << n;
+        {
+            Timing t(results, "grid/create_cart3d", problem.str(), n*n*n);
+            for (int r = 0; r < repeats; ++r) {
+                t.start();
+                UnstructuredGrid* g = create_grid_cart3d(n, n, n);
+                t.stop();
+                destroy_grid(g);
+            }
+        }
+        {
+            Timing t(results, "grid/create_hexa3d", problem.str(), n*n*n);
+            for (int r = 0; r < repeats; ++r) {
+                t.start();
+                UnstructuredGrid* g = create_grid_hexa3d(n, n, n, 10.0, 10.0, 2.0);
+                t.stop();
+                destroy_grid(g);
+            }
+        }
+    }
+
+
+    void benchmarkProblem(const UnstructuredGrid& grid,
+                          const std::string& problem,
+                          const Opm::parameter::ParameterGroup& param,
+                          const int repeats,
+                          std::vector<Result>& results)
+    {
+        using namespace Opm;
+        const int nc = grid.number_of_cells;
+        UnstructuredGrid* gg = const_cast<UnstructuredGrid*>(&grid);
+        const parameter::ParameterGroup defaults = quietDefaults();
+        IncompPropertiesBasic props(defaults, grid.dimensions, nc);
+        std::vector<int> allcells(nc);
+        for (int c = 0; c < nc; ++c) {
+            allcells[c] = c;
+        }
+
+        // Injection and production of 0.1 pore volumes per day.
+        std::vector<double> porevol;
+        computePorevolume(grid, props.porosity(), porevol);
+        const double flow = 0.1*std::accumulate(porevol.begin(), porevol.end(), 0.0)/unit::day;
+        std::vector<double> src(nc, 0.0);
+        src[0] = flow;
+        src[nc - 1] = -flow;
+
+        // Transmissibilities and TPFA assembly.
+        std::vector<double> htrans(grid.cell_facepos[nc]);
+        std::vector<double> trans(grid.number_of_faces);
+        {
+            Timing t(results, "tpfa/transmissibility", problem, nc);
+            for (int r = 0; r < repeats; ++r) {
+                t.start();
+                tpfa_htrans_compute(gg, props.permeability(), &htrans[0]);
+                tpfa_trans_compute(gg, &htrans[0], &trans[0]);
+                t.stop();
+            }
+        }
+        std::vector<double> totmob(nc, 1.0/props.viscosity()[0]);
+        std::vector<double> gpress(grid.cell_facepos[nc], 0.0);
+        ifs_tpfa_forces forces;
+        forces.src = &src[0];
+        forces.bc = NULL;
+        forces.W = NULL;
+        forces.totmob = &totmob[0];
+        forces.wdp = NULL;
+        ifs_tpfa_data* h = ifs_tpfa_construct(gg, NULL);
+        {
+            Timing t(results, "tpfa/assemble", problem, nc);
+            for (int r = 0; r < repeats; ++r) {
+                t.start();
+                const int ok = ifs_tpfa_assemble(gg, &forces, &trans[0], &gpress[0], h);
+                t.stop();
+                if (!ok) {
+                    ifs_tpfa_destroy(h);
+                    OPM_THROW(std::runtime_error, "Failed assembling pressure system.");
+                }
+            }
+        }
+
+        // Linear solvers on the assembled system.
+        const std::vector<std::string> solvers = linearSolvers();
+        for (std::size_t s = 0; s < solvers.size(); ++s) {
+            parameter::ParameterGroup lsparam = quietDefaults();
+            lsparam.insertParameter("linsolver", solvers[s]);
+            LinearSolverFactory linsolver(lsparam);
+            Timing t(results, "linsolve/" + solvers[s], problem, nc);
+            for (int r = 0; r < repeats; ++r) {
+                std::fill(h->x, h->x + h->A->m, 0.0);
+                t.start();
+                linsolver.solve(h->A, h->b, h->x);
+                t.stop();
+            }
+        }
+        ifs_tpfa_destroy(h);
+
+        // Full pressure solve, giving the fluxes for the transport kernels.
+        LinearSolverFactory linsolver(defaults);
+        IncompTpfa psolver(grid, props, 0, linsolver, 0.0, 0.0, 0, 0, 0, src, 0);
+        TwophaseState state;
+        state.init(grid, 2);
+        state.setFirstSat(allcells, props, TwophaseState::MinSat);
+        WellState well_state;
+        well_state.init(0, state);
+        {
+            Timing t(results, "pressure/incomp_tpfa", problem, nc);
+            for (int r = 0; r < repeats; ++r) {
+                t.start();
+                psolver.solve(unit::day, state, well_state);
+                t.stop();
+            }
+        }
+        std::vector<double> transport_src;
+        computeTransportSource(grid, src, state.faceflux(), 1.0, 0, well_state.perfRates(), transport_src);
+
+        // Reorder transport, from the same initial state every time.
+        {
+            TransportSolverTwophaseReorder tsolver(grid, props, 0, 1e-9, 30);
+            const std::vector<double> initial_sat = state.saturation();
+            Timing t(results, "transport/reorder", problem, nc);
+            for (int r = 0; r < repeats; ++r) {
+                state.saturation() = initial_sat;
+                t.start();
+                tsolver.solve(&porevol[0], &transport_src[0], 10.0*unit::day, state);
+                t.stop();
+            }
+        }
+
+        // Time-of-flight.
+        std::vector<double> tof;
+        {
+            TofReorder tofsolver(grid);
+            Timing t(results, "tof/reorder", problem, nc);
+            for (int r = 0; r < repeats; ++r) {
+                t.start();
+                tofsolver.solveTof(&state.faceflux()[0], &porevol[0], &transport_src[0], tof);
+                t.stop();
+            }
+        }
+        {
+            parameter::ParameterGroup dgparam = quietDefaults();
+            std::ostringstream degree;
+            degree << param.getDefault("dg_degree", 1);
+            dgparam.insertParameter("dg_degree", degree.str());
+            TofDiscGalReorder tofsolver(grid, dgparam);
+            Timing t(results, "tof/discgal_reorder", problem, nc);
+            for (int r = 0; r < repeats; ++r) {
+                t.start();
+                tofsolver.solveTof(&state.faceflux()[0], &porevol[0], &transport_src[0], tof);
+                t.stop();
+            }
+        }
+
+        // Property evaluation.
+        {
+            std::vector<double> kr(2*nc), dkrds(4*nc);
+            Timing t(results, "props/incomp_relperm", problem, nc);
+            for (int r = 0; r < repeats; ++r) {
+                t.start();
+                props.relperm(nc, &state.saturation()[0], &allcells[0], &kr[0], &dkrds[0]);
+                t.stop();
+            }
+        }
+    }
+
+
+    // End-to-end runs of the incompressible and compressible two-phase
+    // simulators, with no file output. The incompressible run uses the
+    // same source and sink as benchmarkProblem(). The compressible
+    // simulator does not use source terms, so it is driven by a
+    // bhp-controlled injector and producer in the same cells instead.
+    // Each run starts from the same initial state, and the simulator
+    // construction is part of the timing.
+    void benchmarkSimulators(const UnstructuredGrid& grid,
+                             const std::string& problem,
+                             const Opm::parameter::ParameterGroup& param,
+                             const int repeats,
+                             std::vector<Result>& results)
+    {
+        using namespace Opm;
+        const int nc = grid.number_of_cells;
+        parameter::ParameterGroup simparam = quietDefaults();
+        simparam.insertParameter("output", "false");
+        simparam.insertParameter("quiet", "true");
+        std::ostringstream num_psteps;
+        num_psteps << param.getDefault("sim_steps", 5);
+        simparam.insertParameter("num_psteps", num_psteps.str());
+        simparam.insertParameter("stepsize_days", "10");
+        LinearSolverFactory linsolver(simparam);
+        FlowBCManager bcs;
+
+        {
+            IncompPropertiesBasic props(simparam, grid.dimensions, nc);
+            std::vector<double> porevol;
+            computePorevolume(grid, props.porosity(), porevol);
+            const double flow = 0.1*std::accumulate(porevol.begin(), porevol.end(), 0.0)/unit::day;
+            std::vector<double> src(nc, 0.0);
+            src[0] = flow;
+            src[nc - 1] = -flow;
+            WellsManager wells; // no wells.
+            Timing t(results, "sim/incomp_twophase", problem, nc);
+            for (int r = 0; r < repeats; ++r) {
+                TwophaseState state;
+                initStateBasic(grid, props, simparam, 0.0, state);
+                WellState well_state;
+                well_state.init(wells.c_wells(), state);
+                SimulatorTimer timer;
+                timer.init(simparam);
+                t.start();
+                SimulatorIncompTwophase simulator(simparam, grid, props, 0, wells,
+                                                  src, bcs.c_bcs(), linsolver, 0);
+                simulator.run(timer, state, well_state);
+                t.stop();
+            }
+        }
+
+        {
+            BlackoilPropertiesBasic props(simparam, grid.dimensions, nc);
+            std::shared_ptr<Wells> w(create_wells(2, 2, 2), destroy_wells);
+            const int inj_cell = 0;
+            const int prod_cell = nc - 1;
+            const double WI = 4e-13;
+            const double ifrac[] = { 1.0, 0.0 };
+            const double pfrac[] = { 1.0, 1.0 };
+            add_well(INJECTOR, 0.0, 1, ifrac, &inj_cell, &WI, "INJ", w.get());
+            add_well(PRODUCER, 0.0, 1, pfrac, &prod_cell, &WI, "PROD", w.get());
+            append_well_controls(BHP, 200.0*unit::barsa, NULL, 0, w.get());
+            append_well_controls(BHP, 50.0*unit::barsa, NULL, 1, w.get());
+            set_current_control(0, 0, w.get());
+            set_current_control(1, 0, w.get());
+            WellsManager wells(w.get());
+            const std::vector<double> src(nc, 0.0);
+            Timing t(results, "sim/compressible_twophase", problem, nc);
+            for (int r = 0; r < repeats; ++r) {
+                BlackoilState state;
+                initStateBasic(grid, props, simparam, 0.0, state);
+                initBlackoilSurfvol(grid, props, state);
+                WellState well_state;
+                well_state.init(wells.c_wells(), state);
+                SimulatorTimer timer;
+                timer.init(simparam);
+                t.start();
+                SimulatorCompressibleTwophase simulator(simparam, grid, props, 0, wells,
+                                                        src, bcs.c_bcs(), linsolver, 0);
+                simulator.run(timer, state, well_state);
+                t.stop();
+            }
+        }
+    }
+
+
+    // PVT and relative permeability evaluation in all cells, with
+    // the derivatives used by CompressibleTpfa, at pressures ranging
+    // from 100 to 300 bar.
+    void benchmarkBlackoilProps(const Opm::BlackoilPropertiesInterface& props,
+                                const std::string& problem,
+                                const int repeats,
+                                std::vector<Result>& results)
+    {
+        const int nc = props.numCells();
+        const int np = props.numPhases();
+        std::vector<int> cells(nc);
+        std::vector<double> p(nc), z(nc*np, 1.0), s(nc*np, 1.0/np);
+        for (int c = 0; c < nc; ++c) {
+            cells[c] = c;
+            p[c] = (100.0 + 200.0*c/std::max(nc - 1, 1))*Opm::unit::barsa;
+        }
+        std::vector<double> mu(nc*np), A(nc*np*np), dA(nc*np*np);
+        std::vector<double> kr(nc*np), dkr(nc*np*np);
+        {
+            Timing t(results, "props/pvt", problem, nc);
+            for (int r = 0; r < repeats; ++r) {
+                t.start();
+                props.viscosity(nc, &p[0], &z[0], &cells[0], &mu[0], 0);
+                props.matrix(nc, &p[0], &z[0], &cells[0], &A[0], &dA[0]);
+                t.stop();
+            }
+        }
+        {
+            Timing t(results, "props/relperm", problem, nc);
+            for (int r = 0; r < repeats; ++r) {
+                t.start();
+                props.relperm(nc, &s[0], &cells[0], &kr[0], &dkr[0]);
+                t.stop();
+            }
+        }
+    }
+
+
+    void benchmarkDeck(const std::string& deck_filename,
+                       const int repeats,
+                       std::vector<Result>& results)
+    {
+        using namespace Opm;
+        const std::string problem = "deck";
+        std::unique_ptr<EclipseGridParser> deck;
+        {
+            Timing t(results, "deck/parse", problem, 0);
+            for (int r = 0; r < repeats; ++r) {
+                t.start();
+                deck.reset(new EclipseGridParser(deck_filename));
+                t.stop();
+            }
+        }
+        std::unique_ptr<GridManager> grid;
+        {
+            Timing t(results, "deck/grid", problem, 0);
+            for (int r = 0; r < repeats; ++r) {
+                grid.reset();
+                t.start();
+                grid.reset(new GridManager(*deck));
+                t.stop();
+            }
+        }
+        // Decks with a grid but no fluid description, such as the ones
+        // used by the unit tests, only give the parser and grid timings.
+        if (!deck->hasField("OIL") && !deck->hasField("WATER") && !deck->hasField("GAS")) {
+            return;
+        }
+        const int nc = grid->c_grid()->number_of_cells;
+        std::unique_ptr<BlackoilPropertiesFromDeck> props;
+        {
+            Timing t(results, "deck/props", problem, nc);
+            for (int r = 0; r < repeats; ++r) {
+                props.reset();
+                t.start();
+                props.reset(new BlackoilPropertiesFromDeck(*deck, *grid->c_grid()));
+                t.stop();
+            }
+        }
+        benchmarkBlackoilProps(*props, problem, repeats, results);
+    }
+
+
+    void writeJson(std::ostream& os, const std::string& label, const int repeats,
+                   const std::vector<Result>& results)
+    {
+        os.precision(9);
+        os << "{\n  \"label\": \"" << label << "\",\n"
+           << "  \"repeats\": " << repeats << ",\n"
+           << "  \"results\": [";
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            os << (i == 0 ? "\n" : ",\n")
+               << "    { \"kernel\": \"" << r.kernel << "\""
+               << ", \"problem\": \"" << r.problem << "\""
+               << ", \"cells\": " << r.cells
+               << ", \"min_seconds\": " << r.min()
+               << ", \"median_seconds\": " << r.median()
+               << ", \"mean_seconds\": " << r.mean() << " }";
+        }
+        os << (results.empty() ? "]\n}\n" : "\n  ]\n}\n");
+    }
+
+
+    void writeCsv(std::ostream& os, const std::string& label,
+                  const std::vector<Result>& results)
+    {
+        os.precision(9);
+        os << "label,kernel,problem,cells,min_seconds,median_seconds,mean_seconds\n";
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            os << label << ',' << r.kernel << ',' << r.problem << ',' << r.cells << ','
+               << r.min() << ',' << r.median() << ',' << r.mean() << '\n';
+        }
+    }
+
+} // anon namespace
+
+
+
+// ----------------- Main program -----------------
+int
+main(int argc, char** argv)
+try
+{
+    using namespace Opm;
+
+    parameter::ParameterGroup param(argc, argv, false);
+    const std::vector<int> sizes = parseSizes(param.getDefault<std::string>("sizes", "10,20,40"));
+    const int repeats = param.getDefault("repeats", 5);
+    const std::string label = param.getDefault<std::string>("label", "");
+    const std::string output = param.getDefault<std::string>("output", "benchmark.json");
+    if (repeats < 1) {
+        OPM_THROW(std::runtime_error, "repeats must be positive, got " << repeats);
+    }
+
+    std::cout << std::left << std::setw(28) << "kernel" << std::setw(14) << "problem"
+              << std::right << std::setw(10) << "cells" << std::setw(14) << "min (s)"
+              << std::setw(14) << "median (s)" << std::endl;
+    std::vector<Result> results;
+    for (std::size_t i = 0; i < sizes.size(); ++i) {
+        const int n = sizes[i];
+        benchmarkGrids(n, repeats, results);
+        GridManager grid(n, n, n, 10.0, 10.0, 2.0);
+        std::ostringstream problem;
+        problem << "cart" << n;
+        benchmarkProblem(*grid.c_grid(), problem.str(), param, repeats, results);
+        const parameter::ParameterGroup defaults = quietDefaults();
+        BlackoilPropertiesBasic props(defaults, 3, grid.c_grid()->number_of_cells);
+        benchmarkBlackoilProps(props, problem.str(), repeats, results);
+        benchmarkSimulators(*grid.c_grid(), problem.str(), param, repeats, results);
+    }
+    if (param.has("deck_filename")) {
+        benchmarkDeck(param.get<std::string>("deck_filename"), repeats, results);
+    }
+
+    std::ofstream os(output.c_str());
+    if (!os) {
+        OPM_THROW(std::runtime_error, "Failed to open " << output);
+    }
+    const std::string csv = ".csv";
+    if (output.size() >= csv.size()
+        && output.compare(output.size() - csv.size(), csv.size(), csv) == 0) {
+        writeCsv(os, label, results);
+    } else {
+        writeJson(os, label, repeats, results);
+    }
+    std::cout << "Results written to " << output << std::endl;
+}
+catch (const std::exception &e) {
+    std::cerr << "Program threw an exception: " << e.what() << "\n";
+    throw;
+}
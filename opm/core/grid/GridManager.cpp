@@ -61,6 +61,18 @@ namespace Opm
 
 
 
+    /// Construct a 3d corner-point grid from a corner-point specification.
+    GridManager::GridManager(const struct grdecl& input, double tol)
+    {
+        ug_ = create_grid_cornerpoint(&input, tol);
+        if (!ug_) {
+            OPM_THROW(std::runtime_error, "Failed to construct grid.");
+        }
+    }
+
+
+
+
     /// Construct a 2d cartesian grid with cells of unit size.
     GridManager::GridManager(int nx, int ny)
     {
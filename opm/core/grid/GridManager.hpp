@@ -23,6 +23,7 @@
 #include <string>
 
 struct UnstructuredGrid;
+struct grdecl;
 
 
 namespace Opm
@@ -44,6 +45,11 @@ namespace Opm
         /// Construct a 3d corner-point grid or tensor grid from a deck.
         GridManager(const Opm::EclipseGridParser& deck);
 
+        /// Construct a 3d corner-point grid from a corner-point specification.
+        /// \param[in] input  Corner-point specification, see create_grid_cornerpoint().
+        /// \param[in] tol    Absolute tolerance of node-coincidence.
+        GridManager(const struct grdecl& input, double tol = 0.0);
+
         /// Construct a 2d cartesian grid with cells of unit size.
         GridManager(int nx, int ny);
 
@@ -0,0 +1,380 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+#include <opm/core/io/AsyncOutputWriter.hpp>
+
+#include <opm/core/io/StateFile.hpp>
+#include <opm/core/io/vtk/writeVtkData.hpp>
+#include <opm/core/simulator/TwophaseState.hpp>
+#include <opm/core/simulator/BlackoilState.hpp>
+#include <opm/core/utility/DataMap.hpp>
+#include <opm/core/utility/ErrorMacros.hpp>
+#include <opm/core/utility/miscUtilities.hpp>
+#include <opm/core/utility/Profiler.hpp>
+#include <opm/core/grid.h>
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace Opm
+{
+
+    namespace
+    {
+
+        // The fields of one output step, copied from the state.
+        struct Snapshot
+        {
+            int step;
+            std::vector<double> saturation;
+            std::vector<double> pressure;
+            std::vector<double> faceflux;
+            std::vector<double> surfacevol;
+            bool has_surfacevol;
+            std::string extra_name;
+            std::vector<int> extra;
+        };
+
+        boost::filesystem::path createDirectory(const std::string& dir)
+        {
+            boost::filesystem::path fpath(dir);
+            try {
+                create_directories(fpath);
+            }
+            catch (...) {
+                OPM_THROW(std::runtime_error, "Creating directories failed: " << fpath);
+            }
+            return fpath;
+        }
+
+        template <typename T>
+        void writeMatlab(const std::string& output_dir,
+                         const std::string& name,
+                         const int step,
+                         const std::vector<T>& data,
+                         const int precision)
+        {
+            std::ostringstream fname;
+            fname << output_dir << "/" << name;
+            createDirectory(fname.str());
+            fname << "/" << std::setw(3) << std::setfill('0') << step << ".txt";
+            std::ofstream file(fname.str().c_str());
+            if (!file) {
+                OPM_THROW(std::runtime_error, "Failed to open " << fname.str());
+            }
+            if (precision > 0) {
+                file.precision(precision);
+            }
+            std::copy(data.begin(), data.end(), std::ostream_iterator<double>(file, "\n"));
+        }
+
+        void writeSnapshot(const UnstructuredGrid& grid,
+                           const std::string& output_dir,
+                           const bool output_vtk,
+                           StateFileWriter* state_file,
+                           const Snapshot& s)
+        {
+            OPM_PROFILE_SCOPE("io/write_snapshot");
+            std::vector<double> cell_velocity;
+            Opm::estimateCellVelocity(grid, s.faceflux, cell_velocity);
+            Opm::DataMap dm;
+            dm["saturation"] = &s.saturation;
+            dm["pressure"] = &s.pressure;
+            dm["velocity"] = &cell_velocity;
+
+            // Write data in VTK format.
+            if (output_vtk) {
+                std::ostringstream vtkfilename;
+                vtkfilename << output_dir << "/vtk_files";
+                createDirectory(vtkfilename.str());
+                vtkfilename << "/output-" << std::setw(3) << std::setfill('0') << s.step << ".vtu";
+                std::ofstream vtkfile(vtkfilename.str().c_str());
+                if (!vtkfile) {
+                    OPM_THROW(std::runtime_error, "Failed to open " << vtkfilename.str());
+                }
+                Opm::writeVtkData(grid, dm, vtkfile);
+            }
+
+            if (s.has_surfacevol) {
+                dm["surfvolume"] = &s.surfacevol;
+            }
+
+            // Write data (not grid) to the binary state file.
+            if (state_file) {
+                for (Opm::DataMap::const_iterator it = dm.begin(); it != dm.end(); ++it) {
+                    state_file->write(s.step, it->first, *(it->second));
+                }
+                if (!s.extra_name.empty()) {
+                    state_file->write(s.step, s.extra_name, s.extra);
+                }
+                return;
+            }
+
+            // Write data (not grid) in Matlab format
+            for (Opm::DataMap::const_iterator it = dm.begin(); it != dm.end(); ++it) {
+                writeMatlab(output_dir, it->first, s.step, *(it->second), 15);
+            }
+            if (!s.extra_name.empty()) {
+                writeMatlab(output_dir, s.extra_name, s.step, s.extra, 0);
+            }
+        }
+
+    } // anonymous namespace
+
+
+
+    struct AsyncOutputWriter::Impl
+    {
+        Impl(const UnstructuredGrid& grid,
+             const std::string& output_dir,
+             const bool output_vtk,
+             const int queue_depth,
+             const Format format,
+             const bool compress)
+            : grid_(grid),
+              output_dir_(output_dir),
+              output_vtk_(output_vtk),
+              asynchronous_(queue_depth > 0),
+              slots_(std::max(queue_depth, 1)),
+              done_(false)
+        {
+            for (int i = 0; i < int(slots_.size()); ++i) {
+                free_.push_back(i);
+            }
+            if (format == Binary) {
+                const boost::filesystem::path dir = createDirectory(output_dir);
+                state_file_.reset(new StateFileWriter((dir / "states.bin").string(), compress));
+            }
+            if (asynchronous_) {
+                thread_ = std::thread(&Impl::run, this);
+            }
+        }
+
+        ~Impl()
+        {
+            if (asynchronous_) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    done_ = true;
+                }
+                work_available_.notify_one();
+                thread_.join();
+            }
+        }
+
+        // Wait for a free snapshot buffer.
+        Snapshot& acquire()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (free_.empty()) {
+                slot_freed_.wait(lock);
+            }
+            throwIfFailed();
+            current_ = free_.front();
+            free_.pop_front();
+            Snapshot& s = slots_[current_];
+            s.has_surfacevol = false;
+            s.extra_name.clear();
+            return s;
+        }
+
+        // Hand the buffer obtained by acquire() to the writer.
+        void submit()
+        {
+            if (!asynchronous_) {
+                try {
+                    writeSnapshot(grid_, output_dir_, output_vtk_, state_file_.get(), slots_[current_]);
+                }
+                catch (...) {
+                    free_.push_back(current_);
+                    throw;
+                }
+                free_.push_back(current_);
+                return;
+            }
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                pending_.push_back(current_);
+            }
+            work_available_.notify_one();
+        }
+
+        void flush()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (free_.size() < slots_.size()) {
+                slot_freed_.wait(lock);
+            }
+            throwIfFailed();
+            // No writing is in progress, so the index may be written.
+            if (state_file_) {
+                state_file_->flush();
+            }
+        }
+
+        // Writer thread.
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            for (;;) {
+                while (pending_.empty() && !done_) {
+                    work_available_.wait(lock);
+                }
+                if (pending_.empty()) {
+                    return;
+                }
+                const int slot = pending_.front();
+                pending_.pop_front();
+                lock.unlock();
+                std::string error;
+                try {
+                    writeSnapshot(grid_, output_dir_, output_vtk_, state_file_.get(), slots_[slot]);
+                }
+                catch (const std::exception& e) {
+                    error = e.what();
+                }
+                catch (...) {
+                    error = "Unknown error.";
+                }
+                lock.lock();
+                if (error_.empty()) {
+                    error_ = error;
+                }
+                free_.push_back(slot);
+                slot_freed_.notify_all();
+            }
+        }
+
+        // Must be called with the mutex locked.
+        void throwIfFailed()
+        {
+            if (!error_.empty()) {
+                const std::string error = error_;
+                error_.clear();
+                OPM_THROW(std::runtime_error, "Writing output failed: " << error);
+            }
+        }
+
+        const UnstructuredGrid& grid_;
+        std::string output_dir_;
+        bool output_vtk_;
+        bool asynchronous_;
+        std::unique_ptr<StateFileWriter> state_file_;
+        std::vector<Snapshot> slots_;
+        std::deque<int> free_;
+        std::deque<int> pending_;
+        int current_;
+        bool done_;
+        std::string error_;
+        std::mutex mutex_;
+        std::condition_variable work_available_;
+        std::condition_variable slot_freed_;
+        std::thread thread_;
+    };
+
+
+
+
+    AsyncOutputWriter::AsyncOutputWriter(const UnstructuredGrid& grid,
+                                         const std::string& output_dir,
+                                         const bool output_vtk,
+                                         const int queue_depth,
+                                         const Format format,
+                                         const bool compress)
+        : pimpl_(new Impl(grid, output_dir, output_vtk, queue_depth, format, compress))
+    {
+    }
+
+
+
+
+    AsyncOutputWriter::~AsyncOutputWriter()
+    {
+        // The Impl destructor lets the writer thread finish all
+        // pending output before joining it.
+    }
+
+
+
+
+    void AsyncOutputWriter::write(const int step, const TwophaseState& state)
+    {
+        OPM_PROFILE_SCOPE("io/output");
+        Snapshot& s = pimpl_->acquire();
+        s.step = step;
+        s.saturation.assign(state.saturation().begin(), state.saturation().end());
+        s.pressure.assign(state.pressure().begin(), state.pressure().end());
+        s.faceflux.assign(state.faceflux().begin(), state.faceflux().end());
+        pimpl_->submit();
+    }
+
+
+
+
+    void AsyncOutputWriter::write(const int step, const TwophaseState& state,
+                                  const std::string& name, const std::vector<int>& field)
+    {
+        OPM_PROFILE_SCOPE("io/output");
+        Snapshot& s = pimpl_->acquire();
+        s.step = step;
+        s.saturation.assign(state.saturation().begin(), state.saturation().end());
+        s.pressure.assign(state.pressure().begin(), state.pressure().end());
+        s.faceflux.assign(state.faceflux().begin(), state.faceflux().end());
+        s.extra_name = name;
+        s.extra.assign(field.begin(), field.end());
+        pimpl_->submit();
+    }
+
+
+
+
+    void AsyncOutputWriter::write(const int step, const BlackoilState& state)
+    {
+        OPM_PROFILE_SCOPE("io/output");
+        Snapshot& s = pimpl_->acquire();
+        s.step = step;
+        s.saturation.assign(state.saturation().begin(), state.saturation().end());
+        s.pressure.assign(state.pressure().begin(), state.pressure().end());
+        s.faceflux.assign(state.faceflux().begin(), state.faceflux().end());
+        s.surfacevol.assign(state.surfacevol().begin(), state.surfacevol().end());
+        s.has_surfacevol = true;
+        pimpl_->submit();
+    }
+
+
+
+
+    void AsyncOutputWriter::flush()
+    {
+        pimpl_->flush();
+    }
+
+
+} // namespace Opm
@@ -0,0 +1,115 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_ASYNCOUTPUTWRITER_HEADER_INCLUDED
+#define OPM_ASYNCOUTPUTWRITER_HEADER_INCLUDED
+
+#include <memory>
+#include <string>
+#include <vector>
+
+struct UnstructuredGrid;
+
+namespace Opm
+{
+
+    class TwophaseState;
+    class BlackoilState;
+
+    /// Writes simulator states to disk from a background thread.
+    ///
+    /// Each call to write() copies the fields to be output into one
+    /// of a fixed number of preallocated snapshot buffers and returns,
+    /// leaving the formatting and writing of files to a writer thread.
+    /// If all buffers are waiting to be written, write() blocks until
+    /// one is released, which bounds both the memory used and how far
+    /// output may lag behind the simulation.
+    ///
+    /// The files written are the same as those previously written
+    /// inline by the simulators: saturation, pressure and estimated
+    /// cell velocity (and surface volumes for blackoil states) in
+    /// Matlab text format in output_dir/<field>/<step>.txt, and
+    /// optionally all of them in VTK format in
+    /// output_dir/vtk_files/output-<step>.vtu. Instead of the Matlab
+    /// files, all fields of all steps may be written to a single
+    /// binary file output_dir/states.bin, see StateFileWriter.
+    ///
+    /// Errors in the writer thread are reported by throwing from the
+    /// next call to write() or flush().
+    class AsyncOutputWriter
+    {
+    public:
+        /// Output formats for the fields.
+        enum Format { Matlab, Binary };
+
+        /// Construct writer.
+        /// \param[in] grid         Grid, must outlive the writer.
+        /// \param[in] output_dir   Directory to write to.
+        /// \param[in] output_vtk   If true, also write VTK files.
+        /// \param[in] queue_depth  Number of snapshot buffers. If zero,
+        ///                         no thread is started and write()
+        ///                         writes the files before returning.
+        /// \param[in] format       Write Matlab text files or a binary
+        ///                         state file.
+        /// \param[in] compress     Compress the binary state file.
+        AsyncOutputWriter(const UnstructuredGrid& grid,
+                          const std::string& output_dir,
+                          const bool output_vtk,
+                          const int queue_depth = 2,
+                          const Format format = Matlab,
+                          const bool compress = false);
+
+        /// Destructor. Waits for all pending output to be written.
+        ~AsyncOutputWriter();
+
+        /// Queue output of a state.
+        /// \param[in] step         Step number, used in file names.
+        /// \param[in] state        State to write.
+        void write(const int step, const TwophaseState& state);
+
+        /// Queue output of a state, with an extra integer field.
+        /// \param[in] step         Step number, used in file names.
+        /// \param[in] state        State to write.
+        /// \param[in] name         Name of the extra field, not written
+        ///                         in VTK format.
+        /// \param[in] field        Extra field, for example the number
+        ///                         of iterations per cell.
+        void write(const int step, const TwophaseState& state,
+                   const std::string& name, const std::vector<int>& field);
+
+        /// Queue output of a state, including surface volumes.
+        /// \param[in] step         Step number, used in file names.
+        /// \param[in] state        State to write.
+        void write(const int step, const BlackoilState& state);
+
+        /// Wait until all queued output has been written. The binary
+        /// state file, if any, is readable after this.
+        void flush();
+
+    private:
+        AsyncOutputWriter(const AsyncOutputWriter&);
+        AsyncOutputWriter& operator=(const AsyncOutputWriter&);
+
+        struct Impl;
+        std::unique_ptr<Impl> pimpl_;
+    };
+
+} // namespace Opm
+
+#endif // OPM_ASYNCOUTPUTWRITER_HEADER_INCLUDED
@@ -0,0 +1,599 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+#include <opm/core/io/StateFile.hpp>
+
+#include <opm/core/utility/ErrorMacros.hpp>
+
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <map>
+
+namespace Opm
+{
+
+    namespace
+    {
+
+        // File layout:
+        //   header:  magic "OPMSTATE", uint32 version, uint32 byte order mark
+        //   chunks:  raw or compressed values, each starting at a multiple of 8
+        //   index:   magic "OPMINDEX", uint64 number of entries, entries
+        //   trailer: uint64 position of index, magic "OPMSTEND"
+        // Each index entry is uint64 offset, uint64 stored bytes,
+        // uint64 number of values, int32 step, int32 type,
+        // int32 compressed flag, uint32 name length, name.
+        const char header_magic[8] = { 'O', 'P', 'M', 'S', 'T', 'A', 'T', 'E' };
+        const char index_magic[8] = { 'O', 'P', 'M', 'I', 'N', 'D', 'E', 'X' };
+        const char trailer_magic[8] = { 'O', 'P', 'M', 'S', 'T', 'E', 'N', 'D' };
+        const unsigned int format_version = 1;
+        const unsigned int byte_order_mark = 0x01020304u;
+        const unsigned long long header_size = 16;
+        const unsigned long long trailer_size = 16;
+
+        enum FieldType { DoubleField = 0, IntField = 1 };
+
+        template <typename T> int fieldType();
+        template <> int fieldType<double>() { return DoubleField; }
+        template <> int fieldType<int>() { return IntField; }
+
+        int valueSize(const int type)
+        {
+            return type == IntField ? int(sizeof(int)) : int(sizeof(double));
+        }
+
+        struct Entry
+        {
+            unsigned long long offset;
+            unsigned long long stored_bytes;
+            unsigned long long count;
+            int step;
+            int type;
+            int compressed;
+            std::string name;
+        };
+
+        template <typename T>
+        void put(std::ostream& os, const T& value)
+        {
+            os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        template <typename T>
+        void get(std::istream& is, T& value)
+        {
+            is.read(reinterpret_cast<char*>(&value), sizeof(T));
+        }
+
+#if HAVE_ZLIB
+        // Group the bytes of the values by significance.
+        void shuffle(const char* in, const std::size_t count, const int size, char* out)
+        {
+            for (std::size_t i = 0; i < count; ++i) {
+                for (int b = 0; b < size; ++b) {
+                    out[b*count + i] = in[i*size + b];
+                }
+            }
+        }
+
+        void unshuffle(const char* in, const std::size_t count, const int size, char* out)
+        {
+            for (std::size_t i = 0; i < count; ++i) {
+                for (int b = 0; b < size; ++b) {
+                    out[i*size + b] = in[b*count + i];
+                }
+            }
+        }
+#endif
+
+        // Decode a compressed chunk into out, which must have room
+        // for e.count values.
+        void decompress(const Entry& e, const char* stored, char* out)
+        {
+#if HAVE_ZLIB
+            const int size = valueSize(e.type);
+            const std::size_t nbytes = e.count * size;
+            std::vector<char> shuffled(nbytes);
+            uLongf len = nbytes;
+            if (uncompress(reinterpret_cast<Bytef*>(shuffled.empty() ? 0 : &shuffled[0]), &len,
+                           reinterpret_cast<const Bytef*>(stored), e.stored_bytes) != Z_OK
+                || len != nbytes) {
+                OPM_THROW(std::runtime_error, "Corrupt compressed chunk for field "
+                          << e.name << " at step " << e.step);
+            }
+            unshuffle(shuffled.empty() ? 0 : &shuffled[0], e.count, size, out);
+#else
+            static_cast<void>(stored);
+            static_cast<void>(out);
+            OPM_THROW(std::runtime_error, "Field " << e.name << " at step " << e.step
+                      << " is compressed, but opm-core was built without zlib.");
+#endif
+        }
+
+    } // anonymous namespace
+
+
+
+
+    struct StateFileWriter::Impl
+    {
+        std::string filename;
+        std::fstream file;
+        bool compress;
+        std::vector<Entry> index;
+        std::vector<char> shuffled;
+        std::vector<char> compressed;
+        unsigned long long end_of_data;
+
+        void writeChunk(const int step, const std::string& name, const int type,
+                        const char* data, const std::size_t count);
+    };
+
+
+
+
+    StateFileWriter::StateFileWriter(const std::string& filename, const bool compress)
+        : pimpl_(new Impl)
+    {
+#if !HAVE_ZLIB
+        if (compress) {
+            OPM_THROW(std::runtime_error, "Cannot compress " << filename
+                      << ", opm-core was built without zlib.");
+        }
+#endif
+        pimpl_->filename = filename;
+        pimpl_->compress = compress;
+        pimpl_->file.open(filename.c_str(), std::ios::in | std::ios::out
+                          | std::ios::trunc | std::ios::binary);
+        if (!pimpl_->file) {
+            OPM_THROW(std::runtime_error, "Failed to open " << filename);
+        }
+        pimpl_->file.write(header_magic, sizeof(header_magic));
+        put(pimpl_->file, format_version);
+        put(pimpl_->file, byte_order_mark);
+        pimpl_->end_of_data = header_size;
+        flush();
+    }
+
+
+
+
+    StateFileWriter::~StateFileWriter()
+    {
+        try {
+            close();
+        }
+        catch (...) {
+            // Do not throw from the destructor, call close() to get
+            // errors reported.
+        }
+    }
+
+
+
+
+    void StateFileWriter::write(const int step, const std::string& name,
+                                const std::vector<double>& data)
+    {
+        pimpl_->writeChunk(step, name, DoubleField,
+                           data.empty() ? 0 : reinterpret_cast<const char*>(&data[0]), data.size());
+    }
+
+
+
+
+    void StateFileWriter::write(const int step, const std::string& name,
+                                const std::vector<int>& data)
+    {
+        pimpl_->writeChunk(step, name, IntField,
+                           data.empty() ? 0 : reinterpret_cast<const char*>(&data[0]), data.size());
+    }
+
+
+
+
+    void StateFileWriter::Impl::writeChunk(const int step, const std::string& name, const int type,
+                                           const char* data, const std::size_t count)
+    {
+        Impl& w = *this;
+        if (!w.file.is_open()) {
+            OPM_THROW(std::runtime_error, "Writing to closed file " << w.filename);
+        }
+        const int size = valueSize(type);
+        Entry e;
+        e.offset = w.end_of_data;
+        e.stored_bytes = count * size;
+        e.count = count;
+        e.step = step;
+        e.type = type;
+        e.compressed = 0;
+        e.name = name;
+        const char* stored = data;
+#if HAVE_ZLIB
+        if (w.compress && count > 0) {
+            w.shuffled.resize(count * size);
+            shuffle(data, count, size, &w.shuffled[0]);
+            uLongf len = compressBound(count * size);
+            w.compressed.resize(len);
+            if (compress2(reinterpret_cast<Bytef*>(&w.compressed[0]), &len,
+                          reinterpret_cast<const Bytef*>(&w.shuffled[0]), count * size,
+                          Z_BEST_SPEED) != Z_OK) {
+                OPM_THROW(std::runtime_error, "Compression failed for field " << name);
+            }
+            if (len < e.stored_bytes) {
+                e.stored_bytes = len;
+                e.compressed = 1;
+                stored = &w.compressed[0];
+            }
+        }
+#endif
+        w.file.seekp(w.end_of_data);
+        w.file.write(stored, e.stored_bytes);
+        const unsigned long long padding = (8 - e.stored_bytes % 8) % 8;
+        const char zeros[8] = { 0 };
+        w.file.write(zeros, padding);
+        if (!w.file) {
+            OPM_THROW(std::runtime_error, "Failed writing to " << w.filename);
+        }
+        w.end_of_data += e.stored_bytes + padding;
+        w.index.push_back(e);
+    }
+
+
+
+
+    void StateFileWriter::flush()
+    {
+        Impl& w = *pimpl_;
+        if (!w.file.is_open()) {
+            return;
+        }
+        w.file.seekp(w.end_of_data);
+        w.file.write(index_magic, sizeof(index_magic));
+        put(w.file, static_cast<unsigned long long>(w.index.size()));
+        for (std::size_t i = 0; i < w.index.size(); ++i) {
+            const Entry& e = w.index[i];
+            put(w.file, e.offset);
+            put(w.file, e.stored_bytes);
+            put(w.file, e.count);
+            put(w.file, e.step);
+            put(w.file, e.type);
+            put(w.file, e.compressed);
+            put(w.file, static_cast<unsigned int>(e.name.size()));
+            w.file.write(e.name.data(), e.name.size());
+        }
+        put(w.file, w.end_of_data);
+        w.file.write(trailer_magic, sizeof(trailer_magic));
+        w.file.flush();
+        if (!w.file) {
+            OPM_THROW(std::runtime_error, "Failed writing index to " << w.filename);
+        }
+    }
+
+
+
+
+    void StateFileWriter::close()
+    {
+        if (pimpl_->file.is_open()) {
+            flush();
+            pimpl_->file.close();
+        }
+    }
+
+
+
+
+    bool StateFileWriter::compressionAvailable()
+    {
+#if HAVE_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    }
+
+
+
+
+    struct StateFileReader::Impl
+    {
+        // Entries of one field, by step.
+        struct Field
+        {
+            int type;
+            std::map<int, Entry> chunks;
+        };
+
+        const Entry& chunk(const std::string& name, const int step, const int type) const
+        {
+            const Field& f = field(name);
+            if (f.type != type) {
+                OPM_THROW(std::runtime_error, "Field " << name << " in " << filename
+                          << " is of " << (f.type == IntField ? "integer" : "floating point")
+                          << " type.");
+            }
+            std::map<int, Entry>::const_iterator it = f.chunks.find(step);
+            if (it == f.chunks.end()) {
+                OPM_THROW(std::runtime_error, "Field " << name << " not written for step "
+                          << step << " in " << filename);
+            }
+            return it->second;
+        }
+
+        const Field& field(const std::string& name) const
+        {
+            std::map<std::string, Field>::const_iterator it = fields.find(name);
+            if (it == fields.end()) {
+                OPM_THROW(std::runtime_error, "No field " << name << " in " << filename);
+            }
+            return it->second;
+        }
+
+        void readChunk(const Entry& e, char* out) const
+        {
+            std::ifstream is(filename.c_str(), std::ios::binary);
+            is.seekg(e.offset);
+            if (e.compressed) {
+                std::vector<char> stored(e.stored_bytes);
+                is.read(stored.empty() ? 0 : &stored[0], e.stored_bytes);
+                if (!is) {
+                    OPM_THROW(std::runtime_error, "Failed reading " << filename);
+                }
+                decompress(e, stored.empty() ? 0 : &stored[0], out);
+            } else {
+                is.read(out, e.stored_bytes);
+                if (!is) {
+                    OPM_THROW(std::runtime_error, "Failed reading " << filename);
+                }
+            }
+        }
+
+        // Map the whole file, once.
+        const std::shared_ptr<void>& mapping() const
+        {
+            if (!mapping_) {
+                const int fd = ::open(filename.c_str(), O_RDONLY);
+                if (fd < 0) {
+                    OPM_THROW(std::runtime_error, "Failed to open " << filename);
+                }
+                void* addr = ::mmap(0, file_size, PROT_READ, MAP_SHARED, fd, 0);
+                ::close(fd);
+                if (addr == MAP_FAILED) {
+                    OPM_THROW(std::runtime_error, "Failed to map " << filename);
+                }
+                const std::size_t len = file_size;
+                mapping_.reset(addr, [len](void* p) { ::munmap(p, len); });
+            }
+            return mapping_;
+        }
+
+        std::string filename;
+        unsigned long long file_size;
+        std::map<std::string, Field> fields;
+        mutable std::shared_ptr<void> mapping_;
+    };
+
+
+
+
+    StateFileReader::StateFileReader(const std::string& filename)
+        : pimpl_(new Impl)
+    {
+        pimpl_->filename = filename;
+        std::ifstream is(filename.c_str(), std::ios::binary);
+        if (!is) {
+            OPM_THROW(std::runtime_error, "Failed to open " << filename);
+        }
+        is.seekg(0, std::ios::end);
+        pimpl_->file_size = is.tellg();
+        if (pimpl_->file_size < header_size + trailer_size) {
+            OPM_THROW(std::runtime_error, filename << " is not a state file.");
+        }
+
+        // Header.
+        is.seekg(0);
+        char magic[8];
+        unsigned int version = 0;
+        unsigned int bom = 0;
+        is.read(magic, sizeof(magic));
+        get(is, version);
+        get(is, bom);
+        if (!is || !std::equal(magic, magic + 8, header_magic)) {
+            OPM_THROW(std::runtime_error, filename << " is not a state file.");
+        }
+        if (bom != byte_order_mark) {
+            OPM_THROW(std::runtime_error, filename << " was written with a different byte order.");
+        }
+        if (version != format_version) {
+            OPM_THROW(std::runtime_error, filename << " has unsupported version " << version);
+        }
+
+        // Trailer and index.
+        unsigned long long index_pos = 0;
+        is.seekg(pimpl_->file_size - trailer_size);
+        get(is, index_pos);
+        is.read(magic, sizeof(magic));
+        if (!is || !std::equal(magic, magic + 8, trailer_magic)
+            || index_pos + sizeof(index_magic) > pimpl_->file_size - trailer_size) {
+            OPM_THROW(std::runtime_error, filename << " has no index, it may be incomplete.");
+        }
+        is.seekg(index_pos);
+        unsigned long long n = 0;
+        is.read(magic, sizeof(magic));
+        get(is, n);
+        if (!is || !std::equal(magic, magic + 8, index_magic)) {
+            OPM_THROW(std::runtime_error, filename << " has a corrupt index.");
+        }
+        for (unsigned long long i = 0; i < n; ++i) {
+            Entry e;
+            unsigned int len = 0;
+            get(is, e.offset);
+            get(is, e.stored_bytes);
+            get(is, e.count);
+            get(is, e.step);
+            get(is, e.type);
+            get(is, e.compressed);
+            get(is, len);
+            if (!is || len > index_pos) {
+                OPM_THROW(std::runtime_error, filename << " has a corrupt index.");
+            }
+            e.name.resize(len);
+            is.read(&e.name[0], len);
+            if (!is || (e.type != DoubleField && e.type != IntField)
+                || e.offset + e.stored_bytes > index_pos) {
+                OPM_THROW(std::runtime_error, filename << " has a corrupt index.");
+            }
+            Impl::Field& f = pimpl_->fields[e.name];
+            if (f.chunks.empty()) {
+                f.type = e.type;
+            } else if (f.type != e.type) {
+                OPM_THROW(std::runtime_error, "Field " << e.name << " in " << filename
+                          << " is written with different types.");
+            }
+            // A field written twice for a step: the last one wins.
+            f.chunks[e.step] = e;
+        }
+    }
+
+
+
+
+    StateFileReader::~StateFileReader()
+    {
+    }
+
+
+
+
+    std::vector<std::string> StateFileReader::fieldNames() const
+    {
+        std::vector<std::string> names;
+        std::map<std::string, Impl::Field>::const_iterator it = pimpl_->fields.begin();
+        for (; it != pimpl_->fields.end(); ++it) {
+            names.push_back(it->first);
+        }
+        return names;
+    }
+
+
+
+
+    std::vector<int> StateFileReader::steps(const std::string& name) const
+    {
+        std::vector<int> s;
+        std::map<std::string, Impl::Field>::const_iterator f = pimpl_->fields.find(name);
+        if (f != pimpl_->fields.end()) {
+            std::map<int, Entry>::const_iterator it = f->second.chunks.begin();
+            for (; it != f->second.chunks.end(); ++it) {
+                s.push_back(it->first);
+            }
+        }
+        return s;
+    }
+
+
+
+
+    bool StateFileReader::hasField(const std::string& name, const int step) const
+    {
+        std::map<std::string, Impl::Field>::const_iterator f = pimpl_->fields.find(name);
+        return f != pimpl_->fields.end() && f->second.chunks.count(step) > 0;
+    }
+
+
+
+
+    bool StateFileReader::isIntField(const std::string& name) const
+    {
+        return pimpl_->field(name).type == IntField;
+    }
+
+
+
+
+    void StateFileReader::read(const std::string& name, const int step,
+                               std::vector<double>& data) const
+    {
+        const Entry& e = pimpl_->chunk(name, step, DoubleField);
+        data.resize(e.count);
+        pimpl_->readChunk(e, data.empty() ? 0 : reinterpret_cast<char*>(&data[0]));
+    }
+
+
+
+
+    void StateFileReader::read(const std::string& name, const int step,
+                               std::vector<int>& data) const
+    {
+        const Entry& e = pimpl_->chunk(name, step, IntField);
+        data.resize(e.count);
+        pimpl_->readChunk(e, data.empty() ? 0 : reinterpret_cast<char*>(&data[0]));
+    }
+
+
+
+
+    template <typename T>
+    StateFileReader::MappedField<T> StateFileReader::map(const std::string& name) const
+    {
+        const Impl::Field& f = pimpl_->field(name);
+        if (f.type != fieldType<T>()) {
+            OPM_THROW(std::runtime_error, "Field " << name << " in " << pimpl_->filename
+                      << " is of " << (f.type == IntField ? "integer" : "floating point")
+                      << " type.");
+        }
+        MappedField<T> m;
+        m.mapping_ = pimpl_->mapping();
+        const char* base = static_cast<const char*>(m.mapping_.get());
+        std::map<int, Entry>::const_iterator it = f.chunks.begin();
+        for (; it != f.chunks.end(); ++it) {
+            const Entry& e = it->second;
+            m.steps_.push_back(e.step);
+            m.sizes_.push_back(e.count);
+            if (e.compressed) {
+                m.slot_.push_back(int(m.decompressed_.size()));
+                m.data_.push_back(0);
+                m.decompressed_.push_back(std::vector<T>(e.count));
+                decompress(e, base + e.offset,
+                           reinterpret_cast<char*>(&m.decompressed_.back()[0]));
+            } else {
+                m.slot_.push_back(-1);
+                m.data_.push_back(reinterpret_cast<const T*>(base + e.offset));
+            }
+        }
+        return m;
+    }
+
+    template StateFileReader::MappedField<double> StateFileReader::map<double>(const std::string&) const;
+    template StateFileReader::MappedField<int> StateFileReader::map<int>(const std::string&) const;
+
+
+} // namespace Opm
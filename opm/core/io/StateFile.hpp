@@ -0,0 +1,187 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_STATEFILE_HEADER_INCLUDED
+#define OPM_STATEFILE_HEADER_INCLUDED
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Opm
+{
+
+    /// Binary container for simulator output fields.
+    ///
+    /// A state file holds any number of named fields of doubles or
+    /// ints, each stored once per output step as a separate chunk.
+    /// The file starts with a small header, followed by the chunks in
+    /// the order they were written, each aligned to 8 bytes. An index
+    /// of all chunks (field name, step, type, length and position) is
+    /// written after the chunks when the writer is flushed or closed,
+    /// and the file ends with the position of the index. Data are
+    /// stored in native byte order; the header records it so that a
+    /// mismatch is detected when reading.
+    ///
+    /// Chunks may optionally be compressed with zlib, after the bytes
+    /// of each value have been shuffled so that bytes of equal
+    /// significance are stored together, which makes floating point
+    /// fields compress much better. A chunk that does not shrink is
+    /// stored uncompressed. Compression is only available if opm-core
+    /// was built with zlib.
+    class StateFileWriter
+    {
+    public:
+        /// Create a new state file, overwriting any existing file.
+        /// \param[in] filename     Name of file to create.
+        /// \param[in] compress     If true, compress chunks.
+        StateFileWriter(const std::string& filename, const bool compress = false);
+
+        /// Destructor. Writes the index and closes the file.
+        ~StateFileWriter();
+
+        /// Append a field to the file.
+        /// \param[in] step         Output step.
+        /// \param[in] name         Field name.
+        /// \param[in] data         Field values.
+        void write(const int step, const std::string& name, const std::vector<double>& data);
+
+        /// Append an integer field to the file.
+        /// \param[in] step         Output step.
+        /// \param[in] name         Field name.
+        /// \param[in] data         Field values.
+        void write(const int step, const std::string& name, const std::vector<int>& data);
+
+        /// Write the index, making all chunks written so far readable.
+        /// Writing may continue afterwards.
+        void flush();
+
+        /// Write the index and close the file.
+        void close();
+
+        /// True if compression is available.
+        static bool compressionAvailable();
+
+    private:
+        StateFileWriter(const StateFileWriter&);
+        StateFileWriter& operator=(const StateFileWriter&);
+
+        struct Impl;
+        std::unique_ptr<Impl> pimpl_;
+    };
+
+
+
+
+    /// Reads state files written by StateFileWriter.
+    ///
+    /// The index is read when the file is opened. Single chunks can be
+    /// read into vectors, or a field can be accessed at all steps at
+    /// once through a memory mapping of the file, which avoids reading
+    /// anything except the pages actually touched.
+    class StateFileReader
+    {
+    public:
+        /// A field at all steps it was written for, in increasing step
+        /// order. Uncompressed chunks point directly into a read-only
+        /// memory mapping of the file, compressed chunks are
+        /// decompressed into memory owned by this object. The data
+        /// stay valid as long as this object exists, also after the
+        /// reader is destroyed.
+        template <typename T>
+        class MappedField
+        {
+        public:
+            /// Number of steps the field was written for.
+            int numSteps() const { return int(steps_.size()); }
+            /// Step number of the i'th chunk.
+            int step(const int i) const { return steps_[i]; }
+            /// Number of values of the i'th chunk.
+            std::size_t size(const int i) const { return sizes_[i]; }
+            /// Values of the i'th chunk.
+            const T* data(const int i) const
+            {
+                return slot_[i] < 0 ? data_[i] : &decompressed_[slot_[i]][0];
+            }
+
+        private:
+            friend class StateFileReader;
+            std::shared_ptr<void> mapping_;
+            std::vector<std::vector<T> > decompressed_;
+            std::vector<int> steps_;
+            std::vector<std::size_t> sizes_;
+            std::vector<const T*> data_;
+            std::vector<int> slot_;
+        };
+
+        /// Open a state file and read its index.
+        /// \param[in] filename     Name of file to open.
+        explicit StateFileReader(const std::string& filename);
+
+        /// Destructor.
+        ~StateFileReader();
+
+        /// Names of all fields in the file, sorted.
+        std::vector<std::string> fieldNames() const;
+
+        /// Steps for which a field was written, sorted.
+        /// \param[in] name         Field name.
+        std::vector<int> steps(const std::string& name) const;
+
+        /// True if the field was written for the given step.
+        bool hasField(const std::string& name, const int step) const;
+
+        /// True if the field is of integer type.
+        /// Throws if there is no such field.
+        bool isIntField(const std::string& name) const;
+
+        /// Read a field at one step.
+        /// Throws if the field was not written for the step, or is of
+        /// integer type.
+        /// \param[in] name         Field name.
+        /// \param[in] step         Output step.
+        /// \param[out] data        Field values.
+        void read(const std::string& name, const int step, std::vector<double>& data) const;
+
+        /// Read an integer field at one step.
+        /// Throws if the field was not written for the step, or is not
+        /// of integer type.
+        /// \param[in] name         Field name.
+        /// \param[in] step         Output step.
+        /// \param[out] data        Field values.
+        void read(const std::string& name, const int step, std::vector<int>& data) const;
+
+        /// Access a field at all steps.
+        /// T must be double or int, matching the type of the field.
+        /// \param[in] name         Field name.
+        template <typename T>
+        MappedField<T> map(const std::string& name) const;
+
+    private:
+        StateFileReader(const StateFileReader&);
+        StateFileReader& operator=(const StateFileReader&);
+
+        struct Impl;
+        std::unique_ptr<Impl> pimpl_;
+    };
+
+} // namespace Opm
+
+#endif // OPM_STATEFILE_HEADER_INCLUDED
@@ -21,20 +21,82 @@
 #define OPM_CORNERPOINTCHOPPER_HEADER_INCLUDED
 
 #include <opm/core/io/eclipse/EclipseGridParser.hpp>
+#include <opm/core/io/StateFile.hpp>
+#include <opm/core/grid/GridManager.hpp>
+#include <opm/core/grid/cpgpreprocess/preprocess.h>
 #include <opm/core/utility/parameters/ParameterGroup.hpp>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <vector>
+#include <sstream>
 #include <stdexcept>
 #include <memory>
 
 namespace Opm
 {
 
+    /// Extracts shoe-box shaped sub-models from a corner-point deck.
+    ///
+    /// The deck is parsed once, in the constructor. A single window
+    /// may be extracted with chop(), and then accessed through
+    /// subparser() or writeGrdecl(). For many windows, chopMany(),
+    /// chopToGrids() and writeBinary() extract them in parallel from
+    /// the shared parsed data, without touching the state used by
+    /// chop().
     class CornerPointChopper
     {
     public:
+        /// A window to extract: cells [imin, imax) x [jmin, jmax),
+        /// and the layers within [zmin, zmax].
+        struct Window
+        {
+            Window()
+                : imin(0), imax(0), jmin(0), jmax(0), zmin(0.0), zmax(0.0)
+            {
+            }
+            Window(int i0, int i1, int j0, int j1, double z0, double z1)
+                : imin(i0), imax(i1), jmin(j0), jmax(j1), zmin(z0), zmax(z1)
+            {
+            }
+            int imin, imax, jmin, jmax;
+            double zmin, zmax;
+        };
+
+        /// An extracted sub-model. Property fields not present in the
+        /// original deck are empty.
+        struct SubModel
+        {
+            int dims[3];
+            std::vector<double> COORD;
+            std::vector<double> ZCORN;
+            std::vector<int> ACTNUM;
+            std::vector<double> PORO;
+            std::vector<double> NTG;
+            std::vector<double> PERMX;
+            std::vector<double> PERMY;
+            std::vector<double> PERMZ;
+            std::vector<int> SATNUM;
+            /// Cartesian index in the original grid of each cell.
+            std::vector<int> new_to_old_cell;
+
+            /// Corner-point specification pointing into this sub-model,
+            /// valid as long as it is not modified.
+            struct grdecl grdecl() const
+            {
+                struct grdecl g;
+                for (int dd = 0; dd < 3; ++dd) {
+                    g.dims[dd] = dims[dd];
+                }
+                g.coord = &COORD[0];
+                g.zcorn = &ZCORN[0];
+                g.actnum = ACTNUM.empty() ? 0 : &ACTNUM[0];
+                g.mapaxes = 0;
+                return g;
+            }
+        };
+
         CornerPointChopper(const std::string& file)
             : parser_(file, false)
         {
@@ -51,6 +113,16 @@ namespace Opm
             abszmax_ = *std::max_element(ZCORN.begin(), ZCORN.end());
             abszmin_ = *std::min_element(ZCORN.begin(), ZCORN.end());
 
+            // Depth range of each layer, used to find the layers of a window.
+            layer_zmin_.resize(dims_[2]);
+            layer_zmax_.resize(dims_[2]);
+            if (int(ZCORN.size()) >= layersz*dims_[2]) {
+                for (int k = 0; k < dims_[2]; ++k) {
+                    layer_zmin_[k] = *std::min_element(ZCORN.begin() + k*layersz, ZCORN.begin() + (k + 1)*layersz);
+                    layer_zmax_[k] = *std::max_element(ZCORN.begin() + k*layersz, ZCORN.begin() + (k + 1)*layersz);
+                }
+            }
+
             std::cout << "Parsed grdecl file with dimensions ("
                       << dims_[0] << ", " << dims_[1] << ", " << dims_[2] << ")" << std::endl;
         }
@@ -68,7 +140,7 @@ namespace Opm
 
         const int* newDimensions() const
         {
-            return new_dims_;
+            return current_.dims;
         }
 
 
@@ -129,8 +201,233 @@ namespace Opm
 
         void chop(int imin, int imax, int jmin, int jmax, double zmin, double zmax, bool resettoorigin=true)
         {
-            new_dims_[0] = imax - imin;
-            new_dims_[1] = jmax - jmin;
+            extract(Window(imin, imax, jmin, jmax, zmin, zmax), resettoorigin, true, current_);
+        }
+
+
+
+        /// Extract many windows in parallel.
+        /// The state used by subparser() and writeGrdecl() is not changed.
+        /// \param[in] windows         Windows to extract.
+        /// \param[in] resettoorigin   If true, translate each sub-model to the origin.
+        /// \param[out] submodels      One sub-model per window.
+        void chopMany(const std::vector<Window>& windows,
+                      std::vector<SubModel>& submodels,
+                      bool resettoorigin=true) const
+        {
+            submodels.clear();
+            submodels.resize(windows.size());
+            const int num_windows = windows.size();
+            std::string error;
+#pragma omp parallel for schedule(dynamic)
+            for (int w = 0; w < num_windows; ++w) {
+                try {
+                    extract(windows[w], resettoorigin, false, submodels[w]);
+                } catch (const std::exception& e) {
+#pragma omp critical (CornerPointChopper_chopMany)
+                    if (error.empty()) {
+                        std::ostringstream msg;
+                        msg << "Window " << w << ": " << e.what();
+                        error = msg.str();
+                    }
+                }
+            }
+            if (!error.empty()) {
+                OPM_THROW(std::runtime_error, error);
+            }
+        }
+
+
+
+        /// Extract many windows in parallel, and construct a grid for each.
+        /// \param[in] windows         Windows to extract.
+        /// \param[out] grids          One grid per window.
+        /// \param[in] tol             Absolute tolerance of node-coincidence.
+        /// \param[in] resettoorigin   If true, translate each sub-model to the origin.
+        void chopToGrids(const std::vector<Window>& windows,
+                         std::vector<std::shared_ptr<GridManager> >& grids,
+                         double tol = 0.0,
+                         bool resettoorigin=true) const
+        {
+            grids.clear();
+            grids.resize(windows.size());
+            const int num_windows = windows.size();
+            std::string error;
+#pragma omp parallel for schedule(dynamic)
+            for (int w = 0; w < num_windows; ++w) {
+                try {
+                    SubModel sub;
+                    extract(windows[w], resettoorigin, false, sub);
+                    const struct grdecl g = sub.grdecl();
+                    grids[w].reset(new GridManager(g, tol));
+                } catch (const std::exception& e) {
+#pragma omp critical (CornerPointChopper_chopToGrids)
+                    if (error.empty()) {
+                        std::ostringstream msg;
+                        msg << "Window " << w << ": " << e.what();
+                        error = msg.str();
+                    }
+                }
+            }
+            if (!error.empty()) {
+                OPM_THROW(std::runtime_error, error);
+            }
+        }
+
+
+
+        /// Extract many windows and write them to a single binary file.
+        /// Window number w is stored as step w of a state file (see
+        /// StateFileWriter), with the fields SPECGRID (the three
+        /// dimensions), COORD, ZCORN and those of ACTNUM, PORO, NTG,
+        /// PERMX, PERMY, PERMZ and SATNUM present in the deck. Windows
+        /// are extracted in parallel, a batch at a time, and written in
+        /// order. Use readBinary() to read a sub-model back.
+        /// \param[in] filename        Name of file to create.
+        /// \param[in] windows         Windows to extract.
+        /// \param[in] resettoorigin   If true, translate each sub-model to the origin.
+        /// \param[in] compress        If true, compress the fields.
+        void writeBinary(const std::string& filename,
+                         const std::vector<Window>& windows,
+                         bool resettoorigin=true,
+                         bool compress=false) const
+        {
+            StateFileWriter writer(filename, compress);
+            const int batch_size = 64;
+            std::vector<SubModel> batch;
+            for (std::size_t first = 0; first < windows.size(); first += batch_size) {
+                const std::size_t last = std::min(windows.size(), first + batch_size);
+                chopMany(std::vector<Window>(windows.begin() + first, windows.begin() + last),
+                         batch, resettoorigin);
+                for (std::size_t w = first; w < last; ++w) {
+                    const SubModel& sub = batch[w - first];
+                    const int step = w;
+                    writer.write(step, "SPECGRID", std::vector<int>(sub.dims, sub.dims + 3));
+                    writer.write(step, "COORD", sub.COORD);
+                    writer.write(step, "ZCORN", sub.ZCORN);
+                    writeNonEmpty(writer, step, "ACTNUM", sub.ACTNUM);
+                    writeNonEmpty(writer, step, "PORO", sub.PORO);
+                    writeNonEmpty(writer, step, "NTG", sub.NTG);
+                    writeNonEmpty(writer, step, "PERMX", sub.PERMX);
+                    writeNonEmpty(writer, step, "PERMY", sub.PERMY);
+                    writeNonEmpty(writer, step, "PERMZ", sub.PERMZ);
+                    writeNonEmpty(writer, step, "SATNUM", sub.SATNUM);
+                }
+            }
+            writer.close();
+        }
+
+
+
+        /// Read one sub-model written by writeBinary().
+        /// The mapping to cells of the original grid is not stored,
+        /// so new_to_old_cell will be empty.
+        /// \param[in] reader          Reader of the file.
+        /// \param[in] window          Window number.
+        /// \param[out] sub            The sub-model.
+        static void readBinary(const StateFileReader& reader,
+                               const int window,
+                               SubModel& sub)
+        {
+            std::vector<int> dims;
+            reader.read("SPECGRID", window, dims);
+            if (dims.size() != 3) {
+                OPM_THROW(std::runtime_error, "SPECGRID of window " << window << " does not have three dimensions.");
+            }
+            std::copy(dims.begin(), dims.end(), sub.dims);
+            reader.read("COORD", window, sub.COORD);
+            reader.read("ZCORN", window, sub.ZCORN);
+            readIfPresent(reader, window, "ACTNUM", sub.ACTNUM);
+            readIfPresent(reader, window, "PORO", sub.PORO);
+            readIfPresent(reader, window, "NTG", sub.NTG);
+            readIfPresent(reader, window, "PERMX", sub.PERMX);
+            readIfPresent(reader, window, "PERMY", sub.PERMY);
+            readIfPresent(reader, window, "PERMZ", sub.PERMZ);
+            readIfPresent(reader, window, "SATNUM", sub.SATNUM);
+            sub.new_to_old_cell.clear();
+        }
+
+
+
+        /// Return a subparser with fields corresponding to the selected subset.
+        /// Note that the returned parser is NOT converted to SI, that must be done
+        /// by the user afterwards with the parser's convertToSI() method.
+        EclipseGridParser subparser()
+        {
+            if (parser_.hasField("FIELD") || parser_.hasField("LAB") || parser_.hasField("PVT-M")) {
+                OPM_THROW(std::runtime_error, "CornerPointChopper::subparser() cannot handle any eclipse unit system other than METRIC.");
+            }
+
+            EclipseGridParser sp;
+            std::shared_ptr<SPECGRID> sg(new SPECGRID);
+            for (int dd = 0; dd < 3; ++dd) {
+                sg->dimensions[dd] = current_.dims[dd];
+            }
+            sp.setSpecialField("SPECGRID", sg);
+            sp.setFloatingPointField("COORD", current_.COORD);
+            sp.setFloatingPointField("ZCORN", current_.ZCORN);
+            if (!current_.ACTNUM.empty()) sp.setIntegerField("ACTNUM", current_.ACTNUM);
+            if (!current_.PORO.empty()) sp.setFloatingPointField("PORO", current_.PORO);
+            if (!current_.NTG.empty()) sp.setFloatingPointField("NTG", current_.NTG);
+            if (!current_.PERMX.empty()) sp.setFloatingPointField("PERMX", current_.PERMX);
+            if (!current_.PERMY.empty()) sp.setFloatingPointField("PERMY", current_.PERMY);
+            if (!current_.PERMZ.empty()) sp.setFloatingPointField("PERMZ", current_.PERMZ);
+            if (!current_.SATNUM.empty()) sp.setIntegerField("SATNUM", current_.SATNUM);
+            sp.computeUnits(); // Always METRIC, since that is default.
+            return sp;
+        }
+
+
+
+
+        void writeGrdecl(const std::string& filename)
+        {
+            // Output new versions of SPECGRID, COORD, ZCORN, ACTNUM, PERMX, PORO, SATNUM.
+            std::ofstream out(filename.c_str());
+            if (!out) {
+                std::cerr << "Could not open file " << filename << "\n";
+                throw std::runtime_error("Could not open output file.");
+            }
+            out << "SPECGRID\n" << current_.dims[0] << ' ' << current_.dims[1] << ' ' << current_.dims[2]
+                << " 1 F\n/\n\n";
+
+            outputField(out, current_.COORD, "COORD", /* nl = */ 6);
+            outputField(out, current_.ZCORN, "ZCORN", /* nl = */ 8);
+            outputField(out, current_.ACTNUM, "ACTNUM");
+            outputField(out, current_.PORO, "PORO");
+            if (hasNTG()) {outputField(out, current_.NTG, "NTG");}
+            outputField(out, current_.PERMX, "PERMX");
+            outputField(out, current_.PERMY, "PERMY");
+            outputField(out, current_.PERMZ, "PERMZ");
+            outputField(out, current_.SATNUM, "SATNUM");
+        }
+        bool hasNTG() const {return !current_.NTG.empty(); }
+
+    private:
+        EclipseGridParser parser_;
+        double botmax_;
+        double topmin_;
+        double abszmin_;
+        double abszmax_;
+        std::vector<double> layer_zmin_;
+        std::vector<double> layer_zmax_;
+        int dims_[3];
+        SubModel current_;
+
+
+        // Extract one window into sub. Only reads shared data, so it
+        // may be called concurrently for different sub-models.
+        void extract(const Window& win, bool resettoorigin, bool verbose, SubModel& sub) const
+        {
+            const int imin = win.imin;
+            const int imax = win.imax;
+            const int jmin = win.jmin;
+            const int jmax = win.jmax;
+            double zmin = win.zmin;
+            double zmax = win.zmax;
+            int* new_dims = sub.dims;
+            new_dims[0] = imax - imin;
+            new_dims[1] = jmax - jmin;
 
             // Filter the coord field
             const std::vector<double>& COORD = parser_.getFloatingPointValue("COORD");
@@ -139,24 +436,24 @@ namespace Opm
                 std::cerr << "Error! COORD size (" << COORD.size() << ") not consistent with SPECGRID\n";
                 throw std::runtime_error("Inconsistent COORD and SPECGRID.");
             }
-            int num_new_coord = 6*(new_dims_[0] + 1)*(new_dims_[1] + 1);
+            int num_new_coord = 6*(new_dims[0] + 1)*(new_dims[1] + 1);
             double x_correction = COORD[6*((dims_[0] + 1)*jmin + imin)];
             double y_correction = COORD[6*((dims_[0] + 1)*jmin + imin) + 1];
-            new_COORD_.resize(num_new_coord, 1e100);
+            sub.COORD.resize(num_new_coord, 1e100);
             for (int j = jmin; j < jmax + 1; ++j) {
                 for (int i = imin; i < imax + 1; ++i) {
                     int pos = (dims_[0] + 1)*j + i;
-                    int new_pos = (new_dims_[0] + 1)*(j-jmin) + (i-imin);
+                    int new_pos = (new_dims[0] + 1)*(j-jmin) + (i-imin);
                     // Copy all 6 coordinates for a pillar.
-                    std::copy(COORD.begin() + 6*pos, COORD.begin() + 6*(pos + 1), new_COORD_.begin() + 6*new_pos);
+                    std::copy(COORD.begin() + 6*pos, COORD.begin() + 6*(pos + 1), sub.COORD.begin() + 6*new_pos);
                     if (resettoorigin) {
                         // Substract lowest x value from all X-coords, similarly for y, and truncate in z-direction
-                      new_COORD_[6*new_pos]     -= x_correction;
-                      new_COORD_[6*new_pos + 1] -= y_correction;
-                      new_COORD_[6*new_pos + 2]  = 0;
-                      new_COORD_[6*new_pos + 3] -= x_correction;
-                      new_COORD_[6*new_pos + 4] -= y_correction;
-                      new_COORD_[6*new_pos + 5]  = zmax-zmin;
+                      sub.COORD[6*new_pos]     -= x_correction;
+                      sub.COORD[6*new_pos + 1] -= y_correction;
+                      sub.COORD[6*new_pos + 2]  = 0;
+                      sub.COORD[6*new_pos + 3] -= x_correction;
+                      sub.COORD[6*new_pos + 4] -= y_correction;
+                      sub.COORD[6*new_pos + 5]  = zmax-zmin;
                     }
                 }
             }
@@ -179,14 +476,15 @@ namespace Opm
                 std::cerr << "Error: zmin >= zmax (zmin = " << zmin << ", zmax = " << zmax << ")\n";
                 throw std::runtime_error("zmin >= zmax");
             }
-            std::cout << "Chopping subsample,  i: (" << imin << "--" << imax << ")  j: (" << jmin << "--" << jmax << ")   z: (" << zmin << "--" << zmax << ")" <<  std::endl;
+            if (verbose) {
+                std::cout << "Chopping subsample,  i: (" << imin << "--" << imax << ")  j: (" << jmin << "--" << jmax << ")   z: (" << zmin << "--" << zmax << ")" <<  std::endl;
+            }
 
             // We must find the maximum and minimum k value for the given z limits.
             // First, find the first layer with a z-coordinate strictly above zmin.
             int kmin = -1;
             for (int k = 0; k < dims_[2]; ++k) {
-                double layer_max = *std::max_element(ZCORN.begin() + k*layersz, ZCORN.begin() + (k + 1)*layersz);
-                if (layer_max > zmin) {
+                if (layer_zmax_[k] > zmin) {
                     kmin = k;
                     break;
                 }
@@ -194,28 +492,27 @@ namespace Opm
             // Then, find the last layer with a z-coordinate strictly below zmax.
             int kmax = -1;
             for (int k = dims_[2]; k > 0; --k) {
-                double layer_min = *std::min_element(ZCORN.begin() + (k - 1)*layersz, ZCORN.begin() + k*layersz);
-                if (layer_min < zmax) {
+                if (layer_zmin_[k - 1] < zmax) {
                     kmax = k;
                     break;
                 }
             }
-            new_dims_[2] = kmax - kmin;
+            new_dims[2] = kmax - kmin;
 
             // Filter the ZCORN field, build mapping from new to old cells.
             double z_origin_correction = 0.0;
             if (resettoorigin) {
                 z_origin_correction = zmin;
             }
-            new_ZCORN_.resize(8*new_dims_[0]*new_dims_[1]*new_dims_[2], 1e100);
-            new_to_old_cell_.resize(new_dims_[0]*new_dims_[1]*new_dims_[2], -1);
+            sub.ZCORN.resize(8*new_dims[0]*new_dims[1]*new_dims[2], 1e100);
+            sub.new_to_old_cell.resize(new_dims[0]*new_dims[1]*new_dims[2], -1);
             int cellcount = 0;
             int delta[3] = { 1, 2*dims_[0], 4*dims_[0]*dims_[1] };
-            int new_delta[3] = { 1, 2*new_dims_[0], 4*new_dims_[0]*new_dims_[1] };
+            int new_delta[3] = { 1, 2*new_dims[0], 4*new_dims[0]*new_dims[1] };
             for (int k = kmin; k < kmax; ++k) {
                 for (int j = jmin; j < jmax; ++j) {
                     for (int i = imin; i < imax; ++i) {
-                        new_to_old_cell_[cellcount++] = dims_[0]*dims_[1]*k + dims_[0]*j + i;
+                        sub.new_to_old_cell[cellcount++] = dims_[0]*dims_[1]*k + dims_[0]*j + i;
                         int old_ix = 2*(i*delta[0] + j*delta[1] + k*delta[2]);
                         int new_ix = 2*((i-imin)*new_delta[0] + (j-jmin)*new_delta[1] + (k-kmin)*new_delta[2]);
                         int old_indices[8] = { old_ix, old_ix + delta[0],
@@ -227,97 +524,22 @@ namespace Opm
                                                new_ix + new_delta[2], new_ix + new_delta[2] + new_delta[0],
                                                new_ix + new_delta[2] + new_delta[1], new_ix + new_delta[2] + new_delta[1] + new_delta[0] };
                         for (int cc = 0; cc < 8; ++cc) {
-                            new_ZCORN_[new_indices[cc]] = std::min(zmax, std::max(zmin, ZCORN[old_indices[cc]])) - z_origin_correction;
+                            sub.ZCORN[new_indices[cc]] = std::min(zmax, std::max(zmin, ZCORN[old_indices[cc]])) - z_origin_correction;
                         }
                     }
                 }
             }
 
-            filterIntegerField("ACTNUM", new_ACTNUM_);
-            filterDoubleField("PORO", new_PORO_);
-            filterDoubleField("NTG", new_NTG_);
-            filterDoubleField("PERMX", new_PERMX_);
-            filterDoubleField("PERMY", new_PERMY_);
-            filterDoubleField("PERMZ", new_PERMZ_);
-            filterIntegerField("SATNUM", new_SATNUM_);
+            filterIntegerField("ACTNUM", sub.new_to_old_cell, sub.ACTNUM);
+            filterDoubleField("PORO", sub.new_to_old_cell, sub.PORO);
+            filterDoubleField("NTG", sub.new_to_old_cell, sub.NTG);
+            filterDoubleField("PERMX", sub.new_to_old_cell, sub.PERMX);
+            filterDoubleField("PERMY", sub.new_to_old_cell, sub.PERMY);
+            filterDoubleField("PERMZ", sub.new_to_old_cell, sub.PERMZ);
+            filterIntegerField("SATNUM", sub.new_to_old_cell, sub.SATNUM);
         }
 
 
-
-        /// Return a subparser with fields corresponding to the selected subset.
-        /// Note that the returned parser is NOT converted to SI, that must be done
-        /// by the user afterwards with the parser's convertToSI() method.
-        EclipseGridParser subparser()
-        {
-            if (parser_.hasField("FIELD") || parser_.hasField("LAB") || parser_.hasField("PVT-M")) {
-                OPM_THROW(std::runtime_error, "CornerPointChopper::subparser() cannot handle any eclipse unit system other than METRIC.");
-            }
-
-            EclipseGridParser sp;
-            std::shared_ptr<SPECGRID> sg(new SPECGRID);
-            for (int dd = 0; dd < 3; ++dd) {
-                sg->dimensions[dd] = new_dims_[dd];
-            }
-            sp.setSpecialField("SPECGRID", sg);
-            sp.setFloatingPointField("COORD", new_COORD_);
-            sp.setFloatingPointField("ZCORN", new_ZCORN_);
-            if (!new_ACTNUM_.empty()) sp.setIntegerField("ACTNUM", new_ACTNUM_);
-            if (!new_PORO_.empty()) sp.setFloatingPointField("PORO", new_PORO_);
-            if (!new_NTG_.empty()) sp.setFloatingPointField("NTG", new_NTG_);
-            if (!new_PERMX_.empty()) sp.setFloatingPointField("PERMX", new_PERMX_);
-            if (!new_PERMY_.empty()) sp.setFloatingPointField("PERMY", new_PERMY_);
-            if (!new_PERMZ_.empty()) sp.setFloatingPointField("PERMZ", new_PERMZ_);
-            if (!new_SATNUM_.empty()) sp.setIntegerField("SATNUM", new_SATNUM_);
-            sp.computeUnits(); // Always METRIC, since that is default.
-            return sp;
-        }
-
-
-
-
-        void writeGrdecl(const std::string& filename)
-        {
-            // Output new versions of SPECGRID, COORD, ZCORN, ACTNUM, PERMX, PORO, SATNUM.
-            std::ofstream out(filename.c_str());
-            if (!out) {
-                std::cerr << "Could not open file " << filename << "\n";
-                throw std::runtime_error("Could not open output file.");
-            }
-            out << "SPECGRID\n" << new_dims_[0] << ' ' << new_dims_[1] << ' ' << new_dims_[2]
-                << " 1 F\n/\n\n";
-
-            outputField(out, new_COORD_, "COORD", /* nl = */ 6);
-            outputField(out, new_ZCORN_, "ZCORN", /* nl = */ 8);
-            outputField(out, new_ACTNUM_, "ACTNUM");
-            outputField(out, new_PORO_, "PORO");
-            if (hasNTG()) {outputField(out, new_NTG_, "NTG");}
-            outputField(out, new_PERMX_, "PERMX");
-            outputField(out, new_PERMY_, "PERMY");
-            outputField(out, new_PERMZ_, "PERMZ");
-            outputField(out, new_SATNUM_, "SATNUM");
-        }
-        bool hasNTG() const {return !new_NTG_.empty(); }
-
-    private:
-        EclipseGridParser parser_;
-        double botmax_;
-        double topmin_;
-        double abszmin_;
-        double abszmax_;
-        std::vector<double> new_COORD_;
-        std::vector<double> new_ZCORN_;
-        std::vector<int> new_ACTNUM_;
-        std::vector<double> new_PORO_;
-        std::vector<double> new_NTG_;
-        std::vector<double> new_PERMX_;
-        std::vector<double> new_PERMY_;
-        std::vector<double> new_PERMZ_;
-        std::vector<int> new_SATNUM_;
-        int dims_[3];
-        int new_dims_[3];
-        std::vector<int> new_to_old_cell_;
-
-
         template <typename T>
         void outputField(std::ostream& os,
                          const std::vector<T>& field,
@@ -344,29 +566,60 @@ namespace Opm
 
 
         template <typename T>
-        void filterField(const std::vector<T>& field,
+        static void filterField(const std::vector<T>& field,
+                                const std::vector<int>& new_to_old_cell,
                                 std::vector<T>& output_field)
         {
-            int sz = new_to_old_cell_.size();
+            int sz = new_to_old_cell.size();
             output_field.resize(sz);
             for (int i = 0; i < sz; ++i) {
-                output_field[i] = field[new_to_old_cell_[i]];
+                output_field[i] = field[new_to_old_cell[i]];
             }
         }
 
-        void filterDoubleField(const std::string& keyword, std::vector<double>& output_field)
+        void filterDoubleField(const std::string& keyword,
+                               const std::vector<int>& new_to_old_cell,
+                               std::vector<double>& output_field) const
         {
             if (parser_.hasField(keyword)) {
                 const std::vector<double>& field = parser_.getFloatingPointValue(keyword);
-                filterField(field, output_field);
+                filterField(field, new_to_old_cell, output_field);
+            } else {
+                output_field.clear();
             }
         }
 
-        void filterIntegerField(const std::string& keyword, std::vector<int>& output_field)
+        void filterIntegerField(const std::string& keyword,
+                                const std::vector<int>& new_to_old_cell,
+                                std::vector<int>& output_field) const
         {
             if (parser_.hasField(keyword)) {
                 const std::vector<int>& field = parser_.getIntegerValue(keyword);
-                filterField(field, output_field);
+                filterField(field, new_to_old_cell, output_field);
+            } else {
+                output_field.clear();
+            }
+        }
+
+        template <typename T>
+        static void writeNonEmpty(StateFileWriter& writer, const int step,
+                                  const std::string& keyword,
+                                  const std::vector<T>& field)
+        {
+            if (!field.empty()) {
+                writer.write(step, keyword, field);
+            }
+        }
+
+        template <typename T>
+        static void readIfPresent(const StateFileReader& reader, const int step,
+                                  const std::string& keyword,
+                                  std::vector<T>& field)
+        {
+            if (reader.hasField(keyword, step)) {
+                reader.read(keyword, step, field);
+            } else {
+                field.clear();
             }
         }
 
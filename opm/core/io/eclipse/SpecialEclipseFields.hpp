@@ -1770,25 +1770,35 @@ struct EQUIL : public SpecialBase
 
     virtual void read(std::istream& is)
     {
-        // Note. This function assumes that NTEQUL = 1, and reads only one line.
-        int num_to_read = 9;
-        std::vector<double> data(num_to_read,0);
-        int num_read = readDefaultedVectorData(is, data, num_to_read);
-        if (num_read == num_to_read) {
-            ignoreSlashLine(is);
-        }
+        // Reads one record per equilibration region (NTEQUL records).
+        while (!is.eof()) {
+            int num_to_read = 9;
+            std::vector<double> data(num_to_read,0);
+            int num_read = readDefaultedVectorData(is, data, num_to_read);
+            if (num_read == num_to_read) {
+                ignoreSlashLine(is);
+            }
+
+            EquilLine equil_line;
+            equil_line.datum_depth_             = data[0];
+            equil_line.datum_depth_pressure_    = data[1];
+            equil_line.water_oil_contact_depth_ = data[2];
+            equil_line.oil_water_cap_pressure_  = data[3];
+            equil_line.gas_oil_contact_depth_   = data[4];
+            equil_line.gas_oil_cap_pressure_    = data[5];
+            equil_line.live_oil_table_index_    = int(data[6]);
+            equil_line.wet_gas_table_index_     = int(data[7]);
+            equil_line.N_                       = int(data[8]);
+            equil.push_back(equil_line);
 
-        EquilLine equil_line;
-        equil_line.datum_depth_             = data[0];
-        equil_line.datum_depth_pressure_    = data[1];
-        equil_line.water_oil_contact_depth_ = data[2];
-        equil_line.oil_water_cap_pressure_  = data[3];
-        equil_line.gas_oil_contact_depth_   = data[4];
-        equil_line.gas_oil_cap_pressure_    = data[5];
-        equil_line.live_oil_table_index_    = int(data[6]);
-        equil_line.wet_gas_table_index_     = int(data[7]);
-        equil_line.N_                       = int(data[8]);
-        equil.push_back(equil_line);
+            int action = next_action(is); // 0:continue  1:return  2:throw
+            if (action == 1) {
+                return;     // Alphabetic char. Read next keyword.
+            } else if (action == 2) {
+                OPM_THROW(std::runtime_error, "Error reading EQUIL. Next character is "
+                      <<  (char)is.peek());
+            }
+        }
     }
 
     virtual void write(std::ostream& os) const
@@ -0,0 +1,784 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <opm/core/linalg/LinearSolverAmg.hpp>
+#include <opm/core/linalg/blas_lapack.h>
+#include <opm/core/linalg/sparse_sys.h>
+#include <opm/core/utility/parameters/ParameterGroup.hpp>
+#include <opm/core/utility/ErrorMacros.hpp>
+#include <opm/core/utility/Profiler.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+namespace Opm
+{
+
+
+    namespace {
+
+        // Square or rectangular matrix in compressed sparse row format.
+        template <class Scalar>
+        struct BasicCsr
+        {
+            BasicCsr() : rows(0), cols(0) {}
+            int rows;
+            int cols;
+            std::vector<int> ia;
+            std::vector<int> ja;
+            std::vector<Scalar> sa;
+        };
+
+        typedef BasicCsr<double> Csr;
+
+        // Copy of A with elements of another type.
+        template <class Scalar>
+        BasicCsr<Scalar> convert(const Csr& A)
+        {
+            BasicCsr<Scalar> B;
+            B.rows = A.rows;
+            B.cols = A.cols;
+            B.ia = A.ia;
+            B.ja = A.ja;
+            B.sa.assign(A.sa.begin(), A.sa.end());
+            return B;
+        }
+
+        // y <- A*x
+        template <class Scalar>
+        void spmv(const BasicCsr<Scalar>& A, const Scalar* x, Scalar* y)
+        {
+            const int n = A.rows;
+#pragma omp parallel for schedule(static)
+            for (int i = 0; i < n; ++i) {
+                double s = 0.0;
+                for (int k = A.ia[i]; k < A.ia[i + 1]; ++k) {
+                    s += A.sa[k] * x[A.ja[k]];
+                }
+                y[i] = s;
+            }
+        }
+
+        // r <- b - A*x
+        template <class Scalar>
+        void residual(const BasicCsr<Scalar>& A, const Scalar* x, const Scalar* b, Scalar* r)
+        {
+            const int n = A.rows;
+#pragma omp parallel for schedule(static)
+            for (int i = 0; i < n; ++i) {
+                double s = b[i];
+                for (int k = A.ia[i]; k < A.ia[i + 1]; ++k) {
+                    s -= A.sa[k] * x[A.ja[k]];
+                }
+                r[i] = s;
+            }
+        }
+
+        double dot(const int n, const double* x, const double* y)
+        {
+            double s = 0.0;
+#pragma omp parallel for reduction(+:s) schedule(static)
+            for (int i = 0; i < n; ++i) {
+                s += x[i] * y[i];
+            }
+            return s;
+        }
+
+        Csr transpose(const Csr& A)
+        {
+            Csr At;
+            At.rows = A.cols;
+            At.cols = A.rows;
+            At.ia.assign(At.rows + 1, 0);
+            At.ja.resize(A.ja.size());
+            At.sa.resize(A.sa.size());
+            for (std::size_t k = 0; k < A.ja.size(); ++k) {
+                ++At.ia[A.ja[k] + 1];
+            }
+            for (int i = 0; i < At.rows; ++i) {
+                At.ia[i + 1] += At.ia[i];
+            }
+            std::vector<int> pos(At.ia.begin(), At.ia.end() - 1);
+            for (int i = 0; i < A.rows; ++i) {
+                for (int k = A.ia[i]; k < A.ia[i + 1]; ++k) {
+                    const int p = pos[A.ja[k]]++;
+                    At.ja[p] = i;
+                    At.sa[p] = A.sa[k];
+                }
+            }
+            return At;
+        }
+
+        // C <- A*B, row by row with a dense marker array.
+        Csr multiply(const Csr& A, const Csr& B)
+        {
+            Csr C;
+            C.rows = A.rows;
+            C.cols = B.cols;
+            C.ia.assign(C.rows + 1, 0);
+            std::vector<int> marker(B.cols, -1);
+            for (int i = 0; i < A.rows; ++i) {
+                for (int ka = A.ia[i]; ka < A.ia[i + 1]; ++ka) {
+                    const int j = A.ja[ka];
+                    const double a = A.sa[ka];
+                    for (int kb = B.ia[j]; kb < B.ia[j + 1]; ++kb) {
+                        const int c = B.ja[kb];
+                        if (marker[c] < C.ia[i]) {
+                            marker[c] = C.ja.size();
+                            C.ja.push_back(c);
+                            C.sa.push_back(a * B.sa[kb]);
+                        } else {
+                            C.sa[marker[c]] += a * B.sa[kb];
+                        }
+                    }
+                }
+                C.ia[i + 1] = C.ja.size();
+            }
+            return C;
+        }
+
+        // Inverse diagonal, zero where the diagonal vanishes.
+        std::vector<double> inverseDiagonal(const Csr& A)
+        {
+            std::vector<double> dinv(A.rows, 0.0);
+            for (int i = 0; i < A.rows; ++i) {
+                for (int k = A.ia[i]; k < A.ia[i + 1]; ++k) {
+                    if (A.ja[k] == i && A.sa[k] != 0.0) {
+                        dinv[i] = 1.0 / A.sa[k];
+                    }
+                }
+            }
+            return dinv;
+        }
+
+        // Gershgorin bound on the spectral radius of D^{-1}A.
+        double spectralBound(const Csr& A, const std::vector<double>& dinv)
+        {
+            double rho = 0.0;
+            for (int i = 0; i < A.rows; ++i) {
+                double s = 0.0;
+                for (int k = A.ia[i]; k < A.ia[i + 1]; ++k) {
+                    s += std::fabs(A.sa[k]);
+                }
+                rho = std::max(rho, s * std::fabs(dinv[i]));
+            }
+            return rho > 0.0 ? rho : 1.0;
+        }
+
+        // Greedy aggregation on the graph of strong connections,
+        // following the three phases of Vanek, Mandel and Brezina.
+        // Returns the number of aggregates.
+        int aggregate(const Csr& A, const std::vector<double>& dinv,
+                      const double theta, std::vector<int>& agg)
+        {
+            const int n = A.rows;
+            const int unassigned = -1;
+
+            // Strong neighbours of each node.
+            std::vector<int> sp(n + 1, 0);
+            std::vector<int> sn;
+            std::vector<double> sv;
+            sn.reserve(A.ja.size());
+            sv.reserve(A.ja.size());
+            for (int i = 0; i < n; ++i) {
+                for (int k = A.ia[i]; k < A.ia[i + 1]; ++k) {
+                    const int j = A.ja[k];
+                    if (j == i || dinv[i] == 0.0 || dinv[j] == 0.0) {
+                        continue;
+                    }
+                    const double s = std::fabs(A.sa[k]) * std::sqrt(std::fabs(dinv[i] * dinv[j]));
+                    if (s >= theta) {
+                        sn.push_back(j);
+                        sv.push_back(s);
+                    }
+                }
+                sp[i + 1] = sn.size();
+            }
+
+            agg.assign(n, unassigned);
+            int nagg = 0;
+
+            // Phase 1: a node whose strong neighbours are all free
+            // forms an aggregate with them.
+            for (int i = 0; i < n; ++i) {
+                if (agg[i] != unassigned || sp[i] == sp[i + 1]) {
+                    continue;
+                }
+                bool free = true;
+                for (int k = sp[i]; k < sp[i + 1] && free; ++k) {
+                    free = agg[sn[k]] == unassigned;
+                }
+                if (free) {
+                    agg[i] = nagg;
+                    for (int k = sp[i]; k < sp[i + 1]; ++k) {
+                        agg[sn[k]] = nagg;
+                    }
+                    ++nagg;
+                }
+            }
+
+            // Phase 2: remaining nodes join the aggregate they are
+            // most strongly connected to.
+            std::vector<int> phase1(agg);
+            for (int i = 0; i < n; ++i) {
+                if (phase1[i] != unassigned) {
+                    continue;
+                }
+                double best = 0.0;
+                for (int k = sp[i]; k < sp[i + 1]; ++k) {
+                    if (phase1[sn[k]] != unassigned && sv[k] > best) {
+                        best = sv[k];
+                        agg[i] = phase1[sn[k]];
+                    }
+                }
+            }
+
+            // Phase 3: whatever is left forms aggregates with its free
+            // strong neighbours, isolated nodes become singletons.
+            for (int i = 0; i < n; ++i) {
+                if (agg[i] != unassigned) {
+                    continue;
+                }
+                agg[i] = nagg;
+                for (int k = sp[i]; k < sp[i + 1]; ++k) {
+                    if (agg[sn[k]] == unassigned) {
+                        agg[sn[k]] = nagg;
+                    }
+                }
+                ++nagg;
+            }
+            return nagg;
+        }
+
+        // Smoothed prolongation P = (I - omega D^{-1} A) P0 in which
+        // P0 is the piecewise constant interpolation from aggregates.
+        Csr smoothedProlongation(const Csr& A, const std::vector<double>& dinv,
+                                 const double omega,
+                                 const std::vector<int>& agg, const int nagg)
+        {
+            const int n = A.rows;
+            Csr P0;
+            P0.rows = n;
+            P0.cols = nagg;
+            P0.ia.resize(n + 1);
+            P0.ja = agg;
+            P0.sa.assign(n, 1.0);
+            for (int i = 0; i <= n; ++i) {
+                P0.ia[i] = i;
+            }
+
+            Csr P = multiply(A, P0);
+            Csr Pfull;
+            Pfull.rows = n;
+            Pfull.cols = nagg;
+            Pfull.ia.assign(n + 1, 0);
+            Pfull.ja.reserve(P.ja.size() + n);
+            Pfull.sa.reserve(P.ja.size() + n);
+            for (int i = 0; i < n; ++i) {
+                bool found = false;
+                for (int k = P.ia[i]; k < P.ia[i + 1]; ++k) {
+                    double v = -omega * dinv[i] * P.sa[k];
+                    if (P.ja[k] == agg[i]) {
+                        v += 1.0;
+                        found = true;
+                    }
+                    Pfull.ja.push_back(P.ja[k]);
+                    Pfull.sa.push_back(v);
+                }
+                if (!found) {
+                    Pfull.ja.push_back(agg[i]);
+                    Pfull.sa.push_back(1.0);
+                }
+                Pfull.ia[i + 1] = Pfull.ja.size();
+            }
+            return Pfull;
+        }
+
+
+        // Settings for the AMG hierarchy.
+        struct AmgOptions
+        {
+            double theta;
+            int coarse_size;
+            int smooth_steps;
+            bool gauss_seidel;
+            double prolongate_factor;
+            int verbosity;
+        };
+
+
+        template <class Scalar>
+        struct AmgLevel
+        {
+            BasicCsr<Scalar> A;
+            BasicCsr<Scalar> P;     // Prolongation from the next coarser level.
+            BasicCsr<Scalar> R;     // Restriction to the next coarser level.
+            std::vector<Scalar> dinv;
+            double omega;           // Jacobi damping for this level.
+            mutable std::vector<Scalar> x, b, r;
+        };
+
+
+        /// Smoothed aggregation hierarchy used as a preconditioner.
+        /// The hierarchy is set up in double precision, but stored and
+        /// applied with elements of type Scalar, which halves the memory
+        /// traffic of the V-cycle for Scalar = float. The coarsest level
+        /// is always solved in double precision.
+        template <class Scalar>
+        class AmgHierarchy
+        {
+        public:
+            AmgHierarchy(const Csr& A, const AmgOptions& opt)
+                : smooth_steps_(opt.smooth_steps),
+                  gauss_seidel_(opt.gauss_seidel),
+                  prolongate_factor_(opt.prolongate_factor),
+                  coarse_factored_(false)
+            {
+                OPM_PROFILE_SCOPE("linsolve/amg_setup");
+                const int max_levels = 25;
+                Csr Af = A;
+                for (;;) {
+                    levels_.push_back(AmgLevel<Scalar>());
+                    AmgLevel<Scalar>& fine = levels_.back();
+                    const std::vector<double> dinv = inverseDiagonal(Af);
+                    const double rho = spectralBound(Af, dinv);
+                    fine.A = convert<Scalar>(Af);
+                    fine.dinv.assign(dinv.begin(), dinv.end());
+                    fine.omega = (4.0/3.0) / rho;
+                    fine.x.resize(Af.rows);
+                    fine.b.resize(Af.rows);
+                    fine.r.resize(Af.rows);
+                    if (Af.rows <= opt.coarse_size || int(levels_.size()) == max_levels) {
+                        break;
+                    }
+                    std::vector<int> agg;
+                    const int nagg = aggregate(Af, dinv, opt.theta, agg);
+                    if (nagg == 0 || nagg >= 0.9*Af.rows) {
+                        break;
+                    }
+                    const Csr P = smoothedProlongation(Af, dinv, fine.omega, agg, nagg);
+                    const Csr R = transpose(P);
+                    Csr Ac = multiply(R, multiply(Af, P));
+                    fine.P = convert<Scalar>(P);
+                    fine.R = convert<Scalar>(R);
+                    Af.rows = Ac.rows;
+                    Af.cols = Ac.cols;
+                    Af.ia.swap(Ac.ia);
+                    Af.ja.swap(Ac.ja);
+                    Af.sa.swap(Ac.sa);
+                }
+                factorCoarsest(Af);
+                if (opt.verbosity > 0) {
+                    std::cout << "LinearSolverAmg: " << levels_.size() << " levels, rows per level:";
+                    for (std::size_t l = 0; l < levels_.size(); ++l) {
+                        std::cout << ' ' << levels_[l].A.rows;
+                    }
+                    std::cout << std::endl;
+                }
+            }
+
+            /// z <- M^{-1} r, a single V-cycle from a zero initial guess.
+            void apply(const double* r, double* z) const
+            {
+                const AmgLevel<Scalar>& fine = levels_[0];
+                std::copy(r, r + fine.A.rows, fine.b.begin());
+                std::fill(fine.x.begin(), fine.x.end(), Scalar(0));
+                vcycle(0);
+                std::copy(fine.x.begin(), fine.x.end(), z);
+            }
+
+        private:
+            void factorCoarsest(const Csr& A)
+            {
+                const int n = A.rows;
+                if (n == 0 || n > 2000) {
+                    return;
+                }
+                lu_.assign(n*n, 0.0);
+                ipiv_.resize(n);
+                coarse_rhs_.resize(n);
+                for (int i = 0; i < n; ++i) {
+                    for (int k = A.ia[i]; k < A.ia[i + 1]; ++k) {
+                        lu_[i + A.ja[k]*n] += A.sa[k];
+                    }
+                }
+                MAT_SIZE_T nn = n, info = 0;
+                dgetrf_(&nn, &nn, &lu_[0], &nn, &ipiv_[0], &info);
+                // A singular coarse operator, e.g. from a problem
+                // without Dirichlet conditions, is smoothed instead.
+                coarse_factored_ = (info == 0);
+            }
+
+            void smooth(const AmgLevel<Scalar>& L, const bool forward) const
+            {
+                const BasicCsr<Scalar>& A = L.A;
+                const int n = A.rows;
+                Scalar* x = &L.x[0];
+                const Scalar* b = &L.b[0];
+                if (gauss_seidel_) {
+                    for (int s = 0; s < n; ++s) {
+                        const int i = forward ? s : n - 1 - s;
+                        if (L.dinv[i] == 0.0) {
+                            continue;
+                        }
+                        double v = b[i];
+                        for (int k = A.ia[i]; k < A.ia[i + 1]; ++k) {
+                            v -= A.sa[k] * x[A.ja[k]];
+                        }
+                        x[i] += L.dinv[i] * v;
+                    }
+                } else {
+                    Scalar* r = &L.r[0];
+                    residual(A, x, b, r);
+                    const Scalar omega = L.omega;
+                    const Scalar* dinv = &L.dinv[0];
+#pragma omp parallel for schedule(static)
+                    for (int i = 0; i < n; ++i) {
+                        x[i] += omega * dinv[i] * r[i];
+                    }
+                }
+            }
+
+            void vcycle(const std::size_t l) const
+            {
+                const AmgLevel<Scalar>& L = levels_[l];
+                if (l + 1 == levels_.size()) {
+                    if (coarse_factored_) {
+                        MAT_SIZE_T nn = L.A.rows, nrhs = 1, info = 0;
+                        std::copy(L.b.begin(), L.b.end(), coarse_rhs_.begin());
+                        dgetrs_("N", &nn, &nrhs, &lu_[0], &nn, &ipiv_[0], &coarse_rhs_[0], &nn, &info);
+                        std::copy(coarse_rhs_.begin(), coarse_rhs_.end(), L.x.begin());
+                    } else {
+                        for (int s = 0; s < 10*smooth_steps_; ++s) {
+                            smooth(L, true);
+                            smooth(L, false);
+                        }
+                    }
+                    return;
+                }
+                for (int s = 0; s < smooth_steps_; ++s) {
+                    smooth(L, true);
+                }
+                const AmgLevel<Scalar>& C = levels_[l + 1];
+                residual(L.A, &L.x[0], &L.b[0], &L.r[0]);
+                spmv(L.R, &L.r[0], &C.b[0]);
+                std::fill(C.x.begin(), C.x.end(), Scalar(0));
+                vcycle(l + 1);
+                spmv(L.P, &C.x[0], &L.r[0]);
+                const int n = L.A.rows;
+                const Scalar factor = prolongate_factor_;
+#pragma omp parallel for schedule(static)
+                for (int i = 0; i < n; ++i) {
+                    L.x[i] += factor * L.r[i];
+                }
+                for (int s = 0; s < smooth_steps_; ++s) {
+                    smooth(L, false);
+                }
+            }
+
+            std::vector<AmgLevel<Scalar> > levels_;
+            int smooth_steps_;
+            bool gauss_seidel_;
+            double prolongate_factor_;
+            bool coarse_factored_;
+            std::vector<double> lu_;
+            std::vector<MAT_SIZE_T> ipiv_;
+            mutable std::vector<double> coarse_rhs_;
+        };
+
+
+        // Preconditioned conjugate gradients starting from the guess
+        // in x, stopping when the residual norm has been reduced below
+        // the given tolerance relative to the norm of b.
+        template <class Precond>
+        LinearSolverInterface::LinearSolverReport
+        solveCG(const Csr& A, const Precond& amg, const double* b, double* x,
+                const double tolerance, const int maxit, const int verbosity)
+        {
+            OPM_PROFILE_SCOPE("linsolve/amg_cg");
+            const int n = A.rows;
+            std::vector<double> r(n), z(n), p(n), q(n);
+            residual(A, x, b, &r[0]);
+            const double r0 = std::sqrt(dot(n, b, b));
+            double rnorm = std::sqrt(dot(n, &r[0], &r[0]));
+            if (rnorm >= r0) {
+                // The guess is no better than zero.
+                std::fill(x, x + n, 0.0);
+                std::copy(b, b + n, r.begin());
+                rnorm = r0;
+            }
+
+            LinearSolverInterface::LinearSolverReport res;
+            res.converged = true;
+            res.iterations = 0;
+            res.residual_reduction = (r0 > 0.0) ? rnorm / r0 : 0.0;
+            res.true_residual_reduction = res.residual_reduction;
+            res.reference_iterations = 0;
+            if (rnorm <= tolerance*r0) {
+                return res;
+            }
+
+            amg.apply(&r[0], &z[0]);
+            p = z;
+            double rz = dot(n, &r[0], &z[0]);
+            res.converged = false;
+            int it = 0;
+            while (it < maxit) {
+                ++it;
+                spmv(A, &p[0], &q[0]);
+                const double alpha = rz / dot(n, &p[0], &q[0]);
+#pragma omp parallel for schedule(static)
+                for (int i = 0; i < n; ++i) {
+                    x[i] += alpha * p[i];
+                    r[i] -= alpha * q[i];
+                }
+                rnorm = std::sqrt(dot(n, &r[0], &r[0]));
+                if (verbosity > 1) {
+                    std::cout << "    " << it << "    " << rnorm/r0 << std::endl;
+                }
+                if (rnorm <= tolerance*r0) {
+                    res.converged = true;
+                    break;
+                }
+                amg.apply(&r[0], &z[0]);
+                const double rz_new = dot(n, &r[0], &z[0]);
+                const double beta = rz_new / rz;
+                rz = rz_new;
+#pragma omp parallel for schedule(static)
+                for (int i = 0; i < n; ++i) {
+                    p[i] = z[i] + beta * p[i];
+                }
+            }
+            res.iterations = it;
+            res.residual_reduction = rnorm / r0;
+            // The recursively updated residual may drift from the
+            // true one, in particular with a reduced precision
+            // preconditioner.
+            residual(A, x, b, &r[0]);
+            res.true_residual_reduction = std::sqrt(dot(n, &r[0], &r[0])) / r0;
+            if (verbosity > 0) {
+                std::cout << "LinearSolverAmg: " << (res.converged ? "converged" : "did not converge")
+                          << " in " << it << " iterations, reduction " << res.residual_reduction
+                          << std::endl;
+            }
+            return res;
+        }
+
+        // Solve for all right hand sides with one hierarchy.
+        template <class Scalar>
+        LinearSolverInterface::LinearSolverReport
+        solveAll(const Csr& A, const AmgOptions& opt, const int nrhs,
+                 const double* rhs, double* solution,
+                 const double tolerance, const int maxit)
+        {
+            const AmgHierarchy<Scalar> amg(A, opt);
+            const int size = A.rows;
+            LinearSolverInterface::LinearSolverReport res;
+            res.converged = true;
+            res.iterations = 0;
+            res.residual_reduction = 0.0;
+            res.true_residual_reduction = 0.0;
+            res.reference_iterations = 0;
+            for (int k = 0; k < nrhs; ++k) {
+                const LinearSolverInterface::LinearSolverReport r =
+                    solveCG(A, amg, rhs + k*size, solution + k*size,
+                            tolerance, maxit, opt.verbosity);
+                res.converged = res.converged && r.converged;
+                res.iterations += r.iterations;
+                res.residual_reduction = std::max(res.residual_reduction, r.residual_reduction);
+                res.true_residual_reduction = std::max(res.true_residual_reduction,
+                                                       r.true_residual_reduction);
+            }
+            return res;
+        }
+
+    } // anonymous namespace
+
+
+
+
+    LinearSolverAmg::LinearSolverAmg()
+        : linsolver_residual_tolerance_(1e-8),
+          linsolver_verbosity_(0),
+          linsolver_save_system_(false),
+          linsolver_max_iterations_(0),
+          linsolver_smooth_steps_(2),
+          linsolver_prolongate_factor_(1.0),
+          linsolver_amg_smoother_(GaussSeidel),
+          linsolver_amg_strength_(0.08),
+          linsolver_amg_coarse_size_(200),
+          linsolver_warm_start_(false),
+          linsolver_single_precision_amg_(false),
+          linsolver_precision_comparison_(false)
+    {
+    }
+
+
+
+
+    LinearSolverAmg::LinearSolverAmg(const parameter::ParameterGroup& param)
+        : linsolver_residual_tolerance_(1e-8),
+          linsolver_verbosity_(0),
+          linsolver_save_system_(false),
+          linsolver_max_iterations_(0),
+          linsolver_smooth_steps_(2),
+          linsolver_prolongate_factor_(1.0),
+          linsolver_amg_smoother_(GaussSeidel),
+          linsolver_amg_strength_(0.08),
+          linsolver_amg_coarse_size_(200),
+          linsolver_warm_start_(false),
+          linsolver_single_precision_amg_(false),
+          linsolver_precision_comparison_(false)
+    {
+        linsolver_residual_tolerance_ = param.getDefault("linsolver_residual_tolerance", linsolver_residual_tolerance_);
+        linsolver_verbosity_ = param.getDefault("linsolver_verbosity", linsolver_verbosity_);
+        linsolver_save_system_ = param.getDefault("linsolver_save_system", linsolver_save_system_);
+        if (linsolver_save_system_) {
+            linsolver_save_filename_ = param.getDefault("linsolver_save_filename", std::string("linsys"));
+        }
+        linsolver_max_iterations_ = param.getDefault("linsolver_max_iterations", linsolver_max_iterations_);
+        linsolver_smooth_steps_ = param.getDefault("linsolver_smooth_steps", linsolver_smooth_steps_);
+        linsolver_prolongate_factor_ = param.getDefault("linsolver_prolongate_factor", linsolver_prolongate_factor_);
+        linsolver_amg_smoother_ = Smoother(param.getDefault("linsolver_amg_smoother", int(linsolver_amg_smoother_)));
+        if (linsolver_amg_smoother_ != Jacobi && linsolver_amg_smoother_ != GaussSeidel) {
+            OPM_THROW(std::runtime_error, "Unknown linsolver_amg_smoother: " << int(linsolver_amg_smoother_));
+        }
+        linsolver_amg_strength_ = param.getDefault("linsolver_amg_strength", linsolver_amg_strength_);
+        linsolver_amg_coarse_size_ = param.getDefault("linsolver_amg_coarse_size", linsolver_amg_coarse_size_);
+        linsolver_warm_start_ = param.getDefault("linsolver_warm_start", linsolver_warm_start_);
+        linsolver_single_precision_amg_ = param.getDefault("linsolver_single_precision_amg",
+                                                           linsolver_single_precision_amg_);
+        if (linsolver_single_precision_amg_) {
+            linsolver_precision_comparison_ = param.getDefault("linsolver_precision_comparison",
+                                                               linsolver_precision_comparison_);
+        }
+    }
+
+    LinearSolverAmg::~LinearSolverAmg()
+    {}
+
+    LinearSolverInterface::LinearSolverReport
+    LinearSolverAmg::solve(const int size,
+                           const int nonzeros,
+                           const int* ia,
+                           const int* ja,
+                           const double* sa,
+                           const double* rhs,
+                           double* solution) const
+    {
+        return LinearSolverAmg::solveMultiple(size, nonzeros, ia, ja, sa, 1, rhs, solution);
+    }
+
+    LinearSolverInterface::LinearSolverReport
+    LinearSolverAmg::solveMultiple(const int size,
+                                   const int nonzeros,
+                                   const int* ia,
+                                   const int* ja,
+                                   const double* sa,
+                                   const int nrhs,
+                                   const double* rhs,
+                                   double* solution) const
+    {
+        Csr A;
+        A.rows = size;
+        A.cols = size;
+        A.ia.assign(ia, ia + size + 1);
+        A.ja.assign(ja, ja + nonzeros);
+        A.sa.assign(sa, sa + nonzeros);
+
+        if (linsolver_save_system_)
+        {
+            // Save system to files.
+            CSRMatrix M;
+            M.m = size;
+            M.nnz = nonzeros;
+            M.ia = const_cast<int*>(ia);
+            M.ja = const_cast<int*>(ja);
+            M.sa = const_cast<double*>(sa);
+            csrmatrix_write(&M, (linsolver_save_filename_ + "-mat").c_str());
+            vector_write(std::size_t(nrhs)*size, rhs, (linsolver_save_filename_ + "-rhs").c_str());
+        }
+
+        int maxit = linsolver_max_iterations_;
+        if (maxit == 0) {
+            maxit = 5000;
+        }
+
+        AmgOptions opt;
+        opt.theta = linsolver_amg_strength_;
+        opt.coarse_size = linsolver_amg_coarse_size_;
+        opt.smooth_steps = linsolver_smooth_steps_;
+        opt.gauss_seidel = (linsolver_amg_smoother_ == GaussSeidel);
+        opt.prolongate_factor = linsolver_prolongate_factor_;
+        opt.verbosity = linsolver_verbosity_;
+
+        const std::size_t n = std::size_t(nrhs)*size;
+        if (!linsolver_warm_start_) {
+            std::fill(solution, solution + n, 0.0);
+        }
+        if (!linsolver_single_precision_amg_) {
+            return solveAll<double>(A, opt, nrhs, rhs, solution,
+                                    linsolver_residual_tolerance_, maxit);
+        }
+
+        std::vector<double> guess;
+        if (linsolver_precision_comparison_) {
+            guess.assign(solution, solution + n);
+        }
+        LinearSolverReport res = solveAll<float>(A, opt, nrhs, rhs, solution,
+                                                 linsolver_residual_tolerance_, maxit);
+        if (linsolver_precision_comparison_) {
+            const LinearSolverReport ref = solveAll<double>(A, opt, nrhs, rhs, &guess[0],
+                                                            linsolver_residual_tolerance_, maxit);
+            res.reference_iterations = ref.iterations;
+            if (linsolver_verbosity_ > 0) {
+                std::cout << "LinearSolverAmg: single precision preconditioner used "
+                          << res.iterations << " iterations, double precision "
+                          << ref.iterations << std::endl;
+            }
+        }
+        return res;
+    }
+
+    void LinearSolverAmg::setTolerance(const double tol)
+    {
+        linsolver_residual_tolerance_ = tol;
+    }
+
+    double LinearSolverAmg::getTolerance() const
+    {
+        return linsolver_residual_tolerance_;
+    }
+
+
+
+} // namespace Opm
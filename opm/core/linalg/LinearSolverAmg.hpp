@@ -0,0 +1,165 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_LINEARSOLVERAMG_HEADER_INCLUDED
+#define OPM_LINEARSOLVERAMG_HEADER_INCLUDED
+
+
+#include <opm/core/linalg/LinearSolverInterface.hpp>
+#include <string>
+
+
+namespace Opm
+{
+
+    namespace parameter { class ParameterGroup; }
+
+
+    /// Concrete class implementing a conjugate gradient solver
+    /// preconditioned by a smoothed aggregation algebraic multigrid
+    /// V-cycle. It has no external dependencies and is intended for
+    /// the symmetric positive (semi-)definite systems produced by the
+    /// pressure solvers. Sparse matrix-vector products, Jacobi
+    /// smoothing and vector operations are parallelised with OpenMP.
+    class LinearSolverAmg : public LinearSolverInterface
+    {
+    public:
+        /// Default constructor.
+        /// All parameters controlling the solver are defaulted:
+        ///   linsolver_residual_tolerance  1e-8
+        ///   linsolver_verbosity           0
+        ///   linsolver_save_system         false
+        ///   linsolver_save_filename       <empty string>
+        ///   linsolver_max_iterations      0 (unlimited=5000)
+        ///   linsolver_smooth_steps        2
+        ///   linsolver_prolongate_factor   1.0
+        ///   linsolver_amg_smoother        1 ( = GaussSeidel), alternatives are:
+        ///                                 Jacobi = 0, GaussSeidel = 1
+        ///   linsolver_amg_strength        0.08
+        ///   linsolver_amg_coarse_size     200
+        ///   linsolver_warm_start          false
+        ///   linsolver_single_precision_amg  false
+        ///   linsolver_precision_comparison  false
+        /// The parameter linsolver_type of LinearSolverIstl is accepted
+        /// but ignored, this class always uses AMG-preconditioned CG.
+        /// Since the prolongation operator is smoothed the coarse grid
+        /// correction needs no damping, hence the prolongate factor
+        /// defaults to 1.0 rather than 1.6 as in LinearSolverIstl.
+        /// If linsolver_warm_start is true, the incoming contents of
+        /// the solution array are used as initial guess. The residual
+        /// tolerance is always relative to the norm of the right hand
+        /// side.
+        /// If linsolver_single_precision_amg is true, the AMG hierarchy
+        /// is stored and applied in single precision, while the conjugate
+        /// gradient iteration stays in double precision. If in addition
+        /// linsolver_precision_comparison is true, every solve is repeated
+        /// with a double precision hierarchy and its iteration count is
+        /// returned as reference_iterations in the report.
+        LinearSolverAmg();
+
+        /// Construct from parameters
+        /// Accepted parameters are, with defaults, listed in the
+        /// default constructor.
+        LinearSolverAmg(const parameter::ParameterGroup& param);
+
+        /// Destructor.
+        virtual ~LinearSolverAmg();
+
+        using LinearSolverInterface::solve;
+        using LinearSolverInterface::solveMultiple;
+
+        /// Solve a linear system, with a matrix given in compressed sparse row format.
+        /// \param[in] size        # of rows in matrix
+        /// \param[in] nonzeros    # of nonzeros elements in matrix
+        /// \param[in] ia          array of length (size + 1) containing start and end indices for each row
+        /// \param[in] ja          array of length nonzeros containing column numbers for the nonzero elements
+        /// \param[in] sa          array of length nonzeros containing the values of the nonzero elements
+        /// \param[in] rhs         array of length size containing the right hand side
+        /// \param[inout] solution array of length size to which the solution will be written, may also be used
+        ///                        as initial guess by iterative solvers.
+        virtual LinearSolverReport solve(const int size,
+                                         const int nonzeros,
+                                         const int* ia,
+                                         const int* ja,
+                                         const double* sa,
+                                         const double* rhs,
+                                         double* solution) const;
+
+        /// Solve a linear system with several right hand sides, with a
+        /// matrix given in compressed sparse row format.
+        /// The AMG hierarchy is set up once and reused for all right
+        /// hand sides.
+        /// \param[in] size        # of rows in matrix
+        /// \param[in] nonzeros    # of nonzeros elements in matrix
+        /// \param[in] ia          array of length (size + 1) containing start and end indices for each row
+        /// \param[in] ja          array of length nonzeros containing column numbers for the nonzero elements
+        /// \param[in] sa          array of length nonzeros containing the values of the nonzero elements
+        /// \param[in] nrhs        # of right hand sides
+        /// \param[in] rhs         array of length nrhs*size containing the right hand sides,
+        ///                        each stored contiguously
+        /// \param[inout] solution array of length nrhs*size to which the solutions will be
+        ///                        written in the same layout as rhs, may also be used as
+        ///                        initial guesses if linsolver_warm_start is true.
+        virtual LinearSolverReport solveMultiple(const int size,
+                                                 const int nonzeros,
+                                                 const int* ia,
+                                                 const int* ja,
+                                                 const double* sa,
+                                                 const int nrhs,
+                                                 const double* rhs,
+                                                 double* solution) const;
+
+        /// Set tolerance for the residual in the linear solver.
+        /// \param[in] tol         tolerance value
+        virtual void setTolerance(const double tol);
+
+        /// Get tolerance of the linear solver.
+        /// \param[out] tolerance value
+        virtual double getTolerance() const;
+
+    private:
+        double linsolver_residual_tolerance_;
+        int linsolver_verbosity_;
+        bool linsolver_save_system_;
+        std::string linsolver_save_filename_;
+        int linsolver_max_iterations_;
+        /** \brief The number smoothing steps to apply in AMG. */
+        int linsolver_smooth_steps_;
+        /** \brief The factor to scale the coarse grid correction with. */
+        double linsolver_prolongate_factor_;
+        enum Smoother { Jacobi = 0, GaussSeidel = 1 };
+        Smoother linsolver_amg_smoother_;
+        /** \brief Threshold for strong connections in aggregation. */
+        double linsolver_amg_strength_;
+        /** \brief Stop coarsening when a level has at most this many rows. */
+        int linsolver_amg_coarse_size_;
+        /** \brief Use the incoming solution as initial guess. */
+        bool linsolver_warm_start_;
+        /** \brief Store and apply the AMG hierarchy in single precision. */
+        bool linsolver_single_precision_amg_;
+        /** \brief Also solve with double precision AMG, for comparison. */
+        bool linsolver_precision_comparison_;
+    };
+
+
+} // namespace Opm
+
+
+
+#endif // OPM_LINEARSOLVERAMG_HEADER_INCLUDED
@@ -22,6 +22,7 @@
 #endif
 
 #include <opm/core/linalg/LinearSolverFactory.hpp>
+#include <opm/core/linalg/LinearSolverAmg.hpp>
 
 #if HAVE_SUITESPARSE_UMFPACK_H
 #include <opm/core/linalg/LinearSolverUmfpack.hpp>
@@ -46,7 +47,7 @@ namespace Opm
 #elif HAVE_DUNE_ISTL
         solver_.reset(new LinearSolverIstl);
 #else
-        OPM_THROW(std::runtime_error, "No linear solver available, you must have UMFPACK or dune-istl installed to use LinearSolverFactory.");
+        solver_.reset(new LinearSolverAmg);
 #endif
     }
 
@@ -55,8 +56,15 @@ namespace Opm
 
     LinearSolverFactory::LinearSolverFactory(const parameter::ParameterGroup& param)
     {
+#if HAVE_SUITESPARSE_UMFPACK_H
+        const std::string default_solver = "umfpack";
+#elif HAVE_DUNE_ISTL
+        const std::string default_solver = "istl";
+#else
+        const std::string default_solver = "amg";
+#endif
         const std::string ls =
-            param.getDefault<std::string>("linsolver", "umfpack");
+            param.getDefault<std::string>("linsolver", default_solver);
 
         if (ls == "umfpack") {
 #if HAVE_SUITESPARSE_UMFPACK_H
@@ -70,6 +78,10 @@ namespace Opm
 #endif
         }
 
+        else if (ls == "amg") {
+            solver_.reset(new LinearSolverAmg(param));
+        }
+
         else {
             OPM_THROW(std::runtime_error, "Linear solver " << ls << " is unknown.");
         }
@@ -102,6 +114,22 @@ namespace Opm
         return solver_->solve(size, nonzeros, ia, ja, sa, rhs, solution);
     }
 
+
+
+
+    LinearSolverInterface::LinearSolverReport
+    LinearSolverFactory::solveMultiple(const int size,
+                                       const int nonzeros,
+                                       const int* ia,
+                                       const int* ja,
+                                       const double* sa,
+                                       const int nrhs,
+                                       const double* rhs,
+                                       double* solution) const
+    {
+        return solver_->solveMultiple(size, nonzeros, ia, ja, sa, nrhs, rhs, solution);
+    }
+
     void LinearSolverFactory::setTolerance(const double tol)
     {
         solver_->setTolerance(tol);
@@ -31,18 +31,23 @@ namespace Opm
 
 
     /// Concrete class encapsulating any available linear solver.
-    /// For the moment, this means UMFPACK and dune-istl.
-    /// Since both are optional dependencies, either or both
-    /// may be unavailable, depending on configuration.
+    /// For the moment, this means UMFPACK, dune-istl and the
+    /// built-in AMG solver. Since the first two are optional
+    /// dependencies, either or both may be unavailable, depending
+    /// on configuration. The AMG solver is always available.
     class LinearSolverFactory : public LinearSolverInterface
     {
     public:
         /// Default constructor.
+        /// Uses UMFPACK if available, otherwise dune-istl if
+        /// available, otherwise LinearSolverAmg.
         LinearSolverFactory();
 
         /// Construct from parameters.
         /// The accepted parameters are (default) (allowed values):
-        ///    linsolver ("umfpack")   ("umfpack", "istl")
+        ///    linsolver ("umfpack")   ("umfpack", "istl", "amg")
+        /// If UMFPACK is not available, the default is "istl", and
+        /// if neither UMFPACK nor dune-istl are available it is "amg".
         /// For the umfpack solver to be available, this class must be
         /// compiled with UMFPACK support, as indicated by the
         /// variable HAVE_SUITESPARSE_UMFPACK_H in config.h.
@@ -50,14 +55,15 @@ namespace Opm
         /// compiled with dune-istl support, as indicated by the
         /// variable HAVE_DUNE_ISTL in config.h.
         /// Any further parameters are passed on to the constructors
-        /// of the actual solver used, see LinearSolverUmfpack
-        /// and LinearSolverIstl for details.
+        /// of the actual solver used, see LinearSolverUmfpack,
+        /// LinearSolverIstl and LinearSolverAmg for details.
         LinearSolverFactory(const parameter::ParameterGroup& param);
 
         /// Destructor.
         virtual ~LinearSolverFactory();
 
         using LinearSolverInterface::solve;
+        using LinearSolverInterface::solveMultiple;
 
         /// Solve a linear system, with a matrix given in compressed sparse row format.
         /// \param[in] size        # of rows in matrix
@@ -76,6 +82,29 @@ namespace Opm
                                          const double* rhs,
                                          double* solution) const;
 
+        /// Solve a linear system with several right hand sides, with a
+        /// matrix given in compressed sparse row format.
+        /// Forwarded to the actual solver used.
+        /// \param[in] size        # of rows in matrix
+        /// \param[in] nonzeros    # of nonzeros elements in matrix
+        /// \param[in] ia          array of length (size + 1) containing start and end indices for each row
+        /// \param[in] ja          array of length nonzeros containing column numbers for the nonzero elements
+        /// \param[in] sa          array of length nonzeros containing the values of the nonzero elements
+        /// \param[in] nrhs        # of right hand sides
+        /// \param[in] rhs         array of length nrhs*size containing the right hand sides,
+        ///                        each stored contiguously
+        /// \param[inout] solution array of length nrhs*size to which the solutions will be
+        ///                        written in the same layout as rhs, may also be used as
+        ///                        initial guesses by iterative solvers.
+        virtual LinearSolverReport solveMultiple(const int size,
+                                                 const int nonzeros,
+                                                 const int* ia,
+                                                 const int* ja,
+                                                 const double* sa,
+                                                 const int nrhs,
+                                                 const double* rhs,
+                                                 double* solution) const;
+
         /// Set tolerance for the linear solver.
         /// \param[in] tol         tolerance value
         /// Not used for LinearSolverFactory
@@ -22,6 +22,8 @@
 #include <opm/core/linalg/LinearSolverInterface.hpp>
 #include <opm/core/linalg/sparse_sys.h>
 #include <opm/core/linalg/call_umfpack.h>
+#include <opm/core/utility/Profiler.hpp>
+#include <algorithm>
 
 namespace Opm
 {
@@ -38,8 +40,53 @@ namespace Opm
                                  const double* rhs,
                                  double* solution) const
     {
+        OPM_PROFILE_SCOPE("linsolve/solve");
         return solve(A->m, A->nnz, A->ia, A->ja, A->sa, rhs, solution);
     }
 
+
+
+
+    LinearSolverInterface::LinearSolverReport
+    LinearSolverInterface::solveMultiple(const CSRMatrix* A,
+                                         const int nrhs,
+                                         const double* rhs,
+                                         double* solution) const
+    {
+        return solveMultiple(A->m, A->nnz, A->ia, A->ja, A->sa, nrhs, rhs, solution);
+    }
+
+
+
+
+    LinearSolverInterface::LinearSolverReport
+    LinearSolverInterface::solveMultiple(const int size,
+                                         const int nonzeros,
+                                         const int* ia,
+                                         const int* ja,
+                                         const double* sa,
+                                         const int nrhs,
+                                         const double* rhs,
+                                         double* solution) const
+    {
+        LinearSolverReport res;
+        res.converged = true;
+        res.iterations = 0;
+        res.residual_reduction = 0.0;
+        res.true_residual_reduction = 0.0;
+        res.reference_iterations = 0;
+        for (int k = 0; k < nrhs; ++k) {
+            const LinearSolverReport r = solve(size, nonzeros, ia, ja, sa,
+                                               rhs + k*size, solution + k*size);
+            res.converged = res.converged && r.converged;
+            res.iterations += r.iterations;
+            res.residual_reduction = std::max(res.residual_reduction, r.residual_reduction);
+            res.true_residual_reduction = std::max(res.true_residual_reduction,
+                                                   r.true_residual_reduction);
+            res.reference_iterations += r.reference_iterations;
+        }
+        return res;
+    }
+
 } // namespace Opm
 
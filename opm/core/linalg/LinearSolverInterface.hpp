@@ -37,11 +37,19 @@ namespace Opm
         /// Struct for reporting data about the solution process back
         /// to the caller. The only field that is mandatory to set is
         /// 'converged' (even for direct solvers) to indicate success.
+        /// The field 'true_residual_reduction' is |b - Ax|/|b| evaluated
+        /// in double precision from the returned solution. It may differ
+        /// from 'residual_reduction' when the preconditioner is applied
+        /// in reduced precision. The field 'reference_iterations' is the
+        /// number of iterations of a double precision reference solve,
+        /// when such a comparison was requested, and zero otherwise.
         struct LinearSolverReport
         {
             bool converged;
             int iterations;
             double residual_reduction;
+            double true_residual_reduction;
+            int reference_iterations;
         };
 
         /// Solve a linear system, with a matrix given in compressed sparse row format.
@@ -71,6 +79,49 @@ namespace Opm
                                          const double* rhs,
                                          double* solution) const = 0;
 
+        /// Solve a linear system with several right hand sides, with a
+        /// matrix given in compressed sparse row format.
+        /// \param[in] A           matrix in CSR format
+        /// \param[in] nrhs        # of right hand sides
+        /// \param[in] rhs         array of length nrhs*A->m containing the right hand sides,
+        ///                        each stored contiguously
+        /// \param[inout] solution array of length nrhs*A->m to which the solutions will be
+        ///                        written in the same layout as rhs, may also be used as
+        ///                        initial guesses by iterative solvers.
+        /// Note: this method is a convenience method that calls the virtual solveMultiple() method.
+        LinearSolverReport solveMultiple(const CSRMatrix* A,
+                                         const int nrhs,
+                                         const double* rhs,
+                                         double* solution) const;
+
+        /// Solve a linear system with several right hand sides, with a
+        /// matrix given in compressed sparse row format.
+        /// The default implementation calls solve() once for each right
+        /// hand side. Solvers that can reuse a factorization or a
+        /// preconditioner between right hand sides override it.
+        /// The report is converged only if all systems converged, the
+        /// iterations are summed and the residual reduction is the
+        /// largest of the individual reductions.
+        /// \param[in] size        # of rows in matrix
+        /// \param[in] nonzeros    # of nonzeros elements in matrix
+        /// \param[in] ia          array of length (size + 1) containing start and end indices for each row
+        /// \param[in] ja          array of length nonzeros containing column numbers for the nonzero elements
+        /// \param[in] sa          array of length nonzeros containing the values of the nonzero elements
+        /// \param[in] nrhs        # of right hand sides
+        /// \param[in] rhs         array of length nrhs*size containing the right hand sides,
+        ///                        each stored contiguously
+        /// \param[inout] solution array of length nrhs*size to which the solutions will be
+        ///                        written in the same layout as rhs, may also be used as
+        ///                        initial guesses by iterative solvers.
+        virtual LinearSolverReport solveMultiple(const int size,
+                                                 const int nonzeros,
+                                                 const int* ia,
+                                                 const int* ja,
+                                                 const double* sa,
+                                                 const int nrhs,
+                                                 const double* rhs,
+                                                 double* solution) const;
+
         /// Set tolerance for the linear solver.
         /// \param[in] tol         tolerance value
         virtual void setTolerance(const double tol) = 0;
@@ -39,8 +39,10 @@
 #include <dune/istl/paamg/amg.hh>
 #include <dune/istl/paamg/kamg.hh>
 
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
+#include <vector>
 
 
 namespace Opm
@@ -54,25 +56,189 @@ namespace Opm
         typedef Dune::BlockVector<VectorBlockType>        Vector;
         typedef Dune::MatrixAdapter<Mat,Vector,Vector> Operator;
 
+        // Right hand sides and solutions sharing one matrix, with
+        // the tolerance to apply when solving for each of them.
+        struct SystemSet
+        {
+            std::vector<Vector> x;
+            std::vector<Vector> b;
+            std::vector<double> tolerance;
+            std::vector<double> defect_scale;
+            std::vector<bool> solved;
+        };
+
+        // Solve each system in turn, reusing the preconditioner.
+        template <template <class> class Solver, class Precond>
+        LinearSolverInterface::LinearSolverReport
+        solveSystems(Operator& opA, Precond& precond, SystemSet& sys, int maxit, int verbosity)
+        {
+            LinearSolverInterface::LinearSolverReport res;
+            res.converged = true;
+            res.iterations = 0;
+            res.residual_reduction = 0.0;
+            res.true_residual_reduction = 0.0;
+            res.reference_iterations = 0;
+            for (std::size_t k = 0; k < sys.x.size(); ++k) {
+                double reduction = sys.defect_scale[k];
+                if (!sys.solved[k]) {
+                    Solver<Vector> linsolve(opA, precond, sys.tolerance[k], maxit, verbosity);
+                    Dune::InverseOperatorResult result;
+                    linsolve.apply(sys.x[k], sys.b[k], result);
+                    res.converged = res.converged && result.converged;
+                    res.iterations += result.iterations;
+                    reduction *= result.reduction;
+                }
+                res.residual_reduction = std::max(res.residual_reduction, reduction);
+            }
+            return res;
+        }
+
+        // Matrix, vector and operator types for a preconditioner
+        // built with elements of type Field.
+        template <class Field>
+        struct PrecondTypes
+        {
+            typedef Dune::BCRSMatrix<Dune::FieldMatrix<Field, 1, 1> > Matrix;
+            typedef Dune::BlockVector<Dune::FieldVector<Field, 1> >   Vector;
+            typedef Dune::MatrixAdapter<Matrix, Vector, Vector>       Operator;
+        };
+
+        // The system matrix in the precision of the preconditioner.
+        template <class Field>
+        class PrecondMatrix
+        {
+        public:
+            typedef typename PrecondTypes<Field>::Matrix Matrix;
+            explicit PrecondMatrix(const Mat& A)
+                : M_(A.N(), A.M(), A.nonzeroes(), Matrix::row_wise)
+            {
+                for (typename Matrix::CreateIterator row = M_.createbegin(); row != M_.createend(); ++row) {
+                    const Mat::row_type& arow = A[row.index()];
+                    for (Mat::ConstColIterator col = arow.begin(); col != arow.end(); ++col) {
+                        row.insert(col.index());
+                    }
+                }
+                for (Mat::ConstRowIterator row = A.begin(); row != A.end(); ++row) {
+                    for (Mat::ConstColIterator col = row->begin(); col != row->end(); ++col) {
+                        M_[row.index()][col.index()][0][0] = (*col)[0][0];
+                    }
+                }
+            }
+            const Matrix& matrix() const { return M_; }
+        private:
+            Matrix M_;
+        };
+
+        // In double precision the system matrix is used directly.
+        template <>
+        class PrecondMatrix<double>
+        {
+        public:
+            explicit PrecondMatrix(const Mat& A) : A_(A) {}
+            const Mat& matrix() const { return A_; }
+        private:
+            const Mat& A_;
+        };
+
+        template <class V1, class V2>
+        void copyVector(const V1& from, V2& to)
+        {
+            for (std::size_t i = 0; i < from.size(); ++i) {
+                to[i][0] = from[i][0];
+            }
+        }
+
+        // Applies a preconditioner built in another precision to
+        // double precision vectors, so that the Krylov solver itself
+        // stays in double precision.
+        template <class Precond, class Field>
+        class PrecisionAdapter : public Dune::Preconditioner<Vector, Vector>
+        {
+        public:
+            enum { category = Dune::SolverCategory::sequential };
+
+            PrecisionAdapter(Precond& precond, const std::size_t size)
+                : precond_(precond), x_(size), b_(size), xpre_(size)
+            {
+            }
+
+            // The right hand side b belongs to the Krylov solver and is
+            // never written back, and of x only the entries changed by
+            // the preconditioner are, so that neither is rounded to the
+            // precision of the preconditioner.
+            virtual void pre(Vector& x, Vector& b)
+            {
+                copyVector(x, x_);
+                copyVector(b, b_);
+                xpre_ = x_;
+                precond_.pre(x_, b_);
+                for (std::size_t i = 0; i < x.size(); ++i) {
+                    if (x_[i][0] != xpre_[i][0]) {
+                        x[i][0] = x_[i][0];
+                    }
+                }
+            }
+
+            virtual void apply(Vector& v, const Vector& d)
+            {
+                copyVector(d, b_);
+                x_ = 0.0;
+                precond_.apply(x_, b_);
+                copyVector(x_, v);
+            }
+
+            virtual void post(Vector& x)
+            {
+                copyVector(x, x_);
+                precond_.post(x_);
+            }
+
+        private:
+            Precond& precond_;
+            typename PrecondTypes<Field>::Vector x_;
+            typename PrecondTypes<Field>::Vector b_;
+            typename PrecondTypes<Field>::Vector xpre_;
+        };
+
+        // Solve all systems with a double precision preconditioner.
+        template <template <class> class Solver, class Precond>
+        LinearSolverInterface::LinearSolverReport
+        solveSystemsIn(double, Operator& opA, Precond& precond, SystemSet& sys, int maxit, int verbosity)
+        {
+            return solveSystems<Solver>(opA, precond, sys, maxit, verbosity);
+        }
+
+        // Solve all systems with a single precision preconditioner.
+        template <template <class> class Solver, class Precond>
         LinearSolverInterface::LinearSolverReport
-        solveCG_ILU0(const Mat& A, Vector& x, Vector& b, double tolerance, int maxit, int verbosity);
+        solveSystemsIn(float, Operator& opA, Precond& precond, SystemSet& sys, int maxit, int verbosity)
+        {
+            PrecisionAdapter<Precond, float> adapter(precond, sys.x.empty() ? 0 : sys.x[0].size());
+            return solveSystems<Solver>(opA, adapter, sys, maxit, verbosity);
+        }
 
         LinearSolverInterface::LinearSolverReport
-        solveCG_AMG(const Mat& A, Vector& x, Vector& b, double tolerance, int maxit, int verbosity,
+        solveCG_ILU0(const Mat& A, SystemSet& sys, int maxit, int verbosity);
+
+        template <class Field>
+        LinearSolverInterface::LinearSolverReport
+        solveCG_AMG(const Mat& A, SystemSet& sys, int maxit, int verbosity,
                     double prolongateFactor, int smoothsteps);
 
 #ifdef HAS_DUNE_FAST_AMG
+        template <class Field>
         LinearSolverInterface::LinearSolverReport
-        solveKAMG(const Mat& A, Vector& x, Vector& b, double tolerance, int maxit, int verbosity,
+        solveKAMG(const Mat& A, SystemSet& sys, int maxit, int verbosity,
                   double prolongateFactor, int smoothsteps);
 
+        template <class Field>
         LinearSolverInterface::LinearSolverReport
-        solveFastAMG(const Mat& A, Vector& x, Vector& b, double tolerance, int maxit, int verbosity,
+        solveFastAMG(const Mat& A, SystemSet& sys, int maxit, int verbosity,
                      double prolongateFactor);
 #endif
 
         LinearSolverInterface::LinearSolverReport
-        solveBiCGStab_ILU0(const Mat& A, Vector& x, Vector& b, double tolerance, int maxit, int verbosity);
+        solveBiCGStab_ILU0(const Mat& A, SystemSet& sys, int maxit, int verbosity);
     } // anonymous namespace
 
 
@@ -85,7 +251,10 @@ namespace Opm
           linsolver_save_system_(false),
           linsolver_max_iterations_(0),
           linsolver_smooth_steps_(2),
-          linsolver_prolongate_factor_(1.6)
+          linsolver_prolongate_factor_(1.6),
+          linsolver_warm_start_(false),
+          linsolver_single_precision_amg_(false),
+          linsolver_precision_comparison_(false)
     {
     }
 
@@ -99,7 +268,10 @@ namespace Opm
           linsolver_save_system_(false),
           linsolver_max_iterations_(0),
           linsolver_smooth_steps_(2),
-          linsolver_prolongate_factor_(1.6)
+          linsolver_prolongate_factor_(1.6),
+          linsolver_warm_start_(false),
+          linsolver_single_precision_amg_(false),
+          linsolver_precision_comparison_(false)
     {
         linsolver_residual_tolerance_ = param.getDefault("linsolver_residual_tolerance", linsolver_residual_tolerance_);
         linsolver_verbosity_ = param.getDefault("linsolver_verbosity", linsolver_verbosity_);
@@ -111,6 +283,11 @@ namespace Opm
         linsolver_max_iterations_ = param.getDefault("linsolver_max_iterations", linsolver_max_iterations_);
         linsolver_smooth_steps_ = param.getDefault("linsolver_smooth_steps", linsolver_smooth_steps_);
         linsolver_prolongate_factor_ = param.getDefault("linsolver_prolongate_factor", linsolver_prolongate_factor_);
+        linsolver_warm_start_ = param.getDefault("linsolver_warm_start", linsolver_warm_start_);
+        linsolver_single_precision_amg_ = param.getDefault("linsolver_single_precision_amg", linsolver_single_precision_amg_);
+        if (linsolver_single_precision_amg_) {
+            linsolver_precision_comparison_ = param.getDefault("linsolver_precision_comparison", linsolver_precision_comparison_);
+        }
     }
 
     LinearSolverIstl::~LinearSolverIstl()
@@ -124,6 +301,19 @@ namespace Opm
                             const double* sa,
                             const double* rhs,
                             double* solution) const
+    {
+        return LinearSolverIstl::solveMultiple(size, nonzeros, ia, ja, sa, 1, rhs, solution);
+    }
+
+    LinearSolverInterface::LinearSolverReport
+    LinearSolverIstl::solveMultiple(const int size,
+                                    const int nonzeros,
+                                    const int* ia,
+                                    const int* ja,
+                                    const double* sa,
+                                    const int nrhs,
+                                    const double* rhs,
+                                    double* solution) const
     {
         // Build Istl structures from input.
         // System matrix
@@ -139,12 +329,21 @@ namespace Opm
                 A[ri][ja[i]] = sa[i];
             }
         }
-        // System RHS
-        Vector b(size);
-        std::copy(rhs, rhs + size, b.begin());
-        // System solution
-        Vector x(size);
-        x = 0.0;
+        // System right hand sides and solutions
+        SystemSet sys;
+        sys.x.assign(nrhs, Vector(size));
+        sys.b.assign(nrhs, Vector(size));
+        sys.tolerance.assign(nrhs, linsolver_residual_tolerance_);
+        sys.defect_scale.assign(nrhs, 1.0);
+        sys.solved.assign(nrhs, false);
+        for (int k = 0; k < nrhs; ++k) {
+            std::copy(rhs + k*size, rhs + (k + 1)*size, sys.b[k].begin());
+            if (linsolver_warm_start_) {
+                std::copy(solution + k*size, solution + (k + 1)*size, sys.x[k].begin());
+            } else {
+                sys.x[k] = 0.0;
+            }
+        }
 
         if (linsolver_save_system_)
         {
@@ -154,8 +353,10 @@ namespace Opm
             std::ofstream rhsf(rhsfile.c_str());
             rhsf.precision(15);
             rhsf.setf(std::ios::scientific | std::ios::showpos);
-            std::copy(b.begin(), b.end(),
-                      std::ostream_iterator<VectorBlockType>(rhsf, "\n"));
+            for (int k = 0; k < nrhs; ++k) {
+                std::copy(sys.b[k].begin(), sys.b[k].end(),
+                          std::ostream_iterator<VectorBlockType>(rhsf, "\n"));
+            }
         }
 
         int maxit = linsolver_max_iterations_;
@@ -163,42 +364,106 @@ namespace Opm
             maxit = 5000;
         }
 
-        LinearSolverReport res;
-        switch (linsolver_type_) {
-        case CG_ILU0:
-            res = solveCG_ILU0(A, x, b, linsolver_residual_tolerance_, maxit, linsolver_verbosity_);
-            break;
-        case CG_AMG:
-            res = solveCG_AMG(A, x, b, linsolver_residual_tolerance_, maxit, linsolver_verbosity_,
-                              linsolver_prolongate_factor_, linsolver_smooth_steps_);
-            break;
-        case KAMG:
+        // With a warm start, the dune-istl solvers measure the reduction
+        // relative to the initial defect. Rescale the tolerance so that
+        // it applies to the norm of the right hand side, otherwise a good
+        // initial guess would not save any iterations.
+        if (linsolver_warm_start_) {
+            for (int k = 0; k < nrhs; ++k) {
+                Vector r(sys.b[k]);
+                A.mmv(sys.x[k], r);
+                const double bnorm = sys.b[k].two_norm();
+                const double rnorm = r.two_norm();
+                if (rnorm >= bnorm) {
+                    // The guess is no better than zero.
+                    sys.x[k] = 0.0;
+                } else if (rnorm <= sys.tolerance[k]*bnorm) {
+                    sys.solved[k] = true;
+                    sys.defect_scale[k] = rnorm/bnorm;
+                } else {
+                    sys.defect_scale[k] = rnorm/bnorm;
+                    sys.tolerance[k] /= sys.defect_scale[k];
+                }
+            }
+        }
+
+        // With a single precision AMG hierarchy, optionally repeat the
+        // solve in double precision to report the iteration impact.
+        const bool single = linsolver_single_precision_amg_
+            && linsolver_type_ != CG_ILU0 && linsolver_type_ != BiCGStab_ILU0;
+        const int nruns = (single && linsolver_precision_comparison_) ? 2 : 1;
+        SystemSet reference;
+        if (nruns == 2) {
+            reference = sys;
+        }
+        LinearSolverReport report[2];
+        for (int run = 0; run < nruns; ++run) {
+            SystemSet& s = (run == 0) ? sys : reference;
+            LinearSolverReport& res = report[run];
+            const bool use_float = single && (run == 0);
+            switch (linsolver_type_) {
+            case CG_ILU0:
+                res = solveCG_ILU0(A, s, maxit, linsolver_verbosity_);
+                break;
+            case CG_AMG:
+                res = use_float
+                    ? solveCG_AMG<float>(A, s, maxit, linsolver_verbosity_,
+                                         linsolver_prolongate_factor_, linsolver_smooth_steps_)
+                    : solveCG_AMG<double>(A, s, maxit, linsolver_verbosity_,
+                                          linsolver_prolongate_factor_, linsolver_smooth_steps_);
+                break;
+            case KAMG:
 #ifdef HAS_DUNE_FAST_AMG
-            res = solveKAMG(A, x, b, linsolver_residual_tolerance_, maxit, linsolver_verbosity_,
-                            linsolver_prolongate_factor_, linsolver_smooth_steps_);
+                res = use_float
+                    ? solveKAMG<float>(A, s, maxit, linsolver_verbosity_,
+                                       linsolver_prolongate_factor_, linsolver_smooth_steps_)
+                    : solveKAMG<double>(A, s, maxit, linsolver_verbosity_,
+                                        linsolver_prolongate_factor_, linsolver_smooth_steps_);
 #else
-            throw std::runtime_error("KAMG not supported with this version of DUNE");
+                throw std::runtime_error("KAMG not supported with this version of DUNE");
 #endif
-            break;
-        case FastAMG:
+                break;
+            case FastAMG:
 #ifdef HAS_DUNE_FAST_AMG
-            res = solveFastAMG(A, x, b, linsolver_residual_tolerance_, maxit, linsolver_verbosity_,
-                               linsolver_prolongate_factor_);
+                res = use_float
+                    ? solveFastAMG<float>(A, s, maxit, linsolver_verbosity_,
+                                          linsolver_prolongate_factor_)
+                    : solveFastAMG<double>(A, s, maxit, linsolver_verbosity_,
+                                           linsolver_prolongate_factor_);
 #else
-            if(linsolver_verbosity_)
-              std::cerr<<"Fast AMG is not available; falling back to CG preconditioned with the normal one"<<std::endl;
-            res = solveCG_AMG(A, x, b, linsolver_residual_tolerance_, maxit, linsolver_verbosity_,
-                               linsolver_prolongate_factor_, linsolver_smooth_steps_);
+                if(linsolver_verbosity_)
+                  std::cerr<<"Fast AMG is not available; falling back to CG preconditioned with the normal one"<<std::endl;
+                res = use_float
+                    ? solveCG_AMG<float>(A, s, maxit, linsolver_verbosity_,
+                                         linsolver_prolongate_factor_, linsolver_smooth_steps_)
+                    : solveCG_AMG<double>(A, s, maxit, linsolver_verbosity_,
+                                          linsolver_prolongate_factor_, linsolver_smooth_steps_);
 #endif
-            break;
-        case BiCGStab_ILU0:
-            res = solveBiCGStab_ILU0(A, x, b, linsolver_residual_tolerance_, maxit, linsolver_verbosity_);
-            break;
-        default:
-            std::cerr << "Unknown linsolver_type: " << int(linsolver_type_) << '\n';
-            throw std::runtime_error("Unknown linsolver_type");
+                break;
+            case BiCGStab_ILU0:
+                res = solveBiCGStab_ILU0(A, s, maxit, linsolver_verbosity_);
+                break;
+            default:
+                std::cerr << "Unknown linsolver_type: " << int(linsolver_type_) << '\n';
+                throw std::runtime_error("Unknown linsolver_type");
+            }
+        }
+        LinearSolverReport res = report[0];
+        res.reference_iterations = (nruns == 2) ? report[1].iterations : 0;
+
+        // Residual of the returned solutions, in double precision.
+        res.true_residual_reduction = 0.0;
+        for (int k = 0; k < nrhs; ++k) {
+            Vector r(size);
+            std::copy(rhs + k*size, rhs + (k + 1)*size, r.begin());
+            const double bnorm = r.two_norm();
+            A.mmv(sys.x[k], r);
+            if (bnorm > 0.0) {
+                res.true_residual_reduction = std::max(res.true_residual_reduction,
+                                                       r.two_norm() / bnorm);
+            }
+            std::copy(sys.x[k].begin(), sys.x[k].end(), solution + k*size);
         }
-        std::copy(x.begin(), x.end(), solution);
         return res;
     }
 
@@ -218,26 +483,15 @@ namespace Opm
     {
 
     LinearSolverInterface::LinearSolverReport
-    solveCG_ILU0(const Mat& A, Vector& x, Vector& b, double tolerance, int maxit, int verbosity)
+    solveCG_ILU0(const Mat& A, SystemSet& sys, int maxit, int verbosity)
     {
         Operator opA(A);
 
         // Construct preconditioner.
         Dune::SeqILU0<Mat,Vector,Vector> precond(A, 1.0);
 
-        // Construct linear solver.
-        Dune::CGSolver<Vector> linsolve(opA, precond, tolerance, maxit, verbosity);
-
-        // Solve system.
-        Dune::InverseOperatorResult result;
-        linsolve.apply(x, b, result);
-
-        // Output results.
-        LinearSolverInterface::LinearSolverReport res;
-        res.converged = result.converged;
-        res.iterations = result.iterations;
-        res.residual_reduction = result.reduction;
-        return res;
+        // Construct linear solver and solve all systems.
+        return solveSystems<Dune::CGSolver>(opA, precond, sys, maxit, verbosity);
     }
 
 
@@ -261,11 +515,15 @@ namespace Opm
         criterion.setGamma(1); // V-cycle; this is the default
     }
 
+    template <class Field>
     LinearSolverInterface::LinearSolverReport
-    solveCG_AMG(const Mat& A, Vector& x, Vector& b, double tolerance, int maxit, int verbosity,
+    solveCG_AMG(const Mat& A, SystemSet& sys, int maxit, int verbosity,
                 double linsolver_prolongate_factor, int linsolver_smooth_steps)
     {
-        // Solve with AMG solver.
+        // Solve with AMG solver, the hierarchy built in precision Field.
+        typedef typename PrecondTypes<Field>::Matrix   PMat;
+        typedef typename PrecondTypes<Field>::Vector   PVector;
+        typedef typename PrecondTypes<Field>::Operator POperator;
 
 #if FIRST_DIAGONAL
         typedef Dune::Amg::FirstDiagonal CouplingMetric;
@@ -274,49 +532,44 @@ namespace Opm
 #endif
 
 #if SYMMETRIC
-        typedef Dune::Amg::SymmetricCriterion<Mat,CouplingMetric>   CriterionBase;
+        typedef Dune::Amg::SymmetricCriterion<PMat,CouplingMetric>   CriterionBase;
 #else
-        typedef Dune::Amg::UnSymmetricCriterion<Mat,CouplingMetric> CriterionBase;
+        typedef Dune::Amg::UnSymmetricCriterion<PMat,CouplingMetric> CriterionBase;
 #endif
 
 #if SMOOTHER_ILU
-        typedef Dune::SeqILU0<Mat,Vector,Vector>        Smoother;
+        typedef Dune::SeqILU0<PMat,PVector,PVector>      Smoother;
 #else
-        typedef Dune::SeqSOR<Mat,Vector,Vector>        Smoother;
+        typedef Dune::SeqSOR<PMat,PVector,PVector>       Smoother;
 #endif
         typedef Dune::Amg::CoarsenCriterion<CriterionBase> Criterion;
-        typedef Dune::Amg::AMG<Operator,Vector,Smoother>   Precond;
+        typedef Dune::Amg::AMG<POperator,PVector,Smoother> Precond;
 
         // Construct preconditioner.
         Criterion criterion;
-        Precond::SmootherArgs smootherArgs;
+        typename Precond::SmootherArgs smootherArgs;
         Operator opA(A);
+        const PrecondMatrix<Field> pA(A);
+        POperator opP(pA.matrix());
         setUpCriterion(criterion, linsolver_prolongate_factor, verbosity,
                        linsolver_smooth_steps);
-        Precond precond(opA, criterion, smootherArgs);
-
-        // Construct linear solver.
-        Dune::CGSolver<Vector> linsolve(opA, precond, tolerance, maxit, verbosity);
+        Precond precond(opP, criterion, smootherArgs);
 
-        // Solve system.
-        Dune::InverseOperatorResult result;
-        linsolve.apply(x, b, result);
-
-        // Output results.
-        LinearSolverInterface::LinearSolverReport res;
-        res.converged = result.converged;
-        res.iterations = result.iterations;
-        res.residual_reduction = result.reduction;
-        return res;
+        // Construct linear solver and solve all systems.
+        return solveSystemsIn<Dune::CGSolver>(Field(), opA, precond, sys, maxit, verbosity);
     }
 
 
 #ifdef HAS_DUNE_FAST_AMG
+    template <class Field>
     LinearSolverInterface::LinearSolverReport
-    solveKAMG(const Mat& A, Vector& x, Vector& b, double tolerance, int maxit, int verbosity,
+    solveKAMG(const Mat& A, SystemSet& sys, int maxit, int verbosity,
               double linsolver_prolongate_factor, int linsolver_smooth_steps)
     {
-        // Solve with AMG solver.
+        // Solve with AMG solver, the hierarchy built in precision Field.
+        typedef typename PrecondTypes<Field>::Matrix   PMat;
+        typedef typename PrecondTypes<Field>::Vector   PVector;
+        typedef typename PrecondTypes<Field>::Operator POperator;
 
 #if FIRST_DIAGONAL
         typedef Dune::Amg::FirstDiagonal CouplingMetric;
@@ -325,47 +578,42 @@ namespace Opm
 #endif
 
 #if SYMMETRIC
-        typedef Dune::Amg::SymmetricCriterion<Mat,CouplingMetric>   CriterionBase;
+        typedef Dune::Amg::SymmetricCriterion<PMat,CouplingMetric>   CriterionBase;
 #else
-        typedef Dune::Amg::UnSymmetricCriterion<Mat,CouplingMetric> CriterionBase;
+        typedef Dune::Amg::UnSymmetricCriterion<PMat,CouplingMetric> CriterionBase;
 #endif
 
 #if SMOOTHER_ILU
-        typedef Dune::SeqILU0<Mat,Vector,Vector>        Smoother;
+        typedef Dune::SeqILU0<PMat,PVector,PVector>      Smoother;
 #else
-        typedef Dune::SeqSOR<Mat,Vector,Vector>        Smoother;
+        typedef Dune::SeqSOR<PMat,PVector,PVector>       Smoother;
 #endif
         typedef Dune::Amg::CoarsenCriterion<CriterionBase> Criterion;
-        typedef Dune::Amg::KAMG<Operator,Vector,Smoother,Dune::Amg::SequentialInformation>   Precond;
+        typedef Dune::Amg::KAMG<POperator,PVector,Smoother,Dune::Amg::SequentialInformation> Precond;
 
         // Construct preconditioner.
         Operator opA(A);
-        Precond::SmootherArgs smootherArgs;
+        const PrecondMatrix<Field> pA(A);
+        POperator opP(pA.matrix());
+        typename Precond::SmootherArgs smootherArgs;
         Criterion criterion;
         setUpCriterion(criterion, linsolver_prolongate_factor, verbosity,
                        linsolver_smooth_steps);
-        Precond precond(opA, criterion, smootherArgs);
-
-        // Construct linear solver.
-        Dune::GeneralizedPCGSolver<Vector> linsolve(opA, precond, tolerance, maxit, verbosity);
-
-        // Solve system.
-        Dune::InverseOperatorResult result;
-        linsolve.apply(x, b, result);
+        Precond precond(opP, criterion, smootherArgs);
 
-        // Output results.
-        LinearSolverInterface::LinearSolverReport res;
-        res.converged = result.converged;
-        res.iterations = result.iterations;
-        res.residual_reduction = result.reduction;
-        return res;
+        // Construct linear solver and solve all systems.
+        return solveSystemsIn<Dune::GeneralizedPCGSolver>(Field(), opA, precond, sys, maxit, verbosity);
     }
 
+    template <class Field>
     LinearSolverInterface::LinearSolverReport
-    solveFastAMG(const Mat& A, Vector& x, Vector& b, double tolerance, int maxit, int verbosity,
+    solveFastAMG(const Mat& A, SystemSet& sys, int maxit, int verbosity,
                  double linsolver_prolongate_factor)
     {
-        // Solve with AMG solver.
+        // Solve with AMG solver, the hierarchy built in precision Field.
+        typedef typename PrecondTypes<Field>::Matrix   PMat;
+        typedef typename PrecondTypes<Field>::Vector   PVector;
+        typedef typename PrecondTypes<Field>::Operator POperator;
 
 #if FIRST_DIAGONAL
         typedef Dune::Amg::FirstDiagonal CouplingMetric;
@@ -374,16 +622,18 @@ namespace Opm
 #endif
 
 #if SYMMETRIC
-        typedef Dune::Amg::AggregationCriterion<Dune::Amg::SymmetricMatrixDependency<Mat,CouplingMetric> > CriterionBase;
+        typedef Dune::Amg::AggregationCriterion<Dune::Amg::SymmetricMatrixDependency<PMat,CouplingMetric> > CriterionBase;
 #else
-        typedef Dune::Amg::AggregationCriterion<Dune::Amg::SymmetricMatrixDependency<Mat,CouplingMetric> > CriterionBase;
+        typedef Dune::Amg::AggregationCriterion<Dune::Amg::SymmetricMatrixDependency<PMat,CouplingMetric> > CriterionBase;
 #endif
 
         typedef Dune::Amg::CoarsenCriterion<CriterionBase> Criterion;
-        typedef Dune::Amg::FastAMG<Operator,Vector>   Precond;
+        typedef Dune::Amg::FastAMG<POperator,PVector> Precond;
 
         // Construct preconditioner.
         Operator opA(A);
+        const PrecondMatrix<Field> pA(A);
+        POperator opP(pA.matrix());
         Criterion criterion;
         const int smooth_steps = 1;
         setUpCriterion(criterion, linsolver_prolongate_factor, verbosity, smooth_steps);
@@ -392,46 +642,24 @@ namespace Opm
         parms.setNoPreSmoothSteps(smooth_steps);
         parms.setNoPostSmoothSteps(smooth_steps);
         parms.setProlongationDampingFactor(linsolver_prolongate_factor);
-        Precond precond(opA, criterion, parms);
-
-        // Construct linear solver.
-        Dune::GeneralizedPCGSolver<Vector> linsolve(opA, precond, tolerance, maxit, verbosity);
+        Precond precond(opP, criterion, parms);
 
-        // Solve system.
-        Dune::InverseOperatorResult result;
-        linsolve.apply(x, b, result);
-
-        // Output results.
-        LinearSolverInterface::LinearSolverReport res;
-        res.converged = result.converged;
-        res.iterations = result.iterations;
-        res.residual_reduction = result.reduction;
-        return res;
+        // Construct linear solver and solve all systems.
+        return solveSystemsIn<Dune::GeneralizedPCGSolver>(Field(), opA, precond, sys, maxit, verbosity);
     }
 #endif
 
 
     LinearSolverInterface::LinearSolverReport
-    solveBiCGStab_ILU0(const Mat& A, Vector& x, Vector& b, double tolerance, int maxit, int verbosity)
+    solveBiCGStab_ILU0(const Mat& A, SystemSet& sys, int maxit, int verbosity)
     {
         Operator opA(A);
 
         // Construct preconditioner.
         Dune::SeqILU0<Mat,Vector,Vector> precond(A, 1.0);
 
-        // Construct linear solver.
-        Dune::BiCGSTABSolver<Vector> linsolve(opA, precond, tolerance, maxit, verbosity);
-
-        // Solve system.
-        Dune::InverseOperatorResult result;
-        linsolve.apply(x, b, result);
-
-        // Output results.
-        LinearSolverInterface::LinearSolverReport res;
-        res.converged = result.converged;
-        res.iterations = result.iterations;
-        res.residual_reduction = result.reduction;
-        return res;
+        // Construct linear solver and solve all systems.
+        return solveSystems<Dune::BiCGSTABSolver>(opA, precond, sys, maxit, verbosity);
     }
 
 
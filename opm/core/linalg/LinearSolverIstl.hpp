@@ -48,6 +48,20 @@ namespace Opm
         ///   linsolver_smooth_steps        2
         ///   linsolver_prolongate_factor   1.6
         ///   linsolver_verbosity           0
+        ///   linsolver_warm_start          false
+        ///   linsolver_single_precision_amg  false
+        ///   linsolver_precision_comparison  false
+        /// If linsolver_warm_start is true, the incoming contents of
+        /// the solution array are used as initial guess, and the
+        /// residual tolerance is taken relative to the norm of the
+        /// right hand side rather than of the initial residual.
+        /// If linsolver_single_precision_amg is true, the AMG variants
+        /// (CG_AMG, KAMG, FastAMG) build and apply their hierarchy in
+        /// single precision while the Krylov solver stays in double
+        /// precision. The ILU0 variants are not affected. If in addition
+        /// linsolver_precision_comparison is true, every solve is repeated
+        /// with a double precision hierarchy and its iteration count is
+        /// returned as reference_iterations in the report.
         LinearSolverIstl();
 
         /// Construct from parameters
@@ -59,6 +73,7 @@ namespace Opm
         virtual ~LinearSolverIstl();
 
         using LinearSolverInterface::solve;
+        using LinearSolverInterface::solveMultiple;
 
         /// Solve a linear system, with a matrix given in compressed sparse row format.
         /// \param[in] size        # of rows in matrix
@@ -77,6 +92,30 @@ namespace Opm
                                          const double* rhs,
                                          double* solution) const;
 
+        /// Solve a linear system with several right hand sides, with a
+        /// matrix given in compressed sparse row format.
+        /// The matrix and preconditioner, including any AMG hierarchy,
+        /// are set up once and reused for all right hand sides.
+        /// \param[in] size        # of rows in matrix
+        /// \param[in] nonzeros    # of nonzeros elements in matrix
+        /// \param[in] ia          array of length (size + 1) containing start and end indices for each row
+        /// \param[in] ja          array of length nonzeros containing column numbers for the nonzero elements
+        /// \param[in] sa          array of length nonzeros containing the values of the nonzero elements
+        /// \param[in] nrhs        # of right hand sides
+        /// \param[in] rhs         array of length nrhs*size containing the right hand sides,
+        ///                        each stored contiguously
+        /// \param[inout] solution array of length nrhs*size to which the solutions will be
+        ///                        written in the same layout as rhs, may also be used as
+        ///                        initial guesses if linsolver_warm_start is true.
+        virtual LinearSolverReport solveMultiple(const int size,
+                                                 const int nonzeros,
+                                                 const int* ia,
+                                                 const int* ja,
+                                                 const double* sa,
+                                                 const int nrhs,
+                                                 const double* rhs,
+                                                 double* solution) const;
+
         /// Set tolerance for the residual in dune istl linear solver.
         /// \param[in] tol         tolerance value
         virtual void setTolerance(const double tol);
@@ -97,6 +136,12 @@ namespace Opm
         int linsolver_smooth_steps_;
         /** \brief The factor to scale the coarse grid correction with. */
         double linsolver_prolongate_factor_;
+        /** \brief Use the incoming solution as initial guess. */
+        bool linsolver_warm_start_;
+        /** \brief Build and apply the AMG hierarchy in single precision. */
+        bool linsolver_single_precision_amg_;
+        /** \brief Also solve with double precision AMG, for comparison. */
+        bool linsolver_precision_comparison_;
 
     };
 
@@ -61,6 +61,32 @@ namespace Opm
         return rep;
     }
 
+
+
+
+    LinearSolverInterface::LinearSolverReport
+    LinearSolverUmfpack::solveMultiple(const int size,
+                                       const int nonzeros,
+                                       const int* ia,
+                                       const int* ja,
+                                       const double* sa,
+                                       const int nrhs,
+                                       const double* rhs,
+                                       double* solution) const
+    {
+        CSRMatrix A  = {
+            (size_t)size,
+            (size_t)nonzeros,
+            const_cast<int*>(ia),
+            const_cast<int*>(ja),
+            const_cast<double*>(sa)
+        };
+        call_UMFPACK_multiple(&A, nrhs, rhs, solution);
+        LinearSolverReport rep = {0};
+        rep.converged = true;
+        return rep;
+    }
+
     void LinearSolverUmfpack::setTolerance(const double /*tol*/)
     {
     }
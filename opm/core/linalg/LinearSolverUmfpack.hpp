@@ -39,6 +39,7 @@ namespace Opm
         virtual ~LinearSolverUmfpack();
 
         using LinearSolverInterface::solve;
+        using LinearSolverInterface::solveMultiple;
 
         /// Solve a linear system, with a matrix given in compressed sparse row format.
         /// \param[in] size        # of rows in matrix
@@ -57,6 +58,29 @@ namespace Opm
                                          const double* rhs,
                                          double* solution) const;
 
+        /// Solve a linear system with several right hand sides, with a
+        /// matrix given in compressed sparse row format.
+        /// The matrix is factored once and the factors reused for all
+        /// right hand sides.
+        /// \param[in] size        # of rows in matrix
+        /// \param[in] nonzeros    # of nonzeros elements in matrix
+        /// \param[in] ia          array of length (size + 1) containing start and end indices for each row
+        /// \param[in] ja          array of length nonzeros containing column numbers for the nonzero elements
+        /// \param[in] sa          array of length nonzeros containing the values of the nonzero elements
+        /// \param[in] nrhs        # of right hand sides
+        /// \param[in] rhs         array of length nrhs*size containing the right hand sides,
+        ///                        each stored contiguously
+        /// \param[inout] solution array of length nrhs*size to which the solutions will be
+        ///                        written in the same layout as rhs.
+        virtual LinearSolverReport solveMultiple(const int size,
+                                                 const int nonzeros,
+                                                 const int* ia,
+                                                 const int* ja,
+                                                 const double* sa,
+                                                 const int nrhs,
+                                                 const double* rhs,
+                                                 double* solution) const;
+
         /// Set tolerance for the linear solver.
         /// \param[in] tol         tolerance value
         /// Not used for UMFPACK solver.
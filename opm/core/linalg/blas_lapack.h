@@ -129,6 +129,13 @@ void dgemv_(const char       *trans,
                                      const double     *x, const MAT_SIZE_T *incX,
             const double     *a2   ,       double     *y, const MAT_SIZE_T *incY);
 
+/* A <- a1*x*y' + A */
+void dger_(const MAT_SIZE_T *m   , const MAT_SIZE_T *n,
+           const double     *a1  ,
+           const double     *x   , const MAT_SIZE_T *incX,
+           const double     *y   , const MAT_SIZE_T *incY,
+                 double     *A   , const MAT_SIZE_T *ldA);
+
 
 /* y <- a*x + y */
 void daxpy_(const MAT_SIZE_T *n, const double *a,
@@ -138,9 +138,10 @@ csr_to_csc(const int        *ia,
 
 /* ---------------------------------------------------------------------- */
 static void
-solve_umfpack(struct CSCMatrix *csc, const double *b, double *x)
+solve_umfpack(struct CSCMatrix *csc, int nrhs, const double *b, double *x)
 /* ---------------------------------------------------------------------- */
 {
+    int   k;
     void *Symbolic, *Numeric;
     double Info[UMFPACK_INFO], Control[UMFPACK_CONTROL];
 
@@ -153,8 +154,12 @@ solve_umfpack(struct CSCMatrix *csc, const double *b, double *x)
 
     umfpack_dl_free_symbolic(&Symbolic);
 
-    umfpack_dl_solve(UMFPACK_A, csc->p, csc->i, csc->x, x, b,
-                     Numeric, Control, Info);
+    /* Reuse the numeric factorisation for all right hand sides. */
+    for (k = 0; k < nrhs; k++) {
+        umfpack_dl_solve(UMFPACK_A, csc->p, csc->i, csc->x,
+                         x + k*csc->n, b + k*csc->n,
+                         Numeric, Control, Info);
+    }
 
     umfpack_dl_free_numeric(&Numeric);
 }
@@ -164,6 +169,16 @@ solve_umfpack(struct CSCMatrix *csc, const double *b, double *x)
 void
 call_UMFPACK(struct CSRMatrix *A, const double *b, double *x)
 /*---------------------------------------------------------------------------*/
+{
+    call_UMFPACK_multiple(A, 1, b, x);
+}
+
+
+/*---------------------------------------------------------------------------*/
+void
+call_UMFPACK_multiple(struct CSRMatrix *A, int nrhs,
+                      const double *b, double *x)
+/*---------------------------------------------------------------------------*/
 {
     struct CSCMatrix *csc;
 
@@ -172,9 +187,8 @@ call_UMFPACK(struct CSRMatrix *A, const double *b, double *x)
     if (csc != NULL) {
         csr_to_csc(A->ia, A->ja, A->sa, csc);
 
-        solve_umfpack(csc, b, x);
+        solve_umfpack(csc, nrhs, b, x);
     }
 
     csc_deallocate(csc);
 }
-
@@ -43,6 +43,11 @@ struct CSRMatrix;
 
 void call_UMFPACK(struct CSRMatrix *A, const double *b, double *x);
 
+/* Solve for nrhs right hand sides, stored contiguously in b, using a
+ * single factorisation. Solutions are stored in the same layout in x. */
+void call_UMFPACK_multiple(struct CSRMatrix *A, int nrhs,
+                           const double *b, double *x);
+
 #ifdef __cplusplus
 }
 #endif
@@ -28,6 +28,7 @@
 #include <opm/core/linalg/sparse_sys.h>
 #include <opm/core/utility/ErrorMacros.hpp>
 #include <opm/core/utility/miscUtilities.hpp>
+#include <opm/core/utility/Profiler.hpp>
 #include <opm/core/wells.h>
 #include <opm/core/simulator/BlackoilState.hpp>
 #include <opm/core/simulator/WellState.hpp>
@@ -80,7 +81,8 @@ namespace Opm
           htrans_(grid.cell_facepos[ grid.number_of_cells ]),
           trans_ (grid.number_of_faces),
           allcells_(grid.number_of_cells),
-          singular_(false)
+          singular_(false),
+          iterations_(0)
     {
         if (wells_ && (wells_->number_of_phases != props.numPhases())) {
             OPM_THROW(std::runtime_error, "Inconsistent number of phases specified (wells vs. props): "
@@ -123,6 +125,7 @@ namespace Opm
                                  BlackoilState& state,
                                  WellState& well_state)
     {
+        OPM_PROFILE_SCOPE("pressure/solve");
         const int nc = grid_.number_of_cells;
         const int nw = (wells_ != 0) ? wells_->number_of_wells : 0;
 
@@ -182,6 +185,7 @@ namespace Opm
             OPM_THROW(std::runtime_error, "CompressibleTpfa::solve() failed to converge in " << maxiter_ << " iterations.");
         }
 
+        iterations_ = iter;
         std::cout << "Solved pressure in " << iter << " iterations." << std::endl;
 
         // Compute fluxes and face pressures.
@@ -206,6 +210,15 @@ namespace Opm
 
 
 
+    /// @brief Number of Newton iterations used by the last call to solve().
+    int CompressibleTpfa::numIterations() const
+    {
+        return iterations_;
+    }
+
+
+
+
 
     /// Compute well potentials.
     void CompressibleTpfa::computeWellPotentials(const BlackoilState& state)
@@ -255,6 +268,7 @@ namespace Opm
                                                       const BlackoilState& state,
                                                       const WellState& /*well_state*/)
     {
+        OPM_PROFILE_SCOPE("pressure/properties");
         computeWellPotentials(state);
         if (rock_comp_props_ && rock_comp_props_->isActive()) {
             computePorevolume(grid_, props_.porosity(), *rock_comp_props_, state.pressure(), initial_porevol_);
@@ -269,6 +283,7 @@ namespace Opm
                                                           const BlackoilState& state,
                                                           const WellState& well_state)
     {
+        OPM_PROFILE_SCOPE("pressure/properties");
         // These are the variables that get computed by this function:
         //
         // std::vector<double> cell_A_;
@@ -506,6 +521,7 @@ namespace Opm
                                     const BlackoilState& state,
                                     const WellState& well_state)
     {
+        OPM_PROFILE_SCOPE("pressure/assemble");
         const double* cell_press = &state.pressure()[0];
         const double* well_bhp = well_state.bhp().empty() ? NULL : &well_state.bhp()[0];
         const double* z = &state.surfacevol()[0];
@@ -549,7 +565,10 @@ namespace Opm
     /// Computes pressure_increment_.
     void CompressibleTpfa::solveIncrement()
     {
-        // Increment is equal to -J^{-1}F
+        // Increment is equal to -J^{-1}F. The previous increment,
+        // negated, is the initial guess.
+        std::transform(pressure_increment_.begin(), pressure_increment_.end(),
+                       pressure_increment_.begin(), std::negate<double>());
         linsolver_.solve(h_->J, h_->F, &pressure_increment_[0]);
         std::transform(pressure_increment_.begin(), pressure_increment_.end(),
                        pressure_increment_.begin(), std::negate<double>());
@@ -77,6 +77,9 @@ namespace Opm
         /// Solve the pressure equation by Newton-Raphson scheme.
         /// May throw an exception if the number of iterations
         /// exceed maxiter (set in constructor).
+        /// The previous Newton increment is passed as initial guess
+        /// to the linear solver, which may use it if configured to
+        /// warm start.
         void solve(const double dt,
                    BlackoilState& state,
                    WellState& well_state);
@@ -89,6 +92,9 @@ namespace Opm
         /// are significant.)
         bool singularPressure() const;
 
+        /// @brief Number of Newton iterations used by the last call to solve().
+        int numIterations() const;
+
     private:
         virtual void computePerSolveDynamicData(const double dt,
                                                 const BlackoilState& state,
@@ -157,6 +163,8 @@ namespace Opm
         // if everything is incompressible and there are no pressure
         // conditions.
         bool singular_;
+        // Newton iterations used by the last solve.
+        int iterations_;
     };
 
 } // namespace Opm
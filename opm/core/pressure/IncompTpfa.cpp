@@ -32,6 +32,7 @@
 #include <opm/core/simulator/WellState.hpp>
 #include <opm/core/utility/ErrorMacros.hpp>
 #include <opm/core/utility/miscUtilities.hpp>
+#include <opm/core/utility/Profiler.hpp>
 #include <opm/core/wells.h>
 #include <iostream>
 #include <iomanip>
@@ -158,6 +159,7 @@ namespace Opm
                            TwophaseState& state,
                            WellState& well_state)
     {
+        OPM_PROFILE_SCOPE("pressure/solve");
         if (rock_comp_props_ != 0 && rock_comp_props_->isActive()) {
             solveRockComp(dt, state, well_state);
         } else {
@@ -167,6 +169,49 @@ namespace Opm
 
 
 
+    /// Solve the pressure equation, and switch well controls
+    /// until the well conditions are met.
+    /// After each solve, check.conditionsMet() is called. If it
+    /// fails, only the equations of wells whose control or target
+    /// changed are reassembled, keeping the rest of the system and
+    /// the per-solve data, and the system is solved again with
+    /// the previous solution as initial guess. With rock
+    /// compressibility the Newton iteration is restarted instead.
+    /// Throws if the conditions are not met after
+    /// max_well_control_iterations additional solves.
+    /// \return  The number of additional solves needed.
+    int IncompTpfa::solve(const double dt,
+                          TwophaseState& state,
+                          WellState& well_state,
+                          WellControlCheck& check,
+                          const int max_well_control_iterations)
+    {
+        const bool rock_comp = rock_comp_props_ != 0 && rock_comp_props_->isActive();
+        solve(dt, state, well_state);
+        int iteration = 0;
+        while (!check.conditionsMet(state, well_state)) {
+            if (iteration == max_well_control_iterations) {
+                OPM_THROW(std::runtime_error, "Could not satisfy well conditions in "
+                          << max_well_control_iterations << " tries.");
+            }
+            ++iteration;
+            if (rock_comp) {
+                iterateRockComp(dt, state, well_state);
+            } else {
+                // Modify the well equations in place if possible.
+                UnstructuredGrid* gg = const_cast<UnstructuredGrid*>(&grid_);
+                int num_updated = 0;
+                if (!ifs_tpfa_update_well_controls(gg, &forces_, h_, &num_updated)) {
+                    assembleIncomp();
+                }
+                solveAssembledIncomp(state, well_state);
+            }
+        }
+        return iteration;
+    }
+
+
+
     // Solve with no rock compressibility (linear eqn).
     void IncompTpfa::solveIncomp(const double dt,
                                  TwophaseState& state,
@@ -175,14 +220,38 @@ namespace Opm
         // Set up properties.
         computePerSolveDynamicData(dt, state, well_state);
 
-        // Assemble.
+        // Assemble and solve.
+        assembleIncomp();
+        solveAssembledIncomp(state, well_state);
+    }
+
+
+
+    // Assemble the linear system, with no rock compressibility.
+    void IncompTpfa::assembleIncomp()
+    {
+        OPM_PROFILE_SCOPE("pressure/assemble");
         UnstructuredGrid* gg = const_cast<UnstructuredGrid*>(&grid_);
         int ok = ifs_tpfa_assemble(gg, &forces_, &trans_[0], &gpress_omegaweighted_[0], h_);
         if (!ok) {
             OPM_THROW(std::runtime_error, "Failed assembling pressure system.");
         }
+    }
+
+
 
-        // Solve.
+    // Solve the assembled linear system and compute fluxes.
+    void IncompTpfa::solveAssembledIncomp(TwophaseState& state,
+                                          WellState& well_state)
+    {
+        // Solve, using the current state as initial guess for
+        // iterative solvers that accept one.
+        assert(int(state.pressure().size()) == grid_.number_of_cells);
+        std::copy(state.pressure().begin(), state.pressure().end(), h_->x);
+        if (wells_ != NULL) {
+            assert(int(well_state.bhp().size()) == wells_->number_of_wells);
+            std::copy(well_state.bhp().begin(), well_state.bhp().end(), h_->x + grid_.number_of_cells);
+        }
         linsolver_.solve(h_->A, h_->b, h_->x);
 
         // Obtain solution.
@@ -197,6 +266,7 @@ namespace Opm
             soln.well_flux = &well_state.perfRates()[0];
             soln.well_press = &well_state.bhp()[0];
         }
+        UnstructuredGrid* gg = const_cast<UnstructuredGrid*>(&grid_);
         ifs_tpfa_press_flux(gg, &forces_, &trans_[0], h_, &soln);
     }
 
@@ -213,11 +283,21 @@ namespace Opm
         // This function is identical to CompressibleTpfa::solve().
         // \TODO refactor?
 
+        // Set up dynamic data.
+        computePerSolveDynamicData(dt, state, well_state);
+        iterateRockComp(dt, state, well_state);
+    }
+
+
+
+    // Newton iteration of solveRockComp(), with per-solve data set up.
+    void IncompTpfa::iterateRockComp(const double dt,
+                                     TwophaseState& state,
+                                     WellState& well_state)
+    {
         const int nc = grid_.number_of_cells;
         const int nw = (wells_) ? wells_->number_of_wells : 0;
 
-        // Set up dynamic data.
-        computePerSolveDynamicData(dt, state, well_state);
         computePerIterationDynamicData(dt, state, well_state);
 
         // Assemble J and F.
@@ -312,6 +392,7 @@ namespace Opm
             allcells_[c] = c;
         }
         h_ = ifs_tpfa_construct(gg, const_cast<struct Wells*>(wells_));
+        pressure_increment_.resize(h_->A->m, 0.0);
     }
 
 
@@ -324,6 +405,7 @@ namespace Opm
                                                 const TwophaseState& state,
                                                 const WellState& /*well_state*/)
     {
+        OPM_PROFILE_SCOPE("pressure/properties");
         // Computed here:
         //
         // std::vector<double> wdp_;
@@ -372,6 +454,7 @@ namespace Opm
                                                     const TwophaseState& state,
                                                     const WellState& well_state)
     {
+        OPM_PROFILE_SCOPE("pressure/properties");
         // These are the variables that get computed by this function:
         //
         // std::vector<double> porevol_
@@ -399,6 +482,7 @@ namespace Opm
                               const TwophaseState& state,
                               const WellState& /*well_state*/)
     {
+        OPM_PROFILE_SCOPE("pressure/assemble");
         const double* pressures = wells_ ? &pressures_[0] : &state.pressure()[0];
 
         bool ok = ifs_tpfa_assemble_comprock_increment(const_cast<UnstructuredGrid*>(&grid_),
@@ -420,7 +504,10 @@ namespace Opm
     {
         // Increment is equal to -J^{-1}R.
         // The Jacobian is in h_->A, residual in h_->b.
+        // The previous increment is the initial guess.
+        std::copy(pressure_increment_.begin(), pressure_increment_.end(), h_->x);
         linsolver_.solve(h_->A, h_->b, h_->x);
+        std::copy(h_->x, h_->x + h_->A->m, pressure_increment_.begin());
         // It is not necessary to negate the increment,
         // apparently the system for the increment is generated,
         // not the Jacobian and residual as such.
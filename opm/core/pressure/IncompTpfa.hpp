@@ -111,10 +111,44 @@ namespace Opm
         /// Newton-Raphson scheme.
         /// May throw an exception if the number of iterations
         /// exceed maxiter (set in constructor).
+        /// The incoming pressures, or the previous Newton increment,
+        /// are passed as initial guess to the linear solver, which
+        /// may use them if configured to warm start.
         void solve(const double dt,
                    TwophaseState& state,
                    WellState& well_state);
 
+        /// Interface for checking well conditions after a pressure
+        /// solve, used when switching well controls.
+        class WellControlCheck
+        {
+        public:
+            virtual ~WellControlCheck() {}
+            /// Return true if the well conditions are met by the
+            /// solution. Otherwise the controls of the observed wells
+            /// should be changed before returning. The solution may be
+            /// modified, for example to renormalize pressures.
+            virtual bool conditionsMet(TwophaseState& state,
+                                       WellState& well_state) = 0;
+        };
+
+        /// Solve the pressure equation, and switch well controls
+        /// until the well conditions are met.
+        /// After each solve, check.conditionsMet() is called. If it
+        /// fails, only the equations of wells whose control or target
+        /// changed are reassembled, keeping the rest of the system and
+        /// the per-solve data, and the system is solved again with
+        /// the previous solution as initial guess. With rock
+        /// compressibility the Newton iteration is restarted instead.
+        /// Throws if the conditions are not met after
+        /// max_well_control_iterations additional solves.
+        /// \return  The number of additional solves needed.
+        int solve(const double dt,
+                  TwophaseState& state,
+                  WellState& well_state,
+                  WellControlCheck& check,
+                  const int max_well_control_iterations);
+
 
         /// Expose read-only reference to internal half-transmissibility.
         const std::vector<double>& getHalfTrans() const { return htrans_; }
@@ -128,6 +162,10 @@ namespace Opm
         void solveRockComp(const double dt,
                            TwophaseState& state,
                            WellState& well_state);
+        // Newton iteration of solveRockComp(), with per-solve data set up.
+        void iterateRockComp(const double dt,
+                             TwophaseState& state,
+                             WellState& well_state);
     private:
         // Helper functions.
         void computeStaticData();
@@ -140,6 +178,9 @@ namespace Opm
         void assemble(const double dt,
                       const TwophaseState& state,
                       const WellState& well_state);
+        void assembleIncomp();
+        void solveAssembledIncomp(TwophaseState& state,
+                                  WellState& well_state);
         void solveIncrement();
         double residualNorm() const;
         double incrementNorm() const;
@@ -176,6 +217,7 @@ namespace Opm
         std::vector<double> porevol_;
         std::vector<double> rock_comp_;
         std::vector<double> pressures_;
+        std::vector<double> pressure_increment_;  // Last Newton increment, initial guess for the next.
 
         // ------ Internal data for the ifs_tpfa solver. ------
 	struct ifs_tpfa_data* h_;
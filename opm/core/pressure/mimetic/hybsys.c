@@ -248,34 +248,46 @@ hybsys_schur_comp_symm(int nc, const int *pconn,
                        const double *Binv, struct hybsys *sys)
 /* ---------------------------------------------------------------------- */
 {
-    int    c, p1, p2, nconn;
-    double a1, a2;
-
-    MAT_SIZE_T incx, incy;
-    MAT_SIZE_T nrows, ncols, lda;
+    int c, p1, p2, nconn;
 
-    incx = incy = 1;
     p1 = p2 = 0;
 
     for (c = 0; c < nc; c++) {
         p1    = pconn[c + 0];
         nconn = pconn[c + 1] - pconn[c];
-        nrows = ncols = lda = nconn;
-
-        /* F <- C' * inv(B) == (inv(B) * ones(n,1))' in single cell */
-        a1 = 1.0;  a2 = 0.0;
-        dgemv_("No Transpose"   , &nrows, &ncols,
-               &a1, &Binv[p2]   , &lda, sys->one, &incx,
-               &a2, &sys->F1[p1],                 &incy);
 
-        /* L <- C' * inv(B) * C == SUM(F) == ones(n,1)' * F */
-        sys->L[c] = ddot_(&nrows, sys->one, &incx, &sys->F1[p1], &incy);
+        hybsys_cell_schur_comp_symm(c, nconn, p1, p2, Binv, sys);
 
         p2 += nconn * nconn;
     }
 }
 
 
+/* ---------------------------------------------------------------------- */
+void
+hybsys_cell_schur_comp_symm(int c, int nconn, int p1, int p2,
+                            const double *Binv, struct hybsys *sys)
+/* ---------------------------------------------------------------------- */
+{
+    double a1, a2;
+
+    MAT_SIZE_T incx, incy;
+    MAT_SIZE_T nrows, ncols, lda;
+
+    incx  = incy = 1;
+    nrows = ncols = lda = nconn;
+
+    /* F <- C' * inv(B) == (inv(B) * ones(n,1))' in single cell */
+    a1 = 1.0;  a2 = 0.0;
+    dgemv_("No Transpose"   , &nrows, &ncols,
+           &a1, &Binv[p2]   , &lda, sys->one, &incx,
+           &a2, &sys->F1[p1],                 &incy);
+
+    /* L <- C' * inv(B) * C == SUM(F) == ones(n,1)' * F */
+    sys->L[c] = ddot_(&nrows, sys->one, &incx, &sys->F1[p1], &incy);
+}
+
+
 /* ---------------------------------------------------------------------- */
 void
 hybsys_schur_comp_unsymm(int nc, const int *pconn,
@@ -480,14 +492,26 @@ hybsys_cellcontrib_symm(int c, int nconn, int p1, int p2,
                         const double *gpress, const double *src,
                         const double *Binv, struct hybsys *sys)
 /* ---------------------------------------------------------------------- */
+{
+    sys->q[c] = hybsys_cellcontrib_symm_local(c, nconn, p1, p2, gpress,
+                                              src[c], Binv, sys);
+}
+
+
+/* ---------------------------------------------------------------------- */
+double
+hybsys_cellcontrib_symm_local(int c, int nconn, int p1, int p2,
+                              const double *gpress, double src,
+                              const double *Binv, struct hybsys *sys)
+/* ---------------------------------------------------------------------- */
 {
     hybsys_cellmat_symm_core(nconn, &Binv[p2],
                              sys->L[c], &sys->F1[p1],
                              sys->S);
 
-    sys->q[c] = hybsys_cellrhs_core(nconn, &gpress[p1], src[c], &Binv[p2],
-                                    sys->L[c], &sys->F1[p1], &sys->F1[p1],
-                                    sys->r);
+    return hybsys_cellrhs_core(nconn, &gpress[p1], src, &Binv[p2],
+                               sys->L[c], &sys->F1[p1], &sys->F1[p1],
+                               sys->r);
 }
 
 
@@ -280,6 +280,30 @@ hybsys_schur_comp_symm(int nc, const int *pconn,
                        const double *Binv, struct hybsys *sys);
 
 
+/**
+ * Compute elemental Schur complement contributions of a single cell.
+ *
+ * Identical to function hybsys_schur_comp_symm() restricted to cell
+ * @c c.  This allows callers that change the inverse inner products
+ * of a subset of cells to update the contributions of those cells
+ * only.
+ *
+ * @param[in]     c     Cell for which to compute contributions.
+ * @param[in]     nconn Number of connections (faces) of cell @c c.
+ * @param[in]     p1    Start address (into @c sys->F1) of the
+ *                      connections of cell @c c.
+ * @param[in]     p2    Start address (into @c Binv) of the inverse
+ *                      inner product of cell @c c.
+ * @param[in]     Binv  Inverse inner products for all cells.
+ * @param[in,out] sys   Hybrid system management structure allocated
+ *                      using hybsys_allocate_symm() and initialised
+ *                      using hybsys_init().
+ */
+void
+hybsys_cell_schur_comp_symm(int c, int nconn, int p1, int p2,
+                            const double *Binv, struct hybsys *sys);
+
+
 /**
  * Compute elemental (per-cell) contributions to unsymmetric Schur
  * system of simultaneous linear equations.
@@ -436,6 +460,38 @@ hybsys_cellcontrib_symm(int c, int nconn, int p1, int p2,
                         const double *Binv, struct hybsys *sys);
 
 
+/**
+ * Compute final (symmetric) Schur complement contributions of a single
+ * cell without accessing cell-indexed source terms or right-hand sides.
+ *
+ * Identical to function hybsys_cellcontrib_symm() except that the
+ * source term of cell @c c is passed as a scalar and that the reduced
+ * cell right-hand side, which hybsys_cellcontrib_symm() stores in
+ * <CODE>sys->q[c]</CODE>, is returned instead.  The field @c q of the
+ * hybrid system structure is not referenced.  This allows callers that
+ * assemble systems for a small subset of cells to keep right-hand side
+ * storage for that subset only.
+ *
+ * @param[in]     c      Cell for which to compute local contributions.
+ * @param[in]     nconn  Number of connections (faces) of cell @c c.
+ * @param[in]     p1     Start address (into @c gpress) of the gravity
+ *                       contributions of cell @c c.
+ * @param[in]     p2     Start address (into @c Binv) of the inverse
+ *                       inner product of cell @c c.
+ * @param[in]     gpress Gravity contributions of all cells.
+ * @param[in]     src    Explicit source term of cell @c c.
+ * @param[in]     Binv   Inverse inner products for all cells.
+ * @param[in,out] sys    Hybrid system management structure.  Fields
+ *                       @c S and @c r are overwritten.
+ *
+ * @return Reduced right-hand side of cell @c c.
+ */
+double
+hybsys_cellcontrib_symm_local(int c, int nconn, int p1, int p2,
+                              const double *gpress, double src,
+                              const double *Binv, struct hybsys *sys);
+
+
 /**
  * Compute final (non-symmetric) Schur complement contributions to
  * global system of simultaneous linear equations.
@@ -25,6 +25,54 @@
 #include <opm/core/linalg/blas_lapack.h>
 #include <opm/core/pressure/mimetic/mimetic.h>
 
+/* ------------------------------------------------------------------ */
+/* Compute inverse inner product of single cell 'c' into 'Binv' using
+ * work arrays C, N, A (max_nconn*d, max_nconn*d, max_nconn) and
+ * LAPACK workspace 'work'. */
+/* ------------------------------------------------------------------ */
+static void
+mim_ip_cell(int c, int d,
+            const int *pconn, const int *conn,
+            const int *fneighbour, const double *fcentroid,
+            const double *fnormal, const double *farea,
+            const double *ccentroid, const double *cvol, double *perm,
+            double *C, double *N, double *A, double *work, int lwork,
+            double *Binv)
+/* ------------------------------------------------------------------ */
+{
+    int    i, j, f, nconn;
+    double s;
+
+    double cc[3] = { 0.0 };     /* No more than 3 space dimensions */
+
+    for (j = 0; j < d; j++) {
+        cc[j] = ccentroid[j + c*d];
+    }
+
+    nconn = pconn[c + 1] - pconn[c];
+
+    for (i = 0; i < nconn; i++) {
+        f = conn[pconn[c] + i];
+        s = 2.0*(fneighbour[2 * f] == c) - 1.0;
+
+        A[i] = farea[f];
+
+        for (j = 0; j < d; j++) {
+            C[i + j*nconn] = fcentroid  [j + f*d] - cc[j];
+            N[i + j*nconn] = s * fnormal[j + f*d];
+        }
+    }
+
+    mim_ip_simple(nconn, nconn, d, cvol[c], &perm[c * d * d],
+                  C, A, N, Binv, work, lwork);
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Cells are processed in order of increasing number of connections
+ * so that consecutive (small, dense) factorisations have identical
+ * sizes.  When compiled with OpenMP, the cells are distributed across
+ * threads, each having its own LAPACK workspace. */
 /* ------------------------------------------------------------------ */
 void
 mim_ip_simple_all(int ncells, int d, int max_nconn,
@@ -34,48 +82,59 @@ mim_ip_simple_all(int ncells, int d, int max_nconn,
                   double *perm, double *Binv)
 /* ------------------------------------------------------------------ */
 {
-    int i, j, c, f, nconn, fpos2, lwork;
+    int c, i, n, lwork, ok, *order, *pos2, *cnt;
 
-    double *C, *N, *A, *work, s;
+    double *C, *N, *A, *work;
 
-    double cc[3] = { 0.0 };     /* No more than 3 space dimensions */
+    order = malloc(ncells          * sizeof *order);
+    pos2  = malloc((ncells + 1)    * sizeof *pos2 );
+    cnt   = malloc((max_nconn + 2) * sizeof *cnt  );
+
+    if ((order != NULL) && (pos2 != NULL) && (cnt != NULL)) {
+        /* Binv offsets, and cells grouped by number of connections
+         * (counting sort). */
+        for (n = 0; n < max_nconn + 2; n++) { cnt[n] = 0; }
 
-    lwork = 64 * (max_nconn * d);                 /* 64 from ILAENV() */
-    C     = malloc((max_nconn * d) * sizeof *C);
-    N     = malloc((max_nconn * d) * sizeof *N);
-    A     = malloc(max_nconn       * sizeof *A);
-    work  = malloc(lwork           * sizeof *work);
+        pos2[0] = 0;
+        for (c = 0; c < ncells; c++) {
+            n = pconn[c + 1] - pconn[c];
+
+            pos2[c + 1]  = pos2[c] + (n * n);
+            cnt [n + 1] += 1;
+        }
 
-    if ((C != NULL) && (N != NULL) && (A != NULL) && (work != NULL)) {
-        fpos2 = 0;
+        for (n = 1; n < max_nconn + 2; n++) { cnt[n] += cnt[n - 1]; }
 
         for (c = 0; c < ncells; c++) {
-            for (j = 0; j < d; j++) {
-                cc[j] = ccentroid[j + c*d];
-            }
+            order[ cnt[ pconn[c + 1] - pconn[c] ] ++ ] = c;
+        }
 
-            nconn = pconn[c + 1] - pconn[c];
+        lwork = 64 * (max_nconn * d);             /* 64 from ILAENV() */
 
-            for (i = 0; i < nconn; i++) {
-                f = conn[pconn[c] + i];
-                s = 2.0*(fneighbour[2 * f] == c) - 1.0;
+#pragma omp parallel private(C, N, A, work, ok, i)
+        {
+            C     = malloc((max_nconn * d) * sizeof *C);
+            N     = malloc((max_nconn * d) * sizeof *N);
+            A     = malloc(max_nconn       * sizeof *A);
+            work  = malloc(lwork           * sizeof *work);
 
-                A[i] = farea[f];
+            ok = (C != NULL) && (N != NULL) && (A != NULL) && (work != NULL);
 
-                for (j = 0; j < d; j++) {
-                    C[i + j*nconn] = fcentroid  [j + f*d] - cc[j];
-                    N[i + j*nconn] = s * fnormal[j + f*d];
+#pragma omp for schedule(static, 64)
+            for (i = 0; i < ncells; i++) {
+                if (ok) {
+                    mim_ip_cell(order[i], d, pconn, conn, fneighbour,
+                                fcentroid, fnormal, farea, ccentroid,
+                                cvol, perm, C, N, A, work, lwork,
+                                &Binv[ pos2[ order[i] ] ]);
                 }
             }
 
-            mim_ip_simple(nconn, nconn, d, cvol[c], &perm[c * d * d],
-                          C, A, N, &Binv[fpos2], work, lwork);
-
-            fpos2 += nconn * nconn;
+            free(work);  free(A);  free(N);  free(C);
         }
     }
 
-    free(work);  free(A);  free(N);  free(C);
+    free(cnt);  free(pos2);  free(order);
 }
 
 
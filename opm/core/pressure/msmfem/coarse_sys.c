@@ -25,6 +25,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 
 #ifndef DEBUG_OUTPUT
 #define DEBUG_OUTPUT 0
@@ -71,11 +75,12 @@ struct coarse_sys_meta {
     int *blk_nhf;               /* Number of fs hfaces per block */
     int *blk_nfsf;              /* Number of fs faces per block */
 
-    int *loc_fno;               /* Local (fs) face numbering */
     int *ncf;                   /* diff(face_pos) */
     int *pconn2;                /* cumsum([0; diff(face_pos).^2]) */
 
     int *pb2c, *b2c;            /* Block->cell mapping (CSR packed) */
+    int *blk;                   /* Cell->block mapping (partition) */
+    int *fno;                   /* Block-local fs face number, per face side */
 
     int *bfno;                  /* Active basis function numbering */
     int *loc_dofno;             /* Block-local DOF number of a CF */
@@ -85,6 +90,12 @@ struct coarse_sys_meta {
 };
 
 
+/* Work arrays for constructing a single basis function.  One instance
+ * per thread.  The cell quantities L and F1 of 'fsys' are shared
+ * between all instances, while the cell-local buffers and 'q' are
+ * private.  All private arrays are sized by the largest pair of
+ * blocks, and 'fsys->q' is indexed by the cell's position within the
+ * pair of blocks rather than by global cell number. */
 struct bf_asm_data {
     struct hybsys *fsys;        /* Fine-scale hybrid system contributions */
 
@@ -96,13 +107,14 @@ struct bf_asm_data {
     double           *p;        /* BF pressure. */
     double           *flux;     /* BF flux.  Symmetrised. */
 
-    double           *gpress;   /* BF gravity contrib. (== 0) */
+    const double     *gpress;   /* BF gravity contrib. (== 0, shared) */
 
     double           *work;     /* Back-substitution work array */
 
     int              *pdof;     /* Indirection pointer to linearised DOF */
     int              *dof;      /* Linearised DOFs per BF */
     int              *fcount;   /* Flux symmetrisation face count. */
+    int              *loc_fno;  /* Second block's faces in pair numbering */
 
     /* -------------------------------------------------------------- */
     int    *idata;              /* Linear (integer) storage */
@@ -110,6 +122,26 @@ struct bf_asm_data {
 };
 
 
+/* Data retained between basis function computations.  Created by
+ * coarse_sys_construct() and reused by coarse_sys_update(), which only
+ * rescales the inner products and Schur complements of the cells in
+ * blocks whose mobility changed. */
+struct coarse_sys_bf_data {
+    struct coarse_sys_meta *m;  /* Grid and partition meta data */
+
+    double *Binv0;              /* Fine-scale inverse IP, unit mobility */
+    double *Binv;               /* Binv0 scaled by last used mobility */
+    double *w;                  /* BF weighting source terms */
+    double *gpress;             /* BF gravity contrib. (== 0) */
+    int    *touched;            /* Blocks needing new IP contributions */
+
+    struct hybsys *fsys;        /* Fine-scale Schur complements */
+
+    int                  nthreads; /* Number of per-thread work arrays */
+    struct bf_asm_data **workers;  /* Per-thread BF work arrays */
+};
+
+
 /* ======================================================================
  * Memory management
  * ====================================================================== */
@@ -144,9 +176,10 @@ coarse_sys_meta_allocate(size_t nblocks, size_t nfaces_c,
         alloc_sz += nblocks;     /* blk_nfsf */
         alloc_sz += nc;          /* ncf */
         alloc_sz += nc + 1;      /* pconn2 */
-        alloc_sz += nfaces_f;    /* loc_fno */
         alloc_sz += nblocks + 1; /* pb2c */
         alloc_sz += nc;          /* b2c */
+        alloc_sz += nc;          /* blk */
+        alloc_sz += 2*nfaces_f;  /* fno */
         alloc_sz += nfaces_c;    /* bfno */
         alloc_sz += 2*nfaces_c;  /* loc_dofno */
 
@@ -165,12 +198,12 @@ coarse_sys_meta_allocate(size_t nblocks, size_t nfaces_c,
             new->blk_nfsf  = new->blk_nhf   + nblocks;
             new->ncf       = new->blk_nfsf  + nblocks;
             new->pconn2    = new->ncf       + nc;
-            new->loc_fno   = new->pconn2    + nc + 1;
-
-            new->pb2c      = new->loc_fno   + nfaces_f;
+            new->pb2c      = new->pconn2    + nc + 1;
             new->b2c       = new->pb2c      + nblocks + 1;
+            new->blk       = new->b2c       + nc;
+            new->fno       = new->blk       + nc;
 
-            new->bfno      = new->b2c       + nc;
+            new->bfno      = new->fno       + 2*nfaces_f;
             new->loc_dofno = new->bfno      + nfaces_c;
         }
     }
@@ -188,20 +221,33 @@ bf_asm_data_deallocate(struct bf_asm_data *data)
         free            (data->ddata);
         free            (data->idata);
         csrmatrix_delete(data->A);
-        hybsys_free     (data->fsys);
+
+        if (data->fsys != NULL) {
+            /* L and F1 are owned by the shared system. */
+            free(data->fsys->q  );
+            free(data->fsys->S  );
+            free(data->fsys->r  );
+            free(data->fsys->one);
+        }
+        free(data->fsys);
     }
 
     free(data);
 }
 
 
+/* ---------------------------------------------------------------------- */
+/* Allocate per-thread BF work arrays.  The resulting 'fsys' refers
+ * to the cell quantities L and F1 of 'shared', which must outlive the
+ * work arrays, and 'gpress' refers to the shared gravity contributions. */
 /* ---------------------------------------------------------------------- */
 static struct bf_asm_data *
-bf_asm_data_allocate(struct UnstructuredGrid                 *g,
-                     struct coarse_sys_meta *m)
+bf_asm_data_allocate(struct coarse_sys_meta *m,
+                     struct hybsys          *shared,
+                     const double           *gpress)
 /* ---------------------------------------------------------------------- */
 {
-    int                 tot_ngconn;
+    int                 max_nconn;
     size_t              max_nhf, max_cells, max_faces, nnz;
     size_t              alloc_sz;
     struct bf_asm_data *new;
@@ -213,50 +259,60 @@ bf_asm_data_allocate(struct UnstructuredGrid                 *g,
         max_cells = 2 * m->max_blk_cells;
         max_faces = 2 * m->max_blk_nfsf;
         nnz       = 2 * m->max_blk_sum_nhf2;
-
-        tot_ngconn = g->cell_facepos[ g->number_of_cells ];
-
-        new->fsys = hybsys_allocate_symm((int) m->max_ngconn,
-                                         g->number_of_cells,
-                                         tot_ngconn);
+        max_nconn = (int) m->max_ngconn;
+
+        new->fsys = malloc(1 * sizeof *new->fsys);
+        if (new->fsys != NULL) {
+            new->fsys->L   = shared->L;
+            new->fsys->F1  = shared->F1;
+            new->fsys->F2  = shared->F2;
+            new->fsys->one = malloc(max_nconn             * sizeof *new->fsys->one);
+            new->fsys->r   = malloc(max_nconn             * sizeof *new->fsys->r  );
+            new->fsys->S   = malloc(max_nconn * max_nconn * sizeof *new->fsys->S  );
+            new->fsys->q   = malloc(max_cells             * sizeof *new->fsys->q  );
+        }
 
         new->A = csrmatrix_new_known_nnz(max_faces, nnz);
 
-        alloc_sz   = max_cells + 1; /* pdof */
-        alloc_sz  += max_nhf;       /* dof */
-        alloc_sz  += max_faces;     /* fcount */
+        alloc_sz   = max_cells + 1;        /* pdof */
+        alloc_sz  += max_nhf;              /* dof */
+        alloc_sz  += max_faces;            /* fcount */
+        alloc_sz  += m->max_blk_nfsf;      /* loc_fno */
 
         new->idata = malloc(alloc_sz * sizeof *new->idata);
 
-        alloc_sz   = 2 * max_faces; /* b, x */
-        alloc_sz  += 1 * max_nhf;   /* v */
-        alloc_sz  += 1 * max_cells; /* p */
-        alloc_sz  += 1 * max_faces; /* flux */
-        alloc_sz  += tot_ngconn;    /* gpress */
-        alloc_sz  += m->max_ngconn; /* work */
+        alloc_sz   = 2 * max_faces;        /* b, x */
+        alloc_sz  += 1 * max_nhf;          /* v */
+        alloc_sz  += 1 * max_cells;        /* p */
+        alloc_sz  += 1 * max_faces;        /* flux */
+        alloc_sz  += m->max_ngconn;        /* work */
 
         new->ddata = malloc(alloc_sz * sizeof *new->ddata);
 
         if ((new->fsys  == NULL) || (new->A     == NULL) ||
-            (new->idata == NULL) || (new->ddata == NULL)) {
+            (new->idata == NULL) || (new->ddata == NULL) ||
+            (new->fsys->one == NULL) || (new->fsys->r == NULL) ||
+            (new->fsys->S   == NULL) || (new->fsys->q == NULL)) {
             bf_asm_data_deallocate(new);
             new = NULL;
         } else {
-            new->pdof   = new->idata;
-            new->dof    = new->pdof   + max_cells + 1;
-            new->fcount = new->dof    + max_nhf;
+            new->pdof    = new->idata;
+            new->dof     = new->pdof   + max_cells + 1;
+            new->fcount  = new->dof    + max_nhf;
+            new->loc_fno = new->fcount + max_faces;
 
-            new->b      = new->ddata;
-            new->x      = new->b      + max_faces;
-            new->v      = new->x      + max_faces;
-            new->p      = new->v      + max_nhf;
+            new->b       = new->ddata;
+            new->x       = new->b      + max_faces;
+            new->v       = new->x      + max_faces;
+            new->p       = new->v      + max_nhf;
 
-            new->flux   = new->p      + max_cells;
+            new->flux    = new->p      + max_cells;
 
-            new->gpress = new->flux   + max_faces;
-            new->work   = new->gpress + tot_ngconn;
+            new->work    = new->flux   + max_faces;
 
-            hybsys_init((int) m->max_ngconn, new->fsys);
+            new->gpress  = gpress;
+
+            hybsys_init(max_nconn, new->fsys);
         }
     }
 
@@ -363,9 +419,54 @@ compute_loc_dofno(struct coarse_topology *ct,
 }
 
 
+/* Number the fine-scale faces of each block consecutively, storing the
+ * number of face 'f' as seen from the block of neighbour 'k' in
+ * m->fno[2*f + k].  Faces interior to a block receive the same number
+ * from both sides. */
 /* ---------------------------------------------------------------------- */
 static void
-coarse_sys_meta_fill(int nc, const int *pgconn,
+compute_blk_fno(int nb, size_t nneigh, const int *pgconn,
+                const int *gconn, const int *neigh,
+                struct coarse_sys_meta *m)
+/* ---------------------------------------------------------------------- */
+{
+    int    b, c, f, i, j, k, o, n;
+    size_t p;
+
+    for (p = 0; p < 2 * nneigh; p++) {
+        m->fno[p] = -1;
+    }
+
+    for (b = 0; b < nb; b++) {
+        n = 0;
+
+        for (i = m->pb2c[b]; i < m->pb2c[b + 1]; i++) {
+            c = m->b2c[i];
+
+            for (j = pgconn[c]; j < pgconn[c + 1]; j++) {
+                f = gconn[j];
+                k = neigh[2*f + 0] != c;
+                o = neigh[2*f + (1 - k)];
+
+                if (m->fno[2*f + k] < 0) {
+                    if ((o >= 0) && (m->blk[o] == b) &&
+                        (m->fno[2*f + (1 - k)] >= 0)) {
+                        m->fno[2*f + k] = m->fno[2*f + (1 - k)];
+                    } else {
+                        m->fno[2*f + k] = n++;
+                    }
+                }
+            }
+        }
+
+        assert (n == m->blk_nfsf[b]);
+    }
+}
+
+
+/* ---------------------------------------------------------------------- */
+static void
+coarse_sys_meta_fill(int nc, const int *pgconn, const int *gconn,
                      size_t nneigh, const int *neigh,
                      const int *p,
                      struct coarse_topology *ct,
@@ -412,10 +513,6 @@ coarse_sys_meta_fill(int nc, const int *pgconn,
         }
     }
 
-    for (f = 0; f < nneigh; f++) {
-        m->loc_fno[f] = -1;
-    }
-
     m->max_cf_nf = 0;
 
     for (f = 0; f < (size_t) ct->nfaces; f++) {
@@ -437,6 +534,12 @@ coarse_sys_meta_fill(int nc, const int *pgconn,
 
     partition_invert(nc, p, m->pb2c, m->b2c);
 
+    for (c1 = 0; c1 < nc; c1++) {
+        m->blk[c1] = p[c1];
+    }
+
+    compute_blk_fno(ct->nblocks, nneigh, pgconn, gconn, neigh, m);
+
     m->max_blk_cells = 0;
     for (b1 = 0; b1 < ct->nblocks; b1++) {
         m->max_blk_cells = MAX(m->max_blk_cells,
@@ -475,7 +578,7 @@ coarse_sys_meta_construct(struct UnstructuredGrid *g, const int *p,
 
     if (m != NULL) {
         coarse_sys_meta_fill(g->number_of_cells,
-                             g->cell_facepos,
+                             g->cell_facepos, g->cell_faces,
                              g->number_of_faces,
                              g->face_cells, p, ct, m);
     }
@@ -825,6 +928,8 @@ coarse_sys_allocate(struct coarse_topology *ct,
     new = malloc(1 * sizeof *new);
 
     if (new != NULL) {
+        new->bf_data = NULL;
+
         nb = ct->nblocks;
 
         assert(nb > 0);
@@ -922,9 +1027,11 @@ set_csys_block_pointers(struct coarse_topology *ct,
 
 
 /* Create local numbering of the fine-scale faces contained in a pair
- * of blocks denoted by 'cf'.
- *
- * Precondition: m->loc_fno[0 .. g->number_of_faces-1] < 0
+ * of blocks denoted by 'cf'.  The faces of the first block keep their
+ * block-local numbers, m->fno, while the faces of the second block are
+ * mapped through 'loc_fno' (indexed by the second block's local face
+ * number).  Faces shared between the two blocks take the number of the
+ * first block.
  *
  * Returns the number of local fine-scale faces. */
 /* ---------------------------------------------------------------------- */
@@ -932,76 +1039,60 @@ static int
 enumerate_local_dofs(size_t                  cf,
                      struct UnstructuredGrid                 *g ,
                      struct coarse_topology *ct,
-                     struct coarse_sys_meta *m)
+                     struct coarse_sys_meta *m ,
+                     int                    *loc_fno)
 /* ---------------------------------------------------------------------- */
 {
-    int *b, *c, i, f, loc_no;
+    int *b, *c, i, f, k, o, b0, loc_no;
 
-    loc_no = 0;
+    b0     = -1;
+    loc_no =  0;
 
     for (b  = ct->neighbours + 2*(cf + 0);
          b != ct->neighbours + 2*(cf + 1); b++) {
 
-        if (*b >= 0) {
-            for (c  = m->b2c + m->pb2c[*b + 0];
-                 c != m->b2c + m->pb2c[*b + 1]; c++) {
-
-                for (i = g->cell_facepos[*c + 0];
-                     i < g->cell_facepos[*c + 1]; i++) {
+        if (*b < 0) { continue; }
 
-                    f = g->cell_faces[i];
+        if (b0 < 0) {
+            b0     = *b;
+            loc_no = m->blk_nfsf[b0];
 
-                    if (m->loc_fno[f] < 0) {
-                        m->loc_fno[f] = loc_no++;
-                    }
-                }
-            }
+            continue;
         }
-    }
 
-    assert (loc_no > 0);
-
-    return loc_no;
-}
+        for (i = 0; i < m->blk_nfsf[*b]; i++) {
+            loc_fno[i] = -1;
+        }
 
+        for (c  = m->b2c + m->pb2c[*b + 0];
+             c != m->b2c + m->pb2c[*b + 1]; c++) {
 
-/* Destroy local numbering of fine-scale faces contained in a pair of
- * blocks denoted by 'cf'.
- *
- * This is the inverse of enumerate_local_dofs(), and is needed to
- * prepare assembly of the discrete local system defining the next
- * basis function. */
-/* ---------------------------------------------------------------------- */
-static void
-unenumerate_local_dofs(size_t                  cf,
-                       struct UnstructuredGrid                 *g ,
-                       struct coarse_topology *ct,
-                       struct coarse_sys_meta *m)
-/* ---------------------------------------------------------------------- */
-{
-    int *b, *c, i;
+            for (i = g->cell_facepos[*c + 0];
+                 i < g->cell_facepos[*c + 1]; i++) {
 
-    for (b  = ct->neighbours + 2*(cf + 0);
-         b != ct->neighbours + 2*(cf + 1); b++) {
-        if (*b >= 0) {
-            for (c  = m->b2c + m->pb2c[*b + 0];
-                 c != m->b2c + m->pb2c[*b + 1]; c++) {
+                f = g->cell_faces[i];
+                k = g->face_cells[2*f + 0] != *c;
+                o = g->face_cells[2*f + (1 - k)];
 
-                for (i = g->cell_facepos[*c + 0];
-                     i < g->cell_facepos[*c + 1]; i++) {
-
-                    m->loc_fno[ g->cell_faces[i] ] = -1;
+                if ((o >= 0) && (m->blk[o] == b0)) {
+                    loc_fno[ m->fno[2*f + k] ] = m->fno[2*f + (1 - k)];
+                } else if (loc_fno[ m->fno[2*f + k] ] < 0) {
+                    loc_fno[ m->fno[2*f + k] ] = loc_no++;
                 }
             }
         }
     }
+
+    assert (loc_no > 0);
+
+    return loc_no;
 }
 
 
 /* ---------------------------------------------------------------------- */
 /* Define local (to a single BF) pdof/dof CSR table.
  *
- * Precondition: m->loc_fno valid for BF (i.e., called after
+ * Precondition: bf_asm->loc_fno valid for BF (i.e., called after
  * enumerate_local_dofs()).
  *
  * Does not fail. */
@@ -1014,13 +1105,14 @@ linearise_local_dof(size_t                  cf,
                     struct bf_asm_data     *bf_asm)
 /* ---------------------------------------------------------------------- */
 {
-    int *b, *c, i;
+    int *b, *c, i, f, k, first;
     int *pdof, *dof;
 
     pdof = bf_asm->pdof;
     dof  = bf_asm->dof;
 
     pdof[0] = 0;
+    first   = 1;
 
     for (b  = ct->neighbours + 2*(cf + 0);
          b != ct->neighbours + 2*(cf + 1); b++) {
@@ -1030,11 +1122,17 @@ linearise_local_dof(size_t                  cf,
 
                 for (i = g->cell_facepos[*c + 0];
                      i < g->cell_facepos[*c + 1]; i++) {
-                    *dof++ = m->loc_fno[ g->cell_faces[i] ];
+                    f = g->cell_faces[i];
+                    k = g->face_cells[2*f + 0] != *c;
+
+                    *dof++ = first ? m->fno[2*f + k]
+                                   : bf_asm->loc_fno[ m->fno[2*f + k] ];
                 }
 
                 *++pdof = dof - bf_asm->dof;
             }
+
+            first = 0;
         }
     }
 }
@@ -1129,13 +1227,13 @@ assemble_local_system(size_t                  cf   ,
                       size_t                  nlocf,
                       struct UnstructuredGrid                 *g    ,
                       const double           *Binv ,
-                      double                 *w    ,
+                      const double           *w    ,
                       struct coarse_topology *ct   ,
                       struct coarse_sys_meta *m    ,
                       struct bf_asm_data     *bf_asm)
 /* ---------------------------------------------------------------------- */
 {
-    int    c, i, p1, p2, ndof;
+    int    c, i, k, p1, p2, ndof;
     int    *b, *dof;
     size_t nc;
 
@@ -1158,27 +1256,28 @@ assemble_local_system(size_t                  cf   ,
 
     sgn = 1.0;
     dof = bf_asm->dof;
+    k   = 0;
     for (b  = ct->neighbours + 2*(cf + 0);
          b != ct->neighbours + 2*(cf + 1); b++) {
 
         if (*b >= 0) {
-            for (i = m->pb2c[*b]; i < m->pb2c[*b + 1]; i++) {
+            for (i = m->pb2c[*b]; i < m->pb2c[*b + 1]; i++, k++) {
                 c    = m->b2c[i];
                 p1   = g->cell_facepos[c];
                 p2   = m->pconn2[c];
                 ndof = g->cell_facepos[c + 1] - p1;
 
-                w[c] *= sgn;    /* Set w-sign according to source/sink */
-
-                hybsys_cellcontrib_symm(c, ndof, p1, p2, bf_asm->gpress,
-                                        w, Binv, bf_asm->fsys);
+                /* Set w-sign according to source/sink */
+                bf_asm->fsys->q[k] =
+                    hybsys_cellcontrib_symm_local(c, ndof, p1, p2,
+                                                  bf_asm->gpress,
+                                                  sgn * w[c], Binv,
+                                                  bf_asm->fsys);
 
                 hybsys_global_assemble_cell(ndof, dof, bf_asm->fsys->S,
                                             bf_asm->fsys->r, bf_asm->A,
                                             bf_asm->b);
 
-                w[c] *= sgn;    /* Restore original weighting sign */
-
                 dof += ndof;
             }
 
@@ -1192,20 +1291,55 @@ assemble_local_system(size_t                  cf   ,
 
 
 /* ---------------------------------------------------------------------- */
-/* Scale the fine-scale (inverse) inner product 'Binv' by the
- * corresponding cell's total mobility.  This includes mobility
+/* Set the fine-scale (inverse) inner product 'Binv' to the unit
+ * mobility inner product 'Binv0' scaled by the corresponding cell's
+ * total mobility, in all cells of blocks b for which active_blk[b] is
+ * non-zero (all cells if active_blk is NULL).  This includes mobility
  * effects in the resulting BFs. */
 /* ---------------------------------------------------------------------- */
 static void
-Binv_scale_mobility(int nc, struct coarse_sys_meta *m,
-                    const double *totmob, double *Binv)
+Binv_scale_mobility(int nb, struct coarse_sys_meta *m,
+                    const double *totmob, const int *active_blk,
+                    const double *Binv0, double *Binv)
 /* ---------------------------------------------------------------------- */
 {
-    int c, i;
+    int b, c, i, j;
 
-    for (c = i = 0; c < nc; c++) {
-        for (; i < m->pconn2[c]; i++) {
-            Binv[i] *= totmob[c];
+    for (b = 0; b < nb; b++) {
+        if ((active_blk != NULL) && ! active_blk[b]) { continue; }
+
+        for (j = m->pb2c[b]; j < m->pb2c[b + 1]; j++) {
+            c = m->b2c[j];
+
+            for (i = m->pconn2[c]; i < m->pconn2[c + 1]; i++) {
+                Binv[i] = Binv0[i] * totmob[c];
+            }
+        }
+    }
+}
+
+
+/* ---------------------------------------------------------------------- */
+/* Compute fine-scale Schur complement contributions in all cells of
+ * blocks b for which active_blk[b] is non-zero (all cells if
+ * active_blk is NULL). */
+/* ---------------------------------------------------------------------- */
+static void
+schur_comp_blocks(int nb, struct coarse_sys_meta *m, const int *pconn,
+                  const int *active_blk, const double *Binv,
+                  struct hybsys *fsys)
+/* ---------------------------------------------------------------------- */
+{
+    int b, c, j;
+
+    for (b = 0; b < nb; b++) {
+        if ((active_blk != NULL) && ! active_blk[b]) { continue; }
+
+        for (j = m->pb2c[b]; j < m->pb2c[b + 1]; j++) {
+            c = m->b2c[j];
+
+            hybsys_cell_schur_comp_symm(c, m->ncf[c], pconn[c],
+                                        m->pconn2[c], Binv, fsys);
         }
     }
 }
@@ -1347,7 +1481,7 @@ solve_local_system(size_t                  cf    ,
 
                 p1g = g->cell_facepos[*c];
 
-                bf_asm->p[i]  = bf_asm->fsys->q[*c];
+                bf_asm->p[i]  = bf_asm->fsys->q[i];
                 bf_asm->p[i] += ddot_(&nrows, &bf_asm->fsys->F2[p1g],
                                       &incx, bf_asm->work, &incy);
                 bf_asm->p[i] /= bf_asm->fsys->L[*c];
@@ -1406,146 +1540,73 @@ store_basis_function(size_t                  cf    ,
 }
 
 
-/* ======================================================================
- * Public interfaces below.
- * ====================================================================== */
-
-
 /* ---------------------------------------------------------------------- */
-/* Construct coarse system from fine-scale grid (g), partition vector
- * (p), coarse topology (ct), fine-scale permeability tensor (perm),
- * fine-scale source terms (src), and fine-scale (total) mobility
- * field (totmob).
- *
- * Uses 'linsolve' to resolve local systems of linear equations.
- *
- * Returns fully constructed coarse system if successful (i.e., if all
- * internal allocations succeed and all BFs can be constructed), and
- * NULL if not. */
+/* Release per-thread BF work arrays. */
 /* ---------------------------------------------------------------------- */
-struct coarse_sys *
-coarse_sys_construct(struct UnstructuredGrid *g, const int   *p,
-                     struct coarse_topology *ct,
-                     const double           *perm,
-                     const double           *src,
-                     const double           *totmob,
-                     LocalSolver             linsolve)
+static void
+bf_workers_deallocate(int nthreads, struct bf_asm_data **workers)
 /* ---------------------------------------------------------------------- */
 {
-    int                     cf;
-    size_t                  nlocf;
-    double                 *Binv, *w;
-    struct coarse_sys_meta *m;
-    struct bf_asm_data     *bf_asm;
-    struct coarse_sys      *sys;
-
-    sys = NULL;  bf_asm = NULL;  Binv = NULL;  w = NULL;
-
-    m = coarse_sys_meta_construct(g, p, ct);
-
-    if (m != NULL) {
-        Binv   = compute_fs_ip(g, perm, m);
-        w      = coarse_weight(g, ct->nblocks, p, m, perm, src);
-        bf_asm = bf_asm_data_allocate(g, m);
-        sys    = coarse_sys_allocate(ct, m);
-    }
-
-    if ((Binv != NULL) && (w != NULL) &&
-        (bf_asm != NULL) && (sys != NULL)) {
+    int t;
 
-        /* Provide reverse BF->face mapping for fs flux reconstruction */
-        map_dof_to_conn(ct, m, sys);
-
-        /* Prepare storage tables */
-        set_csys_block_pointers(ct, m, sys);
-
-        /* Exclude effects of gravity */
-        vector_zero(g->cell_facepos[ g->number_of_cells ], bf_asm->gpress);
-
-        /* Include mobility effects (multiple phases) */
-        Binv_scale_mobility(g->number_of_cells, m, totmob, Binv);
-
-        /* Discretise flow equation on fine scale */
-        hybsys_schur_comp_symm(g->number_of_cells, g->cell_facepos,
-                               Binv, bf_asm->fsys);
-
-        for (cf = 0; cf < ct->nfaces; cf++) {
-            if (m->bfno[cf] >= 0) {
-                nlocf = enumerate_local_dofs(cf, g, ct, m);
-
-                assemble_local_system(cf, nlocf, g, Binv, w,
-                                      ct, m, bf_asm);
-
-                solve_local_system(cf, g, Binv, ct, m,
-                                   bf_asm, linsolve);
-
-                store_basis_function(cf, ct, m, bf_asm, sys);
-
-                unenumerate_local_dofs(cf, g, ct, m);
-            }
+    if (workers != NULL) {
+        for (t = 0; t < nthreads; t++) {
+            bf_asm_data_deallocate(workers[t]);
         }
-
-        coarse_sys_compute_cell_ip(g->number_of_cells,
-                                   m->max_ngconn,
-                                   ct->nblocks,
-                                   g->cell_facepos,
-                                   Binv,
-                                   m->pb2c, m->b2c,
-                                   sys);
     }
 
-    bf_asm_data_deallocate(bf_asm);
-
-    free(w);    free(Binv);
-    coarse_sys_meta_destroy(m);
-
-    return sys;
+    free(workers);
 }
 
 
 /* ---------------------------------------------------------------------- */
-/* Release dynamic memory resources for coarse system data structure. */
+/* Allocate one set of BF work arrays per thread.
+ *
+ * Returns NULL in case of allocation failure. */
 /* ---------------------------------------------------------------------- */
-void
-coarse_sys_destroy(struct coarse_sys *sys)
+static struct bf_asm_data **
+bf_workers_allocate(int nthreads,
+                    struct coarse_sys_meta *m,
+                    struct hybsys          *fsys,
+                    const double           *gpress)
 /* ---------------------------------------------------------------------- */
 {
-    if (sys != NULL) {
-        free(sys->Binv);
-        free(sys->cell_ip);
-        free(sys->basis);
+    int                  t, ok;
+    struct bf_asm_data **workers;
 
-        free(sys->cell_ip_pos);
-        free(sys->basis_pos);
+    workers = malloc(nthreads * sizeof *workers);
 
-        free(sys->blkdof);
-        free(sys->blkdof_pos);
+    if (workers != NULL) {
+        for (t = 0, ok = 1; t < nthreads; t++) {
+            workers[t] = bf_asm_data_allocate(m, fsys, gpress);
+            ok         = ok && (workers[t] != NULL);
+        }
 
-        free(sys->dof2conn);
+        if (! ok) {
+            bf_workers_deallocate(nthreads, workers);
+            workers = NULL;
+        }
     }
 
-    free(sys);
+    return workers;
 }
 
 
 /* ---------------------------------------------------------------------- */
-/* Compute \Psi'_i * B * \Psi_j for all basis function pairs (i,j) for
- * all cells.  Inverts inv(B) (i.e., Binv) in each cell.  Iterates
- * over blocks (CSR representation b2c_pos, b2c).  Result store in
- * sys->cell_ip, a packed representation of the IP pairs (one col per
- * cell per block).
- *
- * Allocates work arrays and may fail.  Does currently not report failure.*/
+/* Compute fine-scale inner product contributions for all blocks b for
+ * which active_blk[b] is non-zero, or for all blocks if active_blk is
+ * NULL.  Implementation of coarse_sys_compute_cell_ip(). */
 /* ---------------------------------------------------------------------- */
-void
-coarse_sys_compute_cell_ip(int                nc,
-                           int                max_nconn,
-                           int                nb,
-                           const int         *pconn,
-                           const double      *Binv,
-                           const int         *b2c_pos,
-                           const int         *b2c,
-                           struct coarse_sys *sys)
+static void
+compute_cell_ip(int                nc,
+                int                max_nconn,
+                int                nb,
+                const int         *pconn,
+                const double      *Binv,
+                const int         *b2c_pos,
+                const int         *b2c,
+                const int         *active_blk,
+                struct coarse_sys *sys)
 /* ---------------------------------------------------------------------- */
 {
     int i, i1, i2, b, c, n, bf, *pconn2;
@@ -1588,6 +1649,8 @@ coarse_sys_compute_cell_ip(int                nc,
 #endif
 
         for (b = 0; b < nb; b++) {
+            if ((active_blk != NULL) && ! active_blk[b]) { continue; }
+
             loc_nc = b2c_pos[b + 1] - b2c_pos[b];
             bf_off = 0;
             nbf    = sys->blkdof_pos[b + 1] - sys->blkdof_pos[b];
@@ -1693,6 +1756,378 @@ coarse_sys_compute_cell_ip(int                nc,
 }
 
 
+/* ---------------------------------------------------------------------- */
+/* Release data retained between basis function computations. */
+/* ---------------------------------------------------------------------- */
+static void
+bf_data_destroy(struct coarse_sys_bf_data *d)
+/* ---------------------------------------------------------------------- */
+{
+    if (d != NULL) {
+        bf_workers_deallocate(d->nthreads, d->workers);
+        hybsys_free(d->fsys);
+
+        free(d->touched);  free(d->gpress);  free(d->w);
+        free(d->Binv);     free(d->Binv0);
+
+        coarse_sys_meta_destroy(d->m);
+    }
+
+    free(d);
+}
+
+
+/* ---------------------------------------------------------------------- */
+/* Make sure there is one set of BF work arrays per thread.  The
+ * number of threads may have increased since the last call.
+ *
+ * Returns 1 if successful and 0 in case of allocation failure, in
+ * which case the existing work arrays are kept. */
+/* ---------------------------------------------------------------------- */
+static int
+bf_data_ensure_workers(struct coarse_sys_bf_data *d)
+/* ---------------------------------------------------------------------- */
+{
+    int                  nthreads;
+    struct bf_asm_data **workers;
+
+    nthreads = 1;
+#ifdef _OPENMP
+    nthreads = omp_get_max_threads();
+#endif
+
+    if ((d->workers != NULL) && (nthreads <= d->nthreads)) {
+        return 1;
+    }
+
+    workers = bf_workers_allocate(nthreads, d->m, d->fsys, d->gpress);
+
+    if (workers != NULL) {
+        bf_workers_deallocate(d->nthreads, d->workers);
+
+        d->nthreads = nthreads;
+        d->workers  = workers;
+    }
+
+    return workers != NULL;
+}
+
+
+/* ---------------------------------------------------------------------- */
+/* Create data retained between basis function computations.  Takes
+ * ownership of the meta data 'm', also in case of failure.  Computes
+ * the fine-scale inner products and BF weighting, but leaves the
+ * mobility scaling and Schur complements to build_basis().
+ *
+ * Returns NULL in case of allocation failure. */
+/* ---------------------------------------------------------------------- */
+static struct coarse_sys_bf_data *
+bf_data_construct(struct UnstructuredGrid *g, const int *p,
+                  struct coarse_topology *ct,
+                  struct coarse_sys_meta *m,
+                  const double           *perm,
+                  const double           *src)
+/* ---------------------------------------------------------------------- */
+{
+    int                        tot_ngconn, ok;
+    struct coarse_sys_bf_data *new;
+
+    new = malloc(1 * sizeof *new);
+
+    if (new == NULL) {
+        coarse_sys_meta_destroy(m);
+        return NULL;
+    }
+
+    tot_ngconn = g->cell_facepos[ g->number_of_cells ];
+
+    new->m        = m;
+    new->nthreads = 0;
+    new->workers  = NULL;
+
+    new->Binv0   = compute_fs_ip(g, perm, m);
+    new->Binv    = malloc(m->sum_ngconn2 * sizeof *new->Binv);
+    new->w       = coarse_weight(g, ct->nblocks, p, m, perm, src);
+    new->gpress  = malloc(tot_ngconn  * sizeof *new->gpress );
+    new->touched = malloc(ct->nblocks * sizeof *new->touched);
+    new->fsys    = hybsys_allocate_symm((int) m->max_ngconn,
+                                        g->number_of_cells, tot_ngconn);
+
+    ok = (new->Binv0  != NULL) && (new->Binv    != NULL) &&
+         (new->w      != NULL) && (new->gpress  != NULL) &&
+         (new->touched != NULL) && (new->fsys   != NULL);
+
+    if (ok) {
+        hybsys_init((int) m->max_ngconn, new->fsys);
+
+        /* Exclude effects of gravity */
+        vector_zero(tot_ngconn, new->gpress);
+
+        ok = bf_data_ensure_workers(new);
+    }
+
+    if (! ok) {
+        bf_data_destroy(new);
+        new = NULL;
+    }
+
+    return new;
+}
+
+
+/* ---------------------------------------------------------------------- */
+/* Compute basis functions for all active coarse faces that touch a
+ * block for which active_blk[b] is non-zero (all faces if active_blk
+ * is NULL), and recompute the fine-scale inner product contributions
+ * of every block touched by a recomputed basis function.  The
+ * mobility scaling and Schur complements are refreshed for the cells
+ * of the active blocks only, the other cells keep the mobility of
+ * their block's last basis function computation.
+ *
+ * The basis functions are independent and, when compiled with OpenMP,
+ * are computed concurrently using per-thread work arrays.  In that
+ * case 'linsolve' must be reentrant.
+ *
+ * Returns 1 if successful and 0 in case of allocation failure, in
+ * which case 'sys' is unchanged. */
+/* ---------------------------------------------------------------------- */
+static int
+build_basis(struct UnstructuredGrid *g,
+            struct coarse_topology *ct,
+            const double           *totmob,
+            const int              *active_blk,
+            LocalSolver             linsolve,
+            struct coarse_sys      *sys)
+/* ---------------------------------------------------------------------- */
+{
+    int                        cf, b, *b1;
+    size_t                     nlocf;
+    struct coarse_sys_bf_data *d;
+    struct coarse_sys_meta    *m;
+    struct bf_asm_data        *bf_asm;
+
+    d = sys->bf_data;
+    m = d->m;
+
+    if (! bf_data_ensure_workers(d)) {
+        return 0;
+    }
+
+    /* Include mobility effects (multiple phases) */
+    Binv_scale_mobility(ct->nblocks, m, totmob, active_blk,
+                        d->Binv0, d->Binv);
+
+    /* Discretise flow equation on fine scale */
+    schur_comp_blocks(ct->nblocks, m, g->cell_facepos, active_blk,
+                      d->Binv, d->fsys);
+
+    /* Each BF writes a distinct section of sys->basis. */
+#pragma omp parallel for schedule(dynamic) private(bf_asm, nlocf, b1)
+    for (cf = 0; cf < ct->nfaces; cf++) {
+        b1 = ct->neighbours + 2*cf;
+
+        if ((m->bfno[cf] >= 0) &&
+            ((active_blk == NULL) ||
+             ((b1[0] >= 0) && active_blk[b1[0]]) ||
+             ((b1[1] >= 0) && active_blk[b1[1]]))) {
+#ifdef _OPENMP
+            bf_asm = d->workers[ omp_get_thread_num() ];
+#else
+            bf_asm = d->workers[ 0 ];
+#endif
+
+            nlocf = enumerate_local_dofs(cf, g, ct, m, bf_asm->loc_fno);
+
+            assemble_local_system(cf, nlocf, g, d->Binv, d->w,
+                                  ct, m, bf_asm);
+
+            solve_local_system(cf, g, d->Binv, ct, m,
+                               bf_asm, linsolve);
+
+            store_basis_function(cf, ct, m, bf_asm, sys);
+        }
+    }
+
+    /* Blocks whose basis changed need new inner products. */
+    for (b = 0; b < ct->nblocks; b++) {
+        d->touched[b] = (active_blk == NULL) || active_blk[b];
+    }
+    if (active_blk != NULL) {
+        for (cf = 0; cf < ct->nfaces; cf++) {
+            b1 = ct->neighbours + 2*cf;
+
+            if ((m->bfno[cf] >= 0) &&
+                (((b1[0] >= 0) && active_blk[b1[0]]) ||
+                 ((b1[1] >= 0) && active_blk[b1[1]]))) {
+                if (b1[0] >= 0) { d->touched[b1[0]] = 1; }
+                if (b1[1] >= 0) { d->touched[b1[1]] = 1; }
+            }
+        }
+    }
+
+    compute_cell_ip(g->number_of_cells,
+                    m->max_ngconn,
+                    ct->nblocks,
+                    g->cell_facepos,
+                    d->Binv,
+                    m->pb2c, m->b2c,
+                    d->touched, sys);
+
+    return 1;
+}
+
+
+/* ======================================================================
+ * Public interfaces below.
+ * ====================================================================== */
+
+
+/* ---------------------------------------------------------------------- */
+/* Construct coarse system from fine-scale grid (g), partition vector
+ * (p), coarse topology (ct), fine-scale permeability tensor (perm),
+ * fine-scale source terms (src), and fine-scale (total) mobility
+ * field (totmob).
+ *
+ * Uses 'linsolve' to resolve local systems of linear equations.  The
+ * local problems are independent and, when compiled with OpenMP, are
+ * solved concurrently using per-thread work arrays.  In that case
+ * 'linsolve' must be reentrant.
+ *
+ * The fine-scale inner products, Schur complements and work arrays
+ * are retained in the coarse system for use by coarse_sys_update().
+ *
+ * Returns fully constructed coarse system if successful (i.e., if all
+ * internal allocations succeed and all BFs can be constructed), and
+ * NULL if not. */
+/* ---------------------------------------------------------------------- */
+struct coarse_sys *
+coarse_sys_construct(struct UnstructuredGrid *g, const int   *p,
+                     struct coarse_topology *ct,
+                     const double           *perm,
+                     const double           *src,
+                     const double           *totmob,
+                     LocalSolver             linsolve)
+/* ---------------------------------------------------------------------- */
+{
+    int                     ok;
+    struct coarse_sys_meta *m;
+    struct coarse_sys      *sys;
+
+    sys = NULL;  ok = 0;
+
+    m = coarse_sys_meta_construct(g, p, ct);
+
+    if (m != NULL) {
+        sys = coarse_sys_allocate(ct, m);
+    }
+
+    if (sys != NULL) {
+        /* Provide reverse BF->face mapping for fs flux reconstruction */
+        map_dof_to_conn(ct, m, sys);
+
+        /* Prepare storage tables */
+        set_csys_block_pointers(ct, m, sys);
+
+        sys->bf_data = bf_data_construct(g, p, ct, m, perm, src);
+
+        if (sys->bf_data != NULL) {
+            ok = build_basis(g, ct, totmob, NULL, linsolve, sys);
+        }
+    } else {
+        coarse_sys_meta_destroy(m);
+    }
+
+    if (! ok) {
+        coarse_sys_destroy(sys);
+        sys = NULL;
+    }
+
+    return sys;
+}
+
+
+/* ---------------------------------------------------------------------- */
+/* Recompute the basis functions of all coarse faces touching a block
+ * b for which update_blk[b] is non-zero, using the fine-scale (total)
+ * mobility field (totmob) in the cells of those blocks.  The other
+ * cells keep the mobility with which their block's basis functions
+ * were last computed.  The fine-scale inner product contributions
+ * (->cell_ip) of all blocks touched by a recomputed basis function
+ * are updated accordingly.  The remaining basis functions, as well as
+ * the sparsity structure of the coarse system, are unchanged.
+ *
+ * Reuses the fine-scale inner products, Schur complements and work
+ * arrays retained by coarse_sys_construct(), so 'g', 'ct' and
+ * 'linsolve' must coincide with those used to construct 'sys'.
+ *
+ * Returns 1 if successful and 0 in case of allocation failure, in
+ * which case 'sys' is unchanged. */
+/* ---------------------------------------------------------------------- */
+int
+coarse_sys_update(struct UnstructuredGrid *g,
+                  struct coarse_topology *ct,
+                  const double           *totmob,
+                  const int              *update_blk,
+                  LocalSolver             linsolve,
+                  struct coarse_sys      *sys)
+/* ---------------------------------------------------------------------- */
+{
+    return build_basis(g, ct, totmob, update_blk, linsolve, sys);
+}
+
+
+/* ---------------------------------------------------------------------- */
+/* Release dynamic memory resources for coarse system data structure. */
+/* ---------------------------------------------------------------------- */
+void
+coarse_sys_destroy(struct coarse_sys *sys)
+/* ---------------------------------------------------------------------- */
+{
+    if (sys != NULL) {
+        bf_data_destroy(sys->bf_data);
+
+        free(sys->Binv);
+        free(sys->cell_ip);
+        free(sys->basis);
+
+        free(sys->cell_ip_pos);
+        free(sys->basis_pos);
+
+        free(sys->blkdof);
+        free(sys->blkdof_pos);
+
+        free(sys->dof2conn);
+    }
+
+    free(sys);
+}
+
+
+/* ---------------------------------------------------------------------- */
+/* Compute \Psi'_i * B * \Psi_j for all basis function pairs (i,j) for
+ * all cells.  Inverts inv(B) (i.e., Binv) in each cell.  Iterates
+ * over blocks (CSR representation b2c_pos, b2c).  Result store in
+ * sys->cell_ip, a packed representation of the IP pairs (one col per
+ * cell per block).
+ *
+ * Allocates work arrays and may fail.  Does currently not report failure.*/
+/* ---------------------------------------------------------------------- */
+void
+coarse_sys_compute_cell_ip(int                nc,
+                           int                max_nconn,
+                           int                nb,
+                           const int         *pconn,
+                           const double      *Binv,
+                           const int         *b2c_pos,
+                           const int         *b2c,
+                           struct coarse_sys *sys)
+/* ---------------------------------------------------------------------- */
+{
+    compute_cell_ip(nc, max_nconn, nb, pconn, Binv,
+                    b2c_pos, b2c, NULL, sys);
+}
+
+
 /* ---------------------------------------------------------------------- */
 /* Compute inv(B) on coarse scale from fine-scale contributions.
  * Specifically, this function computes the inverse of
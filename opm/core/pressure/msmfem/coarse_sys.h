@@ -28,6 +28,8 @@ extern "C" {
 
 /* ---------------------------------------------------------------------- */
 
+struct coarse_sys_bf_data;
+
 struct coarse_sys {
     int *dof2conn;           /* Map dof->connection (coarse interface) */
     int *blkdof_pos;         /* Start pointers to each block's dofs */
@@ -38,6 +40,8 @@ struct coarse_sys {
     double *basis;           /* All basis functions */
     double *cell_ip;         /* Fine-scale IP contributions */
     double *Binv;            /* Coarse-scale inverse IP per block */
+
+    struct coarse_sys_bf_data *bf_data; /* Retained for updates.  Private */
 };
 
 
@@ -58,6 +62,14 @@ coarse_sys_construct(struct UnstructuredGrid *g, const int   *p,
                      const double           *totmob,
                      LocalSolver             linsolve);
 
+int
+coarse_sys_update(struct UnstructuredGrid *g,
+                  struct coarse_topology *ct,
+                  const double           *totmob,
+                  const int              *update_blk,
+                  LocalSolver             linsolve,
+                  struct coarse_sys      *sys);
+
 void
 coarse_sys_destroy(struct coarse_sys *sys);
 
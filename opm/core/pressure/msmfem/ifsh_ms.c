@@ -19,6 +19,7 @@
 
 #include "config.h"
 #include <assert.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -58,6 +59,8 @@ struct ifsh_ms_impl {
 
     double *fs_hflux;         /* Fine-scale half-contact fluxes */
 
+    double *totmob_ref;       /* Total mobility at last BF update */
+
     int    *p;                /* Copy of partition vector */
     int    *pb2c, *b2c;       /* Bloc->cell mapping (inverse partition) */
 
@@ -173,6 +176,8 @@ ifsh_ms_vectors_construct(struct UnstructuredGrid *G, struct ifsh_ms_impl *pimpl
 
     alloc_sz   += n_fs_gconn;         /* fs_hflux */
 
+    alloc_sz   += G->number_of_cells; /* totmob_ref */
+
     pimpl->ddata = malloc(alloc_sz * sizeof *pimpl->ddata);
 
     alloc_sz  = G->number_of_cells; /* p */
@@ -216,6 +221,10 @@ set_impl_pointers(struct UnstructuredGrid *G, struct ifsh_ms_data *h)
     /* Fine-scale hflux accumulation array */
     h->pimpl->fs_hflux = h->pimpl->work   + work_sz;
 
+    /* Reference mobility for adaptive BF updates */
+    h->pimpl->totmob_ref = h->pimpl->fs_hflux +
+                           G->cell_facepos[ G->number_of_cells ];
+
     /* Partition vector */
     h->pimpl->p = h->pimpl->idata;
 
@@ -407,6 +416,9 @@ ifsh_ms_construct(struct UnstructuredGrid       *G     ,
 
             memcpy(new->pimpl->p, p, G->number_of_cells * sizeof *p);
 
+            memcpy(new->pimpl->totmob_ref, totmob,
+                   G->number_of_cells * sizeof *totmob);
+
             for (i = 0; i < new->pimpl->ct->nblocks; i++) {
                 new->pimpl->pb2c[i] = 0;
             }
@@ -420,6 +432,72 @@ ifsh_ms_construct(struct UnstructuredGrid       *G     ,
 }
 
 
+/* ---------------------------------------------------------------------- */
+/* Recompute basis functions in those blocks in which the fine-scale
+ * total mobility has changed by more than a relative amount 'tol' in
+ * at least one cell since the block's basis functions were last
+ * computed.  A subsequent call to ifsh_ms_assemble() then includes
+ * the updated basis functions.  The fine-scale inner products and
+ * source terms are those passed to ifsh_ms_construct(), and G and
+ * linsolve must coincide with the ones passed there.
+ *
+ * Returns the number of updated blocks, or -1 in case of allocation
+ * failure in which case the basis functions are unchanged. */
+/* ---------------------------------------------------------------------- */
+int
+ifsh_ms_update_basis(struct UnstructuredGrid *G,
+                     const double        *totmob,
+                     double               tol,
+                     LocalSolver          linsolve,
+                     struct ifsh_ms_data *h)
+/* ---------------------------------------------------------------------- */
+{
+    int     b, c, i, nupd, *upd;
+    double  d, *ref;
+
+    upd = malloc(h->pimpl->ct->nblocks * sizeof *upd);
+
+    if (upd == NULL) { return -1; }
+
+    ref  = h->pimpl->totmob_ref;
+    nupd = 0;
+
+    for (b = i = 0; b < h->pimpl->ct->nblocks; b++) {
+        upd[b] = 0;
+
+        for (; i < h->pimpl->pb2c[b + 1]; i++) {
+            c = h->pimpl->b2c[i];
+            d = fabs(totmob[c] - ref[c]);
+
+            upd[b] = upd[b] || (d > tol * fabs(ref[c]));
+        }
+
+        nupd += upd[b];
+    }
+
+    if (nupd > 0) {
+        if (coarse_sys_update(G, h->pimpl->ct, totmob, upd,
+                              linsolve, h->pimpl->sys)) {
+
+            for (b = i = 0; b < h->pimpl->ct->nblocks; b++) {
+                for (; i < h->pimpl->pb2c[b + 1]; i++) {
+                    if (upd[b]) {
+                        c      = h->pimpl->b2c[i];
+                        ref[c] = totmob[c];
+                    }
+                }
+            }
+        } else {
+            nupd = -1;
+        }
+    }
+
+    free(upd);
+
+    return nupd;
+}
+
+
 /* ---------------------------------------------------------------------- */
 void
 ifsh_ms_destroy(struct ifsh_ms_data *h)
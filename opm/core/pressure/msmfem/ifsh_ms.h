@@ -51,6 +51,13 @@ ifsh_ms_construct(struct UnstructuredGrid       *G,
                   const double *totmob,
                   LocalSolver   linsolve);
 
+int
+ifsh_ms_update_basis(struct UnstructuredGrid *G,
+                     const double        *totmob,
+                     double               tol,
+                     LocalSolver          linsolve,
+                     struct ifsh_ms_data *h);
+
 void
 ifsh_ms_destroy(struct ifsh_ms_data *h);
 
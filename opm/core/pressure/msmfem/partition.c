@@ -581,6 +581,843 @@ partition_split_disconnected(int nc, int nneigh, const int *neigh, int *p)
     return ret;
 }
 
+
+/* ======================================================================
+ * Multilevel, weighted graph partitioning.
+ * ====================================================================== */
+
+#define PARTITION_MAX_LEVELS 64
+
+
+/* Undirected, weighted graph (CSR representation, no self
+ * connections).  Parallel edges are allowed on the finest level. */
+struct wgraph {
+    int     n;                  /* Number of vertices */
+    int    *ia, *ja;            /* Adjacency (CSR) */
+    double *ew;                 /* Edge weights (one per ja entry) */
+    double *vw;                 /* Vertex weights */
+};
+
+
+/* ---------------------------------------------------------------------- */
+static void
+wgraph_destroy(struct wgraph *g)
+/* ---------------------------------------------------------------------- */
+{
+    if (g != NULL) {
+        free(g->vw);  free(g->ew);  free(g->ja);  free(g->ia);
+    }
+
+    free(g);
+}
+
+
+/* ---------------------------------------------------------------------- */
+static struct wgraph *
+wgraph_allocate(int n, int nnz)
+/* ---------------------------------------------------------------------- */
+{
+    struct wgraph *new;
+
+    new = malloc(1 * sizeof *new);
+
+    if (new != NULL) {
+        new->n  = n;
+        new->ia = malloc((n + 1) * sizeof *new->ia);
+        new->ja = malloc(MAX(nnz, 1) * sizeof *new->ja);
+        new->ew = malloc(MAX(nnz, 1) * sizeof *new->ew);
+        new->vw = malloc(n * sizeof *new->vw);
+
+        if ((new->ia == NULL) || (new->ja == NULL) ||
+            (new->ew == NULL) || (new->vw == NULL)) {
+            wgraph_destroy(new);
+            new = NULL;
+        }
+    }
+
+    return new;
+}
+
+
+/* Create fine-scale graph from neighbourship definition 'neigh' with
+ * edge weights 'ntrans' and vertex weights 'cwght'.  Either weight
+ * array may be NULL, in which case unit weights are used.
+ *
+ * Returns fully formed graph if successful and NULL otherwise. */
+/* ---------------------------------------------------------------------- */
+static struct wgraph *
+wgraph_from_neigh(int nc, int nneigh, const int *neigh,
+                  const double *ntrans, const double *cwght)
+/* ---------------------------------------------------------------------- */
+{
+    int            i, c1, c2, nnz;
+    double         t;
+    struct wgraph *g;
+
+    nnz = 0;
+    for (i = 0; i < nneigh; i++) {
+        nnz += 2 * ((neigh[2*i + 0] >= 0) && (neigh[2*i + 1] >= 0));
+    }
+
+    g = wgraph_allocate(nc, nnz);
+
+    if (g != NULL) {
+        for (i = 0; i < nc + 1; i++) { g->ia[i] = 0; }
+
+        for (i = 0; i < nneigh; i++) {
+            c1 = neigh[2*i + 0];
+            c2 = neigh[2*i + 1];
+
+            if ((c1 >= 0) && (c2 >= 0)) {
+                g->ia[ c1 + 1 ] ++;
+                g->ia[ c2 + 1 ] ++;
+            }
+        }
+
+        for (i = 1; i <= nc; i++) {
+            g->ia[0] += g->ia[i];
+            g->ia[i]  = g->ia[0] - g->ia[i];
+        }
+
+        for (i = 0; i < nneigh; i++) {
+            c1 = neigh[2*i + 0];
+            c2 = neigh[2*i + 1];
+
+            if ((c1 >= 0) && (c2 >= 0)) {
+                t = (ntrans != NULL) ? ntrans[i] : 1.0;
+
+                g->ew[ g->ia[c1 + 1] ] = t;  g->ja[ g->ia[c1 + 1] ++ ] = c2;
+                g->ew[ g->ia[c2 + 1] ] = t;  g->ja[ g->ia[c2 + 1] ++ ] = c1;
+            }
+        }
+
+        g->ia[0] = 0;
+
+        for (i = 0; i < nc; i++) {
+            g->vw[i] = (cwght != NULL) ? cwght[i] : 1.0;
+        }
+    }
+
+    return g;
+}
+
+
+/* Visit vertices in pseudo-random (but reproducible) order to avoid
+ * directional bias in the matching. */
+/* ---------------------------------------------------------------------- */
+static void
+shuffled_order(int n, int *order)
+/* ---------------------------------------------------------------------- */
+{
+    int           i, j, t;
+    unsigned long state;
+
+    for (i = 0; i < n; i++) { order[i] = i; }
+
+    state = 12345u;
+    for (i = n - 1; i > 0; i--) {
+        state = (1103515245u*state + 12345u) & 0x7fffffffu;
+        j     = (int) (state % (unsigned long) (i + 1));
+
+        t = order[i];  order[i] = order[j];  order[j] = t;
+    }
+}
+
+
+/* Contract graph 'g' by heavy-edge matching.  Vertices whose combined
+ * weight would exceed 'maxvw' are not matched.  Stores fine->coarse
+ * vertex mapping in 'cmap'.  Work array 'iwork' holds at least 3*g->n
+ * entries.
+ *
+ * Returns coarse graph if successful and NULL otherwise. */
+/* ---------------------------------------------------------------------- */
+static struct wgraph *
+wgraph_coarsen(const struct wgraph *g, double maxvw,
+               int *cmap, int *iwork)
+/* ---------------------------------------------------------------------- */
+{
+    int            i, j, k, u, v, best, nc, p, start;
+    int           *order, *match, *pos;
+    double         wbest;
+    struct wgraph *cg;
+
+    order = iwork;
+    match = order + g->n;
+    pos   = match + g->n;
+
+    shuffled_order(g->n, order);
+
+    for (i = 0; i < g->n; i++) { match[i] = -1; }
+
+    for (i = 0; i < g->n; i++) {
+        u = order[i];
+
+        if (match[u] < 0) {
+            best = u;  wbest = -1.0;
+
+            for (j = g->ia[u]; j < g->ia[u + 1]; j++) {
+                v = g->ja[j];
+
+                if ((match[v] < 0) && (v != u) &&
+                    (g->vw[u] + g->vw[v] <= maxvw) &&
+                    (g->ew[j] > wbest)) {
+                    best = v;  wbest = g->ew[j];
+                }
+            }
+
+            match[u] = best;  match[best] = u;
+        }
+    }
+
+    /* Number coarse vertices */
+    for (i = 0; i < g->n; i++) { cmap[i] = -1; }
+
+    nc = 0;
+    for (i = 0; i < g->n; i++) {
+        u = order[i];
+
+        if (cmap[u] < 0) {
+            cmap[u] = cmap[match[u]] = nc++;
+        }
+    }
+
+    /* Fine-scale adjacency size is an upper bound for coarse. */
+    cg = wgraph_allocate(nc, g->ia[g->n]);
+
+    if (cg != NULL) {
+        for (i = 0; i < nc; i++) { pos[i] = -1; cg->vw[i] = 0.0; }
+
+        /* Reuse 'order' as coarse->fine representative map */
+        for (i = 0; i < g->n; i++) {
+            if (match[i] >= i) { order[cmap[i]] = i; }
+        }
+
+        cg->ia[0] = p = 0;
+        for (k = 0; k < nc; k++) {
+            start = p;
+            u     = order[k];
+
+            for (i = 0; i < 1 + (match[u] != u); i++, u = match[u]) {
+                cg->vw[k] += g->vw[u];
+
+                for (j = g->ia[u]; j < g->ia[u + 1]; j++) {
+                    v = cmap[ g->ja[j] ];
+
+                    if (v == k) { continue; }
+
+                    if (pos[v] < start) {
+                        /* New coarse connection */
+                        pos[v]     = p;
+                        cg->ja[p]  = v;
+                        cg->ew[p]  = g->ew[j];
+                        p += 1;
+                    } else {
+                        cg->ew[ pos[v] ] += g->ew[j];
+                    }
+                }
+            }
+
+            cg->ia[k + 1] = p;
+        }
+    }
+
+    return cg;
+}
+
+
+/* Work arrays for recursive bisection. */
+struct bisect_work {
+    int     stamp;              /* Current set/visit marker */
+    int    *mark;               /* Per-vertex marker (g->n) */
+    int    *order;              /* Vertex ordering (g->n) */
+    int    *best;               /* Best ordering so far (g->n) */
+    double *gain;               /* Connection to grown region (g->n) */
+
+    int     hsize;              /* Number of heap entries */
+    double *hkey;               /* Heap keys (g->ia[g->n] + g->n) */
+    int    *hseq;               /* Heap insertion sequence numbers */
+    int    *hval;               /* Heap vertices */
+};
+
+
+/* ---------------------------------------------------------------------- */
+static int
+heap_before(const struct bisect_work *w, int i, int j)
+/* ---------------------------------------------------------------------- */
+{
+    return (w->hkey[i] > w->hkey[j]) ||
+           ((w->hkey[i] == w->hkey[j]) && (w->hseq[i] < w->hseq[j]));
+}
+
+
+/* ---------------------------------------------------------------------- */
+static void
+heap_swap(struct bisect_work *w, int i, int j)
+/* ---------------------------------------------------------------------- */
+{
+    double k;
+    int    t;
+
+    k = w->hkey[i];  w->hkey[i] = w->hkey[j];  w->hkey[j] = k;
+    t = w->hseq[i];  w->hseq[i] = w->hseq[j];  w->hseq[j] = t;
+    t = w->hval[i];  w->hval[i] = w->hval[j];  w->hval[j] = t;
+}
+
+
+/* Insert vertex 'v' with key 'key' into max-heap.  Earlier insertions
+ * take precedence among equal keys. */
+/* ---------------------------------------------------------------------- */
+static void
+heap_push(struct bisect_work *w, double key, int seq, int v)
+/* ---------------------------------------------------------------------- */
+{
+    int i;
+
+    i = w->hsize++;
+    w->hkey[i] = key;  w->hseq[i] = seq;  w->hval[i] = v;
+
+    while ((i > 0) && heap_before(w, i, (i - 1) / 2)) {
+        heap_swap(w, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+
+/* ---------------------------------------------------------------------- */
+static int
+heap_pop(struct bisect_work *w)
+/* ---------------------------------------------------------------------- */
+{
+    int i, c, v;
+
+    v = w->hval[0];
+
+    w->hsize -= 1;
+    if (w->hsize > 0) {
+        heap_swap(w, 0, w->hsize);
+
+        i = 0;
+        while ((c = 2*i + 1) < w->hsize) {
+            if ((c + 1 < w->hsize) && heap_before(w, c + 1, c)) { c++; }
+            if (! heap_before(w, c, i)) { break; }
+
+            heap_swap(w, i, c);
+            i = c;
+        }
+    }
+
+    return v;
+}
+
+
+/* Order the 'm' vertices 'nodes' of 'g' by greedy region growing from
+ * vertex 'start'.  The next vertex is the one most strongly connected
+ * to the region grown so far or, if 'cut_gain' is set, the one whose
+ * inclusion reduces the weight of the region's cut edges the most.
+ * Stores ordering in w->order. */
+/* ---------------------------------------------------------------------- */
+static void
+grow_region(const struct wgraph *g, int m, const int *nodes, int start,
+            int cut_gain, struct bisect_work *w)
+/* ---------------------------------------------------------------------- */
+{
+    int i, j, u, v, n, seq, next;
+
+    w->stamp += 2;              /* stamp-1: in set, stamp: taken */
+    for (i = 0; i < m; i++) { w->mark[nodes[i]] = w->stamp - 1; }
+
+    /* Cut gain starts at minus the weight of set internal edges */
+    for (i = 0; i < m; i++) {
+        u = nodes[i];
+        w->gain[u] = 0.0;
+
+        for (j = g->ia[u]; cut_gain && (j < g->ia[u + 1]); j++) {
+            if (w->mark[ g->ja[j] ] == w->stamp - 1) {
+                w->gain[u] -= g->ew[j];
+            }
+        }
+    }
+
+    n = seq = next = 0;
+    w->hsize = 0;
+    heap_push(w, w->gain[start], seq++, start);
+
+    while (n < m) {
+        if (w->hsize == 0) {
+            /* Disconnected set.  Restart from untaken vertex. */
+            while (w->mark[nodes[next]] == w->stamp) { next++; }
+            heap_push(w, w->gain[nodes[next]], seq++, nodes[next]);
+        }
+
+        /* Gains only increase so stale entries surface last. */
+        u = heap_pop(w);
+        if (w->mark[u] == w->stamp) { continue; }
+
+        w->mark[u] = w->stamp;
+        w->order[n++] = u;
+
+        for (j = g->ia[u]; j < g->ia[u + 1]; j++) {
+            v = g->ja[j];
+
+            if (w->mark[v] == w->stamp - 1) {
+                w->gain[v] += (1.0 + cut_gain) * g->ew[j];
+                heap_push(w, w->gain[v], seq++, v);
+            }
+        }
+    }
+}
+
+
+/* Split w->order at the weight 'target'.  Returns the split point and
+ * sets '*cut' to the weight of the edges connecting the two parts. */
+/* ---------------------------------------------------------------------- */
+static int
+split_order(const struct wgraph *g, int m, double target,
+            struct bisect_work *w, double *cut)
+/* ---------------------------------------------------------------------- */
+{
+    int    i, j, s, u;
+    double wgt;
+
+    s = 0;  wgt = 0.0;
+    while ((s < m) && (wgt + 0.5*g->vw[w->order[s]] < target)) {
+        wgt += g->vw[w->order[s++]];
+    }
+
+    if (m >= 2) { s = MAX(1, s);  s = (s < m) ? s : m - 1; }
+
+    /* grow_region() left the whole set marked 'stamp'. */
+    w->stamp += 1;
+    for (i = 0; i < s; i++) { w->mark[w->order[i]] = w->stamp; }
+
+    *cut = 0.0;
+    for (i = s; i < m; i++) {
+        u = w->order[i];
+
+        for (j = g->ia[u]; j < g->ia[u + 1]; j++) {
+            if (w->mark[ g->ja[j] ] == w->stamp) { *cut += g->ew[j]; }
+        }
+    }
+
+    return s;
+}
+
+
+/* Split the 'm' vertices 'nodes' of 'g' into 'k' parts numbered
+ * base:base+k-1 by recursive bisection.  Each bisection grows regions
+ * of the requisite weight from a few starting vertices, using both
+ * growth criteria of grow_region(), and keeps the one with the
+ * smallest cut.  Reorders 'nodes'. */
+/* ---------------------------------------------------------------------- */
+static void
+bisect_recursive(const struct wgraph *g, int m, int *nodes, int k, int base,
+                 struct bisect_work *w, int *part)
+/* ---------------------------------------------------------------------- */
+{
+    int    i, t, s, sbest, k1, start[4];
+    double cut, cbest, wtot, target;
+
+    if (m == 0) { return; }
+
+    if (k == 1) {
+        for (i = 0; i < m; i++) { part[nodes[i]] = base; }
+        return;
+    }
+
+    k1   = k / 2;
+    wtot = 0.0;
+    for (i = 0; i < m; i++) { wtot += g->vw[nodes[i]]; }
+
+    target = wtot * k1 / k;
+
+    /* Starting points: Both ends of a pseudo-diameter, an interior
+     * vertex and the vertex farthest from it. */
+    grow_region(g, m, nodes, nodes[0], 0, w);
+    start[0] = w->order[m - 1];
+    grow_region(g, m, nodes, start[0], 0, w);
+    start[1] = w->order[m - 1];
+    start[2] = nodes[m / 2];
+    grow_region(g, m, nodes, start[2], 0, w);
+    start[3] = w->order[m - 1];
+
+    sbest = 0;  cbest = -1.0;
+    for (t = 0; t < 8; t++) {
+        grow_region(g, m, nodes, start[t / 2], t % 2, w);
+        s = split_order(g, m, target, w, &cut);
+
+        if ((cbest < 0.0) || (cut < cbest)) {
+            sbest = s;  cbest = cut;
+            memcpy(w->best, w->order, m * sizeof *w->best);
+        }
+    }
+
+    memcpy(nodes, w->best, m * sizeof *nodes);
+
+    bisect_recursive(g, sbest    , nodes        , k1    , base     , w, part);
+    bisect_recursive(g, m - sbest, nodes + sbest, k - k1, base + k1, w, part);
+}
+
+
+/* Accumulate connection weight from vertex 'u' to each part in
+ * 'conn'.  Stores the parts, other than u's own, to which 'u' is
+ * connected in 'touched' and returns their number.  Array 'seen'
+ * holds 'k' zero-initialised flags.  Use clear_conn() to reset. */
+/* ---------------------------------------------------------------------- */
+static int
+vertex_conn(const struct wgraph *g, int u, const int *part,
+            double *conn, int *touched, int *seen)
+/* ---------------------------------------------------------------------- */
+{
+    int j, b, nt;
+
+    nt = 0;
+
+    for (j = g->ia[u]; j < g->ia[u + 1]; j++) {
+        b = part[ g->ja[j] ];
+
+        if ((b != part[u]) && ! seen[b]) {
+            seen[b] = 1;  touched[nt++] = b;
+        }
+
+        conn[b] += g->ew[j];
+    }
+
+    return nt;
+}
+
+
+/* ---------------------------------------------------------------------- */
+static void
+clear_conn(int own, int nt, const int *touched, double *conn, int *seen)
+/* ---------------------------------------------------------------------- */
+{
+    int j;
+
+    conn[own] = 0.0;
+    for (j = 0; j < nt; j++) {
+        conn[touched[j]] = 0.0;  seen[touched[j]] = 0;
+    }
+}
+
+
+/* Greedy boundary refinement of k-way partition 'part' of 'g'.  A
+ * vertex is moved to the neighbouring part to which it has the
+ * strongest connection if doing so reduces the cut weight without
+ * exceeding the part weight limit 'maxpw', or if it relieves an
+ * overweight part.  Part weights 'pw' are updated.  Work array 'conn'
+ * holds at least 'k' doubles, initialised to zero, and 'touched' at
+ * least 2*k ints of which the last 'k' are initialised to zero. */
+/* ---------------------------------------------------------------------- */
+static void
+refine_partition(const struct wgraph *g, int k, double maxpw,
+                 int *part, double *pw, double *conn, int *touched)
+/* ---------------------------------------------------------------------- */
+{
+    int    pass, nmoves, u, j, b, own, best, nt, *seen;
+    double gain, bgain, vw;
+
+    seen = touched + k;
+
+    for (pass = 0, nmoves = 1; (pass < 8) && (nmoves > 0); pass++) {
+        nmoves = 0;
+
+        for (u = 0; u < g->n; u++) {
+            own = part[u];
+            vw  = g->vw[u];
+            nt  = vertex_conn(g, u, part, conn, touched, seen);
+
+            best = -1;  bgain = 0.0;
+
+            if (pw[own] - vw > 0.0) {
+                for (j = 0; j < nt; j++) {
+                    b    = touched[j];
+                    gain = conn[b] - conn[own];
+
+                    if (pw[b] + vw > maxpw) { continue; }
+
+                    if ((gain > bgain) ||
+                        ((best < 0) && (gain == 0.0) &&
+                         (pw[b] + vw < pw[own])) ||
+                        ((best < 0) && (pw[own] > maxpw))) {
+                        best = b;  bgain = gain;
+                    }
+                }
+            }
+
+            if (best >= 0) {
+                part[u]    = best;
+                pw[own]   -= vw;
+                pw[best]  += vw;
+                nmoves    += 1;
+            }
+
+            clear_conn(own, nt, touched, conn, seen);
+        }
+    }
+}
+
+
+/* Best admissible move of vertex 'u': the neighbouring part with room
+ * for 'u' that maximises the cut weight reduction '*gain' (which may
+ * be negative).  Returns -1 if there is no admissible move. */
+/* ---------------------------------------------------------------------- */
+static int
+best_move(const struct wgraph *g, int u, int k, double maxpw,
+          const int *part, const double *pw,
+          double *conn, int *touched, double *gain)
+/* ---------------------------------------------------------------------- */
+{
+    int    j, b, own, best, nt, *seen;
+    double vw;
+
+    seen = touched + k;
+    own  = part[u];
+    vw   = g->vw[u];
+    nt   = vertex_conn(g, u, part, conn, touched, seen);
+
+    best = -1;  *gain = 0.0;
+
+    if (pw[own] - vw > 0.0) {
+        for (j = 0; j < nt; j++) {
+            b = touched[j];
+
+            if ((pw[b] + vw <= maxpw) &&
+                ((best < 0) || (conn[b] - conn[own] > *gain))) {
+                best = b;  *gain = conn[b] - conn[own];
+            }
+        }
+    }
+
+    clear_conn(own, nt, touched, conn, seen);
+
+    return best;
+}
+
+
+/* Fiduccia-Mattheyses type refinement of k-way partition 'part' of
+ * 'g'.  Boundary vertices are moved in order of decreasing gain, each
+ * at most once per pass, also when this temporarily increases the cut
+ * weight.  Moves beyond the point of smallest cut weight are undone.
+ * This escapes local minima of refine_partition().  Work arrays as for
+ * refine_partition(), heap and markers in 'w'. */
+/* ---------------------------------------------------------------------- */
+static void
+fm_refine_partition(const struct wgraph *g, int k, double maxpw,
+                    int *part, double *pw, double *conn, int *touched,
+                    struct bisect_work *w)
+/* ---------------------------------------------------------------------- */
+{
+    int    pass, u, v, b, j, seq, nmoves, nbest, limit;
+    int   *moved, *from;
+    double key, gain, cum, best_cum;
+
+    moved = w->order;
+    from  = w->best;
+    limit = MAX(25, g->n / 100);
+
+    for (pass = 0, best_cum = 1.0; (pass < 4) && (best_cum > 0.0); pass++) {
+        w->stamp += 1;          /* Locked vertices */
+        w->hsize  = seq = 0;
+
+        for (u = 0; u < g->n; u++) {
+            b = best_move(g, u, k, maxpw, part, pw, conn, touched, &gain);
+            if (b >= 0) { heap_push(w, gain, seq++, u); }
+        }
+
+        nmoves = nbest = 0;
+        cum    = best_cum = 0.0;
+
+        while ((w->hsize > 0) && (nmoves - nbest < limit)) {
+            key = w->hkey[0];
+            u   = heap_pop(w);
+
+            if (w->mark[u] == w->stamp) { continue; }
+
+            b = best_move(g, u, k, maxpw, part, pw, conn, touched, &gain);
+
+            if (b < 0) { continue; }
+            if (gain != key) {
+                /* Stale entry.  Reinsert with current gain. */
+                heap_push(w, gain, seq++, u);
+                continue;
+            }
+
+            moved[nmoves] = u;  from[nmoves] = part[u];  nmoves += 1;
+
+            pw[part[u]] -= g->vw[u];
+            pw[b]       += g->vw[u];
+            part[u]      = b;
+            w->mark[u]   = w->stamp;
+
+            cum += gain;
+            if (cum > best_cum) { best_cum = cum;  nbest = nmoves; }
+
+            for (j = g->ia[u]; j < g->ia[u + 1]; j++) {
+                v = g->ja[j];
+
+                if (w->mark[v] != w->stamp) {
+                    b = best_move(g, v, k, maxpw, part, pw,
+                                  conn, touched, &gain);
+                    if (b >= 0) { heap_push(w, gain, seq++, v); }
+                }
+            }
+        }
+
+        /* Undo moves past the best point */
+        while (nmoves > nbest) {
+            nmoves -= 1;
+            u       = moved[nmoves];
+
+            pw[part[u]]     -= g->vw[u];
+            pw[from[nmoves]] += g->vw[u];
+            part[u]          = from[nmoves];
+        }
+    }
+}
+
+
+/* Partition 'nc' cells into (at most) 'nblk' blocks using multilevel
+ * graph partitioning.  The cell graph is defined by 'neigh' (2*nneigh
+ * array, negative entries denote the outside) with edge weights
+ * 'ntrans' (typically transmissibilities) and vertex weights 'cwght'
+ * (e.g., pore volumes).  Either weight array may be NULL, meaning unit
+ * weights.
+ *
+ * The graph is repeatedly contracted by heavy-edge matching, the
+ * coarsest graph is split by recursive bisection, and the partition
+ * is projected back and refined level by level (greedy and FM type
+ * boundary refinement) to reduce the total weight of cut edges
+ * subject to a maximum block weight of 'ubfactor' (>= 1) times the
+ * mean.  Strongly connected cells thus tend to end up in the same
+ * block.  No external partitioning library is needed.
+ *
+ * Blocks may be disconnected.  Use partition_split_disconnected() and
+ * partition_compress() before constructing a coarse topology.
+ *
+ * Returns 'nc' if successful and -1 otherwise. */
+/* ---------------------------------------------------------------------- */
+int
+partition_graph(int nc, int nneigh, const int *neigh,
+                const double *ntrans, const double *cwght,
+                int nblk, double ubfactor, int *p)
+/* ---------------------------------------------------------------------- */
+{
+    int            ok, i, l, nlev, hcap, coarsen_to;
+    int           *cmap[PARTITION_MAX_LEVELS], *iwork, *touched, *part;
+    double         wtot, maxvw, *pw, *conn;
+    struct wgraph *g[PARTITION_MAX_LEVELS + 1];
+
+    struct bisect_work bw;
+
+    assert ((nc > 0) && (nblk > 0) && (ubfactor >= 1.0));
+
+    g[0] = wgraph_from_neigh(nc, nneigh, neigh, ntrans, cwght);
+
+    bw.gain = bw.hkey = NULL;  bw.hseq = bw.hval = NULL;
+
+    iwork   = malloc(4 * nc * sizeof *iwork);
+    part    = malloc(nc * sizeof *part);
+    touched = malloc(2 * nblk * sizeof *touched);
+    pw      = malloc(nblk * sizeof *pw);
+    conn    = malloc(nblk * sizeof *conn);
+
+    ok = (g[0] != NULL) && (iwork != NULL) && (part != NULL) &&
+         (touched != NULL) && (pw != NULL) && (conn != NULL);
+
+    nlev = 0;
+    if (ok) {
+        wtot = 0.0;
+        for (i = 0; i < nc; i++) { wtot += g[0]->vw[i]; }
+
+        coarsen_to = MAX(20 * nblk, 100);
+        maxvw      = 1.5 * wtot / coarsen_to;
+
+        /* Coarsening phase */
+        while (ok && (nlev < PARTITION_MAX_LEVELS) &&
+               (g[nlev]->n > coarsen_to)) {
+            cmap[nlev] = malloc(g[nlev]->n * sizeof *cmap[nlev]);
+
+            if (cmap[nlev] == NULL) { ok = 0; break; }
+
+            g[nlev + 1] = wgraph_coarsen(g[nlev], maxvw, cmap[nlev], iwork);
+
+            if (g[nlev + 1] == NULL) {
+                free(cmap[nlev]);
+                ok = 0;
+            } else if (g[nlev + 1]->n > 0.95 * g[nlev]->n) {
+                /* Insufficient contraction.  Stop here. */
+                wgraph_destroy(g[nlev + 1]);
+                free(cmap[nlev]);
+                break;
+            } else {
+                nlev += 1;
+            }
+        }
+    }
+
+    if (ok) {
+        hcap = g[0]->ia[nc] + nc;
+
+        /* Initial partition of coarsest graph */
+        bw.stamp = 0;
+        bw.mark  = iwork + nc;
+        bw.order = iwork + 2*nc;
+        bw.best  = iwork + 3*nc;
+        bw.gain  = malloc(nc * sizeof *bw.gain);
+        bw.hkey  = malloc(hcap * sizeof *bw.hkey);
+        bw.hseq  = malloc(hcap * sizeof *bw.hseq);
+        bw.hval  = malloc(hcap * sizeof *bw.hval);
+
+        ok = (bw.gain != NULL) && (bw.hkey != NULL) &&
+             (bw.hseq != NULL) && (bw.hval != NULL);
+
+        if (ok) {
+            for (i = 0; i < nc; i++) { bw.mark[i] = 0; }
+            for (i = 0; i < g[nlev]->n; i++) { iwork[i] = i; }
+
+            bisect_recursive(g[nlev], g[nlev]->n, iwork, nblk, 0, &bw, part);
+        }
+    }
+
+    if (ok) {
+        for (i = 0; i < nblk; i++) {
+            pw[i] = 0.0;  conn[i] = 0.0;  touched[nblk + i] = 0;
+        }
+        for (i = 0; i < g[nlev]->n; i++) { pw[part[i]] += g[nlev]->vw[i]; }
+
+        /* Uncoarsening phase */
+        for (l = nlev; l >= 0; l--) {
+            if (l < nlev) {
+                for (i = 0; i < g[l]->n; i++) {
+                    iwork[i] = part[ cmap[l][i] ];
+                }
+                memcpy(part, iwork, g[l]->n * sizeof *part);
+            }
+
+            refine_partition(g[l], nblk, ubfactor * wtot / nblk,
+                             part, pw, conn, touched);
+
+            fm_refine_partition(g[l], nblk, ubfactor * wtot / nblk,
+                                part, pw, conn, touched, &bw);
+        }
+
+        memcpy(p, part, nc * sizeof *p);
+    }
+
+    for (l = 0; l < nlev; l++) {
+        free(cmap[l]);
+        wgraph_destroy(g[l + 1]);
+    }
+    wgraph_destroy(g[0]);
+
+    free(bw.hval);  free(bw.hseq);  free(bw.hkey);  free(bw.gain);
+
+    free(conn);  free(pw);  free(touched);  free(part);  free(iwork);
+
+    return ok ? nc : -1;
+}
+
+
 /* Local Variables:    */
 /* c-basic-offset:4    */
 /* End:                */
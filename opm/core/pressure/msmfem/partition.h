@@ -55,6 +55,11 @@ int
 partition_split_disconnected(int nc, int nneigh, const int *neigh,
                              int *p);
 
+int
+partition_graph(int nc, int nneigh, const int *neigh,
+                const double *ntrans, const double *cwght,
+                int nblk, double ubfactor, int *p);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,333 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#include <opm/core/linalg/blas_lapack.h>
+
+#include <opm/core/pressure/tpfa/cfs_tpfa_dense.h>
+
+
+/* The fixed-size kernels use LAPACK factorisation instead of the
+ * explicit inverse if |det(A)| is below this fraction of the product
+ * of the column norms of A (Hadamard's bound on |det(A)|). */
+#define CFS_TPFA_DENSE_DET_RTOL 1.0e-8
+
+
+static void
+factorise_fluid_matrix(int np, const double *A, struct cfs_tpfa_dense *d)
+{
+    int        np2;
+    MAT_SIZE_T m, n, ld, info;
+
+    m = n = ld = np;
+    np2 = np * np;
+
+    memcpy (d->lu, A, np2 * sizeof *d->lu);
+    dgetrf_(&m, &n, d->lu, &ld, d->ipiv, &info);
+
+    assert (info == 0);
+
+    d->is_lu = 1;
+}
+
+
+static void
+solve_linear_systems(int                    np  ,
+                     MAT_SIZE_T             nrhs,
+                     struct cfs_tpfa_dense *d   ,
+                     double                *b   )
+{
+    MAT_SIZE_T n, ldA, ldB, info;
+
+    n = ldA = ldB = np;
+
+    dgetrs_("No Transpose", &n,
+            &nrhs, d->lu, &ldA, d->ipiv,
+            b           , &ldB, &info);
+
+    assert (info == 0);
+}
+
+
+static void
+matvec(int nrow, int ncol, const double *A, const double *x, double *y)
+{
+    MAT_SIZE_T m, n, ld, incx, incy;
+    double     a1, a2;
+
+    m    = ld = nrow;
+    n    = ncol;
+    incx = incy = 1;
+    a1   = 1.0;
+    a2   = 0.0;
+
+    dgemv_("No Transpose", &m, &n,
+           &a1, A, &ld, x, &incx,
+           &a2,         y, &incy);
+}
+
+
+static void
+matmat(int np, int ncol, const double *A, const double *B, double *C)
+{
+    MAT_SIZE_T m, n, k, ldA, ldB, ldC;
+    double     a1, a2;
+
+    m  = k = ldA = ldB = ldC = np;
+    n  = ncol;
+    a1 = 1.0;
+    a2 = 0.0;
+
+    dgemm_("No Transpose", "No Transpose", &m, &n, &k,
+           &a1, A, &ldA, B, &ldB, &a2, C, &ldC);
+}
+
+
+/* ---------------------------------------------------------------------- */
+/* Fixed-size kernels for np = 1, 2, 3.  The "factorisation" stores the
+ * explicit inverse of the fluid matrix in d->lu, and the solves
+ * multiply by it.  The generic helpers below are only ever called with
+ * a literal row count, allowing the compiler to unroll the loops. */
+/* ---------------------------------------------------------------------- */
+
+/* Non-zero if det(A) is too small, relative to the columns of A, for
+ * the explicit inverse to be accurate. */
+static int
+near_singular(int n, const double *A, double det)
+{
+    int    i, j;
+    double bound, s;
+
+    bound = 1.0;
+    for (j = 0; j < n; j++) {
+        for (i = 0, s = 0.0; i < n; i++) {
+            s += A[i + j*n] * A[i + j*n];
+        }
+        bound *= sqrt(s);
+    }
+
+    return ! (fabs(det) > CFS_TPFA_DENSE_DET_RTOL * bound);
+}
+
+
+static void
+factorise_fluid_matrix_1(int np, const double *A, struct cfs_tpfa_dense *d)
+{
+    if (near_singular(1, A, A[0])) {
+        factorise_fluid_matrix(np, A, d);
+        return;
+    }
+
+    d->lu[0] = 1.0 / A[0];
+    d->is_lu = 0;
+}
+
+
+static void
+factorise_fluid_matrix_2(int np, const double *A, struct cfs_tpfa_dense *d)
+{
+    double det;
+
+    det = A[0]*A[3] - A[2]*A[1];
+
+    if (near_singular(2, A, det)) {
+        factorise_fluid_matrix(np, A, d);
+        return;
+    }
+
+    d->lu[0] =   A[3] / det;
+    d->lu[1] = - A[1] / det;
+    d->lu[2] = - A[2] / det;
+    d->lu[3] =   A[0] / det;
+    d->is_lu = 0;
+}
+
+
+static void
+factorise_fluid_matrix_3(int np, const double *A, struct cfs_tpfa_dense *d)
+{
+    /* Rows of inv(A) are the cross products of pairs of columns of A,
+     * divided by det(A). */
+    const double *c0, *c1, *c2;
+    double        r[3][3], det;
+    int           i, j;
+
+    c0 = A + 0;  c1 = A + 3;  c2 = A + 6;
+
+    r[0][0] = c1[1]*c2[2] - c1[2]*c2[1];
+    r[0][1] = c1[2]*c2[0] - c1[0]*c2[2];
+    r[0][2] = c1[0]*c2[1] - c1[1]*c2[0];
+
+    r[1][0] = c2[1]*c0[2] - c2[2]*c0[1];
+    r[1][1] = c2[2]*c0[0] - c2[0]*c0[2];
+    r[1][2] = c2[0]*c0[1] - c2[1]*c0[0];
+
+    r[2][0] = c0[1]*c1[2] - c0[2]*c1[1];
+    r[2][1] = c0[2]*c1[0] - c0[0]*c1[2];
+    r[2][2] = c0[0]*c1[1] - c0[1]*c1[0];
+
+    det = c0[0]*r[0][0] + c0[1]*r[0][1] + c0[2]*r[0][2];
+
+    if (near_singular(3, A, det)) {
+        factorise_fluid_matrix(np, A, d);
+        return;
+    }
+
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < 3; j++) {
+            d->lu[i + j*3] = r[i][j] / det;
+        }
+    }
+    d->is_lu = 0;
+}
+
+
+static void
+solve_small(int n, MAT_SIZE_T nrhs, const double *inv, double *b)
+{
+    MAT_SIZE_T k;
+    int        i, j;
+    double     x[3];
+
+    for (k = 0; k < nrhs; k++, b += n) {
+        for (i = 0; i < n; i++) {
+            x[i] = 0.0;
+            for (j = 0; j < n; j++) {
+                x[i] += inv[i + j*n] * b[j];
+            }
+        }
+        for (i = 0; i < n; i++) {
+            b[i] = x[i];
+        }
+    }
+}
+
+
+static void
+matvec_small(int n, int ncol, const double *A, const double *x, double *y)
+{
+    int i, j;
+
+    for (i = 0; i < n; i++) { y[i] = 0.0; }
+
+    for (j = 0; j < ncol; j++, A += n) {
+        for (i = 0; i < n; i++) {
+            y[i] += A[i] * x[j];
+        }
+    }
+}
+
+
+static void
+matmat_small(int n, int ncol, const double *A, const double *B, double *C)
+{
+    int j;
+
+    for (j = 0; j < ncol; j++, B += n, C += n) {
+        matvec_small(n, n, A, B, C);
+    }
+}
+
+
+#define CFS_TPFA_SMALL_KERNELS(N)                                       \
+static void                                                             \
+solve_linear_systems_##N(int np, MAT_SIZE_T nrhs,                       \
+                         struct cfs_tpfa_dense *d, double *b)           \
+{                                                                       \
+    if (d->is_lu) {                                                     \
+        solve_linear_systems(np, nrhs, d, b);                           \
+    } else {                                                            \
+        solve_small(N, nrhs, d->lu, b);                                 \
+    }                                                                   \
+}                                                                       \
+                                                                        \
+static void                                                             \
+matvec_##N(int nrow, int ncol, const double *A, const double *x,        \
+           double *y)                                                   \
+{                                                                       \
+    (void) nrow;                                                        \
+    matvec_small(N, ncol, A, x, y);                                     \
+}                                                                       \
+                                                                        \
+static void                                                             \
+matmat_##N(int np, int ncol, const double *A, const double *B,          \
+           double *C)                                                   \
+{                                                                       \
+    (void) np;                                                          \
+    matmat_small(N, ncol, A, B, C);                                     \
+}
+
+CFS_TPFA_SMALL_KERNELS(1)
+CFS_TPFA_SMALL_KERNELS(2)
+CFS_TPFA_SMALL_KERNELS(3)
+
+#undef CFS_TPFA_SMALL_KERNELS
+
+
+/* ---------------------------------------------------------------------- */
+void
+cfs_tpfa_dense_select_generic(struct cfs_tpfa_dense *d)
+/* ---------------------------------------------------------------------- */
+{
+    d->is_lu     = 1;
+    d->factorise = factorise_fluid_matrix;
+    d->solve     = solve_linear_systems;
+    d->matvec    = matvec;
+    d->matmat    = matmat;
+}
+
+
+/* ---------------------------------------------------------------------- */
+void
+cfs_tpfa_dense_select(int np, struct cfs_tpfa_dense *d)
+/* ---------------------------------------------------------------------- */
+{
+    d->is_lu = 0;
+
+    switch (np) {
+    case 1:
+        d->factorise = factorise_fluid_matrix_1;
+        d->solve     = solve_linear_systems_1;
+        d->matvec    = matvec_1;
+        d->matmat    = matmat_1;
+        break;
+
+    case 2:
+        d->factorise = factorise_fluid_matrix_2;
+        d->solve     = solve_linear_systems_2;
+        d->matvec    = matvec_2;
+        d->matmat    = matmat_2;
+        break;
+
+    case 3:
+        d->factorise = factorise_fluid_matrix_3;
+        d->solve     = solve_linear_systems_3;
+        d->matvec    = matvec_3;
+        d->matmat    = matmat_3;
+        break;
+
+    default:
+        cfs_tpfa_dense_select_generic(d);
+        break;
+    }
+}
@@ -0,0 +1,113 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_CFS_TPFA_DENSE_H_HEADER
+#define OPM_CFS_TPFA_DENSE_H_HEADER
+
+/**
+ * \file
+ * Dense linear algebra kernels for the small (number of phases by
+ * number of phases) fluid matrices of the compressible TPFA residual
+ * formulation.
+ */
+
+#include <opm/core/linalg/blas_lapack.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Dense kernel set and factorisation of a single fluid matrix.  All
+ * matrices are square, of size <CODE>np</CODE>, and stored in column
+ * major (Fortran) order.
+ */
+struct cfs_tpfa_dense {
+    /**
+     * Non-zero if @c lu holds an LU factorisation with pivots @c ipiv,
+     * zero if it holds the explicit inverse of the fluid matrix.
+     */
+    int         is_lu;
+
+    /**
+     * Factorisation.  Array of size <CODE>np * np</CODE>.  Owned by
+     * the client.
+     */
+    double     *lu;
+
+    /**
+     * LU pivots.  Array of size <CODE>np</CODE>.  Owned by the client.
+     */
+    MAT_SIZE_T *ipiv;
+
+    /**
+     * Factorise the fluid matrix @c A.
+     */
+    void (*factorise)(int np, const double *A, struct cfs_tpfa_dense *d);
+
+    /**
+     * Overwrite the @c nrhs right-hand sides @c b by the solutions of
+     * the systems defined by the most recent factorisation.
+     */
+    void (*solve)    (int np, MAT_SIZE_T nrhs,
+                      struct cfs_tpfa_dense *d, double *b);
+
+    /**
+     * Compute <CODE>y = A*x</CODE> for a @c nrow by @c ncol matrix.
+     */
+    void (*matvec)   (int nrow, int ncol,
+                      const double *A, const double *x, double *y);
+
+    /**
+     * Compute <CODE>C = A*B</CODE> for an @c np by @c np matrix @c A
+     * and @c np by @c ncol matrices @c B and @c C.
+     */
+    void (*matmat)   (int np, int ncol,
+                      const double *A, const double *B, double *C);
+};
+
+
+/**
+ * Select kernels for fluid matrices of size @c np.  Fixed-size kernels
+ * based on explicit inverses are used if <CODE>np <= 3</CODE>, and the
+ * generic LAPACK/BLAS kernels otherwise.  The fixed-size kernels fall
+ * back to LAPACK factorisation of matrices that are close to singular.
+ *
+ * @param[in]     np Number of phases.
+ * @param[in,out] d  Kernel set.  Fields @c lu and @c ipiv must be
+ *                   assigned by the caller.
+ */
+void
+cfs_tpfa_dense_select(int np, struct cfs_tpfa_dense *d);
+
+
+/**
+ * Select the generic LAPACK/BLAS kernels irrespective of matrix size.
+ *
+ * @param[in,out] d Kernel set.  Fields @c lu and @c ipiv must be
+ *                  assigned by the caller.
+ */
+void
+cfs_tpfa_dense_select_generic(struct cfs_tpfa_dense *d);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* OPM_CFS_TPFA_DENSE_H_HEADER */
@@ -9,6 +9,7 @@
 #include <opm/core/linalg/blas_lapack.h>
 #include <opm/core/linalg/sparse_sys.h>
 
+#include <opm/core/pressure/tpfa/cfs_tpfa_dense.h>
 #include <opm/core/pressure/tpfa/compr_quant_general.h>
 #include <opm/core/pressure/tpfa/compr_source.h>
 #include <opm/core/pressure/tpfa/trans_tpfa.h>
@@ -33,6 +34,9 @@ struct densrat_util {
     double     *mat_row;
     double     *coeff;
     double     *linsolve_buffer;
+
+    /* Dense kernels, selected by number of phases at construction. */
+    struct cfs_tpfa_dense dense;
 };
 
 
@@ -106,6 +110,10 @@ allocate_densrat(size_t max_conn, int np)
             ratio->mat_row         = ratio->t2      + (1              * np);
             ratio->coeff           = ratio->mat_row + ((max_conn + 1) * 1 );
             ratio->linsolve_buffer = ratio->coeff   + ((max_conn + 1) * 1 );
+
+            ratio->dense.lu   = ratio->lu;
+            ratio->dense.ipiv = ratio->ipiv;
+            cfs_tpfa_dense_select(np, &ratio->dense);
         }
     }
 
@@ -279,74 +287,6 @@ construct_matrix(struct UnstructuredGrid   *G    ,
 }
 
 
-static void
-factorise_fluid_matrix(int np, const double *A, struct densrat_util *ratio)
-{
-    int        np2;
-    MAT_SIZE_T m, n, ld, info;
-
-    m = n = ld = np;
-    np2 = np * np;
-
-    memcpy (ratio->lu, A, np2 * sizeof *ratio->lu);
-    dgetrf_(&m, &n, ratio->lu, &ld, ratio->ipiv, &info);
-
-    assert (info == 0);
-}
-
-
-static void
-solve_linear_systems(int                  np   ,
-                     MAT_SIZE_T           nrhs ,
-                     struct densrat_util *ratio,
-                     double              *b    )
-{
-    MAT_SIZE_T n, ldA, ldB, info;
-
-    n = ldA = ldB = np;
-
-    dgetrs_("No Transpose", &n,
-            &nrhs, ratio->lu, &ldA, ratio->ipiv,
-            b               , &ldB, &info);
-
-    assert (info == 0);
-}
-
-
-static void
-matvec(int nrow, int ncol, const double *A, const double *x, double *y)
-{
-    MAT_SIZE_T m, n, ld, incx, incy;
-    double     a1, a2;
-
-    m    = ld = nrow;
-    n    = ncol;
-    incx = incy = 1;
-    a1   = 1.0;
-    a2   = 0.0;
-
-    dgemv_("No Transpose", &m, &n,
-           &a1, A, &ld, x, &incx,
-           &a2,         y, &incy);
-}
-
-
-static void
-matmat(int np, int ncol, const double *A, const double *B, double *C)
-{
-    MAT_SIZE_T m, n, k, ldA, ldB, ldC;
-    double     a1, a2;
-
-    m  = k = ldA = ldB = ldC = np;
-    n  = ncol;
-    a1 = 1.0;
-    a2 = 0.0;
-
-    dgemm_("No Transpose", "No Transpose", &m, &n, &k,
-           &a1, A, &ldA, B, &ldB, &a2, C, &ldC);
-}
-
-
 static void
 compute_darcyflux_and_deriv(int           np,
                             double        trans,
@@ -403,10 +343,10 @@ compute_compflux_and_deriv(struct UnstructuredGrid  *G     ,
                                         pimpl->flux_work + np);
 
             /* Component flux = Af * v*/
-            matvec(np, np, Af, pimpl->flux_work     , cflux );
+            pimpl->ratio->dense.matvec(np, np, Af, pimpl->flux_work     , cflux );
 
             /* Derivative = Af * (dv/dp) */
-            matmat(np, 2 , Af, pimpl->flux_work + np, dcflux);
+            pimpl->ratio->dense.matmat(np, 2 , Af, pimpl->flux_work + np, dcflux);
         }
 
         /* Boundary connections excluded */
@@ -461,10 +401,10 @@ compute_well_compflux_and_deriv(struct cfs_tpfa_res_wells *wells ,
                                         pimpl->flux_work + np);
 
             /* Component flux = Ap * q*/
-            matvec(np, np, Ap, pimpl->flux_work     , pflux );
+            pimpl->ratio->dense.matvec(np, np, Ap, pimpl->flux_work     , pflux );
 
             /* Derivative = Ap * (dq/dp) */
-            matmat(np, 2 , Ap, pimpl->flux_work + np, dpflux);
+            pimpl->ratio->dense.matmat(np, 2 , Ap, pimpl->flux_work + np, dpflux);
         }
     }
 }
@@ -556,14 +496,14 @@ compute_cell_contrib(struct UnstructuredGrid  *G    ,
     nconn = init_cell_contrib(G, c, np, pvol, dt, z, pimpl);
     nrhs  = 1 + (1 + 2)*nconn;  /* [z, Af*v, Af*dv] */
 
-    factorise_fluid_matrix(np, Ac, pimpl->ratio);
-    solve_linear_systems  (np, nrhs, pimpl->ratio,
-                           pimpl->ratio->linsolve_buffer);
+    pimpl->ratio->dense.factorise(np, Ac, &pimpl->ratio->dense);
+    pimpl->ratio->dense.solve(np, nrhs, &pimpl->ratio->dense,
+                              pimpl->ratio->linsolve_buffer);
 
     /* Sum residual contributions over the connections (+ accumulation):
      *   t1 <- (Ac \ [z, Af*v]) * [-pvol; repmat(dt, [nconn, 1])] */
-    matvec(np, nconn + 1, pimpl->ratio->linsolve_buffer,
-           pimpl->ratio->coeff, pimpl->ratio->t1);
+    pimpl->ratio->dense.matvec(np, nconn + 1, pimpl->ratio->linsolve_buffer,
+                               pimpl->ratio->coeff, pimpl->ratio->t1);
 
     /* Compute residual in cell 'c' */
     pimpl->ratio->residual = pvol;
@@ -577,8 +517,8 @@ compute_cell_contrib(struct UnstructuredGrid  *G    ,
                 pimpl->ratio->mat_row);
 
     /* t2 <- A \ ((dA/dp) * t1) */
-    matvec(np, np, dAc, pimpl->ratio->t1, pimpl->ratio->t2);
-    solve_linear_systems(np, 1, pimpl->ratio, pimpl->ratio->t2);
+    pimpl->ratio->dense.matvec(np, np, dAc, pimpl->ratio->t1, pimpl->ratio->t2);
+    pimpl->ratio->dense.solve(np, 1, &pimpl->ratio->dense, pimpl->ratio->t2);
 
     dF2 = 0.0;
     for (p = 0; p < np; p++) {
@@ -683,9 +623,9 @@ init_completion_contrib(int                       i    ,
            2 * np * sizeof *pimpl->ratio->linsolve_buffer);
 
     /* buffer <- Ac \ [A_{wi}q_{wi}, A_{wi} dq_{wi}] */
-    factorise_fluid_matrix(np, Ac, pimpl->ratio);
-    solve_linear_systems  (np, 1 + 2, pimpl->ratio,
-                           pimpl->ratio->linsolve_buffer);
+    pimpl->ratio->dense.factorise(np, Ac, &pimpl->ratio->dense);
+    pimpl->ratio->dense.solve(np, 1 + 2, &pimpl->ratio->dense,
+                              pimpl->ratio->linsolve_buffer);
 
     /* t1 <- Ac \ (A_{wi} q_{wi}) */
     memcpy(pimpl->ratio->t1,
@@ -693,8 +633,8 @@ init_completion_contrib(int                       i    ,
            np * sizeof *pimpl->ratio->t1);
 
     /* t2 <- Ac \ ((dA/dp) * t1) (== -d(Ac^{-1})/dp (A_{wi} q_{wi})) */
-    matvec(np, np, dAc, pimpl->ratio->t1, pimpl->ratio->t2);
-    solve_linear_systems(np, 1, pimpl->ratio, pimpl->ratio->t2);
+    pimpl->ratio->dense.matvec(np, np, dAc, pimpl->ratio->t1, pimpl->ratio->t2);
+    pimpl->ratio->dense.solve(np, 1, &pimpl->ratio->dense, pimpl->ratio->t2);
 }
 
 
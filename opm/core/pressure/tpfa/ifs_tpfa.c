@@ -36,8 +36,15 @@ struct ifs_tpfa_impl {
     double *fgrav;              /* Accumulated grav contrib/face */
     double *work;
 
+    /* Well controls as last assembled, to support control switching */
+    int    *wtype;              /* Control type/well, -1 if shut */
+    double *wtarget;            /* Control target/well */
+    int     res_is_neumann;     /* No pressure BCs in assembled system */
+    int     switchable;         /* System admits well control updates */
+
     /* Linear storage */
     double *ddata;
+    int    *idata;
 };
 
 
@@ -47,6 +54,7 @@ impl_deallocate(struct ifs_tpfa_impl *pimpl)
 /* ---------------------------------------------------------------------- */
 {
     if (pimpl != NULL) {
+        free(pimpl->idata);
         free(pimpl->ddata);
     }
 
@@ -62,24 +70,31 @@ impl_allocate(struct UnstructuredGrid *G,
 {
     struct ifs_tpfa_impl *new;
 
-    size_t nnu;
+    size_t nnu, nw;
     size_t ddata_sz;
 
     nnu = G->number_of_cells;
+    nw  = 0;
     if (W != NULL) {
-        nnu += W->number_of_wells;
+        nw   = W->number_of_wells;
+        nnu += nw;
     }
 
     ddata_sz  = 2 * nnu;                 /* b, x */
     ddata_sz += 1 * G->number_of_faces;  /* fgrav */
     ddata_sz += 1 * nnu;                 /* work */
+    ddata_sz += 1 * nw;                  /* wtarget */
 
     new = malloc(1 * sizeof *new);
 
     if (new != NULL) {
         new->ddata = malloc(ddata_sz * sizeof *new->ddata);
+        new->idata = malloc((nw + 1) * sizeof *new->idata); /* wtype */
 
-        if (new->ddata == NULL) {
+        new->res_is_neumann = 1;
+        new->switchable     = 0;
+
+        if ((new->ddata == NULL) || (new->idata == NULL)) {
             impl_deallocate(new);
             new = NULL;
         }
@@ -339,6 +354,154 @@ assemble_shut_well(int nc, int w,
 }
 
 
+/* ---------------------------------------------------------------------- */
+static int
+well_control_supported(const struct Wells *W, int w)
+/* ---------------------------------------------------------------------- */
+{
+    int p, np, ok;
+
+    struct WellControls *ctrls;
+
+    ctrls = W->ctrls[ w ];
+    np    = W->number_of_phases;
+    ok    = 1;
+
+    if (ctrls->current >= 0) {
+
+        assert (ctrls->current <  ctrls->num);
+
+        switch (ctrls->type[ ctrls->current ]) {
+        case BHP:
+            break;
+
+        case RESERVOIR_RATE:
+            if (W->type[w] == PRODUCER) {
+                /* Ensure minimal consistency.  A PRODUCER should
+                 * specify a phase distribution of all ones in the
+                 * case of RESV controls. */
+                for (p = 0; p < np; p++) {
+                    if (ctrls->distr[np * ctrls->current + p] != 1.0) {
+                        ok = 0;
+                        break;
+                    }
+                }
+            }
+            /* Ignore phase distribution for non-PRODUCERs */
+            break;
+
+        case SURFACE_RATE:
+            /* We cannot handle this case, since we do
+             * not have access to formation volume factors,
+             * needed to convert between reservoir and
+             * surface rates
+             */
+            fprintf(stderr, "ifs_tpfa cannot handle SURFACE_RATE well controls.\n");
+            ok = 0;
+            break;
+        }
+    }
+
+    return ok;
+}
+
+
+/* ---------------------------------------------------------------------- */
+static void
+assemble_single_well(int                   nc ,
+                     int                   w  ,
+                     const struct Wells   *W  ,
+                     const double         *mt ,
+                     const double         *wdp,
+                     struct ifs_tpfa_data *h  )
+/* ---------------------------------------------------------------------- */
+{
+    struct WellControls *ctrls;
+
+    ctrls = W->ctrls[ w ];
+
+    if (ctrls->current < 0) {
+
+        /* Treat this well as a shut well, isolated from the domain. */
+
+        assemble_shut_well(nc, w, W, mt, h);
+
+        h->pimpl->wtype  [ w ] = -1;
+        h->pimpl->wtarget[ w ] = 0.0;
+
+    } else {
+
+        switch (ctrls->type[ ctrls->current ]) {
+        case BHP:
+            assemble_bhp_well (nc, w, W, mt, wdp, h);
+            break;
+
+        case RESERVOIR_RATE:
+            assemble_rate_well(nc, w, W, mt, wdp, h);
+            break;
+
+        case SURFACE_RATE:
+            assert (0);         /* Rejected by well_control_supported() */
+            break;
+        }
+
+        h->pimpl->wtype  [ w ] = ctrls->type  [ ctrls->current ];
+        h->pimpl->wtarget[ w ] = ctrls->target[ ctrls->current ];
+    }
+}
+
+
+/* ---------------------------------------------------------------------- */
+/* Undo the contributions of well w, as recorded in h->pimpl, from the
+ * assembled system.  The well equation and the cell<->well couplings
+ * belong to this well alone and are reset exactly, the contributions to
+ * the perforated cells' diagonal and right-hand side are subtracted.
+ * ---------------------------------------------------------------------- */
+static void
+remove_single_well(int                   nc ,
+                   int                   w  ,
+                   const struct Wells   *W  ,
+                   const double         *mt ,
+                   const double         *wdp,
+                   struct ifs_tpfa_data *h  )
+/* ---------------------------------------------------------------------- */
+{
+    int    c, i, wdof, type;
+    size_t j, jcc;
+    double trans, target;
+
+    wdof   = nc + w;
+    type   = h->pimpl->wtype  [ w ];
+    target = h->pimpl->wtarget[ w ];
+
+    for (i = W->well_connpos[w]; i < W->well_connpos[w + 1]; i++) {
+
+        c     = W->well_cells[ i ];
+        trans = mt[ c ] * W->WI[ i ];
+
+        if (type == BHP) {
+            jcc = csrmatrix_elm_index(c, c, h->A);
+
+            h->A->sa[ jcc ] -= trans;
+            h->b    [ c   ] -= trans * (target + wdp[ i ]);
+        }
+        else if (type == RESERVOIR_RATE) {
+            jcc = csrmatrix_elm_index(c, c   , h->A);
+            j   = csrmatrix_elm_index(c, wdof, h->A);
+
+            h->A->sa[ jcc ] -= trans;
+            h->A->sa[ j   ]  = 0.0;
+            h->b    [ c   ] -= trans * wdp[ i ];
+        }
+    }
+
+    for (j = h->A->ia[ wdof ]; j < (size_t) h->A->ia[ wdof + 1 ]; j++) {
+        h->A->sa[ j ] = 0.0;
+    }
+    h->b[ wdof ] = 0.0;
+}
+
+
 /* ---------------------------------------------------------------------- */
 static void
 assemble_well_contrib(int                   nc ,
@@ -350,66 +513,29 @@ assemble_well_contrib(int                   nc ,
                       int                  *ok)
 /* ---------------------------------------------------------------------- */
 {
-    int w, p, np;
+    int w;
 
     struct WellControls *ctrls;
 
-    np = W->number_of_phases;
-
     *all_rate = 1;
     *ok = 1;
 
     for (w = 0; w < W->number_of_wells; w++) {
         ctrls = W->ctrls[ w ];
 
-        if (ctrls->current < 0) {
-
-            /* Treat this well as a shut well, isolated from the domain. */
-
-            assemble_shut_well(nc, w, W, mt, h);
-
-        } else {
-
-            assert (ctrls->current <  ctrls->num);
-
-            switch (ctrls->type[ ctrls->current ]) {
-            case BHP:
-                *all_rate = 0;
-                assemble_bhp_well (nc, w, W, mt, wdp, h);
-                break;
-
-            case RESERVOIR_RATE:
-                if (W->type[w] == PRODUCER) {
-                    /* Ensure minimal consistency.  A PRODUCER should
-                     * specify a phase distribution of all ones in the
-                     * case of RESV controls. */
-                    for (p = 0; p < np; p++) {
-                        if (ctrls->distr[np * ctrls->current + p] != 1.0) {
-                            *ok = 0;
-                            break;
-                        }
-                    }
-                } else {
-                    /* Ignore phase distribution for non-PRODUCERs */
-                    *ok = 1;
-                }
+        if (! well_control_supported(W, w)) {
+            h->pimpl->wtype  [ w ] = -1;
+            h->pimpl->wtarget[ w ] = 0.0;
+            *ok = 0;
+            continue;
+        }
 
-                if (*ok) {
-                    assemble_rate_well(nc, w, W, mt, wdp, h);
-                }
-                break;
-
-            case SURFACE_RATE:
-                /* We cannot handle this case, since we do
-                 * not have access to formation volume factors,
-                 * needed to convert between reservoir and
-                 * surface rates
-                 */
-                fprintf(stderr, "ifs_tpfa cannot handle SURFACE_RATE well controls.\n");
-                *ok = 0;
-                break;
-            }
+        if ((ctrls->current >= 0) &&
+            (ctrls->type[ ctrls->current ] == BHP)) {
+            *all_rate = 0;
         }
+
+        assemble_single_well(nc, w, W, mt, wdp, h);
     }
 }
 
@@ -656,6 +782,9 @@ assemble_incompressible(struct UnstructuredGrid      *G     ,
         }
     }
 
+    h->pimpl->res_is_neumann = res_is_neumann;
+    h->pimpl->switchable     = *ok;
+
     *singular = res_is_neumann && wells_are_rate;
 }
 
@@ -687,8 +816,10 @@ ifs_tpfa_construct(struct UnstructuredGrid *G,
         new->b = new->pimpl->ddata;
         new->x = new->b                       + new->A->m;
 
-        new->pimpl->fgrav = new->x            + new->A->m;
-        new->pimpl->work  = new->pimpl->fgrav + G->number_of_faces;
+        new->pimpl->fgrav   = new->x            + new->A->m;
+        new->pimpl->work    = new->pimpl->fgrav + G->number_of_faces;
+        new->pimpl->wtarget = new->pimpl->work  + new->A->m;
+        new->pimpl->wtype   = new->pimpl->idata;
     }
 
     return new;
@@ -716,6 +847,73 @@ ifs_tpfa_assemble(struct UnstructuredGrid      *G     ,
 }
 
 
+/* ---------------------------------------------------------------------- */
+int
+ifs_tpfa_update_well_controls(struct UnstructuredGrid      *G ,
+                              const struct ifs_tpfa_forces *F ,
+                              struct ifs_tpfa_data         *h ,
+                              int                          *nupdated)
+/* ---------------------------------------------------------------------- */
+{
+    int w, nc, changed, is_bhp, was_bhp;
+
+    const struct Wells  *W;
+    struct WellControls *ctrls;
+
+    *nupdated = 0;
+
+    if ((F == NULL) || (F->W == NULL) ||
+        (F->totmob == NULL) || (F->wdp == NULL) ||
+        (! h->pimpl->switchable)) {
+        return 0;
+    }
+
+    W  = F->W;
+    nc = G->number_of_cells;
+
+    /* Check that all new controls can be assembled, and that the system
+     * is not singular before or after the update.  The singular
+     * (all rate, no pressure BC) case has a modified first diagonal
+     * element, and requires full reassembly. */
+    was_bhp = is_bhp = 0;
+    for (w = 0; w < W->number_of_wells; w++) {
+        ctrls = W->ctrls[ w ];
+
+        if (! well_control_supported(W, w)) {
+            return 0;
+        }
+
+        was_bhp = was_bhp || (h->pimpl->wtype[ w ] == BHP);
+        is_bhp  = is_bhp  || ((ctrls->current >= 0) &&
+                              (ctrls->type[ ctrls->current ] == BHP));
+    }
+
+    if (h->pimpl->res_is_neumann && !(was_bhp && is_bhp)) {
+        return 0;
+    }
+
+    for (w = 0; w < W->number_of_wells; w++) {
+        ctrls = W->ctrls[ w ];
+
+        if (ctrls->current < 0) {
+            changed = h->pimpl->wtype[ w ] != -1;
+        } else {
+            changed = (h->pimpl->wtype  [ w ] != (int) ctrls->type  [ ctrls->current ]) ||
+                      (h->pimpl->wtarget[ w ] !=       ctrls->target[ ctrls->current ]);
+        }
+
+        if (changed) {
+            remove_single_well  (nc, w, W, F->totmob, F->wdp, h);
+            assemble_single_well(nc, w, W, F->totmob, F->wdp, h);
+
+            *nupdated += 1;
+        }
+    }
+
+    return 1;
+}
+
+
 /* ---------------------------------------------------------------------- */
 int
 ifs_tpfa_assemble_comprock(struct UnstructuredGrid      *G        ,
@@ -780,6 +978,9 @@ ifs_tpfa_assemble_comprock_increment(struct UnstructuredGrid      *G        ,
     ok = 1;
     assemble_incompressible(G, F, trans, gpress, h, &system_singular, &ok);
 
+    /* The residual form depends on the well equations through A*p. */
+    h->pimpl->switchable = 0;
+
     /* We want to solve a Newton step for the residual
      * (porevol(pressure)-porevol(initial_pressure))/dt + residual_for_incompressible
      *
@@ -108,6 +108,29 @@ ifs_tpfa_assemble(struct UnstructuredGrid      *G     ,
                   const double                 *gpress,
                   struct ifs_tpfa_data         *h     );
 
+/**
+ * Update an assembled system after the active control, or its target, has
+ * changed for one or more wells.  Only the equations of the affected wells
+ * and the perforated cells are modified, the cell-cell connections are
+ * retained.  Requires that the system was last assembled by
+ * ifs_tpfa_assemble() or ifs_tpfa_assemble_comprock() with the same
+ * forces, and that the system is not singular (all wells rate controlled
+ * and no pressure boundary conditions) before or after the update.
+ *
+ * @param[in]     G        Grid.
+ * @param[in]     F        Driving forces, including the wells with their
+ *                         updated controls.
+ * @param[in,out] h        TPFA management structure.
+ * @param[out]    nupdated Number of wells whose equations were updated.
+ * @return Non-zero if the system was updated, zero if it must instead be
+ * reassembled in full.  The system is unchanged in the latter case.
+ */
+int
+ifs_tpfa_update_well_controls(struct UnstructuredGrid      *G ,
+                              const struct ifs_tpfa_forces *F ,
+                              struct ifs_tpfa_data         *h ,
+                              int                          *nupdated);
+
 int
 ifs_tpfa_assemble_comprock(struct UnstructuredGrid      *G        ,
                            const struct ifs_tpfa_forces *F        ,
@@ -150,5 +150,17 @@ namespace Opm
         satprops_.satRange(n, cells, smin, smax);
     }
 
+
+    /// Obtain the saturation function region (SATNUM - 1) of each cell.
+    /// \param[in]  n       Number of data points.
+    /// \param[in]  cells   Array of n cell indices.
+    /// \param[out] regions Array of n region indices, array must be valid before calling.
+    void IncompPropertiesFromDeck::satRegion(const int n,
+                                             const int* cells,
+                                             int* regions) const
+    {
+        satprops_.satRegion(n, cells, regions);
+    }
+
 } // namespace Opm
 
@@ -132,6 +132,14 @@ namespace Opm
                               const int* cells,
                               double* smin,
                               double* smax) const;
+
+        /// Obtain the saturation function region (SATNUM - 1) of each cell.
+        /// \param[in]  n       Number of data points.
+        /// \param[in]  cells   Array of n cell indices.
+        /// \param[out] regions Array of n region indices, array must be valid before calling.
+        virtual void satRegion(const int n,
+                               const int* cells,
+                               int* regions) const;
     private:
         RockFromDeck rock_;
         PvtPropertiesIncompFromDeck pvt_;
@@ -20,6 +20,8 @@
 #ifndef OPM_INCOMPPROPERTIESINTERFACE_HEADER_INCLUDED
 #define OPM_INCOMPPROPERTIESINTERFACE_HEADER_INCLUDED
 
+#include <algorithm>
+
 namespace Opm
 {
 
@@ -120,6 +122,23 @@ namespace Opm
                               const int* cells,
                               double* smin,
                               double* smax) const = 0;
+
+        /// Obtain the saturation function region of each cell.
+        /// Cells in the same region use the same saturation functions
+        /// of the saturation normalised by the range from satRange().
+        /// The default implementation puts all cells in region 0,
+        /// which is correct for properties with a single set of
+        /// saturation functions.
+        /// \param[in]  n       Number of data points.
+        /// \param[in]  cells   Array of n cell indices.
+        /// \param[out] regions Array of n region indices, array must be valid before calling.
+        virtual void satRegion(const int n,
+                               const int* cells,
+                               int* regions) const
+        {
+            static_cast<void>(cells);
+            std::fill(regions, regions + n, 0);
+        }
     };
 
 
@@ -63,6 +63,9 @@ namespace Opm
                                const int* cells,
                                double* smin,
                                double* smax) const;
+        virtual void satRegion (const int n,
+                                const int* cells,
+                                int* regions) const;
 
         /**
          * Use a different set of porosities.
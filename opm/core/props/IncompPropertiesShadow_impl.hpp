@@ -72,6 +72,13 @@ namespace Opm
         prototype_.satRange (n, cells, smin, smax);
     }
 
+    inline void IncompPropertiesShadow::satRegion (const int n,
+                                                   const int* cells,
+                                                   int* regions) const
+    {
+        prototype_.satRegion (n, cells, regions);
+    }
+
     /**
      * Return the new value if indicated in the bitfield, otherwise
      * use the original value from the other object.
@@ -102,6 +102,14 @@ namespace Opm
                       double* smin,
                       double* smax) const;
 
+        /// Obtain the saturation function region (SATNUM - 1) of each cell.
+        /// \param[in]  n       Number of data points.
+        /// \param[in]  cells   Array of n cell indices.
+        /// \param[out] regions Array of n region indices, array must be valid before calling.
+        void satRegion(const int n,
+                       const int* cells,
+                       int* regions) const;
+
     private:
         PhaseUsage phase_usage_;
         std::vector<SatFuncSet> satfuncset_;
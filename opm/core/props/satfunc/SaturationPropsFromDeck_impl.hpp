@@ -245,6 +245,23 @@ namespace Opm
     }
 
 
+    /// Obtain the saturation function region (SATNUM - 1) of each cell.
+    /// \param[in]  n       Number of data points.
+    /// \param[in]  cells   Array of n cell indices.
+    /// \param[out] regions Array of n region indices, array must be valid before calling.
+    template <class SatFuncSet>
+    void SaturationPropsFromDeck<SatFuncSet>::satRegion(const int n,
+                                            const int* cells,
+                                            int* regions) const
+    {
+        assert(cells != 0);
+
+        for (int i = 0; i < n; ++i) {
+            regions[i] = cell_to_func_.empty() ? 0 : cell_to_func_[cells[i]];
+        }
+    }
+
+
     // Map the cell number to the correct function set.
     template <class SatFuncSet>
     const typename SaturationPropsFromDeck<SatFuncSet>::Funcs&
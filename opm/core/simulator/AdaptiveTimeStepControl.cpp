@@ -0,0 +1,155 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+#include <opm/core/simulator/AdaptiveTimeStepControl.hpp>
+#include <opm/core/utility/parameters/ParameterGroup.hpp>
+#include <opm/core/utility/ErrorMacros.hpp>
+#include <opm/core/utility/Units.hpp>
+#include <algorithm>
+#include <limits>
+
+namespace Opm
+{
+
+    AdaptiveTimeStepControl::AdaptiveTimeStepControl(const parameter::ParameterGroup& param)
+        : num_cuts_(0)
+    {
+        using namespace Opm::unit;
+        const double initial_step = param.getDefault("adaptive_initial_step_days", 0.0);
+        const double max_step = param.getDefault("adaptive_max_step_days", 0.0);
+        min_step_ = convert::from(param.getDefault("adaptive_min_step_days", 1e-6), day);
+        max_step_ = max_step > 0.0 ? convert::from(max_step, day)
+                                   : std::numeric_limits<double>::max();
+        max_growth_ = param.getDefault("adaptive_max_growth", 2.0);
+        cut_factor_ = param.getDefault("adaptive_cut_factor", 0.5);
+        max_cuts_ = param.getDefault("adaptive_max_cuts", 10);
+        target_pressure_iterations_ = param.getDefault("adaptive_pressure_iterations", 4);
+        target_transport_iterations_ = param.getDefault("adaptive_transport_iterations", 0);
+        max_cfl_ = param.getDefault("adaptive_max_cfl", 0.0);
+        if (max_growth_ < 1.0) {
+            OPM_THROW(std::runtime_error, "adaptive_max_growth must be at least 1, got " << max_growth_);
+        }
+        if (cut_factor_ <= 0.0 || cut_factor_ >= 1.0) {
+            OPM_THROW(std::runtime_error, "adaptive_cut_factor must be in (0, 1), got " << cut_factor_);
+        }
+        // Without an initial step, the first step is as long as
+        // allowed, and the prediction starts from the step taken.
+        has_prediction_ = initial_step > 0.0;
+        suggested_step_ = has_prediction_ ? std::min(convert::from(initial_step, day), max_step_)
+                                          : max_step_;
+    }
+
+
+
+
+    double AdaptiveTimeStepControl::nextStep(const double remaining) const
+    {
+        const double dt = std::max(suggested_step_, min_step_);
+        if (dt >= remaining) {
+            return remaining;
+        }
+        // Split what remains in two equal steps, rather than leave a
+        // step much shorter than the previous one.
+        if (remaining < 1.5*dt) {
+            return remaining/2.0;
+        }
+        return dt;
+    }
+
+
+
+
+    void AdaptiveTimeStepControl::stepAccepted(const double dt,
+                                               const int pressure_iterations,
+                                               const int transport_iterations,
+                                               const double cfl_step)
+    {
+        num_cuts_ = 0;
+        double factor = max_growth_;
+        if (target_pressure_iterations_ > 0 && pressure_iterations >= 0) {
+            factor = std::min(factor, double(target_pressure_iterations_)
+                              / std::max(pressure_iterations, 1));
+        }
+        if (target_transport_iterations_ > 0 && transport_iterations >= 0) {
+            factor = std::min(factor, double(target_transport_iterations_)
+                              / std::max(transport_iterations, 1));
+        }
+        factor = std::max(factor, 1.0/max_growth_);
+
+        // A step shortened to hit a report time does not reduce the
+        // prediction, unless the iterations ask for it.
+        double step = dt*factor;
+        if (has_prediction_ && dt < suggested_step_) {
+            step = std::max(step, suggested_step_*std::min(factor, 1.0));
+        }
+        if (max_cfl_ > 0.0 && cfl_step > 0.0) {
+            step = std::min(step, max_cfl_*cfl_step);
+        }
+        suggested_step_ = std::min(step, max_step_);
+        has_prediction_ = true;
+    }
+
+
+
+
+    bool AdaptiveTimeStepControl::exceedsCfl(const double dt, const double cfl_step) const
+    {
+        return max_cfl_ > 0.0 && cfl_step > 0.0 && dt > max_cfl_*cfl_step;
+    }
+
+
+
+
+    void AdaptiveTimeStepControl::limitByCfl(const double cfl_step)
+    {
+        if (max_cfl_ > 0.0 && cfl_step > 0.0) {
+            suggested_step_ = std::min(suggested_step_, max_cfl_*cfl_step);
+        }
+    }
+
+
+
+
+    void AdaptiveTimeStepControl::stepFailed(const double dt)
+    {
+        ++num_cuts_;
+        const double step = dt*cut_factor_;
+        if (num_cuts_ > max_cuts_) {
+            OPM_THROW(std::runtime_error, "Time step cut " << max_cuts_
+                      << " times in a row, giving up.");
+        }
+        if (step < min_step_) {
+            OPM_THROW(std::runtime_error, "Time step of " << step
+                      << " seconds is below the minimum of " << min_step_ << " seconds.");
+        }
+        suggested_step_ = step;
+        has_prediction_ = true;
+    }
+
+
+
+
+    double AdaptiveTimeStepControl::suggestedStep() const
+    {
+        return suggested_step_;
+    }
+
+
+} // namespace Opm
@@ -0,0 +1,130 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_ADAPTIVETIMESTEPCONTROL_HEADER_INCLUDED
+#define OPM_ADAPTIVETIMESTEPCONTROL_HEADER_INCLUDED
+
+namespace Opm
+{
+
+    namespace parameter { class ParameterGroup; }
+
+
+    /// Chooses the lengths of the steps taken within the report steps
+    /// of a SimulatorTimer.
+    ///
+    /// After each accepted step the next step length is predicted
+    /// from the nonlinear iteration counts of the pressure and
+    /// transport solvers, growing the step when they converge faster
+    /// than targeted and shrinking it when they are slower, and is
+    /// limited by a maximum CFL number. After a failed step the step
+    /// length is cut, and the step should be repeated. Steps never
+    /// cross a report time, and the last step before a report time
+    /// is balanced with the one before it rather than being left
+    /// arbitrarily short.
+    class AdaptiveTimeStepControl
+    {
+    public:
+        /// Initialise from parameters. Accepts the following:
+        ///    adaptive_initial_step_days (0)   length of first step, 0 means
+        ///                                     a full report step
+        ///    adaptive_min_step_days (1e-6)    give up if a step must be cut
+        ///                                     below this length
+        ///    adaptive_max_step_days (0)       max step length, 0 means unlimited
+        ///    adaptive_max_growth (2.0)        max factor of increase between
+        ///                                     consecutive steps
+        ///    adaptive_cut_factor (0.5)        factor to cut a failed step by
+        ///    adaptive_max_cuts (10)           max consecutive cuts of a step
+        ///    adaptive_pressure_iterations (4) targeted number of pressure solver
+        ///                                     iterations, 0 to ignore them
+        ///    adaptive_transport_iterations (0) targeted max number of transport
+        ///                                     solver iterations in any cell,
+        ///                                     0 to ignore them
+        ///    adaptive_max_cfl (0)             max CFL number of a step, 0 means
+        ///                                     unlimited
+        explicit AdaptiveTimeStepControl(const parameter::ParameterGroup& param);
+
+        /// Length of the next step.
+        /// \param[in] remaining   Time left until the next report time.
+        /// \return                A step length no larger than remaining,
+        ///                        and equal to it if the report time is to
+        ///                        be reached by this step.
+        double nextStep(const double remaining) const;
+
+        /// Update the predicted step length after a successful step.
+        /// \param[in] dt                    Length of the step taken.
+        /// \param[in] pressure_iterations   Iterations used by the pressure
+        ///                                  solver, negative if unknown.
+        /// \param[in] transport_iterations  Max iterations used by the
+        ///                                  transport solver in any cell,
+        ///                                  negative if unknown.
+        /// \param[in] cfl_step              Step length of unit CFL number,
+        ///                                  see computeCflTimeStep(), or
+        ///                                  non-positive if unknown.
+        void stepAccepted(const double dt,
+                          const int pressure_iterations,
+                          const int transport_iterations,
+                          const double cfl_step);
+
+        /// Check a step against the max CFL number. Intended for the
+        /// first step, for which no accepted step has supplied a CFL
+        /// step length: if it is too long, it should be repeated after
+        /// calling limitByCfl().
+        /// \param[in] dt          Length of the step taken.
+        /// \param[in] cfl_step    Step length of unit CFL number, see
+        ///                        computeCflTimeStep(), or non-positive
+        ///                        if unknown.
+        /// \return                True if the step had a CFL number
+        ///                        above the maximum.
+        bool exceedsCfl(const double dt, const double cfl_step) const;
+
+        /// Limit the predicted step length by the max CFL number.
+        /// \param[in] cfl_step    Step length of unit CFL number, see
+        ///                        computeCflTimeStep(), or non-positive
+        ///                        if unknown.
+        void limitByCfl(const double cfl_step);
+
+        /// Cut the predicted step length after a failed step.
+        /// Throws if the step would be cut below the minimum length,
+        /// or has been cut too many times.
+        /// \param[in] dt          Length of the step that failed.
+        void stepFailed(const double dt);
+
+        /// Predicted length of the next step, not taking report
+        /// times into account.
+        double suggestedStep() const;
+
+    private:
+        double min_step_;
+        double max_step_;
+        double max_growth_;
+        double cut_factor_;
+        int max_cuts_;
+        int target_pressure_iterations_;
+        int target_transport_iterations_;
+        double max_cfl_;
+        double suggested_step_;
+        bool has_prediction_;
+        int num_cuts_;
+    };
+
+
+} // namespace Opm
+
+#endif // OPM_ADAPTIVETIMESTEPCONTROL_HEADER_INCLUDED
@@ -31,11 +31,14 @@
 #include <opm/core/wells.h>
 #include <opm/core/pressure/flow_bc.h>
 
+#include <opm/core/simulator/AdaptiveTimeStepControl.hpp>
 #include <opm/core/simulator/SimulatorReport.hpp>
 #include <opm/core/simulator/SimulatorTimer.hpp>
 #include <opm/core/utility/StopWatch.hpp>
-#include <opm/core/io/vtk/writeVtkData.hpp>
+#include <opm/core/utility/Units.hpp>
+#include <opm/core/io/AsyncOutputWriter.hpp>
 #include <opm/core/utility/miscUtilities.hpp>
+#include <opm/core/utility/Profiler.hpp>
 #include <opm/core/utility/miscUtilitiesBlackoil.hpp>
 
 #include <opm/core/wells/WellsManager.hpp>
@@ -52,6 +55,7 @@
 #include <memory>
 #include <boost/lexical_cast.hpp>
 
+#include <algorithm>
 #include <numeric>
 #include <fstream>
 #include <iostream>
@@ -78,6 +82,23 @@ namespace Opm
                             WellState& well_state);
 
     private:
+        // Solve pressure and transport for one step of length dt,
+        // adding the injected and produced surface volumes to the
+        // given arrays and the solver times to sreport. Sets
+        // transport_iterations to the max number of iterations of a
+        // single-cell transport solve. Returns false if a single-cell
+        // transport solve did not converge.
+        bool solveStep(const double dt,
+                       BlackoilState& state,
+                       WellState& well_state,
+                       std::vector<double>& porevol,
+                       std::vector<double>& initial_porevol,
+                       std::vector<double>& transport_src,
+                       double* injected,
+                       double* produced,
+                       SimulatorReport& sreport,
+                       int& transport_iterations);
+
         // Data.
 
         // Parameters for output.
@@ -85,12 +106,18 @@ namespace Opm
         bool output_vtk_;
         std::string output_dir_;
         int output_interval_;
+        std::unique_ptr<AsyncOutputWriter> output_writer_;
+        std::string profile_output_;
         // Parameters for well control
         bool check_well_controls_;
         int max_well_control_iterations_;
         // Parameters for transport solver.
         int num_transport_substeps_;
+        double transport_substep_cfl_;
+        int max_transport_substeps_;
         bool use_segregation_split_;
+        // Adaptive time stepping, null if off.
+        std::unique_ptr<AdaptiveTimeStepControl> timestep_control_;
         // Observed objects.
         const UnstructuredGrid& grid_;
         const BlackoilPropertiesInterface& props_;
@@ -107,6 +134,8 @@ namespace Opm
         std::vector< std::vector<int> > columns_;
         // Misc. data
         std::vector<int> allcells_;
+        std::vector<double> fractional_flows_;
+        std::vector<double> well_resflows_phase_;
     };
 
 
@@ -138,72 +167,6 @@ namespace Opm
 
 
 
-    static void outputStateVtk(const UnstructuredGrid& grid,
-                               const Opm::BlackoilState& state,
-                               const int step,
-                               const std::string& output_dir)
-    {
-        // Write data in VTK format.
-        std::ostringstream vtkfilename;
-        vtkfilename << output_dir << "/vtk_files";
-        boost::filesystem::path fpath(vtkfilename.str());
-        try {
-          create_directories(fpath);
-        }
-        catch (...) {
-          OPM_THROW(std::runtime_error, "Creating directories failed: " << fpath);
-        }
-        vtkfilename << "/output-" << std::setw(3) << std::setfill('0') << step << ".vtu";
-        std::ofstream vtkfile(vtkfilename.str().c_str());
-        if (!vtkfile) {
-            OPM_THROW(std::runtime_error, "Failed to open " << vtkfilename.str());
-        }
-        Opm::DataMap dm;
-        dm["saturation"] = &state.saturation();
-        dm["pressure"] = &state.pressure();
-        std::vector<double> cell_velocity;
-        Opm::estimateCellVelocity(grid, state.faceflux(), cell_velocity);
-        dm["velocity"] = &cell_velocity;
-        Opm::writeVtkData(grid, dm, vtkfile);
-    }
-
-
-    static void outputStateMatlab(const UnstructuredGrid& grid,
-                                  const Opm::BlackoilState& state,
-                                  const int step,
-                                  const std::string& output_dir)
-    {
-        Opm::DataMap dm;
-        dm["saturation"] = &state.saturation();
-        dm["pressure"] = &state.pressure();
-        dm["surfvolume"] = &state.surfacevol();
-        std::vector<double> cell_velocity;
-        Opm::estimateCellVelocity(grid, state.faceflux(), cell_velocity);
-        dm["velocity"] = &cell_velocity;
-
-        // Write data (not grid) in Matlab format
-        for (Opm::DataMap::const_iterator it = dm.begin(); it != dm.end(); ++it) {
-            std::ostringstream fname;
-            fname << output_dir << "/" << it->first;
-            boost::filesystem::path fpath = fname.str();
-            try {
-              create_directories(fpath);
-            }
-            catch (...) {
-              OPM_THROW(std::runtime_error, "Creating directories failed: " << fpath);
-            }
-            fname << "/" << std::setw(3) << std::setfill('0') << step << ".txt";
-            std::ofstream file(fname.str().c_str());
-            if (!file) {
-                OPM_THROW(std::runtime_error, "Failed to open " << fname.str());
-            }
-            file.precision(15);
-            const std::vector<double>& d = *(it->second);
-            std::copy(d.begin(), d.end(), std::ostream_iterator<double>(file, "\n"));
-        }
-    }
-
-
     static void outputWaterCut(const Opm::Watercut& watercut,
                                const std::string& output_dir)
     {
@@ -272,7 +235,20 @@ namespace Opm
                 OPM_THROW(std::runtime_error, "Creating directories failed: " << fpath);
             }
             output_interval_ = param.getDefault("output_interval", 1);
+            const bool output_async = param.getDefault("output_async", true);
+            const int queue_depth = output_async ? param.getDefault("output_queue_depth", 2) : 0;
+            const std::string format = param.getDefault("output_format", std::string("matlab"));
+            if (format != "matlab" && format != "binary") {
+                OPM_THROW(std::runtime_error, "Unknown output_format: " << format);
+            }
+            output_writer_.reset(new AsyncOutputWriter(grid, output_dir_, output_vtk_, queue_depth,
+                                                       format == "binary" ? AsyncOutputWriter::Binary
+                                                                          : AsyncOutputWriter::Matlab,
+                                                       param.getDefault("output_compress", false)));
         }
+        profile_output_ = param.getDefault("profile_output",
+                                           profiling::enabled() && output_ ? output_dir_ + "/profile.json"
+                                                                           : std::string());
 
         // Well control related init.
         check_well_controls_ = param.getDefault("check_well_controls", false);
@@ -280,12 +256,23 @@ namespace Opm
 
         // Transport related init.
         num_transport_substeps_ = param.getDefault("num_transport_substeps", 1);
+        transport_substep_cfl_ = param.getDefault("transport_substep_cfl", 0.0);
+        max_transport_substeps_ = param.getDefault("max_transport_substeps", 100);
+        tsolver_.setIncrementalReordering(param.getDefault("use_incremental_reorder", false),
+                                          param.getDefault("reorder_rebuild_fraction", 0.1),
+                                          param.getDefault("reorder_verbose", false));
+        tsolver_.setUseNewton(param.getDefault("nl_use_newton", false));
         use_segregation_split_ = param.getDefault("use_segregation_split", false);
         if (gravity != 0 && use_segregation_split_){
             tsolver_.initGravity(gravity);
             extractColumn(grid_, columns_);
         }
 
+        // Time stepping related init.
+        if (param.getDefault("adaptive_timestepping", false)) {
+            timestep_control_.reset(new AdaptiveTimeStepControl(param));
+        }
+
         // Misc init.
         const int num_cells = grid.number_of_cells;
         allcells_.resize(num_cells);
@@ -314,9 +301,7 @@ namespace Opm
         std::vector<double> initial_porevol = porevol;
 
         // Main simulation loop.
-        Opm::time::StopWatch pressure_timer;
         double ptime = 0.0;
-        Opm::time::StopWatch transport_timer;
         double ttime = 0.0;
         Opm::time::StopWatch step_timer;
         Opm::time::StopWatch total_timer;
@@ -329,10 +314,9 @@ namespace Opm
         Opm::Watercut watercut;
         watercut.push(0.0, 0.0, 0.0);
         Opm::WellReport wellreport;
-        std::vector<double> fractional_flows;
-        std::vector<double> well_resflows_phase;
         if (wells_) {
-            well_resflows_phase.resize((wells_->number_of_phases)*(wells_->number_of_wells), 0.0);
+            well_resflows_phase_.clear();
+            well_resflows_phase_.resize((wells_->number_of_phases)*(wells_->number_of_wells), 0.0);
             wellreport.push(props_, *wells_,
                             state.pressure(), state.surfacevol(), state.saturation(),
                             0.0, well_state.bhp(), well_state.perfRates());
@@ -342,129 +326,97 @@ namespace Opm
             std::string filename = output_dir_ + "/step_timing.param";
             tstep_os.open(filename.c_str(), std::fstream::out | std::fstream::app);
         }
+        bool first_step = true;
         for (; !timer.done(); ++timer) {
             // Report timestep and (optionally) write state to disk.
             step_timer.start();
             timer.report(std::cout);
             if (output_ && (timer.currentStepNum() % output_interval_ == 0)) {
-                if (output_vtk_) {
-                    outputStateVtk(grid_, state, timer.currentStepNum(), output_dir_);
-                }
-                outputStateMatlab(grid_, state, timer.currentStepNum(), output_dir_);
+                output_writer_->write(timer.currentStepNum(), state);
             }
 
             SimulatorReport sreport;
-
-            // Solve pressure equation.
-            if (check_well_controls_) {
-                computeFractionalFlow(props_, allcells_,
-                                      state.pressure(), state.surfacevol(), state.saturation(),
-                                      fractional_flows);
-                wells_manager_.applyExplicitReinjectionControls(well_resflows_phase, well_resflows_phase);
-            }
-            bool well_control_passed = !check_well_controls_;
-            int well_control_iteration = 0;
-            do {
-                // Run solver.
-                pressure_timer.start();
-                std::vector<double> initial_pressure = state.pressure();
-                psolver_.solve(timer.currentStepLength(), state, well_state);
-
-                // Renormalize pressure if both fluids and rock are
-                // incompressible, and there are no pressure
-                // conditions (bcs or wells).  It is deemed sufficient
-                // for now to renormalize using geometric volume
-                // instead of pore volume.
-                if (psolver_.singularPressure()) {
-                    // Compute average pressures of previous and last
-                    // step, and total volume.
-                    double av_prev_press = 0.0;
-                    double av_press = 0.0;
-                    double tot_vol = 0.0;
-                    const int num_cells = grid_.number_of_cells;
-                    for (int cell = 0; cell < num_cells; ++cell) {
-                        av_prev_press += initial_pressure[cell]*grid_.cell_volumes[cell];
-                        av_press      += state.pressure()[cell]*grid_.cell_volumes[cell];
-                        tot_vol       += grid_.cell_volumes[cell];
+            double injected[2] = { 0.0 };
+            double produced[2] = { 0.0 };
+            if (!timestep_control_) {
+                int transport_iterations = 0;
+                solveStep(timer.currentStepLength(), state, well_state,
+                          porevol, initial_porevol, transport_src,
+                          injected, produced, sreport, transport_iterations);
+            } else {
+                // Take as many steps as needed to reach the end of the
+                // report step, repeating failed steps with shorter ones.
+                double remaining = timer.currentStepLength();
+                int num_steps = 0;
+                int num_cuts = 0;
+                while (remaining > 0.0) {
+                    const double dt = timestep_control_->nextStep(remaining);
+                    std::cout << "Taking step of " << unit::convert::to(dt, unit::day)
+                              << " days." << std::endl;
+                    const BlackoilState state_before = state;
+                    const WellState well_state_before = well_state;
+                    const std::vector<double> porevol_before = porevol;
+                    const std::vector<double> initial_porevol_before = initial_porevol;
+                    const std::vector<double> well_resflows_phase_before = well_resflows_phase_;
+                    wells_manager_.saveControls();
+                    double step_injected[2] = { 0.0 };
+                    double step_produced[2] = { 0.0 };
+                    bool converged = true;
+                    int transport_iterations = 0;
+                    try {
+                        converged = solveStep(dt, state, well_state,
+                                              porevol, initial_porevol, transport_src,
+                                              step_injected, step_produced, sreport,
+                                              transport_iterations);
+                        if (!converged) {
+                            std::cout << "Transport solver did not converge." << std::endl;
+                        }
                     }
-                    // Renormalization constant
-                    const double ren_const = (av_prev_press - av_press)/tot_vol;
-                    for (int cell = 0; cell < num_cells; ++cell) {
-                        state.pressure()[cell] += ren_const;
+                    catch (const std::runtime_error& e) {
+                        std::cout << "Step failed: " << e.what() << std::endl;
+                        converged = false;
                     }
-                    const int num_wells = (wells_ == NULL) ? 0 : wells_->number_of_wells;
-                    for (int well = 0; well < num_wells; ++well) {
-                        well_state.bhp()[well] += ren_const;
+                    // No step has given a CFL step length for the first
+                    // step, so it is checked after it has been taken.
+                    const double cfl_step = computeCflTimeStep(grid_, porevol, state.faceflux(),
+                                                               transport_src);
+                    bool too_long = false;
+                    if (converged && first_step && timestep_control_->exceedsCfl(dt, cfl_step)) {
+                        std::cout << "First step exceeds the max CFL number, repeating it." << std::endl;
+                        too_long = true;
                     }
-                }
-
-                // Stop timer and report.
-                pressure_timer.stop();
-                double pt = pressure_timer.secsSinceStart();
-                std::cout << "Pressure solver took:  " << pt << " seconds." << std::endl;
-                ptime += pt;
-                sreport.pressure_time = pt;
-
-                // Optionally, check if well controls are satisfied.
-                if (check_well_controls_) {
-                    Opm::computePhaseFlowRatesPerWell(*wells_,
-                                                      well_state.perfRates(),
-                                                      fractional_flows,
-                                                      well_resflows_phase);
-                    std::cout << "Checking well conditions." << std::endl;
-                    // For testing we set surface := reservoir
-                    well_control_passed = wells_manager_.conditionsMet(well_state.bhp(), well_resflows_phase, well_resflows_phase);
-                    ++well_control_iteration;
-                    if (!well_control_passed && well_control_iteration > max_well_control_iterations_) {
-                        OPM_THROW(std::runtime_error, "Could not satisfy well conditions in " << max_well_control_iterations_ << " tries.");
-                    }
-                    if (!well_control_passed) {
-                        std::cout << "Well controls not passed, solving again." << std::endl;
-                    } else {
-                        std::cout << "Well conditions met." << std::endl;
+                    if (!converged || too_long) {
+                        state = state_before;
+                        well_state = well_state_before;
+                        porevol = porevol_before;
+                        initial_porevol = initial_porevol_before;
+                        well_resflows_phase_ = well_resflows_phase_before;
+                        wells_manager_.restoreControls();
+                        if (too_long) {
+                            timestep_control_->limitByCfl(cfl_step);
+                            first_step = false;
+                        } else {
+                            timestep_control_->stepFailed(dt);
+                            ++num_cuts;
+                        }
+                        continue;
                     }
+                    first_step = false;
+                    injected[0] += step_injected[0];
+                    injected[1] += step_injected[1];
+                    produced[0] += step_produced[0];
+                    produced[1] += step_produced[1];
+                    remaining = (dt >= remaining) ? 0.0 : remaining - dt;
+                    ++num_steps;
+                    timestep_control_->stepAccepted(dt, psolver_.numIterations(), transport_iterations,
+                                                    cfl_step);
                 }
-            } while (!well_control_passed);
-
-            // Update pore volumes if rock is compressible.
-            if (rock_comp_props_ && rock_comp_props_->isActive()) {
-                initial_porevol = porevol;
-                computePorevolume(grid_, props_.porosity(), *rock_comp_props_, state.pressure(), porevol);
+                std::cout << "Report step took " << num_steps << " steps and "
+                          << num_cuts << " cuts." << std::endl;
             }
+            ptime += sreport.pressure_time;
+            ttime += sreport.transport_time;
 
-            // Process transport sources from well flows.
-            Opm::computeTransportSource(props_, wells_, well_state, transport_src);
-
-            // Solve transport.
-            transport_timer.start();
-            double stepsize = timer.currentStepLength();
-            if (num_transport_substeps_ != 1) {
-                stepsize /= double(num_transport_substeps_);
-                std::cout << "Making " << num_transport_substeps_ << " transport substeps." << std::endl;
-            }
-            double injected[2] = { 0.0 };
-            double produced[2] = { 0.0 };
-            for (int tr_substep = 0; tr_substep < num_transport_substeps_; ++tr_substep) {
-                tsolver_.solve(&state.faceflux()[0], &state.pressure()[0],
-                               &initial_porevol[0], &porevol[0], &transport_src[0], stepsize,
-                               state.saturation(), state.surfacevol());
-                double substep_injected[2] = { 0.0 };
-                double substep_produced[2] = { 0.0 };
-                Opm::computeInjectedProduced(props_, state, transport_src, stepsize,
-                                             substep_injected, substep_produced);
-                injected[0] += substep_injected[0];
-                injected[1] += substep_injected[1];
-                produced[0] += substep_produced[0];
-                produced[1] += substep_produced[1];
-                if (gravity_ != 0 && use_segregation_split_) {
-                    tsolver_.solveGravity(columns_, stepsize, state.saturation(), state.surfacevol());
-                }
-            }
-            transport_timer.stop();
-            double tt = transport_timer.secsSinceStart();
-            sreport.transport_time = tt;
-            std::cout << "Transport solver took: " << tt << " seconds." << std::endl;
-            ttime += tt;
             // Report volume balances.
             Opm::computeSaturatedVol(porevol, state.surfacevol(), inplace_surfvol);
             tot_injected[0] += injected[0];
@@ -514,10 +466,8 @@ namespace Opm
         }
 
         if (output_) {
-            if (output_vtk_) {
-                outputStateVtk(grid_, state, timer.currentStepNum(), output_dir_);
-            }
-            outputStateMatlab(grid_, state, timer.currentStepNum(), output_dir_);
+            output_writer_->write(timer.currentStepNum(), state);
+            output_writer_->flush();
             outputWaterCut(watercut, output_dir_);
             if (wells_) {
                 outputWellReport(wellreport, output_dir_);
@@ -526,6 +476,9 @@ namespace Opm
         }
 
         total_timer.stop();
+        if (!profile_output_.empty()) {
+            profiling::writeReport(profile_output_);
+        }
 
         SimulatorReport report;
         report.pressure_time = ptime;
@@ -535,4 +488,140 @@ namespace Opm
     }
 
 
+
+
+    bool SimulatorCompressibleTwophase::Impl::solveStep(const double dt,
+                                                        BlackoilState& state,
+                                                        WellState& well_state,
+                                                        std::vector<double>& porevol,
+                                                        std::vector<double>& initial_porevol,
+                                                        std::vector<double>& transport_src,
+                                                        double* injected,
+                                                        double* produced,
+                                                        SimulatorReport& sreport,
+                                                        int& transport_iterations)
+    {
+        Opm::time::StopWatch pressure_timer;
+        Opm::time::StopWatch transport_timer;
+
+        // Solve pressure equation.
+        if (check_well_controls_) {
+            computeFractionalFlow(props_, allcells_,
+                                  state.pressure(), state.surfacevol(), state.saturation(),
+                                  fractional_flows_);
+            wells_manager_.applyExplicitReinjectionControls(well_resflows_phase_, well_resflows_phase_);
+        }
+        bool well_control_passed = !check_well_controls_;
+        int well_control_iteration = 0;
+        do {
+            // Run solver.
+            pressure_timer.start();
+            std::vector<double> initial_pressure = state.pressure();
+            psolver_.solve(dt, state, well_state);
+
+            // Renormalize pressure if both fluids and rock are
+            // incompressible, and there are no pressure
+            // conditions (bcs or wells).  It is deemed sufficient
+            // for now to renormalize using geometric volume
+            // instead of pore volume.
+            if (psolver_.singularPressure()) {
+                // Compute average pressures of previous and last
+                // step, and total volume.
+                double av_prev_press = 0.0;
+                double av_press = 0.0;
+                double tot_vol = 0.0;
+                const int num_cells = grid_.number_of_cells;
+                for (int cell = 0; cell < num_cells; ++cell) {
+                    av_prev_press += initial_pressure[cell]*grid_.cell_volumes[cell];
+                    av_press      += state.pressure()[cell]*grid_.cell_volumes[cell];
+                    tot_vol       += grid_.cell_volumes[cell];
+                }
+                // Renormalization constant
+                const double ren_const = (av_prev_press - av_press)/tot_vol;
+                for (int cell = 0; cell < num_cells; ++cell) {
+                    state.pressure()[cell] += ren_const;
+                }
+                const int num_wells = (wells_ == NULL) ? 0 : wells_->number_of_wells;
+                for (int well = 0; well < num_wells; ++well) {
+                    well_state.bhp()[well] += ren_const;
+                }
+            }
+
+            // Stop timer and report.
+            pressure_timer.stop();
+            double pt = pressure_timer.secsSinceStart();
+            std::cout << "Pressure solver took:  " << pt << " seconds." << std::endl;
+            sreport.pressure_time += pt;
+
+            // Optionally, check if well controls are satisfied.
+            if (check_well_controls_) {
+                Opm::computePhaseFlowRatesPerWell(*wells_,
+                                                  well_state.perfRates(),
+                                                  fractional_flows_,
+                                                  well_resflows_phase_);
+                std::cout << "Checking well conditions." << std::endl;
+                // For testing we set surface := reservoir
+                well_control_passed = wells_manager_.conditionsMet(well_state.bhp(), well_resflows_phase_, well_resflows_phase_);
+                ++well_control_iteration;
+                if (!well_control_passed && well_control_iteration > max_well_control_iterations_) {
+                    OPM_THROW(std::runtime_error, "Could not satisfy well conditions in " << max_well_control_iterations_ << " tries.");
+                }
+                if (!well_control_passed) {
+                    std::cout << "Well controls not passed, solving again." << std::endl;
+                } else {
+                    std::cout << "Well conditions met." << std::endl;
+                }
+            }
+        } while (!well_control_passed);
+
+        // Update pore volumes if rock is compressible.
+        if (rock_comp_props_ && rock_comp_props_->isActive()) {
+            initial_porevol = porevol;
+            computePorevolume(grid_, props_.porosity(), *rock_comp_props_, state.pressure(), porevol);
+        }
+
+        // Process transport sources from well flows.
+        Opm::computeTransportSource(props_, wells_, well_state, transport_src);
+
+        // Solve transport.
+        transport_timer.start();
+        int num_substeps = num_transport_substeps_;
+        if (transport_substep_cfl_ > 0.0) {
+            num_substeps = computeNumSubsteps(dt, computeCflTimeStep(grid_, porevol, state.faceflux(),
+                                                                     transport_src),
+                                              transport_substep_cfl_, max_transport_substeps_);
+        }
+        double stepsize = dt;
+        if (num_substeps != 1) {
+            stepsize /= double(num_substeps);
+            std::cout << "Making " << num_substeps << " transport substeps." << std::endl;
+        }
+        transport_iterations = 0;
+        bool transport_converged = true;
+        for (int tr_substep = 0; tr_substep < num_substeps; ++tr_substep) {
+            tsolver_.solve(&state.faceflux()[0], &state.pressure()[0],
+                           &initial_porevol[0], &porevol[0], &transport_src[0], stepsize,
+                           state.saturation(), state.surfacevol());
+            transport_iterations = std::max(transport_iterations, tsolver_.getMaxCellIterations());
+            transport_converged = transport_converged && tsolver_.lastSolveConverged();
+            double substep_injected[2] = { 0.0 };
+            double substep_produced[2] = { 0.0 };
+            Opm::computeInjectedProduced(props_, state, transport_src, stepsize,
+                                         substep_injected, substep_produced);
+            injected[0] += substep_injected[0];
+            injected[1] += substep_injected[1];
+            produced[0] += substep_produced[0];
+            produced[1] += substep_produced[1];
+            if (gravity_ != 0 && use_segregation_split_) {
+                tsolver_.solveGravity(columns_, stepsize, state.saturation(), state.surfacevol());
+            }
+        }
+        transport_timer.stop();
+        double tt = transport_timer.secsSinceStart();
+        sreport.transport_time += tt;
+        std::cout << "Transport solver took: " << tt << " seconds." << std::endl;
+        return transport_converged;
+    }
+
+
 } // namespace Opm
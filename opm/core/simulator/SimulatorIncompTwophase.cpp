@@ -32,11 +32,14 @@
 #include <opm/core/wells.h>
 #include <opm/core/pressure/flow_bc.h>
 
+#include <opm/core/simulator/AdaptiveTimeStepControl.hpp>
 #include <opm/core/simulator/SimulatorReport.hpp>
 #include <opm/core/simulator/SimulatorTimer.hpp>
 #include <opm/core/utility/StopWatch.hpp>
-#include <opm/core/io/vtk/writeVtkData.hpp>
+#include <opm/core/utility/Units.hpp>
+#include <opm/core/io/AsyncOutputWriter.hpp>
 #include <opm/core/utility/miscUtilities.hpp>
+#include <opm/core/utility/Profiler.hpp>
 #include <opm/core/utility/Event.hpp>
 
 #include <opm/core/wells/WellsManager.hpp>
@@ -51,6 +54,7 @@
 #include <boost/filesystem.hpp>
 #include <memory>
 
+#include <algorithm>
 #include <iostream>
 #include <numeric>
 #include <fstream>
@@ -75,6 +79,49 @@ namespace Opm
                             TwophaseState& state,
                             WellState& well_state);
 
+        void outputState(const TwophaseState& state, const int step);
+
+        void renormalizePressure(const std::vector<double>& initial_pressure,
+                                 TwophaseState& state,
+                                 WellState& well_state) const;
+
+        // Solve pressure and transport for one step of length dt,
+        // adding the injected and produced volumes to the given
+        // arrays and the solver times to sreport. Sets
+        // transport_iterations to the max number of iterations of a
+        // single-cell transport solve, or -1 if not known. Returns
+        // false if a single-cell transport solve did not converge.
+        bool solveStep(const double dt,
+                       TwophaseState& state,
+                       WellState& well_state,
+                       std::vector<double>& porevol,
+                       std::vector<double>& initial_porevol,
+                       std::vector<double>& transport_src,
+                       double* injected,
+                       double* produced,
+                       SimulatorReport& sreport,
+                       int& transport_iterations);
+
+        // Checks well conditions after each pressure solve.
+        struct WellControlChecker : public IncompTpfa::WellControlCheck
+        {
+            WellControlChecker(const Impl& sim,
+                               const std::vector<double>& initial_pressure,
+                               const std::vector<double>& fractional_flows,
+                               std::vector<double>& well_resflows_phase)
+                : sim_(sim),
+                  initial_pressure_(initial_pressure),
+                  fractional_flows_(fractional_flows),
+                  well_resflows_phase_(well_resflows_phase)
+            {
+            }
+            virtual bool conditionsMet(TwophaseState& state, WellState& well_state);
+            const Impl& sim_;
+            const std::vector<double>& initial_pressure_;
+            const std::vector<double>& fractional_flows_;
+            std::vector<double>& well_resflows_phase_;
+        };
+
         // Data.
         // Parameters for output.
         std::ostream* log_;
@@ -82,13 +129,19 @@ namespace Opm
         bool output_vtk_;
         std::string output_dir_;
         int output_interval_;
+        std::unique_ptr<AsyncOutputWriter> output_writer_;
+        std::string profile_output_;
         // Parameters for well control
         bool check_well_controls_;
         int max_well_control_iterations_;
         // Parameters for transport solver.
         int num_transport_substeps_;
+        double transport_substep_cfl_;
+        int max_transport_substeps_;
         bool use_reorder_;
         bool use_segregation_split_;
+        // Adaptive time stepping, null if off.
+        std::unique_ptr<AdaptiveTimeStepControl> timestep_control_;
         // Observed objects.
         const UnstructuredGrid& grid_;
         const IncompPropertiesInterface& props_;
@@ -102,6 +155,8 @@ namespace Opm
         std::unique_ptr<TransportSolverTwophaseInterface> tsolver_;
         // Misc. data
         std::vector<int> allcells_;
+        std::vector<double> fractional_flows_;
+        std::vector<double> well_resflows_phase_;
 
         // list of hooks that are notified when a timestep completes
         EventSource timestep_completed_;
@@ -177,92 +232,6 @@ namespace Opm
         os.precision(8);
     }
 
-    static void outputStateVtk(const UnstructuredGrid& grid,
-                               const Opm::TwophaseState& state,
-                               const int step,
-                               const std::string& output_dir)
-    {
-        // Write data in VTK format.
-        std::ostringstream vtkfilename;
-        vtkfilename << output_dir << "/vtk_files";
-        boost::filesystem::path fpath(vtkfilename.str());
-        try {
-            create_directories(fpath);
-        }
-        catch (...) {
-            OPM_THROW(std::runtime_error, "Creating directories failed: " << fpath);
-        }
-        vtkfilename << "/output-" << std::setw(3) << std::setfill('0') << step << ".vtu";
-        std::ofstream vtkfile(vtkfilename.str().c_str());
-        if (!vtkfile) {
-            OPM_THROW(std::runtime_error, "Failed to open " << vtkfilename.str());
-        }
-        Opm::DataMap dm;
-        dm["saturation"] = &state.saturation();
-        dm["pressure"] = &state.pressure();
-        std::vector<double> cell_velocity;
-        Opm::estimateCellVelocity(grid, state.faceflux(), cell_velocity);
-        dm["velocity"] = &cell_velocity;
-        Opm::writeVtkData(grid, dm, vtkfile);
-    }
-
-    static void outputVectorMatlab(const std::string& name,
-                                   const std::vector<int>& vec,
-                                   const int step,
-                                   const std::string& output_dir)
-    {
-        std::ostringstream fname;
-        fname << output_dir << "/" << name;
-        boost::filesystem::path fpath = fname.str();
-        try {
-            create_directories(fpath);
-        }
-        catch (...) {
-            OPM_THROW(std::runtime_error, "Creating directories failed: " << fpath);
-        }
-        fname << "/" << std::setw(3) << std::setfill('0') << step << ".txt";
-        std::ofstream file(fname.str().c_str());
-        if (!file) {
-            OPM_THROW(std::runtime_error, "Failed to open " << fname.str());
-        }
-        std::copy(vec.begin(), vec.end(), std::ostream_iterator<double>(file, "\n"));
-    }
-
-    static void outputStateMatlab(const UnstructuredGrid& grid,
-                                  const Opm::TwophaseState& state,
-                                  const int step,
-                                  const std::string& output_dir)
-    {
-        Opm::DataMap dm;
-        dm["saturation"] = &state.saturation();
-        dm["pressure"] = &state.pressure();
-        std::vector<double> cell_velocity;
-        Opm::estimateCellVelocity(grid, state.faceflux(), cell_velocity);
-        dm["velocity"] = &cell_velocity;
-
-        // Write data (not grid) in Matlab format
-        for (Opm::DataMap::const_iterator it = dm.begin(); it != dm.end(); ++it) {
-            std::ostringstream fname;
-            fname << output_dir << "/" << it->first;
-            boost::filesystem::path fpath = fname.str();
-            try {
-                create_directories(fpath);
-            }
-            catch (...) {
-                OPM_THROW(std::runtime_error, "Creating directories failed: " << fpath);
-            }
-            fname << "/" << std::setw(3) << std::setfill('0') << step << ".txt";
-            std::ofstream file(fname.str().c_str());
-            if (!file) {
-                OPM_THROW(std::runtime_error, "Failed to open " << fname.str());
-            }
-            file.precision(15);
-            const std::vector<double>& d = *(it->second);
-            std::copy(d.begin(), d.end(), std::ostream_iterator<double>(file, "\n"));
-        }
-    }
-
-
     static void outputWaterCut(const Opm::Watercut& watercut,
                                const std::string& output_dir)
     {
@@ -345,13 +314,27 @@ namespace Opm
                    param.getDefault("nl_pressure_maxiter", 10),
                    gravity, wells_manager.c_wells(), src, bcs)
     {
+        log_ = param.getDefault("quiet", false) ? &Opm::null_stream : &std::cout;
+
         // Initialize transport solver.
         if (use_reorder_) {
-            tsolver_.reset(new Opm::TransportSolverTwophaseReorder(grid,
-                                                                   props,
-                                                                   use_segregation_split_ ? gravity : NULL,
-                                                                   param.getDefault("nl_tolerance", 1e-9),
-                                                                   param.getDefault("nl_maxiter", 30)));
+            Opm::TransportSolverTwophaseReorder* tsolver
+                = new Opm::TransportSolverTwophaseReorder(grid,
+                                                          props,
+                                                          use_segregation_split_ ? gravity : NULL,
+                                                          param.getDefault("nl_tolerance", 1e-9),
+                                                          param.getDefault("nl_maxiter", 30));
+            tsolver_.reset(tsolver);
+            tsolver->setIncrementalReordering(param.getDefault("use_incremental_reorder", false),
+                                              param.getDefault("reorder_rebuild_fraction", 0.1),
+                                              param.getDefault("reorder_verbose", false));
+            tsolver->setUseNewton(param.getDefault("nl_use_newton", false));
+            const int fracflow_table_points = param.getDefault("fracflow_table_points", 0);
+            const double fracflow_error = tsolver->setFractionalFlowTables(fracflow_table_points);
+            if (fracflow_table_points > 0) {
+                *log_ << "Fractional flow tables: " << fracflow_table_points
+                      << " points, max error " << fracflow_error << std::endl;
+            }
 
         } else {
             if (rock_comp_props && rock_comp_props->isActive()) {
@@ -371,7 +354,6 @@ namespace Opm
         }
 
         // For output.
-        log_ = param.getDefault("quiet", false) ? &Opm::null_stream : &std::cout;
         output_ = param.getDefault("output", true);
         if (output_) {
             output_vtk_ = param.getDefault("output_vtk", true);
@@ -385,7 +367,20 @@ namespace Opm
                 OPM_THROW(std::runtime_error, "Creating directories failed: " << fpath);
             }
             output_interval_ = param.getDefault("output_interval", 1);
+            const bool output_async = param.getDefault("output_async", true);
+            const int queue_depth = output_async ? param.getDefault("output_queue_depth", 2) : 0;
+            const std::string format = param.getDefault("output_format", std::string("matlab"));
+            if (format != "matlab" && format != "binary") {
+                OPM_THROW(std::runtime_error, "Unknown output_format: " << format);
+            }
+            output_writer_.reset(new AsyncOutputWriter(grid, output_dir_, output_vtk_, queue_depth,
+                                                       format == "binary" ? AsyncOutputWriter::Binary
+                                                                          : AsyncOutputWriter::Matlab,
+                                                       param.getDefault("output_compress", false)));
         }
+        profile_output_ = param.getDefault("profile_output",
+                                           profiling::enabled() && output_ ? output_dir_ + "/profile.json"
+                                                                           : std::string());
 
         // Well control related init.
         check_well_controls_ = param.getDefault("check_well_controls", false);
@@ -393,6 +388,13 @@ namespace Opm
 
         // Transport related init.
         num_transport_substeps_ = param.getDefault("num_transport_substeps", 1);
+        transport_substep_cfl_ = param.getDefault("transport_substep_cfl", 0.0);
+        max_transport_substeps_ = param.getDefault("max_transport_substeps", 100);
+
+        // Time stepping related init.
+        if (param.getDefault("adaptive_timestepping", false)) {
+            timestep_control_.reset(new AdaptiveTimeStepControl(param));
+        }
 
         // Misc init.
         const int num_cells = grid.number_of_cells;
@@ -405,6 +407,81 @@ namespace Opm
 
 
 
+    // Queue state output, written by a background thread.
+    void SimulatorIncompTwophase::Impl::outputState(const TwophaseState& state, const int step)
+    {
+        if (use_reorder_) {
+            // This use of dynamic_cast is not ideal, but should be safe.
+            output_writer_->write(step, state, std::string("reorder_it"),
+                                  dynamic_cast<const TransportSolverTwophaseReorder&>(*tsolver_).getReorderIterations());
+        } else {
+            output_writer_->write(step, state);
+        }
+    }
+
+
+
+
+    // Renormalize pressure if rock is incompressible, and
+    // there are no pressure conditions (bcs or wells).
+    // It is deemed sufficient for now to renormalize
+    // using geometric volume instead of pore volume.
+    void SimulatorIncompTwophase::Impl::renormalizePressure(const std::vector<double>& initial_pressure,
+                                                            TwophaseState& state,
+                                                            WellState& well_state) const
+    {
+        if ((rock_comp_props_ == NULL || !rock_comp_props_->isActive())
+            && allNeumannBCs(bcs_) && allRateWells(wells_)) {
+            // Compute average pressures of previous and last
+            // step, and total volume.
+            double av_prev_press = 0.0;
+            double av_press = 0.0;
+            double tot_vol = 0.0;
+            const int num_cells = grid_.number_of_cells;
+            for (int cell = 0; cell < num_cells; ++cell) {
+                av_prev_press += initial_pressure[cell]*grid_.cell_volumes[cell];
+                av_press      += state.pressure()[cell]*grid_.cell_volumes[cell];
+                tot_vol       += grid_.cell_volumes[cell];
+            }
+            // Renormalization constant
+            const double ren_const = (av_prev_press - av_press)/tot_vol;
+            for (int cell = 0; cell < num_cells; ++cell) {
+                state.pressure()[cell] += ren_const;
+            }
+            const int num_wells = (wells_ == NULL) ? 0 : wells_->number_of_wells;
+            for (int well = 0; well < num_wells; ++well) {
+                well_state.bhp()[well] += ren_const;
+            }
+        }
+    }
+
+
+
+
+    bool SimulatorIncompTwophase::Impl::WellControlChecker::conditionsMet(TwophaseState& state,
+                                                                          WellState& well_state)
+    {
+        sim_.renormalizePressure(initial_pressure_, state, well_state);
+        Opm::computePhaseFlowRatesPerWell(*sim_.wells_,
+                                          well_state.perfRates(),
+                                          fractional_flows_,
+                                          well_resflows_phase_);
+        *sim_.log_ << "Checking well conditions." << std::endl;
+        // For testing we set surface := reservoir
+        const bool passed = sim_.wells_manager_.conditionsMet(well_state.bhp(),
+                                                              well_resflows_phase_,
+                                                              well_resflows_phase_);
+        if (!passed) {
+            *sim_.log_ << "Well controls not passed, solving again." << std::endl;
+        } else {
+            *sim_.log_ << "Well conditions met." << std::endl;
+        }
+        return passed;
+    }
+
+
+
+
     SimulatorReport SimulatorIncompTwophase::Impl::run(SimulatorTimer& timer,
                                                        TwophaseState& state,
                                                        WellState& well_state)
@@ -422,9 +499,7 @@ namespace Opm
         std::vector<double> initial_porevol = porevol;
 
         // Main simulation loop.
-        Opm::time::StopWatch pressure_timer;
         double ptime = 0.0;
-        Opm::time::StopWatch transport_timer;
         double ttime = 0.0;
         Opm::time::StopWatch callback_timer;
         double time_in_callbacks = 0.0;
@@ -441,10 +516,9 @@ namespace Opm
         Opm::Watercut watercut;
         watercut.push(0.0, 0.0, 0.0);
         Opm::WellReport wellreport;
-        std::vector<double> fractional_flows;
-        std::vector<double> well_resflows_phase;
         if (wells_) {
-            well_resflows_phase.resize((wells_->number_of_phases)*(wells_->number_of_wells), 0.0);
+            well_resflows_phase_.clear();
+            well_resflows_phase_.resize((wells_->number_of_phases)*(wells_->number_of_wells), 0.0);
             wellreport.push(props_, *wells_, state.saturation(), 0.0, well_state.bhp(), well_state.perfRates());
         }
         std::fstream tstep_os;
@@ -452,144 +526,106 @@ namespace Opm
             std::string filename = output_dir_ + "/step_timing.param";
             tstep_os.open(filename.c_str(), std::fstream::out | std::fstream::app);
         }
+        bool first_step = true;
         for (; !timer.done(); ++timer) {
             // Report timestep and (optionally) write state to disk.
             step_timer.start();
             timer.report(*log_);
             if (output_ && (timer.currentStepNum() % output_interval_ == 0)) {
-                if (output_vtk_) {
-                    outputStateVtk(grid_, state, timer.currentStepNum(), output_dir_);
-                }
-                outputStateMatlab(grid_, state, timer.currentStepNum(), output_dir_);
-                if (use_reorder_) {
-                    // This use of dynamic_cast is not ideal, but should be safe.
-                    outputVectorMatlab(std::string("reorder_it"),
-                                       dynamic_cast<const TransportSolverTwophaseReorder&>(*tsolver_).getReorderIterations(),
-                                       timer.currentStepNum(), output_dir_);
-                }
+                outputState(state, timer.currentStepNum());
             }
 
             SimulatorReport sreport;
-
-            // Solve pressure equation.
-            if (check_well_controls_) {
-                computeFractionalFlow(props_, allcells_, state.saturation(), fractional_flows);
-                wells_manager_.applyExplicitReinjectionControls(well_resflows_phase, well_resflows_phase);
-            }
-            bool well_control_passed = !check_well_controls_;
-            int well_control_iteration = 0;
-            do {
-                // Run solver.
-                pressure_timer.start();
-                std::vector<double> initial_pressure = state.pressure();
-                psolver_.solve(timer.currentStepLength(), state, well_state);
-
-                // Renormalize pressure if rock is incompressible, and
-                // there are no pressure conditions (bcs or wells).
-                // It is deemed sufficient for now to renormalize
-                // using geometric volume instead of pore volume.
-                if ((rock_comp_props_ == NULL || !rock_comp_props_->isActive())
-                    && allNeumannBCs(bcs_) && allRateWells(wells_)) {
-                    // Compute average pressures of previous and last
-                    // step, and total volume.
-                    double av_prev_press = 0.0;
-                    double av_press = 0.0;
-                    double tot_vol = 0.0;
-                    const int num_cells = grid_.number_of_cells;
-                    for (int cell = 0; cell < num_cells; ++cell) {
-                        av_prev_press += initial_pressure[cell]*grid_.cell_volumes[cell];
-                        av_press      += state.pressure()[cell]*grid_.cell_volumes[cell];
-                        tot_vol       += grid_.cell_volumes[cell];
-                    }
-                    // Renormalization constant
-                    const double ren_const = (av_prev_press - av_press)/tot_vol;
-                    for (int cell = 0; cell < num_cells; ++cell) {
-                        state.pressure()[cell] += ren_const;
+            double injected[2] = { 0.0 };
+            double produced[2] = { 0.0 };
+            if (!timestep_control_) {
+                int transport_iterations = 0;
+                solveStep(timer.currentStepLength(), state, well_state,
+                          porevol, initial_porevol, transport_src,
+                          injected, produced, sreport, transport_iterations);
+            } else {
+                // Take as many steps as needed to reach the end of the
+                // report step, repeating failed steps with shorter ones.
+                double remaining = timer.currentStepLength();
+                int num_steps = 0;
+                int num_cuts = 0;
+                while (remaining > 0.0) {
+                    const double dt = timestep_control_->nextStep(remaining);
+                    *log_ << "Taking step of " << unit::convert::to(dt, unit::day)
+                          << " days." << std::endl;
+                    const TwophaseState state_before = state;
+                    const WellState well_state_before = well_state;
+                    const std::vector<double> porevol_before = porevol;
+                    const std::vector<double> initial_porevol_before = initial_porevol;
+                    const std::vector<double> well_resflows_phase_before = well_resflows_phase_;
+                    wells_manager_.saveControls();
+                    double step_injected[2] = { 0.0 };
+                    double step_produced[2] = { 0.0 };
+                    bool converged = true;
+                    int transport_iterations = 0;
+                    try {
+                        converged = solveStep(dt, state, well_state,
+                                              porevol, initial_porevol, transport_src,
+                                              step_injected, step_produced, sreport,
+                                              transport_iterations);
+                        if (!converged) {
+                            *log_ << "Transport solver did not converge." << std::endl;
+                        }
                     }
-                    const int num_wells = (wells_ == NULL) ? 0 : wells_->number_of_wells;
-                    for (int well = 0; well < num_wells; ++well) {
-                        well_state.bhp()[well] += ren_const;
+                    catch (const std::runtime_error& e) {
+                        *log_ << "Step failed: " << e.what() << std::endl;
+                        converged = false;
                     }
-                }
-
-                // Stop timer and report.
-                pressure_timer.stop();
-                double pt = pressure_timer.secsSinceStart();
-                *log_ << "Pressure solver took:  " << pt << " seconds." << std::endl;
-                ptime += pt;
-                sreport.pressure_time = pt;
-
-                // Optionally, check if well controls are satisfied.
-                if (check_well_controls_) {
-                    Opm::computePhaseFlowRatesPerWell(*wells_,
-                                                      well_state.perfRates(),
-                                                      fractional_flows,
-                                                      well_resflows_phase);
-                    *log_ << "Checking well conditions." << std::endl;
-                    // For testing we set surface := reservoir
-                    well_control_passed = wells_manager_.conditionsMet(well_state.bhp(), well_resflows_phase, well_resflows_phase);
-                    ++well_control_iteration;
-                    if (!well_control_passed && well_control_iteration > max_well_control_iterations_) {
-                        OPM_THROW(std::runtime_error, "Could not satisfy well conditions in " << max_well_control_iterations_ << " tries.");
+                    // No step has given a CFL step length for the first
+                    // step, so it is checked after it has been taken.
+                    const double cfl_step = computeCflTimeStep(grid_, porevol, state.faceflux(),
+                                                               transport_src);
+                    bool too_long = false;
+                    if (converged && first_step && timestep_control_->exceedsCfl(dt, cfl_step)) {
+                        *log_ << "First step exceeds the max CFL number, repeating it." << std::endl;
+                        too_long = true;
                     }
-                    if (!well_control_passed) {
-                        *log_ << "Well controls not passed, solving again." << std::endl;
-                    } else {
-                        *log_ << "Well conditions met." << std::endl;
+                    if (!converged || too_long) {
+                        state = state_before;
+                        well_state = well_state_before;
+                        porevol = porevol_before;
+                        initial_porevol = initial_porevol_before;
+                        well_resflows_phase_ = well_resflows_phase_before;
+                        wells_manager_.restoreControls();
+                        if (too_long) {
+                            timestep_control_->limitByCfl(cfl_step);
+                            first_step = false;
+                        } else {
+                            timestep_control_->stepFailed(dt);
+                            ++num_cuts;
+                        }
+                        continue;
                     }
+                    first_step = false;
+                    injected[0] += step_injected[0];
+                    injected[1] += step_injected[1];
+                    produced[0] += step_produced[0];
+                    produced[1] += step_produced[1];
+                    remaining = (dt >= remaining) ? 0.0 : remaining - dt;
+                    ++num_steps;
+                    // The pressure solver does not report iterations.
+                    timestep_control_->stepAccepted(dt, -1, transport_iterations, cfl_step);
                 }
-            } while (!well_control_passed);
-
-            // Update pore volumes if rock is compressible.
-            if (rock_comp_props_ && rock_comp_props_->isActive()) {
-                initial_porevol = porevol;
-                computePorevolume(grid_, props_.porosity(), *rock_comp_props_, state.pressure(), porevol);
+                *log_ << "Report step took " << num_steps << " steps and "
+                      << num_cuts << " cuts." << std::endl;
             }
+            ptime += sreport.pressure_time;
+            ttime += sreport.transport_time;
 
-            // Process transport sources (to include bdy terms and well flows).
-            Opm::computeTransportSource(grid_, src_, state.faceflux(), 1.0,
-                                        wells_, well_state.perfRates(), transport_src);
-
-            // Solve transport.
-            transport_timer.start();
-            double stepsize = timer.currentStepLength();
-            if (num_transport_substeps_ != 1) {
-                stepsize /= double(num_transport_substeps_);
-                *log_ << "Making " << num_transport_substeps_ << " transport substeps." << std::endl;
-            }
-            double injected[2] = { 0.0 };
-            double produced[2] = { 0.0 };
-            for (int tr_substep = 0; tr_substep < num_transport_substeps_; ++tr_substep) {
-                tsolver_->solve(&initial_porevol[0], &transport_src[0], stepsize, state);
-
-                double substep_injected[2] = { 0.0 };
-                double substep_produced[2] = { 0.0 };
-                Opm::computeInjectedProduced(props_, state.saturation(), transport_src, stepsize,
-                                             substep_injected, substep_produced);
-                injected[0] += substep_injected[0];
-                injected[1] += substep_injected[1];
-                produced[0] += substep_produced[0];
-                produced[1] += substep_produced[1];
-                if (use_reorder_ && use_segregation_split_) {
-                    // Again, unfortunate but safe use of dynamic_cast.
-                    // Possible solution: refactor gravity solver to its own class.
-                    dynamic_cast<TransportSolverTwophaseReorder&>(*tsolver_)
-                        .solveGravity(&initial_porevol[0], stepsize, state);
-                }
-                watercut.push(timer.currentTime() + timer.currentStepLength(),
-                              produced[0]/(produced[0] + produced[1]),
-                              tot_produced[0]/tot_porevol_init);
-                if (wells_) {
-                    wellreport.push(props_, *wells_, state.saturation(),
-                                    timer.currentTime() + timer.currentStepLength(),
-                                    well_state.bhp(), well_state.perfRates());
-                }
+            watercut.push(timer.currentTime() + timer.currentStepLength(),
+                          produced[0]/(produced[0] + produced[1]),
+                          tot_produced[0]/tot_porevol_init);
+            if (wells_) {
+                wellreport.push(props_, *wells_, state.saturation(),
+                                timer.currentTime() + timer.currentStepLength(),
+                                well_state.bhp(), well_state.perfRates());
             }
-            transport_timer.stop();
-            double tt = transport_timer.secsSinceStart();
-            sreport.transport_time = tt;
-            *log_ << "Transport solver took: " << tt << " seconds." << std::endl;
-            ttime += tt;
+
             // Report volume balances.
             Opm::computeSaturatedVol(porevol, state.saturation(), satvol);
             tot_injected[0] += injected[0];
@@ -613,16 +649,8 @@ namespace Opm
         }
 
         if (output_) {
-            if (output_vtk_) {
-                outputStateVtk(grid_, state, timer.currentStepNum(), output_dir_);
-            }
-            outputStateMatlab(grid_, state, timer.currentStepNum(), output_dir_);
-            if (use_reorder_) {
-                // This use of dynamic_cast is not ideal, but should be safe.
-                outputVectorMatlab(std::string("reorder_it"),
-                                   dynamic_cast<const TransportSolverTwophaseReorder&>(*tsolver_).getReorderIterations(),
-                                   timer.currentStepNum(), output_dir_);
-                }
+            outputState(state, timer.currentStepNum());
+            output_writer_->flush();
             outputWaterCut(watercut, output_dir_);
             if (wells_) {
                 outputWellReport(wellreport, output_dir_);
@@ -631,6 +659,9 @@ namespace Opm
         }
 
         total_timer.stop();
+        if (!profile_output_.empty()) {
+            profiling::writeReport(profile_output_);
+        }
 
         SimulatorReport report;
         report.pressure_time = ptime;
@@ -640,4 +671,104 @@ namespace Opm
     }
 
 
+
+
+    bool SimulatorIncompTwophase::Impl::solveStep(const double dt,
+                                                  TwophaseState& state,
+                                                  WellState& well_state,
+                                                  std::vector<double>& porevol,
+                                                  std::vector<double>& initial_porevol,
+                                                  std::vector<double>& transport_src,
+                                                  double* injected,
+                                                  double* produced,
+                                                  SimulatorReport& sreport,
+                                                  int& transport_iterations)
+    {
+        Opm::time::StopWatch pressure_timer;
+        Opm::time::StopWatch transport_timer;
+
+        // Solve pressure equation.
+        if (check_well_controls_) {
+            computeFractionalFlow(props_, allcells_, state.saturation(), fractional_flows_);
+            wells_manager_.applyExplicitReinjectionControls(well_resflows_phase_, well_resflows_phase_);
+        }
+        pressure_timer.start();
+        std::vector<double> initial_pressure = state.pressure();
+        if (check_well_controls_) {
+            // Well controls are switched within the pressure solver,
+            // reusing the assembled system.
+            WellControlChecker checker(*this, initial_pressure,
+                                       fractional_flows_, well_resflows_phase_);
+            psolver_.solve(dt, state, well_state,
+                           checker, max_well_control_iterations_);
+        } else {
+            psolver_.solve(dt, state, well_state);
+            renormalizePressure(initial_pressure, state, well_state);
+        }
+
+        // Stop timer and report.
+        pressure_timer.stop();
+        double pt = pressure_timer.secsSinceStart();
+        *log_ << "Pressure solver took:  " << pt << " seconds." << std::endl;
+        sreport.pressure_time += pt;
+
+        // Update pore volumes if rock is compressible.
+        if (rock_comp_props_ && rock_comp_props_->isActive()) {
+            initial_porevol = porevol;
+            computePorevolume(grid_, props_.porosity(), *rock_comp_props_, state.pressure(), porevol);
+        }
+
+        // Process transport sources (to include bdy terms and well flows).
+        Opm::computeTransportSource(grid_, src_, state.faceflux(), 1.0,
+                                    wells_, well_state.perfRates(), transport_src);
+
+        // Solve transport.
+        transport_timer.start();
+        int num_substeps = num_transport_substeps_;
+        if (transport_substep_cfl_ > 0.0) {
+            num_substeps = computeNumSubsteps(dt, computeCflTimeStep(grid_, porevol, state.faceflux(),
+                                                                     transport_src),
+                                              transport_substep_cfl_, max_transport_substeps_);
+        }
+        double stepsize = dt;
+        if (num_substeps != 1) {
+            stepsize /= double(num_substeps);
+            *log_ << "Making " << num_substeps << " transport substeps." << std::endl;
+        }
+        transport_iterations = use_reorder_ ? 0 : -1;
+        bool transport_converged = true;
+        for (int tr_substep = 0; tr_substep < num_substeps; ++tr_substep) {
+            tsolver_->solve(&initial_porevol[0], &transport_src[0], stepsize, state);
+            if (use_reorder_) {
+                // This use of dynamic_cast is not ideal, but should be safe.
+                const TransportSolverTwophaseReorder& reorder_solver
+                    = dynamic_cast<const TransportSolverTwophaseReorder&>(*tsolver_);
+                transport_iterations = std::max(transport_iterations,
+                                                reorder_solver.getMaxCellIterations());
+                transport_converged = transport_converged && reorder_solver.lastSolveConverged();
+            }
+
+            double substep_injected[2] = { 0.0 };
+            double substep_produced[2] = { 0.0 };
+            Opm::computeInjectedProduced(props_, state.saturation(), transport_src, stepsize,
+                                         substep_injected, substep_produced);
+            injected[0] += substep_injected[0];
+            injected[1] += substep_injected[1];
+            produced[0] += substep_produced[0];
+            produced[1] += substep_produced[1];
+            if (use_reorder_ && use_segregation_split_) {
+                // Again, unfortunate but safe use of dynamic_cast.
+                // Possible solution: refactor gravity solver to its own class.
+                dynamic_cast<TransportSolverTwophaseReorder&>(*tsolver_)
+                    .solveGravity(&initial_porevol[0], stepsize, state);
+            }
+        }
+        transport_timer.stop();
+        double tt = transport_timer.secsSinceStart();
+        sreport.transport_time += tt;
+        *log_ << "Transport solver took: " << tt << " seconds." << std::endl;
+        return transport_converged;
+    }
+
+
 } // namespace Opm
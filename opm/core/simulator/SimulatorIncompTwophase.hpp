@@ -52,12 +52,47 @@ namespace Opm
         ///     output (true)                  write output to files?
         ///     output_dir ("output")          output directoty
         ///     output_interval (1)            output every nth step
+        ///     output_async (true)            write output files in a background thread
+        ///     output_queue_depth (2)         max number of steps waiting to be written
+        ///     output_format ("matlab")       "matlab" for text files per field and step,
+        ///                                    "binary" for a single file output_dir/states.bin
+        ///     output_compress (false)        compress the binary output (requires zlib)
+        ///     profile_output                 file for the timers and counters of the run,
+        ///                                    as CSV if it ends with .csv, JSON otherwise.
+        ///                                    Only recorded if built with USE_PROFILING,
+        ///                                    then defaults to output_dir/profile.json
         ///     nl_pressure_residual_tolerance (0.0) pressure solver residual tolerance (in Pascal)
         ///     nl_pressure_change_tolerance (1.0)   pressure solver change tolerance (in Pascal)
         ///     nl_pressure_maxiter (10)       max nonlinear iterations in pressure
         ///     nl_maxiter (30)                max nonlinear iterations in transport
         ///     nl_tolerance (1e-9)            transport solver absolute residual tolerance
+        ///     nl_use_newton (false)          use safeguarded Newton instead of regula falsi
+        ///                                    in the transport solver's single-cell solves
+        ///     fracflow_table_points (0)      if positive, tabulate fractional flow per
+        ///                                    saturation region with this many points
         ///     num_transport_substeps (1)     number of transport steps per pressure step
+        ///     transport_substep_cfl (0)      if positive, choose the number of transport
+        ///                                    steps per pressure step such that each has
+        ///                                    at most this CFL number, computed from the
+        ///                                    fluxes and transport sources of the step,
+        ///                                    instead of using num_transport_substeps
+        ///     max_transport_substeps (100)   max number of CFL-limited transport steps
+        ///     adaptive_timestepping (false)  divide report steps into steps chosen by
+        ///                                    an AdaptiveTimeStepControl, which also
+        ///                                    accepts its own parameters. Steps where
+        ///                                    a solver fails or a single-cell transport
+        ///                                    solve does not converge in nl_maxiter
+        ///                                    iterations are repeated with a shorter
+        ///                                    step and the well controls of the step's
+        ///                                    start. A first step above the max CFL
+        ///                                    number is repeated with a shorter step.
+        ///                                    The pressure iterations are not known,
+        ///                                    and not used to choose the step length.
+        ///     use_incremental_reorder (false) reuse and repair the previous step's cell
+        ///                                    ordering instead of recomputing it
+        ///     reorder_rebuild_fraction (0.1) fraction of changed faces or reordered cells
+        ///                                    above which a full reordering is done
+        ///     reorder_verbose (false)        report timing of incremental reordering
         ///     use_segregation_split (false)  solve for gravity segregation (if false,
         ///                                    segregation is ignored).
         ///
@@ -25,12 +25,12 @@
 #include <opm/core/grid.h>
 #include <opm/core/io/eclipse/EclipseGridParser.hpp>
 #include <opm/core/utility/ErrorMacros.hpp>
-#include <opm/core/utility/MonotCubicInterpolator.hpp>
 #include <opm/core/utility/Units.hpp>
 #include <opm/core/props/IncompPropertiesInterface.hpp>
 #include <opm/core/props/BlackoilPropertiesInterface.hpp>
 #include <opm/core/props/phaseUsageFromDeck.hpp>
 
+#include <algorithm>
 #include <iostream>
 #include <cmath>
 
@@ -43,19 +43,22 @@ namespace Opm
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wunneeded-internal-declaration"
 #endif /* __clang__ */
-        // Find the cells that are below and above a depth.
+        // Find the cells among a set of cells that are below and
+        // above a depth.
         // TODO: add 'anitialiasing', obtaining a more precise split
         //       by f. ex. subdividing cells cut by the split depths.
         void cellsBelowAbove(const UnstructuredGrid& grid,
+                             const std::vector<int>& cells,
                              const double depth,
                              std::vector<int>& below,
                              std::vector<int>& above)
         {
-            const int num_cells = grid.number_of_cells;
+            const int num_cells = cells.size();
             below.reserve(num_cells);
             above.reserve(num_cells);
             const int dim = grid.dimensions;
-            for (int c = 0; c < num_cells; ++c) {
+            for (int i = 0; i < num_cells; ++i) {
+                const int c = cells[i];
                 const double z = grid.cell_centroids[dim*c + dim - 1];
                 if (z > depth) {
                     below.push_back(c);
@@ -64,6 +67,16 @@ namespace Opm
                 }
             }
         }
+
+        // The indices of all cells of a grid.
+        std::vector<int> allCells(const UnstructuredGrid& grid)
+        {
+            std::vector<int> cells(grid.number_of_cells);
+            for (int c = 0; c < grid.number_of_cells; ++c) {
+                cells[c] = c;
+            }
+            return cells;
+        }
 #ifdef __clang__
 #pragma clang diagnostic pop
 #endif /* __clang__ */
@@ -73,9 +86,11 @@ namespace Opm
         // Initialize saturations so that there is water below woc,
         // and oil above.
         // If invert is true, water is instead above, oil below.
+        // Only the given cells are initialized.
         template <class Props, class State>
         void initWaterOilContact(const UnstructuredGrid& grid,
                                  const Props& props,
+                                 const std::vector<int>& cells,
                                  const double woc,
                                  const WaterInit waterinit,
                                  State& state)
@@ -90,16 +105,27 @@ namespace Opm
             // }
             switch (waterinit) {
             case WaterBelow:
-                cellsBelowAbove(grid, woc, water, oil);
+                cellsBelowAbove(grid, cells, woc, water, oil);
                 break;
             case WaterAbove:
-                cellsBelowAbove(grid, woc, oil, water);
+                cellsBelowAbove(grid, cells, woc, oil, water);
             }
             // Set saturations.
             state.setFirstSat(oil, props, State::MinSat);
             state.setFirstSat(water, props, State::MaxSat);
         }
 
+        // Initialize saturations of all cells from a water-oil contact.
+        template <class Props, class State>
+        void initWaterOilContact(const UnstructuredGrid& grid,
+                                 const Props& props,
+                                 const double woc,
+                                 const WaterInit waterinit,
+                                 State& state)
+        {
+            initWaterOilContact(grid, props, allCells(grid), woc, waterinit, state);
+        }
+
 
         // Initialize hydrostatic pressures depending only on gravity,
         // (constant) phase densities and a water-oil contact depth.
@@ -112,9 +138,11 @@ namespace Opm
         // Note that by manipulating the densities parameter,
         // it is possible to initialise with water on top instead of
         // on the bottom etc.
+        // Only the pressures of the given cells are set.
         template <class State>
         void initHydrostaticPressure(const UnstructuredGrid& grid,
                                      const double* densities,
+                                     const std::vector<int>& cells,
                                      const double woc,
                                      const double gravity,
                                      const double datum_z,
@@ -122,23 +150,53 @@ namespace Opm
                                      State& state)
         {
             std::vector<double>& p = state.pressure();
-            const int num_cells = grid.number_of_cells;
+            const int num_cells = cells.size();
             const int dim = grid.dimensions;
             // Compute pressure at woc
             const double rho_datum = datum_z > woc ? densities[0] : densities[1];
             const double woc_p = datum_p + (woc - datum_z)*gravity*rho_datum;
-            for (int c = 0; c < num_cells; ++c) {
+#pragma omp parallel for schedule(static)
+            for (int i = 0; i < num_cells; ++i) {
                 // Compute pressure as delta from woc pressure.
+                const int c = cells[i];
                 const double z = grid.cell_centroids[dim*c + dim - 1];
                 const double rho = z > woc ? densities[0] : densities[1];
                 p[c] = woc_p + (z - woc)*gravity*rho;
             }
         }
 
+        // As above, for all cells.
+        template <class State>
+        void initHydrostaticPressure(const UnstructuredGrid& grid,
+                                     const double* densities,
+                                     const double woc,
+                                     const double gravity,
+                                     const double datum_z,
+                                     const double datum_p,
+                                     State& state)
+        {
+            initHydrostaticPressure(grid, densities, allCells(grid), woc, gravity, datum_z, datum_p, state);
+        }
+
 
         // Facade to initHydrostaticPressure() taking a property object,
         // for similarity to initHydrostaticPressure() for compressible fluids.
         template <class State>
+        void initHydrostaticPressure(const UnstructuredGrid& grid,
+                                     const IncompPropertiesInterface& props,
+                                     const std::vector<int>& cells,
+                                     const double woc,
+                                     const double gravity,
+                                     const double datum_z,
+                                     const double datum_p,
+                                     State& state)
+        {
+            const double* densities = props.density();
+            initHydrostaticPressure(grid, densities, cells, woc, gravity, datum_z, datum_p, state);
+        }
+
+        // As above, for all cells.
+        template <class State>
         void initHydrostaticPressure(const UnstructuredGrid& grid,
                                      const IncompPropertiesInterface& props,
                                      const double woc,
@@ -157,14 +215,16 @@ namespace Opm
         struct Density
         {
             const BlackoilPropertiesInterface& props_;
-            Density(const BlackoilPropertiesInterface& props) : props_(props) {}
+            const int cell_;
+            Density(const BlackoilPropertiesInterface& props, const int cell)
+                : props_(props), cell_(cell) {}
             double operator()(const double pressure, const int phase)
             {
                 assert(props_.numPhases() == 2);
                 const double surfvol[2][2] = { { 1.0, 0.0 },
                                                { 0.0, 1.0 } };
-                // We do not handle multi-region PVT/EQUIL at this point.
-                const int* cells = 0;
+                // The cell selects the PVT region.
+                const int* cells = &cell_;
                 double A[4] = { 0.0 };
                 props_.matrix(1, &pressure, surfvol[phase], cells, A, 0);
                 double rho[2] = { 0.0 };
@@ -173,6 +233,112 @@ namespace Opm
             }
         };
 
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunneeded-internal-declaration"
+#endif /* __clang__ */
+        // Integrate the pressure ODE
+        //     dp/dz = \rho(p) g
+        // from (z0, p0) to z1 for a single phase, with the adaptive
+        // Bogacki-Shampine 3(2) Runge-Kutta scheme. The nodes, starting
+        // with (z0, p0), are appended to zv and pv, and dp/dz at the
+        // nodes to dv.
+        void integratePressure(Density& rho,
+                               const int phase,
+                               const double gravity,
+                               const double z0,
+                               const double p0,
+                               const double z1,
+                               std::vector<double>& zv,
+                               std::vector<double>& pv,
+                               std::vector<double>& dv)
+        {
+            const double rtol = 1e-8;
+            const double atol = 1e-3;
+            const int max_steps = 100000;
+
+            double z = z0;
+            double p = p0;
+            double f = rho(p, phase)*gravity;
+            zv.push_back(z);
+            pv.push_back(p);
+            dv.push_back(f);
+
+            double h = z1 - z0;
+            int num_steps = 0;
+            while (z != z1) {
+                if (++num_steps > max_steps) {
+                    OPM_THROW(std::runtime_error, "initHydrostaticPressure(): pressure integration did not converge.");
+                }
+                const bool last = std::fabs(h) >= std::fabs(z1 - z);
+                const double step = last ? z1 - z : h;
+                const double k2 = rho(p + 0.5*step*f, phase)*gravity;
+                const double k3 = rho(p + 0.75*step*k2, phase)*gravity;
+                const double p_new = p + step*(2.0/9.0*f + 1.0/3.0*k2 + 4.0/9.0*k3);
+                const double k4 = rho(p_new, phase)*gravity;
+                const double err = std::fabs(step*(-5.0/72.0*f + 1.0/12.0*k2
+                                                   + 1.0/9.0*k3 - 1.0/8.0*k4));
+                const double tol = atol + rtol*std::fabs(p_new);
+                if (err <= tol) {
+                    z = last ? z1 : z + step;
+                    p = p_new;
+                    f = k4;
+                    zv.push_back(z);
+                    pv.push_back(p);
+                    dv.push_back(f);
+                }
+                const double fac = err > 0.0 ? 0.9*std::pow(tol/err, 1.0/3.0) : 5.0;
+                h = step*std::min(5.0, std::max(0.2, fac));
+            }
+        }
+
+        // Integrate the pressure ODE from (z0, p0) to z1, switching
+        // between water (below) and oil (above) at the woc.
+        void integratePressure(Density& rho,
+                               const double woc,
+                               const double gravity,
+                               const double z0,
+                               const double p0,
+                               const double z1,
+                               std::vector<double>& zv,
+                               std::vector<double>& pv,
+                               std::vector<double>& dv)
+        {
+            if ((z0 - woc)*(z1 - woc) < 0.0) {
+                const int phase = z0 > woc ? 0 : 1;
+                integratePressure(rho, phase, gravity, z0, p0, woc, zv, pv, dv);
+                const double woc_p = pv.back();
+                integratePressure(rho, 1 - phase, gravity, woc, woc_p, z1, zv, pv, dv);
+            } else {
+                const int phase = 0.5*(z0 + z1) > woc ? 0 : 1;
+                integratePressure(rho, phase, gravity, z0, p0, z1, zv, pv, dv);
+            }
+        }
+
+        // Evaluate the cubic Hermite interpolant of nodes (zv, pv) with
+        // derivatives dv. The nodes must be sorted by z, and a node may
+        // be repeated where the derivative jumps.
+        double interpolatePressure(const std::vector<double>& zv,
+                                   const std::vector<double>& pv,
+                                   const std::vector<double>& dv,
+                                   const double z)
+        {
+            const int n = zv.size();
+            int i = int(std::upper_bound(zv.begin(), zv.end(), z) - zv.begin()) - 1;
+            i = std::max(0, std::min(i, n - 2));
+            const double h = zv[i + 1] - zv[i];
+            if (h == 0.0) {
+                return pv[i];
+            }
+            const double t = (z - zv[i])/h;
+            const double s = 1.0 - t;
+            return (1.0 + 2.0*t)*s*s*pv[i] + t*s*s*h*dv[i]
+                + t*t*(3.0 - 2.0*t)*pv[i + 1] - t*t*s*h*dv[i + 1];
+        }
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif /* __clang__ */
+
         // Initialize hydrostatic pressures depending only on gravity,
         // phase densities that may vary with pressure and a water-oil
         // contact depth. The pressure ODE is given as
@@ -180,9 +346,14 @@ namespace Opm
         // where rho is the oil density above the woc, water density
         // below woc. Note that even if there is (immobile) water in
         // the oil zone, it does not contribute to the pressure there.
+        // The ODE is solved with an adaptive step from the datum depth
+        // up and down to cover the given cells, and the pressure of
+        // each cell is interpolated from the solution.
+        // Only the pressures of the given cells are set.
         template <class State>
         void initHydrostaticPressure(const UnstructuredGrid& grid,
                                      const BlackoilPropertiesInterface& props,
+                                     const std::vector<int>& cells,
                                      const double woc,
                                      const double gravity,
                                      const double datum_z,
@@ -190,87 +361,56 @@ namespace Opm
                                      State& state)
         {
             assert(props.numPhases() == 2);
+            const int num_cells = cells.size();
+            if (num_cells == 0) {
+                return;
+            }
 
             // Obtain max and min z for which we will need to compute p.
-            const int num_cells = grid.number_of_cells;
             const int dim = grid.dimensions;
-            double zlim[2] = { 1e100, -1e100 };
-            for (int c = 0; c < num_cells; ++c) {
-                const double z = grid.cell_centroids[dim*c + dim - 1];
+            double zlim[2] = { datum_z, datum_z };
+            for (int i = 0; i < num_cells; ++i) {
+                const double z = grid.cell_centroids[dim*cells[i] + dim - 1];
                 zlim[0] = std::min(zlim[0], z);
                 zlim[1] = std::max(zlim[1], z);
             }
 
-            // We'll use a minimum stepsize of 1/100 of the z range.
-            const double hmin = (zlim[1] - zlim[0])/100.0;
-
-            // Store p(z) results in an associative array.
-            std::map<double, double> press_by_z;
-            press_by_z[datum_z] = datum_p;
-
             // Set up density evaluator.
-            Density rho(props);
-
-            // Solve the ODE from datum_z to woc.
-            int phase = (datum_z > woc) ? 0 : 1;
-            int num_steps = int(std::ceil(std::fabs(woc - datum_z)/hmin));
-            double pval = datum_p;
-            double zval = datum_z;
-            double h = (woc - datum_z)/double(num_steps);
-            for (int i = 0; i < num_steps; ++i) {
-                zval += h;
-                const double dp = rho(pval, phase)*gravity;
-                pval += h*dp;
-                press_by_z[zval] = pval;
-            }
-            double woc_p = pval;
-
-            // Solve the ODE from datum_z to the end of the interval.
-            double z_end = (datum_z > woc) ? zlim[1] : zlim[0];
-            num_steps = int(std::ceil(std::fabs(z_end - datum_z)/hmin));
-            pval = datum_p;
-            zval = datum_z;
-            h = (z_end - datum_z)/double(num_steps);
-            for (int i = 0; i < num_steps; ++i) {
-                zval += h;
-                const double dp = rho(pval, phase)*gravity;
-                pval += h*dp;
-                press_by_z[zval] = pval;
-            }
-
-            // Solve the ODE from woc to the other end of the interval.
-            // Switching phase and z_end.
-            phase = (phase + 1) % 2;
-            z_end = (datum_z > woc) ? zlim[0] : zlim[1];
-            pval = woc_p;
-            zval = woc;
-            h = (z_end - datum_z)/double(num_steps);
-            for (int i = 0; i < num_steps; ++i) {
-                zval += h;
-                const double dp = rho(pval, phase)*gravity;
-                pval += h*dp;
-                press_by_z[zval] = pval;
-            }
-
-            // Create monotone spline for interpolating solution.
-            std::vector<double> zv, pv;
-            zv.reserve(press_by_z.size());
-            pv.reserve(press_by_z.size());
-            for (std::map<double, double>::const_iterator it = press_by_z.begin();
-                 it != press_by_z.end(); ++it) {
-                zv.push_back(it->first);
-                pv.push_back(it->second);
-            }
-            MonotCubicInterpolator press(zv, pv);
+            Density rho(props, cells[0]);
+
+            // Solve the ODE from datum_z up to the top, and down to the
+            // bottom. The upward solution is reversed, so that the nodes
+            // are sorted by z.
+            std::vector<double> zv, pv, dv;
+            integratePressure(rho, woc, gravity, datum_z, datum_p, zlim[0], zv, pv, dv);
+            std::reverse(zv.begin(), zv.end());
+            std::reverse(pv.begin(), pv.end());
+            std::reverse(dv.begin(), dv.end());
+            integratePressure(rho, woc, gravity, datum_z, datum_p, zlim[1], zv, pv, dv);
 
             // Evaluate pressure at each cell centroid.
             std::vector<double>& p = state.pressure();
-            for (int c = 0; c < num_cells; ++c) {
+#pragma omp parallel for schedule(static)
+            for (int i = 0; i < num_cells; ++i) {
+                const int c = cells[i];
                 const double z = grid.cell_centroids[dim*c + dim - 1];
-                p[c] = press(z);
+                p[c] = interpolatePressure(zv, pv, dv, z);
             }
         }
 
+        // As above, for all cells.
+        template <class State>
+        void initHydrostaticPressure(const UnstructuredGrid& grid,
+                                     const BlackoilPropertiesInterface& props,
+                                     const double woc,
+                                     const double gravity,
+                                     const double datum_z,
+                                     const double datum_p,
+                                     State& state)
+        {
+            initHydrostaticPressure(grid, props, allCells(grid), woc, gravity, datum_z, datum_p, state);
+        }
+
         // Initialize face pressures to distance-weighted average of adjacent cell pressures.
         template <class State>
         void initFacePressure(const UnstructuredGrid& grid,
@@ -492,17 +632,41 @@ namespace Opm
             if (pu.phase_used[BlackoilPhases::Vapour]) {
                 OPM_THROW(std::runtime_error, "initStateFromDeck(): EQUIL-based init currently handling only oil-water scenario (no gas).");
             }
-            // Set saturations depending on oil-water contact.
+            // Equilibrate each region (EQLNUM) separately, using its
+            // own EQUIL record. Without EQLNUM, all cells are in region 1.
             const EQUIL& equil= deck.getEQUIL();
-            if (equil.equil.size() != 1) {
-                OPM_THROW(std::runtime_error, "initStateFromDeck(): No region support yet.");
+            const int num_regions = equil.equil.size();
+            const int num_cells = grid.number_of_cells;
+            std::vector<std::vector<int> > region_cells(num_regions);
+            if (deck.hasField("EQLNUM")) {
+                const std::vector<int>& eqlnum = deck.getIntegerValue("EQLNUM");
+                for (int c = 0; c < num_cells; ++c) {
+                    int c_deck = (grid.global_cell == NULL) ? c : grid.global_cell[c];
+                    const int region = eqlnum[c_deck] - 1;
+                    if (region < 0 || region >= num_regions) {
+                        OPM_THROW(std::runtime_error, "initStateFromDeck(): EQLNUM of cell " << c
+                                  << " is " << eqlnum[c_deck] << ", but there are "
+                                  << num_regions << " EQUIL records.");
+                    }
+                    region_cells[region].push_back(c);
+                }
+            } else {
+                region_cells[0] = allCells(grid);
+            }
+            for (int region = 0; region < num_regions; ++region) {
+                const std::vector<int>& cells = region_cells[region];
+                if (cells.empty()) {
+                    continue;
+                }
+                // Set saturations depending on oil-water contact.
+                const EquilLine& line = equil.equil[region];
+                const double woc = line.water_oil_contact_depth_;
+                initWaterOilContact(grid, props, cells, woc, WaterBelow, state);
+                // Set pressure depending on densities and depths.
+                const double datum_z = line.datum_depth_;
+                const double datum_p = line.datum_depth_pressure_;
+                initHydrostaticPressure(grid, props, cells, woc, gravity, datum_z, datum_p, state);
             }
-            const double woc = equil.equil[0].water_oil_contact_depth_;
-            initWaterOilContact(grid, props, woc, WaterBelow, state);
-            // Set pressure depending on densities and depths.
-            const double datum_z = equil.equil[0].datum_depth_;
-            const double datum_p = equil.equil[0].datum_depth_pressure_;
-            initHydrostaticPressure(grid, props, woc, gravity, datum_z, datum_p, state);
         } else if (deck.hasField("PRESSURE")) {
             // Set saturations from SWAT/SGAS, pressure from PRESSURE.
             std::vector<double>& s = state.saturation();
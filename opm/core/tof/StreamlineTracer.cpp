@@ -0,0 +1,389 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+#include <opm/core/tof/StreamlineTracer.hpp>
+#include <opm/core/grid.h>
+#include <opm/core/utility/ErrorMacros.hpp>
+#include <opm/core/utility/Profiler.hpp>
+#include <opm/core/utility/SparseTable.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Opm
+{
+
+
+    namespace
+    {
+        // Place num_seeds seeds on a face, in the given cell.
+        // A single seed is placed at the face centroid, otherwise the
+        // seeds are placed on rings around the centroid, on the lines
+        // towards the face nodes.
+        void placeSeeds(const UnstructuredGrid& grid,
+                        const int face,
+                        const int cell,
+                        const int source_cell,
+                        const int label,
+                        const double flux,
+                        const int num_seeds,
+                        std::vector<StreamlineTracer::Seed>& seeds)
+        {
+            const int dim = grid.dimensions;
+            const double* fc = grid.face_centroids + dim*face;
+            const int node_beg = grid.face_nodepos[face];
+            const int num_nodes = grid.face_nodepos[face + 1] - node_beg;
+            const int num_rings = (num_seeds + num_nodes - 1)/num_nodes;
+            StreamlineTracer::Seed seed;
+            seed.cell = cell;
+            seed.face = face;
+            seed.source_cell = source_cell;
+            seed.label = label;
+            seed.flux = flux/num_seeds;
+            std::fill(seed.point, seed.point + 3, 0.0);
+            for (int k = 0; k < num_seeds; ++k) {
+                if (num_seeds == 1) {
+                    std::copy(fc, fc + dim, seed.point);
+                } else {
+                    const int node = grid.face_nodes[node_beg + k % num_nodes];
+                    const double* nc = grid.node_coordinates + dim*node;
+                    const double r = double(k/num_nodes + 1)/double(num_rings + 1);
+                    for (int dd = 0; dd < dim; ++dd) {
+                        seed.point[dd] = fc[dd] + r*(nc[dd] - fc[dd]);
+                    }
+                }
+                seeds.push_back(seed);
+            }
+        }
+    } // anonymous namespace
+
+
+
+
+    /// Construct tracer.
+    /// \param[in] grid            A 2d or 3d grid.
+    /// \param[in] steps_per_cell  Number of integration steps to cross a cell.
+    /// \param[in] max_cells       Maximum number of cells of a single streamline.
+    StreamlineTracer::StreamlineTracer(const UnstructuredGrid& grid,
+                                       const int steps_per_cell,
+                                       const int max_cells)
+        : grid_(grid),
+          velocity_(grid),
+          steps_per_cell_(steps_per_cell),
+          max_cells_(max_cells),
+          cell_size_(grid.number_of_cells)
+    {
+        if (steps_per_cell_ < 1) {
+            OPM_THROW(std::runtime_error, "StreamlineTracer: steps_per_cell must be positive, got " << steps_per_cell_);
+        }
+        const double inv_dim = 1.0/grid.dimensions;
+        for (int c = 0; c < grid.number_of_cells; ++c) {
+            cell_size_[c] = std::pow(grid.cell_volumes[c], inv_dim);
+        }
+    }
+
+
+
+
+    /// Create seeds on the outflow faces of some cells.
+    void StreamlineTracer::seedsFromCells(const double* darcyflux,
+                                          const SparseTable<int>& heads,
+                                          const int seeds_per_face,
+                                          std::vector<Seed>& seeds) const
+    {
+        seeds.clear();
+        for (int label = 0; label < heads.size(); ++label) {
+            for (int i = 0; i < heads.rowSize(label); ++i) {
+                const int cell = heads[label][i];
+                for (int hface = grid_.cell_facepos[cell]; hface < grid_.cell_facepos[cell + 1]; ++hface) {
+                    const int face = grid_.cell_faces[hface];
+                    const bool first = grid_.face_cells[2*face] == cell;
+                    const double outflux = first ? darcyflux[face] : -darcyflux[face];
+                    const int downstream = grid_.face_cells[2*face + (first ? 1 : 0)];
+                    if (outflux > 0.0 && downstream >= 0) {
+                        placeSeeds(grid_, face, downstream, cell, label, outflux, seeds_per_face, seeds);
+                    }
+                }
+            }
+        }
+    }
+
+
+
+
+    /// Create seeds on some faces.
+    void StreamlineTracer::seedsFromFaces(const double* darcyflux,
+                                          const SparseTable<int>& faces,
+                                          const int seeds_per_face,
+                                          std::vector<Seed>& seeds) const
+    {
+        seeds.clear();
+        for (int label = 0; label < faces.size(); ++label) {
+            for (int i = 0; i < faces.rowSize(label); ++i) {
+                const int face = faces[label][i];
+                const double flux = darcyflux[face];
+                if (flux == 0.0) {
+                    continue;
+                }
+                const int downstream = grid_.face_cells[2*face + (flux > 0.0 ? 1 : 0)];
+                if (downstream >= 0) {
+                    placeSeeds(grid_, face, downstream, -1, label, std::fabs(flux), seeds_per_face, seeds);
+                }
+            }
+        }
+    }
+
+
+
+
+    /// Trace streamlines from the given seeds.
+    void StreamlineTracer::trace(const double* darcyflux,
+                                 const double* porevolume,
+                                 const double* source,
+                                 const std::vector<Seed>& seeds,
+                                 std::vector<Streamline>& lines)
+    {
+        OPM_PROFILE_SCOPE("streamline/trace");
+        const int nc = grid_.number_of_cells;
+        velocity_.setupFluxes(darcyflux);
+        porosity_.resize(nc);
+        sink_inflow_.assign(nc, 0.0);
+        for (int c = 0; c < nc; ++c) {
+            porosity_[c] = porevolume[c]/grid_.cell_volumes[c];
+            if (source && source[c] < 0.0) {
+                double inflow = 0.0;
+                for (int hface = grid_.cell_facepos[c]; hface < grid_.cell_facepos[c + 1]; ++hface) {
+                    const int face = grid_.cell_faces[hface];
+                    const double influx = grid_.face_cells[2*face] == c ? -darcyflux[face] : darcyflux[face];
+                    inflow += std::max(influx, 0.0);
+                }
+                sink_inflow_[c] = inflow;
+            }
+        }
+
+        const int num_seeds = seeds.size();
+        lines.resize(num_seeds);
+#pragma omp parallel for schedule(dynamic, 16)
+        for (int s = 0; s < num_seeds; ++s) {
+            traceOne(seeds[s], lines[s]);
+        }
+    }
+
+
+
+
+    /// Map streamline results to cells.
+    void StreamlineTracer::mapToCells(const std::vector<Streamline>& lines,
+                                      const int num_labels,
+                                      std::vector<double>& tof,
+                                      std::vector<double>& tracer) const
+    {
+        const int nc = grid_.number_of_cells;
+        tof.assign(nc, 0.0);
+        tracer.assign(nc*num_labels, 0.0);
+        // Each streamline segment is weighted by the pore volume it
+        // sweeps, flux*(tof_out - tof_in), so that lines cutting a
+        // corner of a cell count less than lines crossing it. Cells
+        // where all segments have zero volume use flux weights.
+        std::vector<double> weight(nc, 0.0);
+        std::vector<double> vol_weight(nc, 0.0);
+        std::vector<double> vol_tof(nc, 0.0);
+        std::vector<double> vol_tracer(nc*num_labels, 0.0);
+        for (std::size_t l = 0; l < lines.size(); ++l) {
+            const Streamline& line = lines[l];
+            if (line.label >= num_labels) {
+                OPM_THROW(std::runtime_error, "Streamline label " << line.label
+                          << " out of range, number of labels is " << num_labels);
+            }
+            for (std::size_t i = 0; i < line.cells.size(); ++i) {
+                const int cell = line.cells[i];
+                const double mean_tof = 0.5*(line.tof_in[i] + line.tof_out[i]);
+                const double vol = line.flux*(line.tof_out[i] - line.tof_in[i]);
+                tof[cell] += line.flux*mean_tof;
+                weight[cell] += line.flux;
+                vol_tof[cell] += vol*mean_tof;
+                vol_weight[cell] += vol;
+                if (line.label >= 0) {
+                    tracer[cell*num_labels + line.label] += line.flux;
+                    vol_tracer[cell*num_labels + line.label] += vol;
+                }
+            }
+        }
+        for (int c = 0; c < nc; ++c) {
+            if (vol_weight[c] > 0.0) {
+                tof[c] = vol_tof[c]/vol_weight[c];
+                for (int l = 0; l < num_labels; ++l) {
+                    tracer[c*num_labels + l] = vol_tracer[c*num_labels + l]/vol_weight[c];
+                }
+            } else if (weight[c] > 0.0) {
+                tof[c] /= weight[c];
+                for (int l = 0; l < num_labels; ++l) {
+                    tracer[c*num_labels + l] /= weight[c];
+                }
+            } else {
+                tof[c] = -1.0;
+            }
+        }
+
+        // Source cells not passed by any streamline.
+        std::vector<double> source_weight(nc, 0.0);
+        for (std::size_t l = 0; l < lines.size(); ++l) {
+            const Streamline& line = lines[l];
+            const int cell = line.source_cell;
+            if (cell >= 0 && weight[cell] == 0.0) {
+                source_weight[cell] += line.flux;
+                if (line.label >= 0) {
+                    tracer[cell*num_labels + line.label] += line.flux;
+                }
+            }
+        }
+        for (int c = 0; c < nc; ++c) {
+            if (source_weight[c] > 0.0) {
+                tof[c] = 0.0;
+                for (int l = 0; l < num_labels; ++l) {
+                    tracer[c*num_labels + l] /= source_weight[c];
+                }
+            }
+        }
+    }
+
+
+
+
+    // Signed distance from x to the plane of a face, positive
+    // outside the cell.
+    double StreamlineTracer::faceDistance(const int cell, const int face, const double* x) const
+    {
+        const int dim = grid_.dimensions;
+        const double* fc = grid_.face_centroids + dim*face;
+        const double* fn = grid_.face_normals + dim*face;
+        double d = 0.0;
+        for (int dd = 0; dd < dim; ++dd) {
+            d += (x[dd] - fc[dd])*fn[dd];
+        }
+        d /= grid_.face_areas[face];
+        return grid_.face_cells[2*face] == cell ? d : -d;
+    }
+
+
+
+
+    // Trace a single streamline. Only reads shared data, so several
+    // streamlines may be traced at once.
+    void StreamlineTracer::traceOne(const Seed& seed, Streamline& line) const
+    {
+        const int dim = grid_.dimensions;
+        const int max_steps = 20*steps_per_cell_;
+        line.label = seed.label;
+        line.flux = seed.flux;
+        line.source_cell = seed.source_cell;
+        line.cells.clear();
+        line.tof_in.clear();
+        line.tof_out.clear();
+        line.points.assign(seed.point, seed.point + dim);
+
+        double x[3], x1[3], xn[3], v[3], v1[3];
+        std::copy(seed.point, seed.point + 3, x);
+        int cell = seed.cell;
+        int entry_face = seed.face;
+        double tof = 0.0;
+        for (int count = 0; count < max_cells_ && cell >= 0; ++count) {
+            line.cells.push_back(cell);
+            line.tof_in.push_back(tof);
+
+            // Streamlines end in sinks, after the mean residence time.
+            if (sink_inflow_[cell] > 0.0) {
+                tof += porosity_[cell]*grid_.cell_volumes[cell]/sink_inflow_[cell];
+                line.tof_out.push_back(tof);
+                line.points.insert(line.points.end(), x, x + dim);
+                break;
+            }
+
+            const double phi = porosity_[cell];
+            const double size = cell_size_[cell];
+            const int face_beg = grid_.cell_facepos[cell];
+            const int face_end = grid_.cell_facepos[cell + 1];
+            int exit_face = -1;
+            for (int step = 0; step < max_steps && exit_face < 0; ++step) {
+                velocity_.interpolate(cell, x, v);
+                double speed = 0.0;
+                for (int dd = 0; dd < dim; ++dd) {
+                    speed += v[dd]*v[dd];
+                }
+                speed = std::sqrt(speed);
+                if (!(speed > 0.0)) {
+                    break;
+                }
+                const double h = size/(steps_per_cell_*speed);
+
+                // Heun's method, falling back to an Euler step if the
+                // predictor leaves the cell.
+                for (int dd = 0; dd < dim; ++dd) {
+                    x1[dd] = x[dd] + h*v[dd];
+                }
+                bool inside = true;
+                for (int hface = face_beg; hface < face_end && inside; ++hface) {
+                    inside = faceDistance(cell, grid_.cell_faces[hface], x1) <= 0.0;
+                }
+                if (inside) {
+                    velocity_.interpolate(cell, x1, v1);
+                    for (int dd = 0; dd < dim; ++dd) {
+                        xn[dd] = x[dd] + 0.5*h*(v[dd] + v1[dd]);
+                    }
+                } else {
+                    std::copy(x1, x1 + dim, xn);
+                }
+
+                // Find the first face plane the step crosses going outwards.
+                double frac = 1.0;
+                for (int hface = face_beg; hface < face_end; ++hface) {
+                    const int face = grid_.cell_faces[hface];
+                    const double d0 = faceDistance(cell, face, x);
+                    const double d1 = faceDistance(cell, face, xn);
+                    if (d1 > 0.0 && d1 > d0) {
+                        const double f = d0 >= 0.0 ? 0.0 : -d0/(d1 - d0);
+                        if (exit_face < 0 || f < frac) {
+                            frac = f;
+                            exit_face = face;
+                        }
+                    }
+                }
+                for (int dd = 0; dd < dim; ++dd) {
+                    x[dd] += frac*(xn[dd] - x[dd]);
+                }
+                tof += phi*frac*h;
+            }
+            line.tof_out.push_back(tof);
+            line.points.insert(line.points.end(), x, x + dim);
+
+            // Stop if stagnant, or if the flow reverses across the
+            // entry face.
+            if (exit_face < 0 || exit_face == entry_face) {
+                break;
+            }
+            cell = grid_.face_cells[2*exit_face] == cell
+                ? grid_.face_cells[2*exit_face + 1]
+                : grid_.face_cells[2*exit_face];
+            entry_face = exit_face;
+        }
+    }
+
+
+} // namespace Opm
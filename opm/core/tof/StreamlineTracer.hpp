@@ -0,0 +1,164 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_STREAMLINETRACER_HEADER_INCLUDED
+#define OPM_STREAMLINETRACER_HEADER_INCLUDED
+
+#include <opm/core/utility/VelocityInterpolation.hpp>
+#include <vector>
+
+struct UnstructuredGrid;
+
+namespace Opm
+{
+
+    template <typename T> class SparseTable;
+
+    /// Traces streamlines through a 2d or 3d grid, and computes
+    /// time-of-flight and tracer labels along them.
+    ///
+    /// The velocity inside each cell is given by the extended CVI
+    /// interpolation of the face fluxes (VelocityInterpolationECVI).
+    /// Each streamline is integrated with Heun's method, with a time
+    /// step chosen to take a given number of steps to cross a cell.
+    /// When a step leaves the cell, it is cut where it crosses the
+    /// plane of a cell face, and tracing continues in the neighbour
+    /// across that face. Time-of-flight grows as
+    ///     \f[d\tau = \phi\, dt,\quad dx/dt = v,\f]
+    /// with \f$ v \f$ the Darcy velocity and \f$ \phi \f$ the porosity.
+    ///
+    /// Streamlines are traced in parallel (OpenMP) over the seeds. To
+    /// trace backwards, for example from producers, pass negated
+    /// fluxes and sources.
+    class StreamlineTracer
+    {
+    public:
+        /// A starting point of a streamline.
+        struct Seed
+        {
+            int cell;           // Cell containing the point.
+            int face;           // Face the point lies on, or -1.
+            int source_cell;    // Cell the streamline represents outflow from, or -1.
+            int label;          // Tracer label, or -1 for none.
+            double flux;        // Flux carried by the streamline.
+            double point[3];    // Coordinates, grid.dimensions are used.
+        };
+
+        /// A traced streamline.
+        struct Streamline
+        {
+            int label;                  // Label of its seed.
+            double flux;                // Flux of its seed.
+            int source_cell;            // Source cell of its seed.
+            std::vector<int> cells;     // Cells passed through, in order.
+            std::vector<double> tof_in; // Time-of-flight entering each cell.
+            std::vector<double> tof_out;// Time-of-flight leaving each cell.
+            std::vector<double> points; // Seed point and exit point of each
+                                        // cell, grid.dimensions per point.
+        };
+
+        /// Construct tracer.
+        /// \param[in] grid            A 2d or 3d grid.
+        /// \param[in] steps_per_cell  Number of integration steps to cross a cell.
+        /// \param[in] max_cells       Maximum number of cells of a single streamline.
+        explicit StreamlineTracer(const UnstructuredGrid& grid,
+                                  const int steps_per_cell = 4,
+                                  const int max_cells = 100000);
+
+        /// Create seeds on the outflow faces of some cells, typically
+        /// those perforated by injection wells.
+        /// Each outflow face gets seeds_per_face seeds, spread over the
+        /// face, in the cell downstream of the face. The flux of the
+        /// face is divided equally between them.
+        /// \param[in]  darcyflux       Array of signed face fluxes.
+        /// \param[in]  heads           Table containing one row per label, and each
+        ///                             row contains the source cells for that label.
+        /// \param[in]  seeds_per_face  Number of seeds on each outflow face.
+        /// \param[out] seeds           The seeds.
+        void seedsFromCells(const double* darcyflux,
+                            const SparseTable<int>& heads,
+                            const int seeds_per_face,
+                            std::vector<Seed>& seeds) const;
+
+        /// Create seeds on some faces, for example those of an inflow
+        /// boundary. Faces without flow into a cell are skipped.
+        /// \param[in]  darcyflux       Array of signed face fluxes.
+        /// \param[in]  faces           Table containing one row per label, and each
+        ///                             row contains faces for that label.
+        /// \param[in]  seeds_per_face  Number of seeds on each face.
+        /// \param[out] seeds           The seeds.
+        void seedsFromFaces(const double* darcyflux,
+                            const SparseTable<int>& faces,
+                            const int seeds_per_face,
+                            std::vector<Seed>& seeds) const;
+
+        /// Trace streamlines from the given seeds.
+        /// A streamline ends at a sink cell, on the boundary, or when
+        /// it stagnates or reverses across a face.
+        /// \param[in]  darcyflux   Array of signed face fluxes.
+        /// \param[in]  porevolume  Array of pore volumes.
+        /// \param[in]  source      Source term, may be null. Sign convention is:
+        ///                           (+) inflow flux,
+        ///                           (-) outflow flux.
+        /// \param[in]  seeds       Starting points.
+        /// \param[out] lines       One streamline per seed.
+        void trace(const double* darcyflux,
+                   const double* porevolume,
+                   const double* source,
+                   const std::vector<Seed>& seeds,
+                   std::vector<Streamline>& lines);
+
+        /// Map streamline results to cells.
+        /// The time-of-flight of a cell is the average of the mean
+        /// time-of-flight of the streamlines passing it, weighted by
+        /// the pore volume each streamline sweeps in the cell, that is
+        /// its flux times its time-of-flight increment. The tracer
+        /// values are the fraction of that volume swept by streamlines
+        /// of each label. Cells where the swept volume is zero use the
+        /// streamline fluxes as weights instead. Source cells of seeds
+        /// that are not passed by any streamline get zero
+        /// time-of-flight and the labels of those seeds. Other cells
+        /// not passed by any streamline get time-of-flight -1 and zero
+        /// tracer values.
+        /// \param[in]  lines       Traced streamlines.
+        /// \param[in]  num_labels  Number of labels.
+        /// \param[out] tof         Array of time-of-flight values (1 per cell).
+        /// \param[out] tracer      Array of tracer values, num_labels per cell.
+        void mapToCells(const std::vector<Streamline>& lines,
+                        const int num_labels,
+                        std::vector<double>& tof,
+                        std::vector<double>& tracer) const;
+
+    private:
+        void traceOne(const Seed& seed, Streamline& line) const;
+        double faceDistance(const int cell, const int face, const double* x) const;
+
+        const UnstructuredGrid& grid_;
+        VelocityInterpolationECVI velocity_;
+        int steps_per_cell_;
+        int max_cells_;
+        std::vector<double> cell_size_;
+        // Set up by trace().
+        std::vector<double> porosity_;
+        std::vector<double> sink_inflow_;
+    };
+
+} // namespace Opm
+
+#endif // OPM_STREAMLINETRACER_HEADER_INCLUDED
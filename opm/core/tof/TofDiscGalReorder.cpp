@@ -30,6 +30,7 @@
 #include <opm/core/linalg/blas_lapack.h>
 
 #include <algorithm>
+#include <functional>
 #include <cmath>
 #include <numeric>
 #include <iostream>
@@ -48,7 +49,6 @@ namespace Opm
           limiter_method_(MinUpwindAverage),
           limiter_usage_(DuringComputations),
           coord_(grid.dimensions),
-          velocity_(grid.dimensions),
           gauss_seidel_tol_(1e-3)
     {
         const int dg_degree = param.getDefault("dg_degree", 0);
@@ -60,6 +60,7 @@ namespace Opm
         }
 
         use_cvi_ = param.getDefault("use_cvi", use_cvi_);
+        gauss_seidel_tol_ = param.getDefault("gauss_seidel_tol", gauss_seidel_tol_);
         use_limiter_ = param.getDefault("use_limiter", use_limiter_);
         if (use_limiter_) {
             limiter_relative_flux_threshold_ = param.getDefault("limiter_relative_flux_threshold",
@@ -105,54 +106,10 @@ namespace Opm
                                      const double* source,
                                      std::vector<double>& tof_coeff)
     {
-        darcyflux_ = darcyflux;
         porevolume_ = porevolume;
-        source_ = source;
-#ifndef NDEBUG
-        // Sanity check for sources.
-        const double cum_src = std::accumulate(source, source + grid_.number_of_cells, 0.0);
-        if (std::fabs(cum_src) > *std::max_element(source, source + grid_.number_of_cells)*1e-2) {
-            // OPM_THROW(std::runtime_error, "Sources do not sum to zero: " << cum_src);
-            OPM_MESSAGE("Warning: sources do not sum to zero: " << cum_src);
-        }
-#endif
-        const int num_basis = basis_func_->numBasisFunc();
-        tof_coeff.resize(num_basis*grid_.number_of_cells);
-        std::fill(tof_coeff.begin(), tof_coeff.end(), 0.0);
-        tof_coeff_ = &tof_coeff[0];
-        rhs_.resize(num_basis);
-        jac_.resize(num_basis*num_basis);
-        orig_jac_.resize(num_basis*num_basis);
-        basis_.resize(num_basis);
-        basis_nb_.resize(num_basis);
-        grad_basis_.resize(num_basis*grid_.dimensions);
-        velocity_interpolation_->setupFluxes(darcyflux);
-        num_tracers_ = 0;
-        num_multicell_ = 0;
-        max_size_multicell_ = 0;
-        max_iter_multicell_ = 0;
-        num_singlesolves_ = 0;
-        reorderAndTransport(grid_, darcyflux);
-        switch (limiter_usage_) {
-        case AsPostProcess:
-            applyLimiterAsPostProcess();
-            break;
-        case AsSimultaneousPostProcess:
-            applyLimiterAsSimultaneousPostProcess();
-            break;
-        case DuringComputations:
-            // Do nothing.
-            break;
-        default:
-            OPM_THROW(std::runtime_error, "Unknown limiter usage choice: " << limiter_usage_);
-        }
-        if (num_multicell_ > 0) {
-            std::cout << num_multicell_ << " multicell blocks with max size "
-                      << max_size_multicell_ << " cells in upto "
-                      << max_iter_multicell_ << " iterations." << std::endl;
-            std::cout << "Average solves per cell (for all cells) was "
-                      << double(num_singlesolves_)/double(grid_.number_of_cells) << std::endl;
-        }
+        std::vector<double> no_tracer;
+        reorder(grid_, darcyflux);
+        solveInSequence(darcyflux, source, 0, tof_coeff, no_tracer, false);
     }
 
 
@@ -183,8 +140,58 @@ namespace Opm
                                            std::vector<double>& tof_coeff,
                                            std::vector<double>& tracer_coeff)
     {
-        darcyflux_ = darcyflux;
         porevolume_ = porevolume;
+        reorder(grid_, darcyflux);
+        solveInSequence(darcyflux, source, &tracerheads, tof_coeff, tracer_coeff, false);
+    }
+
+
+
+
+    /// Solve for forward and backward time-of-flight, and for
+    /// injector and producer tracers, using a single reordering.
+    void TofDiscGalReorder::solveTofTracerForwardBackward(const double* darcyflux,
+                                                          const double* porevolume,
+                                                          const double* source,
+                                                          const SparseTable<int>& injectorheads,
+                                                          const SparseTable<int>& producerheads,
+                                                          std::vector<double>& forward_tof_coeff,
+                                                          std::vector<double>& forward_tracer_coeff,
+                                                          std::vector<double>& backward_tof_coeff,
+                                                          std::vector<double>& backward_tracer_coeff)
+    {
+        porevolume_ = porevolume;
+        reorder(grid_, darcyflux);
+
+        // Forward problem.
+        solveInSequence(darcyflux, source, &injectorheads,
+                        forward_tof_coeff, forward_tracer_coeff, false);
+
+        // Backward problem, using the reversed ordering.
+        reversed_flux_.resize(grid_.number_of_faces);
+        reversed_source_.resize(grid_.number_of_cells);
+        std::transform(darcyflux, darcyflux + grid_.number_of_faces,
+                       reversed_flux_.begin(), std::negate<double>());
+        std::transform(source, source + grid_.number_of_cells,
+                       reversed_source_.begin(), std::negate<double>());
+        solveInSequence(&reversed_flux_[0], &reversed_source_[0], &producerheads,
+                        backward_tof_coeff, backward_tracer_coeff, true);
+    }
+
+
+
+
+    // Solve using the ordering from the last reorder() call, which
+    // must have been computed from darcyflux (or its negation, if
+    // reverse is true). A null tracerheads means no tracers.
+    void TofDiscGalReorder::solveInSequence(const double* darcyflux,
+                                            const double* source,
+                                            const SparseTable<int>* tracerheads,
+                                            std::vector<double>& tof_coeff,
+                                            std::vector<double>& tracer_coeff,
+                                            const bool reverse)
+    {
+        darcyflux_ = darcyflux;
         source_ = source;
 #ifndef NDEBUG
         // Sanity check for sources.
@@ -195,7 +202,7 @@ namespace Opm
         }
 #endif
         const int num_basis = basis_func_->numBasisFunc();
-        num_tracers_ = tracerheads.size();
+        num_tracers_ = tracerheads ? tracerheads->size() : 0;
         tof_coeff.resize(num_basis*grid_.number_of_cells);
         std::fill(tof_coeff.begin(), tof_coeff.end(), 0.0);
         tof_coeff_ = &tof_coeff[0];
@@ -205,6 +212,8 @@ namespace Opm
         basis_.resize(num_basis);
         basis_nb_.resize(num_basis);
         grad_basis_.resize(num_basis*grid_.dimensions);
+        tracer_upstream_.resize(num_tracers_);
+        tracer_average_.resize(num_tracers_);
         velocity_interpolation_->setupFluxes(darcyflux);
 
         // Set up tracer
@@ -215,23 +224,23 @@ namespace Opm
             tracerhead_by_cell_.resize(grid_.number_of_cells, NoTracerHead);
         }
         for (int tr = 0; tr < num_tracers_; ++tr) {
-            for (int i = 0; i < tracerheads[tr].size(); ++i) {
-                const int cell = tracerheads[tr][i];
+            for (int i = 0; i < (*tracerheads)[tr].size(); ++i) {
+                const int cell = (*tracerheads)[tr][i];
                 basis_func_->addConstant(1.0, &tracer_coeff[cell*num_tracers_*num_basis + tr*num_basis]);
                 tracer_coeff[cell*num_tracers_ + tr] = 1.0;
                 tracerhead_by_cell_[cell] = tr;
             }
         }
 
-        tracer_coeff_ = &tracer_coeff[0];
+        tracer_coeff_ = num_tracers_ > 0 ? &tracer_coeff[0] : 0;
         num_multicell_ = 0;
         max_size_multicell_ = 0;
         max_iter_multicell_ = 0;
         num_singlesolves_ = 0;
-        reorderAndTransport(grid_, darcyflux);
+        transportInSequence(reverse);
         switch (limiter_usage_) {
         case AsPostProcess:
-            applyLimiterAsPostProcess();
+            applyLimiterAsPostProcess(reverse);
             break;
         case AsSimultaneousPostProcess:
             applyLimiterAsSimultaneousPostProcess();
@@ -339,15 +348,23 @@ namespace Opm
                 for (int j = 0; j < num_basis; ++j) {
                     rhs_[j] -= w * tof_upstream * normal_velocity * basis_[j];
                 }
-                // Modify tracer rhs
+                // Modify tracer rhs. The upstream tracer coefficients form a
+                // (num_basis x num_tracers_) matrix U, and the tracer part of
+                // rhs_ is a matrix R of the same shape, so this is
+                //   t = U^T b_nb,   R -= w v_n b t^T
+                // done for all tracers at once.
                 if (num_tracers_ && tracerhead_by_cell_[cell] == NoTracerHead) {
-                    for (int tr = 0; tr < num_tracers_; ++tr) {
-                        const double* up_tr_co = tracer_coeff_ + num_tracers_*num_basis*upstream_cell + num_basis*tr;
-                        const double tracer_up = std::inner_product(basis_nb_.begin(), basis_nb_.end(), up_tr_co, 0.0);
-                        for (int j = 0; j < num_basis; ++j) {
-                            rhs_[num_basis*(tr + 1) + j] -= w * tracer_up * normal_velocity * basis_[j];
-                        }
-                    }
+                    const MAT_SIZE_T nb = num_basis;
+                    const MAT_SIZE_T ntr = num_tracers_;
+                    const MAT_SIZE_T incr = 1;
+                    const double one = 1.0;
+                    const double zero = 0.0;
+                    const double scale = -w * normal_velocity;
+                    const double* up_tr_co = tracer_coeff_ + num_tracers_*num_basis*upstream_cell;
+                    dgemv_("T", &nb, &ntr, &one, up_tr_co, &nb, &basis_nb_[0], &incr,
+                           &zero, &tracer_upstream_[0], &incr);
+                    dger_(&nb, &ntr, &scale, &basis_[0], &incr, &tracer_upstream_[0], &incr,
+                          &rhs_[num_basis], &nb);
                 }
             }
         }
@@ -366,17 +383,25 @@ namespace Opm
             // const int deg_needed = 2*basis_func_->degree() - 1;
             const int deg_needed = 2*basis_func_->degree();
             CellQuadrature quad(grid_, cell, deg_needed);
-            for (int quad_pt = 0; quad_pt < quad.numQuadPts(); ++quad_pt) {
+            // Interpolate the velocity at all quadrature points at once.
+            const int num_quad_pts = quad.numQuadPts();
+            quad_coord_.resize(dim*num_quad_pts);
+            quad_velocity_.resize(dim*num_quad_pts);
+            for (int quad_pt = 0; quad_pt < num_quad_pts; ++quad_pt) {
+                quad.quadPtCoord(quad_pt, &quad_coord_[dim*quad_pt]);
+            }
+            velocity_interpolation_->interpolateInCell(cell, num_quad_pts, &quad_coord_[0], &quad_velocity_[0]);
+            for (int quad_pt = 0; quad_pt < num_quad_pts; ++quad_pt) {
                 // b_i (v \cdot \grad b_j)
-                quad.quadPtCoord(quad_pt, &coord_[0]);
-                basis_func_->eval(cell, &coord_[0], &basis_[0]);
-                basis_func_->evalGrad(cell, &coord_[0], &grad_basis_[0]);
-                velocity_interpolation_->interpolate(cell, &coord_[0], &velocity_[0]);
+                const double* coord = &quad_coord_[dim*quad_pt];
+                const double* velocity = &quad_velocity_[dim*quad_pt];
+                basis_func_->eval(cell, coord, &basis_[0]);
+                basis_func_->evalGrad(cell, coord, &grad_basis_[0]);
                 const double w = quad.quadPtWeight(quad_pt);
                 for (int j = 0; j < num_basis; ++j) {
                     for (int i = 0; i < num_basis; ++i) {
                         for (int dd = 0; dd < dim; ++dd) {
-                            jac_[j*num_basis + i] -= w * basis_[j] * grad_basis_[dim*i + dd] * velocity_[dd];
+                            jac_[j*num_basis + i] -= w * basis_[j] * grad_basis_[dim*i + dd] * velocity[dd];
                         }
                     }
                 }
@@ -479,23 +504,25 @@ namespace Opm
         // Apply limiter.
         if (basis_func_->degree() > 0 && use_limiter_ && limiter_usage_ == DuringComputations) {
 #ifdef EXTRA_VERBOSE
+            // Velocity at the last quadrature point of the cell.
+            const std::vector<double> vel_last(quad_velocity_.end() - dim, quad_velocity_.end());
             std::cout << "Cell: " << cell << "   ";
             std::cout << "v = ";
             for (int dd = 0; dd < dim; ++dd) {
-                std::cout << velocity_[dd] << ' ';
+                std::cout << vel_last[dd] << ' ';
             }
             std::cout << "     grad tau = ";
             for (int dd = 0; dd < dim; ++dd) {
                 std::cout << tof_coeff_[num_basis*cell + dd + 1] << ' ';
             }
-            const double prod = std::inner_product(velocity_.begin(), velocity_.end(),
+            const double prod = std::inner_product(vel_last.begin(), vel_last.end(),
                                                    tof_coeff_ + num_basis*cell + 1, 0.0);
-            const double vv = std::inner_product(velocity_.begin(), velocity_.end(),
-                                                 velocity_.begin(), 0.0);
+            const double vv = std::inner_product(vel_last.begin(), vel_last.end(),
+                                                 vel_last.begin(), 0.0);
             const double gg = std::inner_product(tof_coeff_ + num_basis*cell + 1,
                                                  tof_coeff_ + num_basis*cell + num_basis,
                                                  tof_coeff_ + num_basis*cell + 1, 0.0);
-            std::cout << "     prod = " << std::inner_product(velocity_.begin(), velocity_.end(),
+            std::cout << "     prod = " << std::inner_product(vel_last.begin(), vel_last.end(),
                                                               tof_coeff_ + num_basis*cell + 1, 0.0);
             std::cout << "     normalized = " << prod/std::sqrt(vv*gg);
             std::cout << "     angle = " << std::acos(prod/std::sqrt(vv*gg))*360.0/(2.0*M_PI);
@@ -511,7 +538,7 @@ namespace Opm
 
         // Ensure that tracer averages sum to 1.
         if (num_tracers_ && tracerhead_by_cell_[cell] == NoTracerHead) {
-            std::vector<double> tr_aver(num_tracers_);
+            std::vector<double>& tr_aver = tracer_average_;
             double tr_sum = 0.0;
             for (int tr = 0; tr < num_tracers_; ++tr) {
                 const double* local_basis = tracer_coeff_ + cell*num_tracers_*num_basis + tr*num_basis;
@@ -667,7 +694,7 @@ namespace Opm
 
 
 
-    void TofDiscGalReorder::applyLimiterAsPostProcess()
+    void TofDiscGalReorder::applyLimiterAsPostProcess(const bool reverse)
     {
         // Apply the limiter sequentially to all cells.
         // This means that a cell's limiting behaviour may be affected by
@@ -676,7 +703,7 @@ namespace Opm
         const int nc = seq.size();
         assert(nc == grid_.number_of_cells);
         for (int i = 0; i < nc; ++i) {
-            const int cell = seq[i];
+            const int cell = reverse ? seq[nc - 1 - i] : seq[i];
             applyLimiter(cell, tof_coeff_);
         }
     }
@@ -57,6 +57,8 @@ namespace Opm
         ///   - \c use_tensorial_basis (false)             -- Use tensor-product basis, interpreting dg_degree as
         ///                                                   bi/tri-degree not total degree.
         ///   - \c use_cvi (false)                         -- Use ECVI velocity interpolation.
+        ///   - \c gauss_seidel_tol (1e-3)                 -- Tolerance for the change in cell average tof
+        ///                                                   in Gauss-Seidel iterations over multi-cell blocks.
         ///   - \c use_limiter (false)                     -- Use a slope limiter. If true, the next three parameters are used.
         ///   - \c limiter_relative_flux_threshold (1e-3)  -- Ignore upstream fluxes below this threshold,
         ///                                                   relative to total cell flux.
@@ -117,7 +119,46 @@ namespace Opm
                             std::vector<double>& tof_coeff,
                             std::vector<double>& tracer_coeff);
 
+        /// Solve for forward and backward time-of-flight, and for
+        /// injector and producer tracers, using a single reordering.
+        /// The backward problem is the forward problem with all
+        /// fluxes and sources negated. Its ordering is obtained by
+        /// traversing the forward ordering in reverse, so the upwind
+        /// graph and topological sort are only computed once.
+        /// \param[in]  darcyflux         Array of signed face fluxes.
+        /// \param[in]  porevolume        Array of pore volumes.
+        /// \param[in]  source            Source term. Sign convention is:
+        ///                                 (+) inflow flux,
+        ///                                 (-) outflow flux.
+        /// \param[in]  injectorheads     Table containing one row per forward tracer,
+        ///                               each row contains the source cells for that
+        ///                               tracer. May be empty.
+        /// \param[in]  producerheads     Table containing one row per backward tracer,
+        ///                               each row contains the sink cells for that
+        ///                               tracer. May be empty.
+        /// \param[out] forward_tof_coeff      Forward time-of-flight coefficients,
+        ///                                    ordered as for solveTof().
+        /// \param[out] forward_tracer_coeff   Forward tracer coefficients, ordered
+        ///                                    as for solveTofTracer().
+        /// \param[out] backward_tof_coeff     Backward time-of-flight coefficients.
+        /// \param[out] backward_tracer_coeff  Backward tracer coefficients.
+        void solveTofTracerForwardBackward(const double* darcyflux,
+                                           const double* porevolume,
+                                           const double* source,
+                                           const SparseTable<int>& injectorheads,
+                                           const SparseTable<int>& producerheads,
+                                           std::vector<double>& forward_tof_coeff,
+                                           std::vector<double>& forward_tracer_coeff,
+                                           std::vector<double>& backward_tof_coeff,
+                                           std::vector<double>& backward_tracer_coeff);
+
     private:
+        void solveInSequence(const double* darcyflux,
+                             const double* source,
+                             const SparseTable<int>* tracerheads,
+                             std::vector<double>& tof_coeff,
+                             std::vector<double>& tracer_coeff,
+                             const bool reverse);
         virtual void solveSingleCell(const int cell);
         virtual void solveMultiCell(const int num_cells, const int* cells);
 
@@ -146,6 +187,11 @@ namespace Opm
         int num_tracers_;
         enum { NoTracerHead = -1 };
         std::vector<int> tracerhead_by_cell_;
+        std::vector<double> tracer_upstream_;  // one value per tracer
+        std::vector<double> tracer_average_;   // one value per tracer
+        // For solveTofTracerForwardBackward():
+        std::vector<double> reversed_flux_;
+        std::vector<double> reversed_source_;
         // Used by solveSingleCell().
         std::vector<double> rhs_;   // single-cell right-hand-sides
         std::vector<double> jac_;   // single-cell jacobian
@@ -155,7 +201,8 @@ namespace Opm
         mutable std::vector<double> basis_;
         mutable std::vector<double> basis_nb_;
         std::vector<double> grad_basis_;
-        std::vector<double> velocity_;
+        std::vector<double> quad_coord_;     // dim per quadrature point
+        std::vector<double> quad_velocity_;  // dim per quadrature point
         int num_singlesolves_;
         // Used by solveMultiCell():
         double gauss_seidel_tol_;
@@ -170,7 +217,7 @@ namespace Opm
         //  with tof_coeff as tof argument.
         void applyLimiter(const int cell, double* tof);
         void applyMinUpwindLimiter(const int cell, const bool face_min, double* tof);
-        void applyLimiterAsPostProcess();
+        void applyLimiterAsPostProcess(const bool reverse);
         void applyLimiterAsSimultaneousPostProcess();
         double totalFlux(const int cell) const;
         double minCornerVal(const int cell, const int face) const;
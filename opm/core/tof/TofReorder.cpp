@@ -24,6 +24,7 @@
 #include <opm/core/utility/SparseTable.hpp>
 
 #include <algorithm>
+#include <functional>
 #include <numeric>
 #include <cmath>
 #include <iostream>
@@ -64,33 +65,10 @@ namespace Opm
                               const double* source,
                               std::vector<double>& tof)
     {
-        darcyflux_ = darcyflux;
         porevolume_ = porevolume;
-        source_ = source;
-#ifndef NDEBUG
-        // Sanity check for sources.
-        const double cum_src = std::accumulate(source, source + grid_.number_of_cells, 0.0);
-        if (std::fabs(cum_src) > *std::max_element(source, source + grid_.number_of_cells)*1e-2) {
-            OPM_THROW(std::runtime_error, "Sources do not sum to zero: " << cum_src);
-        }
-#endif
-        tof.resize(grid_.number_of_cells);
-        std::fill(tof.begin(), tof.end(), 0.0);
-        tof_ = &tof[0];
-        if (use_multidim_upwind_) {
-            face_tof_.resize(grid_.number_of_faces);
-            std::fill(face_tof_.begin(), face_tof_.end(), 0.0);
-        }
-        num_tracers_ = 0;
-        num_multicell_ = 0;
-        max_size_multicell_ = 0;
-        max_iter_multicell_ = 0;
-        reorderAndTransport(grid_, darcyflux);
-        if (num_multicell_ > 0) {
-            std::cout << num_multicell_ << " multicell blocks with max size "
-                      << max_size_multicell_ << " cells in upto "
-                      << max_iter_multicell_ << " iterations." << std::endl;
-        }
+        std::vector<double> no_tracer;
+        reorder(grid_, darcyflux);
+        solveInSequence(darcyflux, source, 0, tof, no_tracer, false);
     }
 
 
@@ -114,8 +92,63 @@ namespace Opm
                                     std::vector<double>& tof,
                                     std::vector<double>& tracer)
     {
-        darcyflux_ = darcyflux;
+        if (use_multidim_upwind_) {
+            OPM_THROW(std::runtime_error, "Multidimensional upwind not yet implemented for tracer.");
+        }
         porevolume_ = porevolume;
+        reorder(grid_, darcyflux);
+        solveInSequence(darcyflux, source, &tracerheads, tof, tracer, false);
+    }
+
+
+
+
+    /// Solve for forward and backward time-of-flight, and for
+    /// injector and producer tracers, using a single reordering.
+    void TofReorder::solveTofTracerForwardBackward(const double* darcyflux,
+                                                   const double* porevolume,
+                                                   const double* source,
+                                                   const SparseTable<int>& injectorheads,
+                                                   const SparseTable<int>& producerheads,
+                                                   std::vector<double>& forward_tof,
+                                                   std::vector<double>& forward_tracer,
+                                                   std::vector<double>& backward_tof,
+                                                   std::vector<double>& backward_tracer)
+    {
+        if (use_multidim_upwind_ && (!injectorheads.empty() || !producerheads.empty())) {
+            OPM_THROW(std::runtime_error, "Multidimensional upwind not yet implemented for tracer.");
+        }
+        porevolume_ = porevolume;
+        reorder(grid_, darcyflux);
+
+        // Forward problem.
+        solveInSequence(darcyflux, source, &injectorheads, forward_tof, forward_tracer, false);
+
+        // Backward problem, using the reversed ordering.
+        reversed_flux_.resize(grid_.number_of_faces);
+        reversed_source_.resize(grid_.number_of_cells);
+        std::transform(darcyflux, darcyflux + grid_.number_of_faces,
+                       reversed_flux_.begin(), std::negate<double>());
+        std::transform(source, source + grid_.number_of_cells,
+                       reversed_source_.begin(), std::negate<double>());
+        solveInSequence(&reversed_flux_[0], &reversed_source_[0], &producerheads,
+                        backward_tof, backward_tracer, true);
+    }
+
+
+
+
+    // Solve using the ordering from the last reorder() call, which
+    // must have been computed from darcyflux (or its negation, if
+    // reverse is true). A null tracerheads means no tracers.
+    void TofReorder::solveInSequence(const double* darcyflux,
+                                     const double* source,
+                                     const SparseTable<int>* tracerheads,
+                                     std::vector<double>& tof,
+                                     std::vector<double>& tracer,
+                                     const bool reverse)
+    {
+        darcyflux_ = darcyflux;
         source_ = source;
 #ifndef NDEBUG
         // Sanity check for sources.
@@ -129,7 +162,7 @@ namespace Opm
         tof_ = &tof[0];
 
         // Find the tracer heads (injectors).
-        num_tracers_ = tracerheads.size();
+        num_tracers_ = tracerheads ? tracerheads->size() : 0;
         tracer.resize(grid_.number_of_cells*num_tracers_);
         std::fill(tracer.begin(), tracer.end(), 0.0);
         if (num_tracers_ > 0) {
@@ -137,23 +170,22 @@ namespace Opm
             tracerhead_by_cell_.resize(grid_.number_of_cells, NoTracerHead);
         }
         for (int tr = 0; tr < num_tracers_; ++tr) {
-            for (int i = 0; i < tracerheads[tr].size(); ++i) {
-                const int cell = tracerheads[tr][i];
+            for (int i = 0; i < (*tracerheads)[tr].size(); ++i) {
+                const int cell = (*tracerheads)[tr][i];
                 tracer[cell*num_tracers_ + tr] = 1.0;
                 tracerhead_by_cell_[cell] = tr;
             }
         }
+        tracer_ = num_tracers_ > 0 ? &tracer[0] : 0;
 
-        tracer_ = &tracer[0];
         if (use_multidim_upwind_) {
             face_tof_.resize(grid_.number_of_faces);
             std::fill(face_tof_.begin(), face_tof_.end(), 0.0);
-            OPM_THROW(std::runtime_error, "Multidimensional upwind not yet implemented for tracer.");
         }
         num_multicell_ = 0;
         max_size_multicell_ = 0;
         max_iter_multicell_ = 0;
-        reorderAndTransport(grid_, darcyflux);
+        transportInSequence(reverse);
         if (num_multicell_ > 0) {
             std::cout << num_multicell_ << " multicell blocks with max size "
                       << max_size_multicell_ << " cells in upto "
@@ -176,10 +208,12 @@ namespace Opm
         // to the downwind_flux (note sign change resulting from
         // different sign conventions: pos. source is injection,
         // pos. flux is outflow).
-        if (num_tracers_ && tracerhead_by_cell_[cell] == NoTracerHead) {
-            for (int tr = 0; tr < num_tracers_; ++tr) {
-                tracer_[num_tracers_*cell + tr] = 0.0;
-            }
+        // The tracers of a cell are stored contiguously, so that the
+        // updates below are simple loops over the tracer index.
+        const bool compute_tracer = num_tracers_ && tracerhead_by_cell_[cell] == NoTracerHead;
+        double* cell_tracer = compute_tracer ? tracer_ + num_tracers_*cell : 0;
+        if (compute_tracer) {
+            std::fill(cell_tracer, cell_tracer + num_tracers_, 0.0);
         }
         double upwind_term = 0.0;
         double downwind_flux = std::max(-source_[cell], 0.0);
@@ -202,9 +236,10 @@ namespace Opm
                 // face.
                 if (other != -1) {
                     upwind_term += flux*tof_[other];
-                    if (num_tracers_ && tracerhead_by_cell_[cell] == NoTracerHead) {
+                    if (compute_tracer) {
+                        const double* upwind_tracer = tracer_ + num_tracers_*other;
                         for (int tr = 0; tr < num_tracers_; ++tr) {
-                            tracer_[num_tracers_*cell + tr] += flux*tracer_[num_tracers_*other + tr];
+                            cell_tracer[tr] += flux*upwind_tracer[tr];
                         }
                     }
                 }
@@ -218,9 +253,10 @@ namespace Opm
 
         // Compute tracers (if any).
         // Do not change tracer solution in source cells.
-        if (num_tracers_ && tracerhead_by_cell_[cell] == NoTracerHead) {
+        if (compute_tracer) {
+            const double factor = -1.0/downwind_flux;
             for (int tr = 0; tr < num_tracers_; ++tr) {
-                tracer_[num_tracers_*cell + tr] *= -1.0/downwind_flux;
+                cell_tracer[tr] *= factor;
             }
         }
     }
@@ -79,7 +79,46 @@ namespace Opm
                             std::vector<double>& tof,
                             std::vector<double>& tracer);
 
+        /// Solve for forward and backward time-of-flight, and for
+        /// injector and producer tracers, using a single reordering.
+        /// The backward problem is the forward problem with all
+        /// fluxes and sources negated. Its ordering is obtained by
+        /// traversing the forward ordering in reverse, so the upwind
+        /// graph and topological sort are only computed once.
+        /// \param[in]  darcyflux         Array of signed face fluxes.
+        /// \param[in]  porevolume        Array of pore volumes.
+        /// \param[in]  source            Source term. Sign convention is:
+        ///                                 (+) inflow flux,
+        ///                                 (-) outflow flux.
+        /// \param[in]  injectorheads     Table containing one row per forward tracer,
+        ///                               each row contains the source cells for that
+        ///                               tracer. May be empty.
+        /// \param[in]  producerheads     Table containing one row per backward tracer,
+        ///                               each row contains the sink cells for that
+        ///                               tracer. May be empty.
+        /// \param[out] forward_tof       Array of forward time-of-flight values (1 per cell).
+        /// \param[out] forward_tracer    Array of forward tracer values, injectorheads.size()
+        ///                               per cell.
+        /// \param[out] backward_tof      Array of backward time-of-flight values (1 per cell).
+        /// \param[out] backward_tracer   Array of backward tracer values, producerheads.size()
+        ///                               per cell.
+        void solveTofTracerForwardBackward(const double* darcyflux,
+                                           const double* porevolume,
+                                           const double* source,
+                                           const SparseTable<int>& injectorheads,
+                                           const SparseTable<int>& producerheads,
+                                           std::vector<double>& forward_tof,
+                                           std::vector<double>& forward_tracer,
+                                           std::vector<double>& backward_tof,
+                                           std::vector<double>& backward_tracer);
+
     private:
+        void solveInSequence(const double* darcyflux,
+                             const double* source,
+                             const SparseTable<int>* tracerheads,
+                             std::vector<double>& tof,
+                             std::vector<double>& tracer,
+                             const bool reverse);
         virtual void solveSingleCell(const int cell);
         void solveSingleCellMultidimUpwind(const int cell);
         void assembleSingleCell(const int cell,
@@ -110,6 +149,9 @@ namespace Opm
         bool use_multidim_upwind_;
         std::vector<double> face_tof_;       // For multidim upwind face tofs.
         mutable std::vector<int> adj_faces_; // For multidim upwind logic.
+        // For solveTofTracerForwardBackward():
+        std::vector<double> reversed_flux_;
+        std::vector<double> reversed_source_;
     };
 
 } // namespace Opm
@@ -33,6 +33,7 @@
 #include <opm/core/transport/implicit/TransportSolverTwophaseImplicit.hpp>
 #include <opm/core/simulator/TwophaseState.hpp>
 #include <opm/core/utility/miscUtilities.hpp>
+#include <opm/core/utility/Profiler.hpp>
 
 #include <iostream>
 
@@ -76,6 +77,7 @@ namespace Opm
                                                 const double dt,
                                                 TwophaseState& state)
     {
+        OPM_PROFILE_SCOPE("transport/solve");
         // A very crude check for constant porosity (i.e. no rock-compressibility).
         if (porevolume[0] != initial_porevolume_cell0_) {
             OPM_THROW(std::runtime_error, "Detected changed pore volumes, but solver cannot handle rock compressibility.");
@@ -20,47 +20,327 @@
 #include "config.h"
 #include <opm/core/transport/reorder/ReorderSolverInterface.hpp>
 #include <opm/core/transport/reorder/reordersequence.h>
+#include <opm/core/transport/reorder/tarjan.h>
 #include <opm/core/grid.h>
 #include <opm/core/utility/StopWatch.hpp>
+#include <opm/core/utility/Profiler.hpp>
 
+#include <algorithm>
+#include <exception>
+#include <utility>
 #include <vector>
 #include <cassert>
 #include <iostream>
 
 
+namespace
+{
+
+    // Direction of flux across face f: +1 if from face_cells[2*f] to
+    // face_cells[2*f + 1], -1 if opposite, 0 if there is no upwind
+    // graph edge (zero flux or boundary face).
+    inline signed char fluxDirection(const UnstructuredGrid& grid, const double* darcyflux, const int f)
+    {
+        if (grid.face_cells[2*f] < 0 || grid.face_cells[2*f + 1] < 0) {
+            return 0;
+        }
+        return darcyflux[f] > 0.0 ? 1 : (darcyflux[f] < 0.0 ? -1 : 0);
+    }
+
+} // anonymous namespace
+
+
+Opm::ReorderSolverInterface::ReorderSolverInterface()
+    : incremental_(false),
+      rebuild_fraction_(0.1),
+      verbose_(false)
+{
+}
+
+
+void Opm::ReorderSolverInterface::setIncrementalReordering(const bool incremental,
+                                                           const double rebuild_fraction,
+                                                           const bool verbose)
+{
+    incremental_ = incremental;
+    rebuild_fraction_ = rebuild_fraction;
+    verbose_ = verbose;
+    if (!incremental_) {
+        face_direction_.clear();
+        cell_component_.clear();
+    }
+}
+
+
+bool Opm::ReorderSolverInterface::concurrentComponents() const
+{
+    return false;
+}
+
+
 void Opm::ReorderSolverInterface::reorderAndTransport(const UnstructuredGrid& grid, const double* darcyflux)
+{
+    reorder(grid, darcyflux);
+    transportInSequence();
+}
+
+
+void Opm::ReorderSolverInterface::reorder(const UnstructuredGrid& grid, const double* darcyflux)
+{
+    OPM_PROFILE_SCOPE("reorder/sort");
+    time::StopWatch clock;
+    clock.start();
+    const bool have_previous = incremental_
+        && int(face_direction_.size()) == grid.number_of_faces
+        && int(sequence_.size()) == grid.number_of_cells;
+    if (!have_previous) {
+        fullReorder(grid, darcyflux);
+        clock.stop();
+        if (!incremental_ || verbose_) {
+            std::cout << "Topological sort took: " << clock.secsSinceStart() << " seconds." << std::endl;
+        }
+        return;
+    }
+
+    // Find faces whose upwind direction changed.
+    std::vector<int> changed_faces;
+    for (int f = 0; f < grid.number_of_faces; ++f) {
+        if (fluxDirection(grid, darcyflux, f) != face_direction_[f]) {
+            changed_faces.push_back(f);
+        }
+    }
+    if (changed_faces.empty()) {
+        clock.stop();
+        if (verbose_) {
+            std::cout << "Topological sort reused, check took: " << clock.secsSinceStart() << " seconds." << std::endl;
+        }
+        return;
+    }
+    const bool done = double(changed_faces.size()) <= rebuild_fraction_*grid.number_of_faces
+        && incrementalReorder(grid, darcyflux, changed_faces);
+    if (!done) {
+        fullReorder(grid, darcyflux);
+    }
+    clock.stop();
+    if (verbose_) {
+        std::cout << "Topological sort (" << (done ? "incremental, " : "full, ") << changed_faces.size()
+                  << " faces changed) took: " << clock.secsSinceStart() << " seconds." << std::endl;
+    }
+}
+
+
+void Opm::ReorderSolverInterface::fullReorder(const UnstructuredGrid& grid, const double* darcyflux)
 {
     // Compute reordered sequence of single-cell problems
     sequence_.resize(grid.number_of_cells);
     components_.resize(grid.number_of_cells + 1);
+    levels_.resize(grid.number_of_cells + 1);
     int ncomponents;
-    time::StopWatch clock;
-    clock.start();
-    compute_sequence(&grid, darcyflux, &sequence_[0], &components_[0], &ncomponents);
-    clock.stop();
-    std::cout << "Topological sort took: " << clock.secsSinceStart() << " seconds." << std::endl;
+    int nlevels;
+    compute_sequence_levels(&grid, darcyflux, &sequence_[0], &components_[0], &ncomponents,
+                            &levels_[0], &nlevels);
 
     // Make vector's size match actual used data.
     components_.resize(ncomponents + 1);
+    levels_.resize(nlevels + 1);
+
+    if (incremental_) {
+        storeFluxDirections(grid, darcyflux);
+    }
+}
+
 
-    // Invoke appropriate solve method for each interdependent component.
+// Repair the ordering after the flux directions of changed_faces
+// have changed. Every new upwind edge that goes backwards in the
+// current component order, and every removed edge internal to a
+// multi-cell component, marks a window of components. Overlapping
+// windows are merged, and each window is then reordered on its own
+// by running tarjan() on the induced subgraph. Edges leaving a window
+// are consistent with the old order, so the rest of the ordering is
+// left untouched. Returns false if the windows cover too many cells,
+// in which case nothing is modified. Otherwise the components are
+// finally regrouped by level.
+bool Opm::ReorderSolverInterface::incrementalReorder(const UnstructuredGrid& grid,
+                                                     const double* darcyflux,
+                                                     const std::vector<int>& changed_faces)
+{
+    typedef std::pair<int, int> Window;
+    std::vector<Window> windows;
+    for (std::vector<int>::const_iterator it = changed_faces.begin(); it != changed_faces.end(); ++it) {
+        const int f = *it;
+        const int c0 = grid.face_cells[2*f];
+        const int c1 = grid.face_cells[2*f + 1];
+        if (c0 < 0 || c1 < 0) {
+            continue;
+        }
+        const int k0 = cell_component_[c0];
+        const int k1 = cell_component_[c1];
+        if (face_direction_[f] != 0 && k0 == k1) {
+            // Removed edge inside a component, which may now split.
+            windows.push_back(Window(k0, k0));
+        }
+        const signed char dir = fluxDirection(grid, darcyflux, f);
+        const int kup = dir > 0 ? k0 : k1;
+        const int kdown = dir > 0 ? k1 : k0;
+        if (dir != 0 && kup > kdown) {
+            windows.push_back(Window(kdown, kup));
+        }
+    }
+
+    // Merge overlapping windows.
+    std::sort(windows.begin(), windows.end());
+    std::vector<Window> merged;
+    for (std::vector<Window>::const_iterator it = windows.begin(); it != windows.end(); ++it) {
+        if (!merged.empty() && it->first <= merged.back().second) {
+            merged.back().second = std::max(merged.back().second, it->second);
+        } else {
+            merged.push_back(*it);
+        }
+    }
+    int num_window_cells = 0;
+    for (std::vector<Window>::const_iterator it = merged.begin(); it != merged.end(); ++it) {
+        num_window_cells += components_[it->second + 1] - components_[it->first];
+    }
+    if (num_window_cells > rebuild_fraction_*grid.number_of_cells) {
+        return false;
+    }
+
+    // Reorder each window, building the new component pointers as we go.
+    std::vector<int> new_components;
+    new_components.reserve(components_.size());
+    std::vector<int> local_index(grid.number_of_cells, -1);
+    std::vector<int> ia, ja, vert, comp, work;
+    int next_comp = 0;
+    const int ncomponents = components_.size() - 1;
+    for (std::vector<Window>::const_iterator it = merged.begin(); it != merged.end(); ++it) {
+        // Components before this window are unchanged.
+        for (; next_comp < it->first; ++next_comp) {
+            new_components.push_back(components_[next_comp]);
+        }
+        const int start = components_[it->first];
+        const int n = components_[it->second + 1] - start;
+        int* cells = &sequence_[start];
+        for (int i = 0; i < n; ++i) {
+            local_index[cells[i]] = i;
+        }
+        // Upwind graph of the window: edges from each cell to its
+        // upwind neighbours inside the window.
+        ia.assign(n + 1, 0);
+        ja.clear();
+        for (int i = 0; i < n; ++i) {
+            const int cell = cells[i];
+            for (int hf = grid.cell_facepos[cell]; hf < grid.cell_facepos[cell + 1]; ++hf) {
+                const int f = grid.cell_faces[hf];
+                const signed char dir = fluxDirection(grid, darcyflux, f);
+                const bool first = (grid.face_cells[2*f] == cell);
+                const int other = grid.face_cells[2*f + (first ? 1 : 0)];
+                const bool inflow = first ? (dir < 0) : (dir > 0);
+                if (inflow && local_index[other] >= 0) {
+                    ja.push_back(local_index[other]);
+                }
+            }
+            ia[i + 1] = ja.size();
+        }
+        vert.resize(n);
+        comp.resize(n + 1);
+        work.resize(3*n);
+        int nlocal = 0;
+        tarjan(n, &ia[0], ja.empty() ? 0 : &ja[0], &vert[0], &comp[0], &nlocal, &work[0]);
+        for (int i = 0; i < n; ++i) {
+            vert[i] = cells[vert[i]];
+        }
+        std::copy(vert.begin(), vert.end(), cells);
+        for (int i = 0; i < n; ++i) {
+            local_index[cells[i]] = -1;
+        }
+        for (int k = 0; k < nlocal; ++k) {
+            new_components.push_back(start + comp[k]);
+        }
+        next_comp = it->second + 1;
+    }
+    for (; next_comp <= ncomponents; ++next_comp) {
+        new_components.push_back(components_[next_comp]);
+    }
+    components_.swap(new_components);
+
+    const int new_ncomponents = components_.size() - 1;
+    levels_.resize(new_ncomponents + 1);
+    int nlevels;
+    sort_sequence_levels(&grid, darcyflux, &sequence_[0], &components_[0], new_ncomponents,
+                         &levels_[0], &nlevels);
+    levels_.resize(nlevels + 1);
+
+    storeFluxDirections(grid, darcyflux);
+    return true;
+}
+
+
+void Opm::ReorderSolverInterface::storeFluxDirections(const UnstructuredGrid& grid, const double* darcyflux)
+{
+    face_direction_.resize(grid.number_of_faces);
+    for (int f = 0; f < grid.number_of_faces; ++f) {
+        face_direction_[f] = fluxDirection(grid, darcyflux, f);
+    }
+    cell_component_.resize(grid.number_of_cells);
+    const int ncomponents = components_.size() - 1;
     for (int comp = 0; comp < ncomponents; ++comp) {
+        for (int i = components_[comp]; i < components_[comp + 1]; ++i) {
+            cell_component_[sequence_[i]] = comp;
+        }
+    }
+}
+
+
+void Opm::ReorderSolverInterface::transportInSequence(const bool reverse)
+{
+    const int nlevels = levels_.size() - 1;
+
+    // Invoke appropriate solve method for each interdependent component,
+    // one level at a time. Exceptions cannot leave a parallel region, so
+    // the first one thrown is kept and rethrown once the level is done.
+    for (int l = 0; l < nlevels; ++l) {
+        const int level = reverse ? nlevels - 1 - l : l;
+        const int first = levels_[level];
+        const int last = levels_[level + 1];
+        std::exception_ptr error;
+#pragma omp parallel for schedule(dynamic) if(concurrentComponents() && last - first > 1)
+        for (int comp = first; comp < last; ++comp) {
+            try {
+                solveComponent(comp);
+            } catch (...) {
+#pragma omp critical(reorder_transport_error)
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+
+void Opm::ReorderSolverInterface::solveComponent(const int comp)
+{
 #if 0
 #ifdef MATLAB_MEX_FILE
-	// \TODO replace this with general signal handling code, check if it costs performance.
-        if (interrupt_signal) {
-            mexPrintf("Reorder loop interrupted by user: %d of %d "
-                      "cells finished.\n", i, grid.number_of_cells);
-            break;
-        }
+    // \TODO replace this with general signal handling code, check if it costs performance.
+    if (interrupt_signal) {
+        mexPrintf("Reorder loop interrupted by user: %d of %d "
+                  "cells finished.\n", i, grid.number_of_cells);
+        return;
+    }
 #endif
 #endif
-	const int comp_size = components_[comp + 1] - components_[comp];
-	if (comp_size == 1) {
-	    solveSingleCell(sequence_[components_[comp]]);
-	} else {
-	    solveMultiCell(comp_size, &sequence_[components_[comp]]);
-	}
+    const int comp_size = components_[comp + 1] - components_[comp];
+    if (comp_size == 1) {
+        OPM_PROFILE_SCOPE("reorder/single_cell");
+        solveSingleCell(sequence_[components_[comp]]);
+    } else {
+        OPM_PROFILE_SCOPE("reorder/multi_cell");
+        OPM_PROFILE_COUNT("reorder/multi_cell_cells", comp_size);
+        solveMultiCell(comp_size, &sequence_[components_[comp]]);
     }
 }
 
@@ -75,3 +355,9 @@ const std::vector<int>& Opm::ReorderSolverInterface::components() const
 {
     return components_;
 }
+
+
+const std::vector<int>& Opm::ReorderSolverInterface::levels() const
+{
+    return levels_;
+}
@@ -35,20 +35,85 @@ namespace Opm
     /// class.) The reorderAndTransport() method is provided as an aid
     /// to implementing solve() in subclasses, together with the
     /// sequence() and components() methods for accessing the ordering.
+    /// Subclasses that need to sweep the same flux field more than
+    /// once (for example both downstream and upstream) may instead
+    /// call reorder() once, followed by one or more calls to
+    /// transportInSequence().
+    /// The components of the ordering are grouped into levels of
+    /// components that do not depend on each other (see levels()).
+    /// If a subclass overrides concurrentComponents() to return
+    /// true, and OpenMP is enabled, the components of each level are
+    /// solved concurrently.
     class ReorderSolverInterface
     {
     public:
+        ReorderSolverInterface();
     virtual ~ReorderSolverInterface() {}
+
+        /// Enable or disable incremental reordering.
+        /// When enabled, reorder() remembers the upwind directions of
+        /// the last flux field. On the next call, only the faces whose
+        /// flux changed sign are examined: if none did, the previous
+        /// ordering is reused, and otherwise only the range of
+        /// components spanned by the affected cells is reordered.
+        /// \param[in] incremental       Turn incremental reordering on or off.
+        /// \param[in] rebuild_fraction  If more than this fraction of the faces
+        ///                              changed sign, or more than this fraction
+        ///                              of the cells must be reordered, a full
+        ///                              reordering is done instead.
+        /// \param[in] verbose           If true, report the time spent on each
+        ///                              reordering, and whether it was reused,
+        ///                              repaired or rebuilt. Otherwise nothing
+        ///                              is printed in incremental mode.
+        void setIncrementalReordering(const bool incremental,
+                                      const double rebuild_fraction = 0.1,
+                                      const bool verbose = false);
     private:
 	virtual void solveSingleCell(const int cell) = 0;
 	virtual void solveMultiCell(const int num_cells, const int* cells) = 0;
+        /// Return true if solveSingleCell() and solveMultiCell() may be
+        /// called concurrently for components on the same level, that
+        /// is, if they only modify data of the cells they are given.
+        /// The default implementation returns false.
+        virtual bool concurrentComponents() const;
     protected:
 	void reorderAndTransport(const UnstructuredGrid& grid, const double* darcyflux);
+        /// Compute and store the ordering for the given flux field,
+        /// without solving anything.
+        void reorder(const UnstructuredGrid& grid, const double* darcyflux);
+        /// Invoke solveSingleCell() and solveMultiCell() for all
+        /// components of the ordering computed by the last call to
+        /// reorder(). If reverse is true, the levels are visited in
+        /// opposite order. Since the upwind graph of the negated
+        /// flux field is the transpose of the original, and has the
+        /// same strongly connected components, this is a valid
+        /// ordering for the reversed flux field.
+        /// With OpenMP enabled, and if concurrentComponents() returns
+        /// true, the components of each level are solved concurrently.
+        void transportInSequence(const bool reverse = false);
         const std::vector<int>& sequence() const;
         const std::vector<int>& components() const;
+        /// Level pointers into components(). The components of level
+        /// l are levels()[l] ... levels()[l + 1] - 1. Components on
+        /// the same level do not depend on each other, and all
+        /// upwind components of a level are on lower levels.
+        const std::vector<int>& levels() const;
     private:
+        void solveComponent(const int comp);
+        void fullReorder(const UnstructuredGrid& grid, const double* darcyflux);
+        bool incrementalReorder(const UnstructuredGrid& grid, const double* darcyflux,
+                                const std::vector<int>& changed_faces);
+        void storeFluxDirections(const UnstructuredGrid& grid, const double* darcyflux);
+
         std::vector<int> sequence_;
         std::vector<int> components_;
+        std::vector<int> levels_;
+        // For incremental reordering.
+        bool incremental_;
+        double rebuild_fraction_;
+        bool verbose_;
+        std::vector<signed char> face_direction_;  // sign of flux per face at last reorder()
+        std::vector<int> cell_component_;          // component index per cell
     };
 
 
@@ -26,6 +26,7 @@
 #include <opm/core/utility/RootFinders.hpp>
 #include <opm/core/utility/miscUtilities.hpp>
 #include <opm/core/utility/miscUtilitiesBlackoil.hpp>
+#include <opm/core/utility/Profiler.hpp>
 #include <opm/core/pressure/tpfa/trans_tpfa.h>
 
 #include <iostream>
@@ -39,6 +40,7 @@ namespace Opm
 
     // Choose error policy for scalar solves here.
     typedef RegulaFalsi<WarnAndContinueOnError> RootFinder;
+    typedef SafeguardedNewton<WarnAndContinueOnError> NewtonRootFinder;
 
 
     TransportSolverCompressibleTwophaseReorder::TransportSolverCompressibleTwophaseReorder(
@@ -50,11 +52,15 @@ namespace Opm
           props_(props),
           tol_(tol),
           maxit_(maxit),
+          use_newton_(false),
           darcyflux_(0),
           source_(0),
           dt_(0.0),
           saturation_(grid.number_of_cells, -1.0),
           fractionalflow_(grid.number_of_cells, -1.0),
+          reorder_iterations_(grid.number_of_cells, 0),
+          max_cell_iterations_(0),
+          converged_(true),
           gravity_(0),
           mob_(2*grid.number_of_cells, -1.0),
           ia_upw_(grid.number_of_cells + 1, -1),
@@ -87,6 +93,7 @@ namespace Opm
                                                    std::vector<double>& saturation,
                                                    std::vector<double>& surfacevol)
     {
+        OPM_PROFILE_SCOPE("transport/solve");
         darcyflux_ = darcyflux;
         surfacevol0_ = &surfacevol[0];
         porevolume0_ = porevolume0;
@@ -95,8 +102,11 @@ namespace Opm
         dt_ = dt;
         toWaterSat(saturation, saturation_);
 
-        props_.viscosity(props_.numCells(), pressure, NULL, &allcells_[0], &visc_[0], NULL);
-        props_.matrix(props_.numCells(), pressure, NULL, &allcells_[0], &A_[0], NULL);
+        {
+            OPM_PROFILE_SCOPE("transport/properties");
+            props_.viscosity(props_.numCells(), pressure, NULL, &allcells_[0], &visc_[0], NULL);
+            props_.matrix(props_.numCells(), pressure, NULL, &allcells_[0], &A_[0], NULL);
+        }
 
         // Check immiscibility requirement (only done for first cell).
         if (A_[1] != 0.0 || A_[2] != 0.0) {
@@ -115,6 +125,9 @@ namespace Opm
         compute_sequence_graph(&grid_, &neg_darcyflux[0],
                                &seq[0], &comp[0], &ncomp,
                                &ia_downw_[0], &ja_downw_[0]);
+        std::fill(reorder_iterations_.begin(), reorder_iterations_.end(), 0);
+        max_cell_iterations_ = 0;
+        converged_ = true;
         reorderAndTransport(grid_, darcyflux);
         toBothSat(saturation_, saturation);
 
@@ -122,6 +135,30 @@ namespace Opm
         computeSurfacevol(grid_.number_of_cells, props_.numPhases(), &A_[0], &saturation[0], &surfacevol[0]);
     }
 
+
+    const std::vector<int>& TransportSolverCompressibleTwophaseReorder::getReorderIterations() const
+    {
+        return reorder_iterations_;
+    }
+
+
+    int TransportSolverCompressibleTwophaseReorder::getMaxCellIterations() const
+    {
+        return max_cell_iterations_;
+    }
+
+
+    bool TransportSolverCompressibleTwophaseReorder::lastSolveConverged() const
+    {
+        return converged_;
+    }
+
+
+    void TransportSolverCompressibleTwophaseReorder::setUseNewton(const bool use_newton)
+    {
+        use_newton_ = use_newton;
+    }
+
     // Residual function r(s) for a single-cell implicit Euler transport
     //
     // [[ incompressible was: r(s) = s - s0 + dt/pv*( influx + outflux*f(s) ) ]]
@@ -186,14 +223,45 @@ namespace Opm
             // return s - s0 + dtpv*(outflux*tm.fracFlow(s, cell) + influx + s*comp_term);
             return s - B_cell*z0 + dtpv*(outflux*tm.fracFlow(s, cell) + influx) + s*comp_term;
         }
+        double operator()(double s, double& dres) const
+        {
+            double dfds;
+            const double f = tm.fracFlow(s, cell, dfds);
+            dres = 1.0 + dtpv*outflux*dfds + comp_term;
+            return s - B_cell*z0 + dtpv*(outflux*f + influx) + s*comp_term;
+        }
     };
 
 
+    bool TransportSolverCompressibleTwophaseReorder::concurrentComponents() const
+    {
+        // solveSingleCell() and solveMultiCell() only modify the
+        // state of the cells they are given, and the shared
+        // statistics under a critical section.
+        return true;
+    }
+
+
     void TransportSolverCompressibleTwophaseReorder::solveSingleCell(const int cell)
     {
         Residual res(*this, cell);
-        int iters_used;
-        saturation_[cell] = RootFinder::solve(res, saturation_[cell], 0.0, 1.0, maxit_, tol_, iters_used);
+        int iters_used = 0;
+        const double s0 = saturation_[cell];
+        if (use_newton_) {
+            saturation_[cell] = NewtonRootFinder::solve(res, s0, 0.0, 1.0, maxit_, tol_, iters_used);
+        } else {
+            saturation_[cell] = RootFinder::solve(res, s0, 0.0, 1.0, maxit_, tol_, iters_used);
+        }
+        // The root finders report more than maxit_ iterations only
+        // when they fail to converge.
+        const bool converged = iters_used <= maxit_;
+        // Components on the same level may be solved concurrently.
+#pragma omp critical(reorder_cell_statistics)
+        {
+            converged_ = converged_ && converged;
+            max_cell_iterations_ = std::max(max_cell_iterations_, iters_used);
+        }
+        reorder_iterations_[cell] += iters_used;
         fractionalflow_[cell] = fracFlow(saturation_[cell], cell);
     }
 
@@ -315,6 +383,24 @@ namespace Opm
     }
 
 
+    // Fractional flow and its derivative with respect to water saturation.
+    // Since s_o = 1 - s_w, we have d(kr_i)/ds = dkr_i/ds_w - dkr_i/ds_o.
+    double TransportSolverCompressibleTwophaseReorder::fracFlow(double s, int cell, double& dfds) const
+    {
+        double sat[2] = { s, 1.0 - s };
+        double mob[2];
+        double dmob[4];
+        props_.relperm(1, sat, &cell, mob, dmob);
+        const double dmobw = (dmob[0] - dmob[2])/visc_[2*cell + 0];
+        const double dmobo = (dmob[1] - dmob[3])/visc_[2*cell + 1];
+        mob[0] /= visc_[2*cell + 0];
+        mob[1] /= visc_[2*cell + 1];
+        const double mobt = mob[0] + mob[1];
+        dfds = (dmobw*mob[1] - mob[0]*dmobo)/(mobt*mobt);
+        return mob[0]/mobt;
+    }
+
+
 
 
 
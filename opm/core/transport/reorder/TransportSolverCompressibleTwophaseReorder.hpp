@@ -82,9 +82,34 @@ namespace Opm
                           std::vector<double>& saturation,
                           std::vector<double>& surfacevol);
 
+        /// Return the number of iterations used by the reordering solver
+        /// in the last call to solve().
+        /// \return vector of iterations per cell
+        const std::vector<int>& getReorderIterations() const;
+
+        /// Return the max number of iterations used by a single-cell solve
+        /// in the last call to solve(). Unlike getReorderIterations(), the
+        /// iterations of repeated solves in a cell, as done for strongly
+        /// connected components, are not summed.
+        int getMaxCellIterations() const;
+
+        /// Return true if all single-cell solves in the last call to
+        /// solve() converged within the maximum number of iterations.
+        /// If not, the saturations are approximate.
+        bool lastSolveConverged() const;
+
+        /// Choose the scalar solver used in each cell.
+        /// \param[in] use_newton  If true, use a safeguarded Newton method
+        ///                        with analytical fractional flow derivatives,
+        ///                        falling back to regula falsi if it fails to
+        ///                        bracket the solution. If false (default),
+        ///                        use regula falsi only.
+        void setUseNewton(const bool use_newton);
+
     private:
         virtual void solveSingleCell(const int cell);
         virtual void solveMultiCell(const int num_cells, const int* cells);
+        virtual bool concurrentComponents() const;
         void solveSingleCellGravity(const std::vector<int>& cells,
                                     const int pos,
                                     const double* gravflux);
@@ -101,6 +126,7 @@ namespace Opm
         std::vector<double> smax_;
         double tol_;
         int maxit_;
+        bool use_newton_;
 
         const double* darcyflux_;   // one flux per grid face
         const double* surfacevol0_; // one per phase per cell
@@ -110,6 +136,9 @@ namespace Opm
         double dt_;
         std::vector<double> saturation_;        // P (= num. phases) per cell
         std::vector<double> fractionalflow_;  // = m[0]/(m[0] + m[1]) per cell
+        std::vector<int> reorder_iterations_;
+        int max_cell_iterations_;
+        bool converged_;
         // For gravity segregation.
         const double* gravity_;
         std::vector<double> trans_;
@@ -126,6 +155,7 @@ namespace Opm
 
         struct Residual;
         double fracFlow(double s, int cell) const;
+        double fracFlow(double s, int cell, double& dfds) const;
 
         struct GravityResidual;
         void mobility(double s, int cell, double* mob) const;
@@ -25,8 +25,11 @@
 #include <opm/core/grid/ColumnExtract.hpp>
 #include <opm/core/utility/RootFinders.hpp>
 #include <opm/core/utility/miscUtilities.hpp>
+#include <opm/core/utility/Profiler.hpp>
 #include <opm/core/pressure/tpfa/trans_tpfa.h>
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <fstream>
 #include <iterator>
@@ -41,6 +44,7 @@ namespace Opm
 
     // Choose error policy for scalar solves here.
     typedef RegulaFalsi<WarnAndContinueOnError> RootFinder;
+    typedef SafeguardedNewton<WarnAndContinueOnError> NewtonRootFinder;
 
 
     TransportSolverTwophaseReorder::TransportSolverTwophaseReorder(const UnstructuredGrid& grid,
@@ -52,12 +56,16 @@ namespace Opm
           props_(props),
           tol_(tol),
           maxit_(maxit),
+          use_newton_(false),
+          table_points_(0),
           darcyflux_(0),
           source_(0),
           dt_(0.0),
           saturation_(grid.number_of_cells, -1.0),
           fractionalflow_(grid.number_of_cells, -1.0),
           reorder_iterations_(grid.number_of_cells, 0),
+          max_cell_iterations_(0),
+          converged_(true),
           mob_(2*grid.number_of_cells, -1.0)
 #ifdef EXPERIMENT_GAUSS_SEIDEL
         , ia_upw_(grid.number_of_cells + 1, -1),
@@ -95,6 +103,7 @@ namespace Opm
                                                const double dt,
                                                TwophaseState& state)
     {
+        OPM_PROFILE_SCOPE("transport/solve");
         darcyflux_ = &state.faceflux()[0];
         porevolume_ = porevolume;
         source_ = source;
@@ -116,6 +125,8 @@ namespace Opm
                                &ia_downw_[0], &ja_downw_[0]);
 #endif
         std::fill(reorder_iterations_.begin(),reorder_iterations_.end(),0);
+        max_cell_iterations_ = 0;
+        converged_ = true;
         reorderAndTransport(grid_, darcyflux_);
         toBothSat(saturation_, state.saturation());
     }
@@ -127,6 +138,98 @@ namespace Opm
     }
 
 
+    int TransportSolverTwophaseReorder::getMaxCellIterations() const
+    {
+        return max_cell_iterations_;
+    }
+
+
+    bool TransportSolverTwophaseReorder::lastSolveConverged() const
+    {
+        return converged_;
+    }
+
+
+    void TransportSolverTwophaseReorder::setUseNewton(const bool use_newton)
+    {
+        use_newton_ = use_newton;
+    }
+
+
+    double TransportSolverTwophaseReorder::setFractionalFlowTables(const int num_points)
+    {
+        table_points_ = 0;
+        cell_region_.clear();
+        table_f_.clear();
+        table_dfds_.clear();
+        table_smin_.clear();
+        table_smax_.clear();
+        if (num_points <= 0) {
+            return 0.0;
+        }
+        if (num_points < 2) {
+            OPM_THROW(std::runtime_error, "Fractional flow tables need at least 2 points, got " << num_points);
+        }
+
+        // One table per saturation function region, tabulated in the
+        // first cell of the region. Other cells of the region map their
+        // saturation through their own saturation range to the range
+        // of that cell.
+        const int nc = grid_.number_of_cells;
+        std::vector<int> cells(nc);
+        for (int cell = 0; cell < nc; ++cell) {
+            cells[cell] = cell;
+        }
+        cell_region_.resize(nc);
+        props_.satRegion(nc, &cells[0], &cell_region_[0]);
+        const int num_regions = nc > 0 ? *std::max_element(cell_region_.begin(), cell_region_.end()) + 1 : 0;
+        std::vector<int> region_cell(num_regions, -1);
+        for (int cell = nc - 1; cell >= 0; --cell) {
+            region_cell[cell_region_[cell]] = cell;
+        }
+
+        // Tabulate f and df/ds for each region at uniformly spaced
+        // saturations.
+        table_f_.resize(num_regions*num_points);
+        table_dfds_.resize(num_regions*num_points);
+        table_smin_.assign(num_regions, 0.0);
+        table_smax_.assign(num_regions, 1.0);
+        std::vector<double> node_s(num_points);
+        for (int i = 0; i < num_points; ++i) {
+            node_s[i] = double(i)/double(num_points - 1);
+        }
+        for (int r = 0; r < num_regions; ++r) {
+            const int cell = region_cell[r];
+            if (cell < 0) {
+                continue;
+            }
+            table_smin_[r] = smin_[2*cell];
+            table_smax_[r] = smax_[2*cell];
+            evalFracFlowDirect(num_points, &node_s[0], cell,
+                               &table_f_[r*num_points], &table_dfds_[r*num_points]);
+        }
+        table_points_ = num_points;
+
+        // Check accuracy in every cell at the interval midpoints, where
+        // the interpolation error is largest, or at a fixed number of
+        // probe saturations for fine tables.
+        const int num_probes = std::min(num_points - 1, 10);
+        std::vector<double> probe_s(num_probes);
+        for (int i = 0; i < num_probes; ++i) {
+            probe_s[i] = (double(i) + 0.5)/double(num_probes);
+        }
+        double max_error = 0.0;
+        for (int cell = 0; cell < nc; ++cell) {
+            for (int i = 0; i < num_probes; ++i) {
+                double dfds;
+                const double f = tableFracFlow(probe_s[i], cell, dfds);
+                max_error = std::max(max_error, std::fabs(f - fracFlowDirect(probe_s[i], cell)));
+            }
+        }
+        return max_error;
+    }
+
+
     // Residual function r(s) for a single-cell implicit Euler transport
     //
     //     r(s) = s - s0 + dt/pv*( influx + outflux*f(s) )
@@ -183,9 +286,25 @@ namespace Opm
         {
             return s - s0 + dtpv*(outflux*tm.fracFlow(s, cell) + influx);
         }
+        double operator()(double s, double& dres) const
+        {
+            double dfds;
+            const double f = tm.fracFlow(s, cell, dfds);
+            dres = 1.0 + dtpv*outflux*dfds;
+            return s - s0 + dtpv*(outflux*f + influx);
+        }
     };
 
 
+    bool TransportSolverTwophaseReorder::concurrentComponents() const
+    {
+        // solveSingleCell() and solveMultiCell() only modify the
+        // state of the cells they are given, and the shared
+        // statistics under a critical section.
+        return true;
+    }
+
+
     void TransportSolverTwophaseReorder::solveSingleCell(const int cell)
     {
         Residual res(*this, cell);
@@ -195,7 +314,21 @@ namespace Opm
         // }
         int iters_used = 0;
         // saturation_[cell] = modifiedRegulaFalsi(res, smin_[2*cell], smax_[2*cell], maxit_, tol_, iters_used);
-        saturation_[cell] = RootFinder::solve(res, saturation_[cell], 0.0, 1.0, maxit_, tol_, iters_used);
+        const double s0 = saturation_[cell];
+        if (use_newton_) {
+            saturation_[cell] = NewtonRootFinder::solve(res, s0, 0.0, 1.0, maxit_, tol_, iters_used);
+        } else {
+            saturation_[cell] = RootFinder::solve(res, s0, 0.0, 1.0, maxit_, tol_, iters_used);
+        }
+        // The root finders report more than maxit_ iterations only
+        // when they fail to converge.
+        const bool converged = iters_used <= maxit_;
+        // Components on the same level may be solved concurrently.
+#pragma omp critical(reorder_cell_statistics)
+        {
+            converged_ = converged_ && converged;
+            max_cell_iterations_ = std::max(max_cell_iterations_, iters_used);
+        }
         // add if it is iteration on an out loop
         reorder_iterations_[cell] = reorder_iterations_[cell] + iters_used;
         fractionalflow_[cell] = fracFlow(saturation_[cell], cell);
@@ -456,6 +589,16 @@ namespace Opm
     }
 
     double TransportSolverTwophaseReorder::fracFlow(double s, int cell) const
+    {
+        if (table_points_ > 0) {
+            double dfds;
+            return tableFracFlow(s, cell, dfds);
+        }
+        return fracFlowDirect(s, cell);
+    }
+
+
+    double TransportSolverTwophaseReorder::fracFlowDirect(double s, int cell) const
     {
         double sat[2] = { s, 1.0 - s };
         double mob[2];
@@ -466,6 +609,87 @@ namespace Opm
     }
 
 
+    // Fractional flow and its derivative with respect to water saturation.
+    // Since s_o = 1 - s_w, we have d(kr_i)/ds = dkr_i/ds_w - dkr_i/ds_o.
+    double TransportSolverTwophaseReorder::fracFlow(double s, int cell, double& dfds) const
+    {
+        if (table_points_ > 0) {
+            return tableFracFlow(s, cell, dfds);
+        }
+        double sat[2] = { s, 1.0 - s };
+        double mob[2];
+        double dmob[4];
+        props_.relperm(1, sat, &cell, mob, dmob);
+        const double dmobw = (dmob[0] - dmob[2])/visc_[0];
+        const double dmobo = (dmob[1] - dmob[3])/visc_[1];
+        mob[0] /= visc_[0];
+        mob[1] /= visc_[1];
+        const double mobt = mob[0] + mob[1];
+        dfds = (dmobw*mob[1] - mob[0]*dmobo)/(mobt*mobt);
+        return mob[0]/mobt;
+    }
+
+
+    // Evaluate fractional flow and its derivative for n saturations
+    // in a single cell, without using the tables.
+    void TransportSolverTwophaseReorder::evalFracFlowDirect(const int n, const double* s, const int cell,
+                                                            double* f, double* dfds) const
+    {
+        std::vector<double> sat(2*n);
+        for (int i = 0; i < n; ++i) {
+            sat[2*i] = s[i];
+            sat[2*i + 1] = 1.0 - s[i];
+        }
+        std::vector<int> cells(n, cell);
+        std::vector<double> mob(2*n);
+        std::vector<double> dmob(4*n);
+        props_.relperm(n, &sat[0], &cells[0], &mob[0], &dmob[0]);
+        for (int i = 0; i < n; ++i) {
+            const double* dm = &dmob[4*i];
+            const double dmobw = (dm[0] - dm[2])/visc_[0];
+            const double dmobo = (dm[1] - dm[3])/visc_[1];
+            const double mobw = mob[2*i]/visc_[0];
+            const double mobo = mob[2*i + 1]/visc_[1];
+            const double mobt = mobw + mobo;
+            f[i] = mobw/mobt;
+            dfds[i] = (dmobw*mobo - mobw*dmobo)/(mobt*mobt);
+        }
+    }
+
+
+    // Cubic Hermite interpolation in the fractional flow table
+    // of the cell's region, after mapping the saturation from the
+    // cell's saturation range to that of the table. The returned
+    // derivative is the exact derivative of the interpolant, so that
+    // Newton iterations see a consistent function.
+    double TransportSolverTwophaseReorder::tableFracFlow(double s, int cell, double& dfds) const
+    {
+        const int n = table_points_;
+        const int region = cell_region_[cell];
+        const double* f = &table_f_[region*n];
+        const double* d = &table_dfds_[region*n];
+        const double cell_range = smax_[2*cell] - smin_[2*cell];
+        const double scale = cell_range > 0.0 ? (table_smax_[region] - table_smin_[region])/cell_range : 1.0;
+        const double ts = table_smin_[region] + (s - smin_[2*cell])*scale;
+        const double h = 1.0/double(n - 1);
+        const double x = std::min(std::max(ts, 0.0), 1.0)*double(n - 1);
+        const int i = std::min(int(x), n - 2);
+        const double t = x - double(i);
+        const double t2 = t*t;
+        const double t3 = t2*t;
+        const double h00 = 2.0*t3 - 3.0*t2 + 1.0;
+        const double h10 = t3 - 2.0*t2 + t;
+        const double h01 = -2.0*t3 + 3.0*t2;
+        const double h11 = t3 - t2;
+        const double dh00 = 6.0*t2 - 6.0*t;
+        const double dh10 = 3.0*t2 - 4.0*t + 1.0;
+        const double dh01 = -dh00;
+        const double dh11 = 3.0*t2 - 2.0*t;
+        dfds = scale*(dh00*f[i] + dh10*h*d[i] + dh01*f[i + 1] + dh11*h*d[i + 1])/h;
+        return h00*f[i] + h10*h*d[i] + h01*f[i + 1] + h11*h*d[i + 1];
+    }
+
+
 
 
 
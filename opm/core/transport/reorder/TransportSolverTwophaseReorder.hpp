@@ -80,11 +80,49 @@ namespace Opm
         //// \return vector of iteration per cell
         const std::vector<int>& getReorderIterations() const;
 
+        /// Return the max number of iterations used by a single-cell solve
+        /// in the last call to solve(). Unlike getReorderIterations(), the
+        /// iterations of repeated solves in a cell, as done for strongly
+        /// connected components, are not summed.
+        int getMaxCellIterations() const;
+
+        /// Return true if all single-cell solves in the last call to
+        /// solve() converged within the maximum number of iterations.
+        /// If not, the saturations are approximate.
+        bool lastSolveConverged() const;
+
+        /// Choose the scalar solver used in each cell.
+        /// \param[in] use_newton  If true, use a safeguarded Newton method
+        ///                        with analytical fractional flow derivatives,
+        ///                        falling back to regula falsi if it fails to
+        ///                        bracket the solution. If false (default),
+        ///                        use regula falsi only.
+        void setUseNewton(const bool use_newton);
+
+        /// Tabulate fractional flow and its derivative for each saturation
+        /// region, and use cubic Hermite interpolation in the tables instead
+        /// of evaluating relative permeabilities in the single-cell solves.
+        /// The regions are those of IncompPropertiesInterface::satRegion().
+        /// Each region is tabulated in one of its cells, and the other
+        /// cells of the region map their saturation linearly from their
+        /// own saturation range to the range of that cell.
+        /// \param[in] num_points  Number of uniformly spaced table points
+        ///                        on [0, 1]. If zero, tables are not used
+        ///                        (the default).
+        /// \return Maximum absolute error in fractional flow over all cells,
+        ///         measured against direct evaluation at the interval
+        ///         midpoints, or at ten probe saturations if the table
+        ///         has more intervals.
+        double setFractionalFlowTables(const int num_points);
+
+        using ReorderSolverInterface::setIncrementalReordering;
+
     private:
         void initGravity(const double* grav);
         void initColumns();
         virtual void solveSingleCell(const int cell);
         virtual void solveMultiCell(const int num_cells, const int* cells);
+        virtual bool concurrentComponents() const;
 
         void solveSingleCellGravity(const std::vector<int>& cells,
                                     const int pos,
@@ -98,6 +136,14 @@ namespace Opm
         std::vector<double> smax_;
         double tol_;
         int maxit_;
+        bool use_newton_;
+        // For fractional flow tables, f and df/ds per region and table point.
+        int table_points_;
+        std::vector<int> cell_region_;
+        std::vector<double> table_f_;
+        std::vector<double> table_dfds_;
+        std::vector<double> table_smin_;   // water saturation range per region
+        std::vector<double> table_smax_;
 
         const double* darcyflux_;   // one flux per grid face
         const double* porevolume_;  // one volume per cell
@@ -106,6 +152,8 @@ namespace Opm
         std::vector<double> saturation_;        // one per cell, only water saturation!
         std::vector<double> fractionalflow_;  // = m[0]/(m[0] + m[1]) per cell
         std::vector<int> reorder_iterations_;
+        int max_cell_iterations_;
+        bool converged_;
         //std::vector<double> reorder_fval_;
         // For gravity segregation.
         std::vector<double> gravflux_;
@@ -121,6 +169,11 @@ namespace Opm
 
         struct Residual;
         double fracFlow(double s, int cell) const;
+        double fracFlow(double s, int cell, double& dfds) const;
+        void evalFracFlowDirect(const int n, const double* s, const int cell,
+                                double* f, double* dfds) const;
+        double tableFracFlow(double s, int cell, double& dfds) const;
+        double fracFlowDirect(double s, int cell) const;
 
         struct GravityResidual;
         void mobility(double s, int cell, double* mob) const;
@@ -30,7 +30,8 @@ struct SortByAbsFlux
 
 
 /* Construct adjacency matrix of upwind graph wrt flux.  Column
-   indices are not sorted. */
+   indices are not sorted.  The rows are counted and filled
+   independently, so both passes run in parallel with OpenMP. */
 // ---------------------------------------------------------------------
 static void
 make_upwind_graph(int           nc       ,
@@ -49,9 +50,12 @@ make_upwind_graph(int           nc       ,
     int i, j, p, f, positive_sign, boundaryface;
     double theflux;
 
-    /* For each face, store upwind cell in work array */
+    /* For each face, store upwind cell in work array.  Count number
+       of upwind cells of each cell in ia[i+1]. */
+#pragma omp parallel for private(j, f, positive_sign, boundaryface, theflux)
     for (i=0; i<nc; ++i)
     {
+        ia[i+1] = 0;
         for (j=faceptr[i]; j<faceptr[i+1]; ++j)
         {
             f  = cellfaces[j];
@@ -63,14 +67,26 @@ make_upwind_graph(int           nc       ,
                 /* i is upwind cell for face f */
                 work[f] = i;
             }
+            else if ( theflux < 0 )
+            {
+                boundaryface = (face2cell[2*f+0] == -1) ||
+                               (face2cell[2*f+1] == -1);
+                ia[i+1] += !boundaryface;
+            }
         }
     }
 
     /* Fill ia and ja */
-    p = 0;
-    ia[0] = p;
+    ia[0] = 0;
     for (i=0; i<nc; ++i)
     {
+        ia[i+1] += ia[i];
+    }
+
+#pragma omp parallel for private(j, p, f, positive_sign, boundaryface, theflux)
+    for (i=0; i<nc; ++i)
+    {
+        p = ia[i];
         for (j=faceptr[i]; j<faceptr[i+1]; ++j)
         {
 
@@ -91,7 +107,7 @@ make_upwind_graph(int           nc       ,
                 ja[p++] = work[f];
             }
         }
-        ia[i+1] = p;
+        assert (p == ia[i+1]);
     }
 }
 
@@ -177,6 +193,356 @@ compute_sequence_graph(const struct UnstructuredGrid* grid       ,
 }
 
 
+/* Compute the transpose (downwind graph) of the upwind graph (ia,ja).
+   Row i of (ib,jb) holds the cells that have i as an upwind cell. */
+// ---------------------------------------------------------------------
+static void
+make_downwind_graph(int        nc,
+                    const int *ia,
+                    const int *ja,
+                    int       *ib,
+                    int       *jb,
+                    int       *work)
+// ---------------------------------------------------------------------
+{
+    int i, j, p;
+
+    for (i = 0; i <= nc; ++i) { ib[i] = 0; }
+
+#pragma omp parallel for private(j)
+    for (i = 0; i < nc; ++i)
+    {
+        for (j = ia[i]; j < ia[i+1]; ++j)
+        {
+#pragma omp atomic
+            ++ib[ja[j] + 1];
+        }
+    }
+    for (i = 0; i < nc; ++i)
+    {
+        ib[i+1] += ib[i];
+        work[i]  = ib[i];
+    }
+
+#pragma omp parallel for private(j, p)
+    for (i = 0; i < nc; ++i)
+    {
+        for (j = ia[i]; j < ia[i+1]; ++j)
+        {
+#pragma omp atomic capture
+            p = work[ja[j]]++;
+            jb[p] = i;
+        }
+    }
+}
+
+
+/* Remove cells whose remaining degree is zero, one round at a time.
+   The first round is queue[0 .. tail-1].  Removing cell c decrements
+   deg[] of the cells in row c of (ptr,adj), and the cells whose degree
+   drops to zero form the next round.  Cells that must never be removed
+   may be given an initial degree of zero as long as they are not in
+   the first round.  If level is non-NULL, level[c] is set to the round
+   in which c was removed.  Each round is sorted so the result does not
+   depend on thread scheduling.  Returns the number of removed cells,
+   in order of removal in queue. */
+// ---------------------------------------------------------------------
+static int
+peel_graph(const int *ptr,
+           const int *adj,
+           int       *deg,
+           int       *queue,
+           int        tail,
+           int       *level)
+// ---------------------------------------------------------------------
+{
+    int i, j, c, d, r, p, lo, hi, round;
+
+    round = 0;
+    lo    = 0;
+    hi    = tail;
+    while (lo < hi)
+    {
+#pragma omp parallel for private(j, c, d, r, p)
+        for (i = lo; i < hi; ++i)
+        {
+            c = queue[i];
+            if (level != NULL) { level[c] = round; }
+
+            for (j = ptr[c]; j < ptr[c+1]; ++j)
+            {
+                d = adj[j];
+#pragma omp atomic capture
+                r = --deg[d];
+                if (r == 0)
+                {
+#pragma omp atomic capture
+                    p = tail++;
+                    queue[p] = d;
+                }
+            }
+        }
+
+        std::sort(queue + hi, queue + tail);
+
+        lo = hi;
+        hi = tail;
+        ++round;
+    }
+
+    return tail;
+}
+
+
+/* Sort the components of a causal sequence by level.  On input the
+   components are in topological order of the upwind graph (ia,ja), and
+   level[c] is either the known level of cell c or -1, in which case it
+   is computed here as one more than the highest level among the upwind
+   cells outside the component.  Components keep their relative order
+   within each level. */
+// ---------------------------------------------------------------------
+static void
+sort_components_by_level(int        nc,
+                         const int *ia,
+                         const int *ja,
+                         int       *sequence,
+                         int       *components,
+                         int        ncomponents,
+                         int       *level,
+                         int       *levels,
+                         int       *nlevels)
+// ---------------------------------------------------------------------
+{
+    std::vector<int> comp(nc);
+    for (int k = 0; k < ncomponents; ++k)
+    {
+        for (int i = components[k]; i < components[k+1]; ++i)
+        {
+            comp[sequence[i]] = k;
+        }
+    }
+
+    std::vector<int> comp_level(ncomponents);
+    int nlev = 0;
+    for (int k = 0; k < ncomponents; ++k)
+    {
+        int lev = level[sequence[components[k]]];
+        if (lev < 0)
+        {
+            lev = 0;
+            for (int i = components[k]; i < components[k+1]; ++i)
+            {
+                const int c = sequence[i];
+                for (int j = ia[c]; j < ia[c+1]; ++j)
+                {
+                    const int u = ja[j];
+                    if (comp[u] != k)
+                    {
+                        assert (level[u] >= 0);
+                        lev = std::max(lev, level[u] + 1);
+                    }
+                }
+            }
+            for (int i = components[k]; i < components[k+1]; ++i)
+            {
+                level[sequence[i]] = lev;
+            }
+        }
+        comp_level[k] = lev;
+        nlev = std::max(nlev, lev + 1);
+    }
+
+    /* Counting sort of the components by level. */
+    std::vector<int> count(nlev + 1, 0);    /* Components per level. */
+    std::vector<int> ccount(nlev + 1, 0);   /* Cells per level. */
+    for (int k = 0; k < ncomponents; ++k)
+    {
+        ++count[comp_level[k] + 1];
+        ccount[comp_level[k] + 1] += components[k+1] - components[k];
+    }
+    for (int l = 0; l < nlev; ++l)
+    {
+        count[l+1]  += count[l];
+        ccount[l+1] += ccount[l];
+    }
+
+    const std::vector<int> seq(sequence, sequence + nc);
+    const std::vector<int> cptr(components, components + ncomponents + 1);
+    std::vector<int> cpos(count.begin(), count.end() - 1);
+    std::vector<int> vpos(ccount.begin(), ccount.end() - 1);
+    for (int k = 0; k < ncomponents; ++k)
+    {
+        const int l = comp_level[k];
+        components[cpos[l]++] = vpos[l];
+        for (int i = cptr[k]; i < cptr[k+1]; ++i)
+        {
+            sequence[vpos[l]++] = seq[i];
+        }
+    }
+    components[ncomponents] = nc;
+
+    std::copy(count.begin(), count.end(), levels);
+    *nlevels = nlev;
+}
+
+
+// ---------------------------------------------------------------------
+void
+compute_sequence_levels(const struct UnstructuredGrid* grid       ,
+                        const double*                  flux       ,
+                        int*                           sequence   ,
+                        int*                           components ,
+                        int*                           ncomponents,
+                        int*                           levels     ,
+                        int*                           nlevels    )
+// ---------------------------------------------------------------------
+{
+    const int nc = grid->number_of_cells;
+    const int nf = grid->number_of_faces;
+
+    std::vector<int> work  (std::max(nf, nc));
+    std::vector<int> ia    (nc + 1);
+    std::vector<int> ja    (nf);  // A bit too much.
+    std::vector<int> ib    (nc + 1);
+    std::vector<int> jb    (nf);
+    std::vector<int> indeg (nc);
+    std::vector<int> outdeg(nc);
+    std::vector<int> level (nc, -1);
+    std::vector<int> fwd   (nc);
+    std::vector<int> bwd   (nc);
+
+    make_upwind_graph(nc, grid->cell_faces, grid->cell_facepos,
+                      grid->face_cells, flux, &ia[0], &ja[0], &work[0]);
+    make_downwind_graph(nc, &ia[0], &ja[0], &ib[0], &jb[0], &work[0]);
+
+    /* Forward trimming: cells that are not part of, or downstream of,
+       a loop.  Their level is the round in which they are removed. */
+    int nfwd = 0;
+    for (int c = 0; c < nc; ++c)
+    {
+        indeg[c] = ia[c+1] - ia[c];
+        if (indeg[c] == 0) { fwd[nfwd++] = c; }
+    }
+    nfwd = peel_graph(&ib[0], &jb[0], &indeg[0], &fwd[0], nfwd, &level[0]);
+
+    /* Backward trimming of the remaining cells (indeg > 0): cells that
+       are downstream of, but not part of, a loop.  Trimmed cells start
+       with an outdegree of zero so they are never removed again. */
+    int nbwd = 0;
+#pragma omp parallel for
+    for (int c = 0; c < nc; ++c)
+    {
+        outdeg[c] = 0;
+        if (indeg[c] > 0)
+        {
+            for (int j = ib[c]; j < ib[c+1]; ++j)
+            {
+                outdeg[c] += (indeg[jb[j]] > 0);
+            }
+        }
+    }
+    for (int c = 0; c < nc; ++c)
+    {
+        if ((indeg[c] > 0) && (outdeg[c] == 0)) { bwd[nbwd++] = c; }
+    }
+    nbwd = peel_graph(&ia[0], &ja[0], &outdeg[0], &bwd[0], nbwd, 0);
+
+    /* Assemble a topological order of all components: forward trimmed
+       cells, then the strong components of the remaining core, then
+       backward trimmed cells in reverse order of removal. */
+    int pos = 0, ncomp = 0;
+    for (int i = 0; i < nfwd; ++i)
+    {
+        components[ncomp++] = pos;
+        sequence[pos++]     = fwd[i];
+    }
+
+    const int nr = nc - nfwd - nbwd;
+    if (nr > 0)
+    {
+        /* Find the strong components of the core with tarjan() on the
+           induced subgraph. */
+        std::vector<int> rcell(nr);
+        std::vector<int> local(nc, -1);
+        for (int c = 0, k = 0; c < nc; ++c)
+        {
+            if ((indeg[c] > 0) && (outdeg[c] > 0))
+            {
+                local[c]   = k;
+                rcell[k++] = c;
+            }
+        }
+        std::vector<int> ria(nr + 1, 0);
+        std::vector<int> rja;
+        rja.reserve(ia[nc]);
+        for (int k = 0; k < nr; ++k)
+        {
+            const int c = rcell[k];
+            for (int j = ia[c]; j < ia[c+1]; ++j)
+            {
+                if (local[ja[j]] >= 0) { rja.push_back(local[ja[j]]); }
+            }
+            ria[k+1] = rja.size();
+        }
+        std::vector<int> rvert(nr), rcomp(nr + 1), rwork(3 * nr);
+        int nrcomp = 0;
+        tarjan(nr, &ria[0], rja.empty() ? 0 : &rja[0],
+               &rvert[0], &rcomp[0], &nrcomp, &rwork[0]);
+
+        for (int k = 0; k < nrcomp; ++k)
+        {
+            components[ncomp++] = pos;
+            for (int i = rcomp[k]; i < rcomp[k+1]; ++i)
+            {
+                sequence[pos++] = rcell[rvert[i]];
+            }
+        }
+    }
+
+    for (int i = nbwd - 1; i >= 0; --i)
+    {
+        components[ncomp++] = pos;
+        sequence[pos++]     = bwd[i];
+    }
+    assert (pos == nc);
+    components[ncomp] = nc;
+    *ncomponents = ncomp;
+
+    sort_components_by_level(nc, &ia[0], &ja[0], sequence, components,
+                             ncomp, &level[0], levels, nlevels);
+
+    assert (0 < *ncomponents);
+    assert (*ncomponents <= nc);
+}
+
+
+// ---------------------------------------------------------------------
+void
+sort_sequence_levels(const struct UnstructuredGrid* grid       ,
+                     const double*                  flux       ,
+                     int*                           sequence   ,
+                     int*                           components ,
+                     int                            ncomponents,
+                     int*                           levels     ,
+                     int*                           nlevels    )
+// ---------------------------------------------------------------------
+{
+    const int nc = grid->number_of_cells;
+    const int nf = grid->number_of_faces;
+
+    std::vector<int> work (nf);
+    std::vector<int> ia   (nc + 1);
+    std::vector<int> ja   (nf);  // A bit too much.
+    std::vector<int> level(nc, -1);
+
+    make_upwind_graph(nc, grid->cell_faces, grid->cell_facepos,
+                      grid->face_cells, flux, &ia[0], &ja[0], &work[0]);
+
+    sort_components_by_level(nc, &ia[0], &ja[0], sequence, components,
+                             ncomponents, &level[0], levels, nlevels);
+}
+
+
 /* Local Variables:    */
 /* c-basic-offset:4    */
 /* End:                */
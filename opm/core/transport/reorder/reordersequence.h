@@ -138,6 +138,113 @@ compute_sequence_graph(const struct UnstructuredGrid *grid       ,
                        int                           *ia         ,
                        int                           *ja         );
 
+
+
+/**
+ * Compute causal permutation sequence of grid cells with respect to
+ * specific Darcy flux field, grouped into levels of mutually
+ * independent strongly connected components.
+ *
+ * The level of a component is the length of the longest path leading
+ * to it in the upwind graph of components, so components on the same
+ * level do not depend on each other and may be processed
+ * concurrently once all lower levels are done.
+ *
+ * Cells that are not part of, or downstream of, any loop in the
+ * upwind graph are found by repeatedly removing cells that have no
+ * remaining upwind cells.  Of the remaining cells, those that are
+ * downstream of but not part of a loop are then found by repeatedly
+ * removing cells that have no remaining downwind cells.  Both passes
+ * proceed one round at a time, in parallel over the cells of the
+ * round when OpenMP is enabled.  Only the cells that are left, i.e.,
+ * those that are part of a loop, are passed to tarjan().  The strongly
+ * connected components are the same as those of compute_sequence().
+ *
+ * \param[in] grid Grid structure for which to compute causal cell
+ *                 permutation.
+ *
+ * \param[in] flux Darcy flux field.  Same interpretation as for
+ *                 compute_sequence().
+ *
+ * \param[out] sequence
+ *                 Causal grid cell permutation.  Array of size
+ *                 <CODE>grid->number_of_cells</CODE>.  Components
+ *                 are sorted by level.
+ *
+ * \param[out] components
+ *                 Indirection pointers that describe the strongly
+ *                 connected components, as for compute_sequence().
+ *                 Array of size <CODE>grid->number_of_cells +
+ *                 1</CODE>.
+ *
+ * \param[out] ncomponents
+ *                 Number of strongly connected components.  Pointer
+ *                 to a single integer.
+ *
+ * \param[out] levels
+ *                 Indirection pointers into <CODE>components</CODE>
+ *                 that describe the levels.  Specifically, the
+ *                 \f$l\f$'th level constitutes components
+ *                 <CODE>levels[l] ... levels[l + 1] - 1</CODE>.  Array
+ *                 of size <CODE>grid->number_of_cells + 1</CODE>.
+ *
+ * \param[out] nlevels
+ *                 Number of levels.  Pointer to a single integer.
+ */
+void
+compute_sequence_levels(const struct UnstructuredGrid *grid       ,
+                        const double                  *flux       ,
+                        int                           *sequence   ,
+                        int                           *components ,
+                        int                           *ncomponents,
+                        int                           *levels     ,
+                        int                           *nlevels    );
+
+
+/**
+ * Sort the strongly connected components of a causal permutation
+ * sequence by level, as defined for compute_sequence_levels().  This
+ * is used to regroup a sequence that has been computed or modified by
+ * other means, e.g., by compute_sequence().
+ *
+ * \param[in] grid Grid structure of the sequence.
+ *
+ * \param[in] flux Darcy flux field.  Same interpretation as for
+ *                 compute_sequence().
+ *
+ * \param[in,out] sequence
+ *                 Causal grid cell permutation.  On input ordered
+ *                 according to any topological sorting of the
+ *                 strongly connected components.  On output the
+ *                 components are sorted by level, keeping their
+ *                 relative order within each level.
+ *
+ * \param[in,out] components
+ *                 Indirection pointers that describe the strongly
+ *                 connected components, as for compute_sequence().
+ *                 Updated to match the output sequence.
+ *
+ * \param[in] ncomponents
+ *                 Number of strongly connected components.
+ *
+ * \param[out] levels
+ *                 Indirection pointers into <CODE>components</CODE>
+ *                 that describe the levels, as for
+ *                 compute_sequence_levels().  Array of size
+ *                 <CODE>ncomponents + 1</CODE>.
+ *
+ * \param[out] nlevels
+ *                 Number of levels.  Pointer to a single integer.
+ */
+void
+sort_sequence_levels(const struct UnstructuredGrid *grid       ,
+                     const double                  *flux       ,
+                     int                           *sequence   ,
+                     int                           *components ,
+                     int                            ncomponents,
+                     int                           *levels     ,
+                     int                           *nlevels    );
+
 #ifdef __cplusplus
 }
 #endif  /* __cplusplus */
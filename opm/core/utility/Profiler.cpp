@@ -0,0 +1,321 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+#include <opm/core/utility/Profiler.hpp>
+#include <opm/core/utility/ErrorMacros.hpp>
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <ostream>
+
+namespace Opm
+{
+
+    namespace profiling
+    {
+
+        namespace
+        {
+
+            struct Slot
+            {
+                Slot()
+                    : calls(0), count(0), total(0.0),
+                      min(std::numeric_limits<double>::max()), max(0.0)
+                {
+                }
+                long calls;
+                long count;
+                double total;
+                double min;
+                double max;
+            };
+
+            // Records of one thread, only ever modified by that thread.
+            struct ThreadSlots
+            {
+                std::vector<Slot> slots;
+            };
+
+            // Escape a name for use in a JSON string.
+            std::string jsonString(const std::string& s)
+            {
+                std::string res = "\"";
+                for (std::string::const_iterator it = s.begin(); it != s.end(); ++it) {
+                    if (*it == '"' || *it == '\\') {
+                        res += '\\';
+                    }
+                    res += *it;
+                }
+                return res + "\"";
+            }
+
+            bool nameLess(const Entry& a, const Entry& b)
+            {
+                return a.name < b.name;
+            }
+
+        } // anonymous namespace
+
+
+        struct Registry::Impl
+        {
+            int id(const char* name, const EntryKind kind)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (int i = 0; i < int(names.size()); ++i) {
+                    if (names[i] == name) {
+                        if (kinds[i] != kind) {
+                            OPM_THROW(std::runtime_error, "Profiling entry " << name
+                                      << " used both as a timer and as a counter.");
+                        }
+                        return i;
+                    }
+                }
+                names.push_back(name);
+                kinds.push_back(kind);
+                return names.size() - 1;
+            }
+
+            // The slot of id for the calling thread.
+            Slot& slot(const int id)
+            {
+                // Registered once per thread. The records are owned by
+                // the registry, so they outlive the thread.
+                thread_local ThreadSlots* mine = 0;
+                if (mine == 0) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    threads.push_back(std::unique_ptr<ThreadSlots>(new ThreadSlots));
+                    mine = threads.back().get();
+                }
+                if (id >= int(mine->slots.size())) {
+                    mine->slots.resize(id + 1);
+                }
+                return mine->slots[id];
+            }
+
+            std::mutex mutex;
+            std::vector<std::string> names;
+            std::vector<EntryKind> kinds;
+            std::vector<std::unique_ptr<ThreadSlots> > threads;
+        };
+
+
+
+
+        Registry& Registry::instance()
+        {
+            static Registry registry;
+            return registry;
+        }
+
+
+
+
+        Registry::Registry()
+            : pimpl_(new Impl)
+        {
+        }
+
+
+
+
+        Registry::~Registry()
+        {
+        }
+
+
+
+
+        int Registry::timerId(const char* name)
+        {
+            return pimpl_->id(name, Timer);
+        }
+
+
+
+
+        int Registry::counterId(const char* name)
+        {
+            return pimpl_->id(name, Counter);
+        }
+
+
+
+
+        void Registry::addTime(const int id, const double seconds)
+        {
+            Slot& s = pimpl_->slot(id);
+            ++s.calls;
+            s.total += seconds;
+            s.min = std::min(s.min, seconds);
+            s.max = std::max(s.max, seconds);
+        }
+
+
+
+
+        void Registry::addCount(const int id, const long n)
+        {
+            Slot& s = pimpl_->slot(id);
+            ++s.calls;
+            s.count += n;
+        }
+
+
+
+
+        std::vector<Entry> Registry::entries() const
+        {
+            std::lock_guard<std::mutex> lock(pimpl_->mutex);
+            std::vector<Entry> res;
+            for (int i = 0; i < int(pimpl_->names.size()); ++i) {
+                Entry e;
+                e.name = pimpl_->names[i];
+                e.kind = pimpl_->kinds[i];
+                e.calls = 0;
+                e.count = 0;
+                e.total_seconds = 0.0;
+                e.min_seconds = std::numeric_limits<double>::max();
+                e.max_seconds = 0.0;
+                e.max_thread_seconds = 0.0;
+                e.num_threads = 0;
+                for (std::size_t t = 0; t < pimpl_->threads.size(); ++t) {
+                    const std::vector<Slot>& slots = pimpl_->threads[t]->slots;
+                    if (i >= int(slots.size()) || slots[i].calls == 0) {
+                        continue;
+                    }
+                    const Slot& s = slots[i];
+                    e.calls += s.calls;
+                    e.count += s.count;
+                    e.total_seconds += s.total;
+                    e.min_seconds = std::min(e.min_seconds, s.min);
+                    e.max_seconds = std::max(e.max_seconds, s.max);
+                    e.max_thread_seconds = std::max(e.max_thread_seconds, s.total);
+                    ++e.num_threads;
+                }
+                if (e.calls == 0) {
+                    continue;
+                }
+                if (e.kind == Counter) {
+                    e.min_seconds = 0.0;
+                }
+                res.push_back(e);
+            }
+            std::sort(res.begin(), res.end(), nameLess);
+            return res;
+        }
+
+
+
+
+        void Registry::reset()
+        {
+            std::lock_guard<std::mutex> lock(pimpl_->mutex);
+            for (std::size_t t = 0; t < pimpl_->threads.size(); ++t) {
+                std::vector<Slot>& slots = pimpl_->threads[t]->slots;
+                std::fill(slots.begin(), slots.end(), Slot());
+            }
+        }
+
+
+
+
+        void writeJson(std::ostream& os, const std::vector<Entry>& entries)
+        {
+            const std::streamsize precision = os.precision(9);
+            os << "{\n  \"enabled\": " << (enabled() ? "true" : "false") << ",\n  \"entries\": [";
+            for (std::size_t i = 0; i < entries.size(); ++i) {
+                const Entry& e = entries[i];
+                os << (i == 0 ? "\n" : ",\n")
+                   << "    { \"name\": " << jsonString(e.name)
+                   << ", \"kind\": \"" << (e.kind == Timer ? "timer" : "counter") << "\""
+                   << ", \"calls\": " << e.calls
+                   << ", \"threads\": " << e.num_threads;
+                if (e.kind == Timer) {
+                    os << ", \"total_seconds\": " << e.total_seconds
+                       << ", \"min_seconds\": " << e.min_seconds
+                       << ", \"max_seconds\": " << e.max_seconds
+                       << ", \"max_thread_seconds\": " << e.max_thread_seconds;
+                } else {
+                    os << ", \"count\": " << e.count;
+                }
+                os << " }";
+            }
+            os << (entries.empty() ? "]\n}\n" : "\n  ]\n}\n");
+            os.precision(precision);
+        }
+
+
+
+
+        void writeCsv(std::ostream& os, const std::vector<Entry>& entries)
+        {
+            const std::streamsize precision = os.precision(9);
+            os << "name,kind,calls,threads,count,total_seconds,min_seconds,max_seconds,max_thread_seconds\n";
+            for (std::size_t i = 0; i < entries.size(); ++i) {
+                const Entry& e = entries[i];
+                os << e.name << ',' << (e.kind == Timer ? "timer" : "counter") << ','
+                   << e.calls << ',' << e.num_threads << ',' << e.count << ','
+                   << e.total_seconds << ',' << e.min_seconds << ','
+                   << e.max_seconds << ',' << e.max_thread_seconds << '\n';
+            }
+            os.precision(precision);
+        }
+
+
+
+
+        void writeReport(const std::string& filename)
+        {
+            std::ofstream os(filename.c_str());
+            if (!os) {
+                OPM_THROW(std::runtime_error, "Failed to open " << filename);
+            }
+            const std::vector<Entry> entries = Registry::instance().entries();
+            const std::string ext = ".csv";
+            if (filename.size() >= ext.size()
+                && filename.compare(filename.size() - ext.size(), ext.size(), ext) == 0) {
+                writeCsv(os, entries);
+            } else {
+                writeJson(os, entries);
+            }
+            if (!os) {
+                OPM_THROW(std::runtime_error, "Failed to write " << filename);
+            }
+        }
+
+
+
+
+        bool enabled()
+        {
+#if OPM_PROFILING
+            return true;
+#else
+            return false;
+#endif
+        }
+
+    } // namespace profiling
+
+} // namespace Opm
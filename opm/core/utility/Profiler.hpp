@@ -0,0 +1,184 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_PROFILER_HEADER_INCLUDED
+#define OPM_PROFILER_HEADER_INCLUDED
+
+#include <chrono>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// \file
+/// Named scoped timers and counters for the hot paths of the
+/// simulators and solvers.
+///
+/// Code is instrumented with the macros
+///
+///     OPM_PROFILE_SCOPE("pressure/assemble");   // time until end of scope
+///     OPM_PROFILE_COUNT("reorder/single_cell", 1);
+///
+/// which expand to nothing unless OPM_PROFILING is defined, which is
+/// done by configuring with -DUSE_PROFILING=ON. Each thread records
+/// into its own slots without locking, and the records are summed
+/// over the threads when a report is made, typically at the end of
+/// a run by writeReport().
+
+namespace Opm
+{
+
+    namespace profiling
+    {
+
+        /// Kind of a profiling entry.
+        enum EntryKind { Timer, Counter };
+
+        /// Accumulated record of one named timer or counter.
+        struct Entry
+        {
+            std::string name;
+            EntryKind kind;
+            /// Number of times the scope was entered, or the counter
+            /// incremented.
+            long calls;
+            /// Sum of increments for counters, unused for timers.
+            long count;
+            /// Total, min and max seconds spent in a timed scope.
+            double total_seconds;
+            double min_seconds;
+            double max_seconds;
+            /// Total seconds of the thread spending the most time in
+            /// the scope, which is at most the wall clock time spent.
+            double max_thread_seconds;
+            /// Number of threads that recorded anything.
+            int num_threads;
+        };
+
+
+        /// Process-wide store of profiling records.
+        class Registry
+        {
+        public:
+            /// The single instance.
+            static Registry& instance();
+
+            ~Registry();
+
+            /// Id of a named timer, registering it on first use.
+            /// Ids are stable, so this is meant to be called once for
+            /// each instrumented site (the macros store it in a static).
+            int timerId(const char* name);
+
+            /// Id of a named counter, registering it on first use.
+            int counterId(const char* name);
+
+            /// Record a time spent in the scope of timer id by the
+            /// calling thread.
+            void addTime(const int id, const double seconds);
+
+            /// Increment counter id by n for the calling thread.
+            void addCount(const int id, const long n);
+
+            /// Records summed over all threads, sorted by name. Entries
+            /// that have been registered but not recorded are omitted.
+            /// Must not be called while other threads are recording.
+            std::vector<Entry> entries() const;
+
+            /// Clear all records, keeping the registered names.
+            void reset();
+
+        private:
+            Registry();
+            Registry(const Registry&);
+            Registry& operator=(const Registry&);
+
+            struct Impl;
+            std::unique_ptr<Impl> pimpl_;
+        };
+
+
+        /// Times the scope it lives in.
+        class ScopedTimer
+        {
+        public:
+            explicit ScopedTimer(const int id)
+                : id_(id), start_(std::chrono::steady_clock::now())
+            {
+            }
+            ~ScopedTimer()
+            {
+                const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_;
+                Registry::instance().addTime(id_, elapsed.count());
+            }
+        private:
+            ScopedTimer(const ScopedTimer&);
+            ScopedTimer& operator=(const ScopedTimer&);
+            int id_;
+            std::chrono::steady_clock::time_point start_;
+        };
+
+
+        /// Write entries as a JSON object with an array "entries".
+        void writeJson(std::ostream& os, const std::vector<Entry>& entries);
+
+        /// Write entries as CSV with a header line.
+        void writeCsv(std::ostream& os, const std::vector<Entry>& entries);
+
+        /// Write the current records of the registry to a file, as
+        /// CSV if its name ends with ".csv" and as JSON otherwise.
+        /// Throws if the file cannot be written.
+        void writeReport(const std::string& filename);
+
+        /// True if the library was built with profiling enabled.
+        bool enabled();
+
+    } // namespace profiling
+
+} // namespace Opm
+
+
+#define OPM_PROFILE_CONCAT_IMPL(a, b) a ## b
+#define OPM_PROFILE_CONCAT(a, b) OPM_PROFILE_CONCAT_IMPL(a, b)
+
+#if OPM_PROFILING
+
+/// Time the rest of the enclosing scope under the given name.
+#define OPM_PROFILE_SCOPE(name)                                         \
+    static const int OPM_PROFILE_CONCAT(opm_profile_id_, __LINE__) =   \
+        ::Opm::profiling::Registry::instance().timerId(name);           \
+    ::Opm::profiling::ScopedTimer OPM_PROFILE_CONCAT(opm_profile_timer_, __LINE__) \
+        (OPM_PROFILE_CONCAT(opm_profile_id_, __LINE__))
+
+/// Increment the named counter by n.
+#define OPM_PROFILE_COUNT(name, n)                                      \
+    do {                                                                \
+        static const int opm_profile_id =                               \
+            ::Opm::profiling::Registry::instance().counterId(name);     \
+        ::Opm::profiling::Registry::instance().addCount(opm_profile_id, (n)); \
+    } while (false)
+
+#else
+
+#define OPM_PROFILE_SCOPE(name) do {} while (false)
+#define OPM_PROFILE_COUNT(name, n) do {} while (false)
+
+#endif // OPM_PROFILING
+
+#endif // OPM_PROFILER_HEADER_INCLUDED
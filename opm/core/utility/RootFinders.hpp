@@ -293,6 +293,96 @@ namespace Opm
 
 
 
+    template <class ErrorPolicy = ThrowOnError>
+    class SafeguardedNewton
+    {
+    public:
+
+
+        /// Implements Newton's method, safeguarded by bisection once
+        /// a bracketing interval has been found among the iterates.
+        /// If a Newton step leaves [a, b] before a bracket is known,
+        /// or the iteration does not converge within max_iter steps,
+        /// the method falls back to RegulaFalsi, starting from the
+        /// last iterate.
+        /// The functor must provide both
+        ///     double operator()(double x) const, and
+        ///     double operator()(double x, double& dfdx) const,
+        /// the latter returning the function value and its derivative.
+        /// The fallback is given the iterations that remain of
+        /// max_iter, and the iterations it uses are included in
+        /// iterations_used. Hence iterations_used exceeds max_iter
+        /// only if the method fails to converge.
+        template <class Functor>
+        inline static double solve(const Functor& f,
+                                   const double initial_guess,
+                                   const double a,
+                                   const double b,
+                                   const int max_iter,
+                                   const double tolerance,
+                                   int& iterations_used)
+        {
+            using namespace std;
+            const double macheps = numeric_limits<double>::epsilon();
+            const double eps = tolerance + macheps*max(max(fabs(a), fabs(b)), 1.0);
+
+            double x = std::min(std::max(initial_guess, std::min(a, b)), std::max(a, b));
+            double dfdx = 0.0;
+            double fx = f(x, dfdx);
+            const double epsF = tolerance + macheps*max(fabs(fx), 1.0);
+            iterations_used = 0;
+            // Most recent iterates with negative and positive function values.
+            double x_neg = x;
+            double x_pos = x;
+            bool have_neg = false;
+            bool have_pos = false;
+            while (fabs(fx) >= epsF) {
+                if (fx < 0.0) {
+                    x_neg = x;
+                    have_neg = true;
+                } else {
+                    x_pos = x;
+                    have_pos = true;
+                }
+                if (iterations_used >= max_iter) {
+                    break;
+                }
+                double xnew = x - fx/dfdx;
+                if (have_neg && have_pos) {
+                    // Bisect if the Newton step leaves the bracket,
+                    // or if the derivative was zero (xnew not finite).
+                    const double lo = std::min(x_neg, x_pos);
+                    const double hi = std::max(x_neg, x_pos);
+                    if (!(xnew > lo && xnew < hi)) {
+                        xnew = 0.5*(lo + hi);
+                    }
+                    if (hi - lo < eps) {
+                        return 0.5*(lo + hi);
+                    }
+                } else if (!(xnew >= std::min(a, b) && xnew <= std::max(a, b))) {
+                    break;
+                }
+                if (fabs(xnew - x) < eps) {
+                    return xnew;
+                }
+                x = xnew;
+                fx = f(x, dfdx);
+                ++iterations_used;
+            }
+            if (fabs(fx) < epsF) {
+                return x;
+            }
+            // Newton failed to bracket the zero, use regula falsi instead.
+            int fallback_iterations = 0;
+            const double xfinal = RegulaFalsi<ErrorPolicy>::solve(f, x, a, b, max_iter - iterations_used,
+                                                                  tolerance, fallback_iterations);
+            iterations_used += fallback_iterations;
+            return xfinal;
+        }
+    };
+
+
+
     /// Attempts to find an interval bracketing a zero by successive
     /// enlargement of search interval.
     template <class Functor>
@@ -21,6 +21,7 @@
 #include <opm/core/utility/VelocityInterpolation.hpp>
 #include <opm/core/grid.h>
 #include <opm/core/linalg/blas_lapack.h>
+#include <opm/core/utility/ErrorMacros.hpp>
 
 #include <iostream>
 
@@ -30,10 +31,39 @@ namespace Opm
     // --------  Methods of class VelocityInterpolationInterface  --------
 
 
+    VelocityInterpolationInterface::VelocityInterpolationInterface(const int dimensions)
+        : dimensions_(dimensions)
+    {
+    }
+
     VelocityInterpolationInterface::~VelocityInterpolationInterface()
     {
     }
 
+    /// Interpolate velocity at a number of points in one cell.
+    void VelocityInterpolationInterface::interpolateInCell(const int cell,
+                                                           const int num_points,
+                                                           const double* x,
+                                                           double* v) const
+    {
+        const int dim = dimensions_;
+        for (int pt = 0; pt < num_points; ++pt) {
+            interpolate(cell, x + dim*pt, v + dim*pt);
+        }
+    }
+
+    /// Interpolate velocity at a number of points, each in its own cell.
+    void VelocityInterpolationInterface::interpolateInCells(const int num_points,
+                                                            const int* cells,
+                                                            const double* x,
+                                                            double* v) const
+    {
+        const int dim = dimensions_;
+        for (int pt = 0; pt < num_points; ++pt) {
+            interpolate(cells[pt], x + dim*pt, v + dim*pt);
+        }
+    }
+
 
 
     // --------  Methods of class VelocityInterpolationConstant  --------
@@ -41,7 +71,7 @@ namespace Opm
     /// Constructor.
     /// \param[in]  grid   A grid.
     VelocityInterpolationConstant::VelocityInterpolationConstant(const UnstructuredGrid& grid)
-        : grid_(grid)
+        : VelocityInterpolationInterface(grid.dimensions), grid_(grid)
     {
     }
 
@@ -82,6 +112,7 @@ namespace Opm
     }
 
 
+
     // --------  Methods of class VelocityInterpolationECVI  --------
 
 
@@ -89,7 +120,7 @@ namespace Opm
     /// Constructor.
     /// \param[in]  grid   A grid.
     VelocityInterpolationECVI::VelocityInterpolationECVI(const UnstructuredGrid& grid)
-        : bcmethod_(grid), grid_(grid)
+        : VelocityInterpolationInterface(grid.dimensions), bcmethod_(grid), grid_(grid)
     {
     }
 
@@ -166,20 +197,68 @@ namespace Opm
     void VelocityInterpolationECVI::interpolate(const int cell,
                                                 const double* x,
                                                 double* v) const
+    {
+        interpolateInCell(cell, 1, x, v);
+    }
+
+    /// Interpolate velocity at a number of points in one cell.
+    /// \param[in]  cell        Cell in which to interpolate.
+    /// \param[in]  num_points  Number of points.
+    /// \param[in]  x           Coordinates of points at which to interpolate.
+    ///                         Must be array of length num_points*grid.dimensions.
+    /// \param[out] v           Interpolated velocities.
+    ///                         Must be array of length num_points*grid.dimensions.
+    void VelocityInterpolationECVI::interpolateInCell(const int cell,
+                                                      const int num_points,
+                                                      const double* x,
+                                                      double* v) const
     {
         const int n = bcmethod_.numCorners(cell);
         const int dim = grid_.dimensions;
-        bary_coord_.resize(n);
-        bcmethod_.cartToBary(cell, x, &bary_coord_[0]);
-        std::fill(v, v + dim, 0.0);
-        const SparseTable<WachspressCoord::CornerInfo>& all_ci = bcmethod_.cornerInfo();
-        for (int i = 0; i < n; ++i) {
-            const int cid = all_ci[cell][i].corner_id;
-            for (int dd = 0; dd < dim; ++dd) {
-                v[dd] += corner_velocity_[dim*cid + dd] * bary_coord_[i];
+        // Local storage for the barycentric coordinates, so that
+        // this method may be called from several threads at once.
+        // Single points in cells with few corners fit on the stack.
+        const int num_coords = num_points*n;
+        double small[max_stack_coords];
+        std::vector<double> large;
+        double* bary_coord = small;
+        if (num_coords > max_stack_coords) {
+            large.resize(num_coords);
+            bary_coord = &large[0];
+        }
+        bcmethod_.cartToBary(cell, num_points, x, bary_coord);
+        // The corner ids of a cell are consecutive.
+        const double* cell_corner_velocity = &corner_velocity_[0]
+            + dim*bcmethod_.cornerInfo()[cell][0].corner_id;
+        for (int pt = 0; pt < num_points; ++pt) {
+            const double* bpt = bary_coord + n*pt;
+            double* vpt = v + dim*pt;
+            std::fill(vpt, vpt + dim, 0.0);
+            for (int i = 0; i < n; ++i) {
+                for (int dd = 0; dd < dim; ++dd) {
+                    vpt[dd] += cell_corner_velocity[dim*i + dd] * bpt[i];
+                }
             }
         }
     }
 
+    /// Interpolate velocity at a number of points, each in its own cell.
+    /// \param[in]  num_points  Number of points.
+    /// \param[in]  cells       Cell of each point.
+    /// \param[in]  x           Coordinates of points at which to interpolate.
+    ///                         Must be array of length num_points*grid.dimensions.
+    /// \param[out] v           Interpolated velocities.
+    ///                         Must be array of length num_points*grid.dimensions.
+    void VelocityInterpolationECVI::interpolateInCells(const int num_points,
+                                                       const int* cells,
+                                                       const double* x,
+                                                       double* v) const
+    {
+        const int dim = grid_.dimensions;
+        for (int pt = 0; pt < num_points; ++pt) {
+            interpolateInCell(cells[pt], 1, x + dim*pt, v + dim*pt);
+        }
+    }
+
 
 } // namespace Opm
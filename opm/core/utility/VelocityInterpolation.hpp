@@ -47,6 +47,41 @@ namespace Opm
         virtual void interpolate(const int cell,
                                  const double* x,
                                  double* v) const = 0;
+
+        /// Interpolate velocity at a number of points in one cell.
+        /// The default implementation calls interpolate() for each point.
+        /// \param[in]  cell        Cell in which to interpolate.
+        /// \param[in]  num_points  Number of points.
+        /// \param[in]  x           Coordinates of points at which to interpolate.
+        ///                         Must be array of length num_points*grid.dimensions.
+        /// \param[out] v           Interpolated velocities.
+        ///                         Must be array of length num_points*grid.dimensions.
+        virtual void interpolateInCell(const int cell,
+                                       const int num_points,
+                                       const double* x,
+                                       double* v) const;
+
+        /// Interpolate velocity at a number of points, each in its own cell.
+        /// The default implementation calls interpolate() for each point.
+        /// \param[in]  num_points  Number of points.
+        /// \param[in]  cells       Cell of each point.
+        /// \param[in]  x           Coordinates of points at which to interpolate.
+        ///                         Must be array of length num_points*grid.dimensions.
+        /// \param[out] v           Interpolated velocities.
+        ///                         Must be array of length num_points*grid.dimensions.
+        virtual void interpolateInCells(const int num_points,
+                                        const int* cells,
+                                        const double* x,
+                                        double* v) const;
+
+    protected:
+        /// Constructor.
+        /// \param[in]  dimensions  Spatial dimension of the points,
+        ///                         used by the default batch methods.
+        explicit VelocityInterpolationInterface(const int dimensions);
+
+    private:
+        const int dimensions_;
     };
 
 
@@ -99,6 +134,7 @@ namespace Opm
         virtual void setupFluxes(const double* flux);
 
         /// Interpolate velocity.
+        /// May be called concurrently from several threads.
         /// \param[in]  cell   Cell in which to interpolate.
         /// \param[in]  x      Coordinates of point at which to interpolate.
         ///                    Must be array of length grid.dimensions.
@@ -107,10 +143,36 @@ namespace Opm
         virtual void interpolate(const int cell,
                                  const double* x,
                                  double* v) const;
+
+        /// Interpolate velocity at a number of points in one cell.
+        /// May be called concurrently from several threads.
+        /// \param[in]  cell        Cell in which to interpolate.
+        /// \param[in]  num_points  Number of points.
+        /// \param[in]  x           Coordinates of points at which to interpolate.
+        ///                         Must be array of length num_points*grid.dimensions.
+        /// \param[out] v           Interpolated velocities.
+        ///                         Must be array of length num_points*grid.dimensions.
+        virtual void interpolateInCell(const int cell,
+                                       const int num_points,
+                                       const double* x,
+                                       double* v) const;
+
+        /// Interpolate velocity at a number of points, each in its own cell.
+        /// May be called concurrently from several threads.
+        /// \param[in]  num_points  Number of points.
+        /// \param[in]  cells       Cell of each point.
+        /// \param[in]  x           Coordinates of points at which to interpolate.
+        ///                         Must be array of length num_points*grid.dimensions.
+        /// \param[out] v           Interpolated velocities.
+        ///                         Must be array of length num_points*grid.dimensions.
+        virtual void interpolateInCells(const int num_points,
+                                        const int* cells,
+                                        const double* x,
+                                        double* v) const;
     private:
+        enum { max_stack_coords = 32 };
         WachspressCoord bcmethod_;
         const UnstructuredGrid& grid_;
-        mutable std::vector<double> bary_coord_;
         std::vector<double> corner_velocity_; // size = dim * #corners
     };
 
@@ -20,6 +20,7 @@
 #include "config.h"
 #include <opm/core/utility/WachspressCoord.hpp>
 #include <opm/core/grid.h>
+#include <algorithm>
 #include <cmath>
 #include <map>
 #include <set>
@@ -151,6 +152,14 @@ namespace Opm
                                     vert_adj_faces.begin(), vert_adj_faces.end(),
                                     vert_nonadj_faces.begin());
                 nonadj_faces_.appendRow(vert_nonadj_faces.begin(), vert_nonadj_faces.end());
+                // Position of each nonadjacent face among the faces of the cell.
+                const int* cf_beg = grid.cell_faces + grid.cell_facepos[cell];
+                const int* cf_end = grid.cell_faces + grid.cell_facepos[cell + 1];
+                std::vector<int> local_faces(vert_nonadj_faces.size());
+                for (std::size_t j = 0; j < vert_nonadj_faces.size(); ++j) {
+                    local_faces[j] = std::find(cf_beg, cf_end, vert_nonadj_faces[j]) - cf_beg;
+                }
+                nonadj_local_faces_.appendRow(local_faces.begin(), local_faces.end());
             }
             corner_info_.appendRow(cell_corner_info.begin(), cell_corner_info.end());
         }
@@ -198,38 +207,70 @@ namespace Opm
                                      const double* x,
                                      double* xb) const
     {
-        // Note:
-        // A possible optimization is: compute all n_j * (c_j - x) factors
-        // once, instead of repeating computation for all corners (for
-        // which j is a nonadjacent face).
+        cartToBary(cell, 1, x, xb);
+    }
+
+
+
+    /// Compute generalized barycentric coordinates for a number of
+    /// points with respect to the vertices of a grid cell.
+    /// \param[in]  cell        Cell in which to compute coordinates.
+    /// \param[in]  num_points  Number of points.
+    /// \param[in]  x           Coordinates of points in cartesian coordinates.
+    ///                         Must be array of length num_points*grid.dimensions.
+    /// \param[out] xb          Coordinates of points in barycentric coordinates.
+    ///                         Must be array of length num_points*numCorners(cell).
+    void WachspressCoord::cartToBary(const int cell,
+                                     const int num_points,
+                                     const double* x,
+                                     double* xb) const
+    {
+        // The factors n_j * (c_j - x) are computed once for each face
+        // of the cell, instead of once for each corner the face is
+        // nonadjacent to.
+        enum { MaxStackFaces = 32 };
         const int n = numCorners(cell);
         const int dim = grid_.dimensions;
-        double totw = 0.0;
-        for (int i = 0; i < n; ++i) {
-            const CornerInfo& ci = corner_info_[cell][i];
-            // Weight (unnormalized) is equal to:
-            // V_i * (prod_{j \in nonadjacent faces} n_j * (c_j - x) )
-            // ^^^                                   ^^^    ^^^
-            // corner "volume"                    normal    centroid
-            xb[i] = ci.volume;
-            const int num_nonadj_faces = nonadj_faces_[ci.corner_id].size();
-            for (int j = 0; j < num_nonadj_faces; ++j) {
-                const int face = nonadj_faces_[ci.corner_id][j];
-                double factor = 0.0;
+        const int hface_beg = grid_.cell_facepos[cell];
+        const int num_faces = grid_.cell_facepos[cell + 1] - hface_beg;
+        double small[MaxStackFaces];
+        std::vector<double> large;
+        double* factor = small;
+        if (num_faces > MaxStackFaces) {
+            large.resize(num_faces);
+            factor = &large[0];
+        }
+        for (int pt = 0; pt < num_points; ++pt, x += dim, xb += n) {
+            for (int lf = 0; lf < num_faces; ++lf) {
+                const int face = grid_.cell_faces[hface_beg + lf];
+                double f = 0.0;
                 for (int dd = 0; dd < dim; ++dd) {
-                    factor += grid_.face_normals[dim*face + dd]*(grid_.face_centroids[dim*face + dd] - x[dd]);
+                    f += grid_.face_normals[dim*face + dd]*(grid_.face_centroids[dim*face + dd] - x[dd]);
                 }
                 // Assumes outward-pointing normals, so negate factor if necessary.
                 if (grid_.face_cells[2*face] != cell) {
                     assert(grid_.face_cells[2*face + 1] == cell);
-                    factor = -factor;
+                    f = -f;
                 }
-                xb[i] *= factor;
+                factor[lf] = f;
+            }
+            double totw = 0.0;
+            for (int i = 0; i < n; ++i) {
+                const CornerInfo& ci = corner_info_[cell][i];
+                // Weight (unnormalized) is equal to:
+                // V_i * (prod_{j \in nonadjacent faces} n_j * (c_j - x) )
+                // ^^^                                   ^^^    ^^^
+                // corner "volume"                    normal    centroid
+                xb[i] = ci.volume;
+                const int num_nonadj_faces = nonadj_local_faces_[ci.corner_id].size();
+                for (int j = 0; j < num_nonadj_faces; ++j) {
+                    xb[i] *= factor[nonadj_local_faces_[ci.corner_id][j]];
+                }
+                totw += xb[i];
+            }
+            for (int i = 0; i < n; ++i) {
+                xb[i] /= totw;
             }
-            totw += xb[i];
-        }
-        for (int i = 0; i < n; ++i) {
-            xb[i] /= totw;
         }
     }
 
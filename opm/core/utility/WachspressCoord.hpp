@@ -56,6 +56,19 @@ namespace Opm
                         const double* x,
                         double* xb) const;
 
+        /// Compute generalized barycentric coordinates for a number of
+        /// points with respect to the vertices of a grid cell.
+        /// \param[in]  cell        Cell in which to compute coordinates.
+        /// \param[in]  num_points  Number of points.
+        /// \param[in]  x           Coordinates of points in cartesian coordinates.
+        ///                         Must be array of length num_points*grid.dimensions.
+        /// \param[out] xb          Coordinates of points in barycentric coordinates.
+        ///                         Must be array of length num_points*numCorners(cell).
+        void cartToBary(const int cell,
+                        const int num_points,
+                        const double* x,
+                        double* xb) const;
+
         // A corner is here defined as a {cell, vertex} pair where the
         // vertex is adjacent to the cell.
         struct CornerInfo
@@ -78,6 +91,7 @@ namespace Opm
         SparseTable<CornerInfo> corner_info_;   // Corner info by cell.
         std::vector<int> adj_faces_;    // Set of adjacent faces, by corner id. Contains dim face indices per corner.
         SparseTable<int> nonadj_faces_; // Set of nonadjacent faces, by corner id.
+        SparseTable<int> nonadj_local_faces_; // Same, as positions among the faces of the cell.
     };
 
 } // namespace Opm
@@ -31,6 +31,7 @@
 #include <functional>
 #include <cmath>
 #include <iterator>
+#include <limits>
 
 namespace Opm
 {
@@ -392,6 +393,55 @@ namespace Opm
         }
     }
 
+    /// @brief Computes the time step for which the largest outflow
+    /// from any cell equals its pore volume.
+    double computeCflTimeStep(const UnstructuredGrid& grid,
+                              const std::vector<double>& porevol,
+                              const std::vector<double>& faceflux,
+                              const std::vector<double>& transport_src)
+    {
+        const int nc = grid.number_of_cells;
+        std::vector<double> outflow(nc, 0.0);
+        for (int c = 0; c < nc; ++c) {
+            if (transport_src[c] < 0.0) {
+                outflow[c] = -transport_src[c];
+            }
+        }
+        for (int f = 0; f < grid.number_of_faces; ++f) {
+            const int c0 = grid.face_cells[2*f];
+            const int c1 = grid.face_cells[2*f + 1];
+            if (c0 < 0 || c1 < 0) {
+                continue;
+            }
+            if (faceflux[f] > 0.0) {
+                outflow[c0] += faceflux[f];
+            } else {
+                outflow[c1] -= faceflux[f];
+            }
+        }
+        double dt = std::numeric_limits<double>::max();
+        for (int c = 0; c < nc; ++c) {
+            if (outflow[c] > 0.0) {
+                dt = std::min(dt, porevol[c]/outflow[c]);
+            }
+        }
+        return dt;
+    }
+
+    /// @brief Computes the number of equal substeps a step must be
+    /// divided into for each substep to have at most a given CFL number.
+    int computeNumSubsteps(const double dt,
+                           const double cfl_step,
+                           const double max_cfl,
+                           const int max_substeps)
+    {
+        const double n = std::ceil(dt/(max_cfl*cfl_step));
+        if (n >= max_substeps) {
+            return std::max(max_substeps, 1);
+        }
+        return std::max(int(n), 1);
+    }
+
     /// @brief Estimates a scalar cell velocity from face fluxes.
     /// @param[in]  grid            a grid
     /// @param[in]  face_flux       signed per-face fluxes
@@ -180,6 +180,39 @@ namespace Opm
 				std::vector<double>& transport_src);
 
 
+    /// @brief Computes the time step for which the largest outflow
+    /// from any cell equals its pore volume, that is, the step of unit
+    /// CFL number for explicit upstream transport.
+    /// @param[in]  grid            a grid
+    /// @param[in]  porevol         pore volumes by cell
+    /// @param[in]  faceflux        signed per-face fluxes
+    /// @param[in]  transport_src   transport source terms, as computed by
+    ///                             computeTransportSource(), of which only
+    ///                             the (negative) outflow terms are used.
+    ///                             Boundary outflow must be included here,
+    ///                             since only interior faces are considered.
+    /// @return the time step, or std::numeric_limits<double>::max() if
+    ///         there is no outflow from any cell.
+    double computeCflTimeStep(const UnstructuredGrid& grid,
+                              const std::vector<double>& porevol,
+                              const std::vector<double>& faceflux,
+                              const std::vector<double>& transport_src);
+
+
+    /// @brief Computes the number of equal substeps a step must be
+    /// divided into for each substep to have at most a given CFL number.
+    /// @param[in]  dt              length of the step
+    /// @param[in]  cfl_step        step length of unit CFL number, as
+    ///                             computed by computeCflTimeStep()
+    /// @param[in]  max_cfl         max CFL number of a substep
+    /// @param[in]  max_substeps    upper bound of the result
+    /// @return the number of substeps, at least 1 and at most max_substeps.
+    int computeNumSubsteps(const double dt,
+                           const double cfl_step,
+                           const double max_cfl,
+                           const int max_substeps);
+
+
     /// @brief Estimates a scalar cell velocity from face fluxes.
     /// @param[in]  grid            a grid
     /// @param[in]  face_flux       signed per-face fluxes
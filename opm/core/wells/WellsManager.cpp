@@ -878,4 +878,56 @@ namespace Opm
         well_collection_.applyExplicitReinjectionControls(well_reservoirrates_phase, well_surfacerates_phase);
     }
 
+
+
+    void WellsManager::saveControls()
+    {
+        saved_num_.clear();
+        saved_current_.clear();
+        saved_type_.clear();
+        saved_target_.clear();
+        saved_distr_.clear();
+        if (w_ == 0) {
+            return;
+        }
+        const int np = w_->number_of_phases;
+        for (int w = 0; w < w_->number_of_wells; ++w) {
+            const WellControls& ctrl = *w_->ctrls[w];
+            saved_num_.push_back(ctrl.num);
+            saved_current_.push_back(ctrl.current);
+            saved_type_.insert(saved_type_.end(), ctrl.type, ctrl.type + ctrl.num);
+            saved_target_.insert(saved_target_.end(), ctrl.target, ctrl.target + ctrl.num);
+            saved_distr_.insert(saved_distr_.end(), ctrl.distr, ctrl.distr + np*ctrl.num);
+        }
+    }
+
+
+
+    void WellsManager::restoreControls()
+    {
+        if (w_ == 0) {
+            return;
+        }
+        if (int(saved_num_.size()) != w_->number_of_wells) {
+            OPM_THROW(std::runtime_error, "restoreControls() called without matching saveControls().");
+        }
+        const int np = w_->number_of_phases;
+        int offset = 0;
+        for (int w = 0; w < w_->number_of_wells; ++w) {
+            WellControls& ctrl = *w_->ctrls[w];
+            // Controls are only ever appended, so the saved ones
+            // are still the first ones.
+            const int num = saved_num_[w];
+            assert(num <= ctrl.num);
+            for (int c = 0; c < num; ++c) {
+                ctrl.type[c] = static_cast<WellControlType>(saved_type_[offset + c]);
+                ctrl.target[c] = saved_target_[offset + c];
+            }
+            std::copy(saved_distr_.begin() + np*offset, saved_distr_.begin() + np*(offset + num),
+                      ctrl.distr);
+            ctrl.current = saved_current_[w];
+            offset += num;
+        }
+    }
+
 } // namespace Opm
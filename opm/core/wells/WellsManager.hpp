@@ -23,6 +23,7 @@
 
 #include <opm/core/wells/WellCollection.hpp>
 #include <opm/core/wells/WellsGroup.hpp>
+#include <vector>
 
 struct Wells;
 struct UnstructuredGrid;
@@ -108,6 +109,15 @@ namespace Opm
         void applyExplicitReinjectionControls(const std::vector<double>& well_reservoirrates_phase,
                                               const std::vector<double>& well_surfacerates_phase);
 
+        /// Save the controls of all wells, for restoreControls().
+        void saveControls();
+
+        /// Restore the controls saved by the last call to saveControls(),
+        /// undoing the control switches and target changes made since,
+        /// for instance when a time step is repeated. Controls appended
+        /// since are kept, but are not active.
+        void restoreControls();
+
     private:
 	// Disable copying and assignment.
 	WellsManager(const WellsManager& other);
@@ -116,6 +126,12 @@ namespace Opm
 	// Data
 	Wells* w_;
         WellCollection well_collection_;
+        // Controls saved by saveControls(), concatenated for all wells.
+        std::vector<int> saved_num_;
+        std::vector<int> saved_current_;
+        std::vector<int> saved_type_;
+        std::vector<double> saved_target_;
+        std::vector<double> saved_distr_;
 
 
 
@@ -0,0 +1,164 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+
+#if HAVE_DYNAMIC_BOOST_TEST
+#define BOOST_TEST_DYN_LINK
+#endif
+#define NVERBOSE // to suppress our messages when throwing
+
+#define BOOST_TEST_MODULE AdaptiveTimeStepControlTest
+#include <boost/test/unit_test.hpp>
+
+#include <opm/core/simulator/AdaptiveTimeStepControl.hpp>
+#include <opm/core/utility/parameters/ParameterGroup.hpp>
+#include <opm/core/utility/miscUtilities.hpp>
+#include <opm/core/utility/Units.hpp>
+#include <opm/core/grid/GridManager.hpp>
+#include <opm/core/grid.h>
+#include <limits>
+#include <vector>
+
+using namespace Opm;
+
+namespace
+{
+
+    const double day = unit::day;
+
+} // anonymous namespace
+
+
+BOOST_AUTO_TEST_CASE(GrowsAndLandsOnReportTimes)
+{
+    parameter::ParameterGroup param;
+    param.insertParameter("adaptive_initial_step_days", "1");
+    param.insertParameter("adaptive_max_growth", "2");
+    param.insertParameter("adaptive_pressure_iterations", "4");
+    AdaptiveTimeStepControl control(param);
+
+    // Easy steps double in length, and the report time is hit exactly.
+    const double report_step = 10.0*day;
+    double remaining = report_step;
+    std::vector<double> steps;
+    while (remaining > 0.0) {
+        const double dt = control.nextStep(remaining);
+        BOOST_REQUIRE(dt > 0.0 && dt <= remaining);
+        steps.push_back(dt);
+        remaining = (dt >= remaining) ? 0.0 : remaining - dt;
+        control.stepAccepted(dt, 1, -1, -1.0);
+    }
+    // 1 + 2 + 4 = 7 days, then 3 days remain, which is less than
+    // 1.5 times the suggested 8 days: one step of 3 days.
+    BOOST_REQUIRE_EQUAL(steps.size(), 4u);
+    BOOST_CHECK_CLOSE(steps[0], 1.0*day, 1e-12);
+    BOOST_CHECK_CLOSE(steps[1], 2.0*day, 1e-12);
+    BOOST_CHECK_CLOSE(steps[2], 4.0*day, 1e-12);
+    BOOST_CHECK_CLOSE(steps[3], 3.0*day, 1e-12);
+    // The short landing step does not reduce the prediction.
+    BOOST_CHECK_CLOSE(control.suggestedStep(), 8.0*day, 1e-12);
+
+    // Slightly more than the suggested step left: two equal steps.
+    BOOST_CHECK_CLOSE(control.nextStep(10.0*day), 5.0*day, 1e-12);
+    BOOST_CHECK_CLOSE(control.nextStep(20.0*day), 8.0*day, 1e-12);
+
+    // Hard steps shrink, by at most the max growth factor.
+    control.stepAccepted(8.0*day, 8, -1, -1.0);
+    BOOST_CHECK_CLOSE(control.suggestedStep(), 4.0*day, 1e-12);
+    control.stepAccepted(4.0*day, 100, -1, -1.0);
+    BOOST_CHECK_CLOSE(control.suggestedStep(), 2.0*day, 1e-12);
+}
+
+
+BOOST_AUTO_TEST_CASE(CutsFailedSteps)
+{
+    parameter::ParameterGroup param;
+    param.insertParameter("adaptive_cut_factor", "0.25");
+    param.insertParameter("adaptive_max_cuts", "3");
+    param.insertParameter("adaptive_min_step_days", "1e-3");
+    AdaptiveTimeStepControl control(param);
+
+    // No initial step: the first step is the full report step.
+    BOOST_CHECK_EQUAL(control.nextStep(16.0*day), 16.0*day);
+    control.stepFailed(16.0*day);
+    BOOST_CHECK_CLOSE(control.nextStep(16.0*day), 4.0*day, 1e-12);
+    control.stepFailed(4.0*day);
+    control.stepFailed(1.0*day);
+    BOOST_CHECK_THROW(control.stepFailed(0.25*day), std::runtime_error);
+
+    // Success resets the count of cuts, the min step length is enforced.
+    control.stepAccepted(0.25*day, 4, -1, -1.0);
+    BOOST_CHECK_THROW(control.stepFailed(0.002*day), std::runtime_error);
+}
+
+
+BOOST_AUTO_TEST_CASE(CflLimit)
+{
+    GridManager gm(4, 1);
+    const UnstructuredGrid& grid = *gm.c_grid();
+    const int nc = grid.number_of_cells;
+    std::vector<double> porevol(nc, 2.0);
+    std::vector<double> faceflux(grid.number_of_faces, 0.0);
+    std::vector<double> src(nc, 0.0);
+    BOOST_CHECK_EQUAL(computeCflTimeStep(grid, porevol, faceflux, src),
+                      std::numeric_limits<double>::max());
+
+    // Flow of 1 from left to right through all interior faces, and
+    // out of the last cell through a sink of 4.
+    for (int f = 0; f < grid.number_of_faces; ++f) {
+        const int c0 = grid.face_cells[2*f];
+        const int c1 = grid.face_cells[2*f + 1];
+        if (c0 >= 0 && c1 >= 0) {
+            faceflux[f] = (c0 < c1) ? 1.0 : -1.0;
+        }
+    }
+    BOOST_CHECK_CLOSE(computeCflTimeStep(grid, porevol, faceflux, src), 2.0, 1e-12);
+    src[nc - 1] = -4.0;
+    BOOST_CHECK_CLOSE(computeCflTimeStep(grid, porevol, faceflux, src), 0.5, 1e-12);
+
+    parameter::ParameterGroup param;
+    param.insertParameter("adaptive_max_cfl", "3");
+    AdaptiveTimeStepControl control(param);
+    control.stepAccepted(1.0, 1, -1, 0.5);
+    BOOST_CHECK_CLOSE(control.suggestedStep(), 1.5, 1e-12);
+
+    // The first step is limited too, before any step is accepted.
+    AdaptiveTimeStepControl first(param);
+    BOOST_CHECK_EQUAL(first.nextStep(10.0), 10.0);
+    BOOST_CHECK(first.exceedsCfl(10.0, 0.5));
+    BOOST_CHECK(!first.exceedsCfl(1.5, 0.5));
+    BOOST_CHECK(!first.exceedsCfl(10.0, -1.0));
+    first.limitByCfl(0.5);
+    BOOST_CHECK_CLOSE(first.nextStep(10.0), 1.5, 1e-12);
+    first.limitByCfl(-1.0);
+    BOOST_CHECK_CLOSE(first.nextStep(10.0), 1.5, 1e-12);
+}
+
+
+BOOST_AUTO_TEST_CASE(NumSubsteps)
+{
+    // Step of 10 with unit CFL step 2: CFL number 5.
+    BOOST_CHECK_EQUAL(computeNumSubsteps(10.0, 2.0, 5.0, 100), 1);
+    BOOST_CHECK_EQUAL(computeNumSubsteps(10.0, 2.0, 1.0, 100), 5);
+    BOOST_CHECK_EQUAL(computeNumSubsteps(10.0, 2.0, 0.9, 100), 6);
+    BOOST_CHECK_EQUAL(computeNumSubsteps(10.0, 2.0, 0.01, 100), 100);
+    // No flow.
+    BOOST_CHECK_EQUAL(computeNumSubsteps(10.0, std::numeric_limits<double>::max(), 1.0, 100), 1);
+}
@@ -0,0 +1,137 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+
+#if HAVE_DYNAMIC_BOOST_TEST
+#define BOOST_TEST_DYN_LINK
+#endif
+#define NVERBOSE // to suppress our messages when throwing
+
+#define BOOST_TEST_MODULE AsyncOutputWriterTest
+#include <boost/test/unit_test.hpp>
+
+#include <opm/core/io/AsyncOutputWriter.hpp>
+#include <opm/core/simulator/TwophaseState.hpp>
+#include <opm/core/grid/GridManager.hpp>
+#include <opm/core/grid.h>
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Opm;
+
+namespace
+{
+
+    std::string readFile(const boost::filesystem::path& p)
+    {
+        std::ifstream is(p.string().c_str());
+        BOOST_REQUIRE(is);
+        return std::string(std::istreambuf_iterator<char>(is),
+                           std::istreambuf_iterator<char>());
+    }
+
+    // Write a sequence of states, modifying the state right after
+    // each call to make sure the writer works on copies.
+    void writeSteps(const UnstructuredGrid& grid, const boost::filesystem::path& dir,
+                    const int queue_depth)
+    {
+        TwophaseState state;
+        state.init(grid, 2);
+        std::vector<int> iterations(grid.number_of_cells);
+        AsyncOutputWriter writer(grid, dir.string(), true, queue_depth);
+        for (int step = 0; step < 6; ++step) {
+            for (int c = 0; c < grid.number_of_cells; ++c) {
+                state.pressure()[c] = 1e5*(step + 1) + c;
+                state.saturation()[2*c] = 0.1*step;
+                state.saturation()[2*c + 1] = 1.0 - 0.1*step;
+                iterations[c] = step + c;
+            }
+            for (int f = 0; f < grid.number_of_faces; ++f) {
+                state.faceflux()[f] = 1e-3*(f % 7) - step*1e-4;
+            }
+            writer.write(step, state, "iterations", iterations);
+            std::fill(state.pressure().begin(), state.pressure().end(), -1.0);
+            std::fill(iterations.begin(), iterations.end(), -1);
+        }
+        writer.flush();
+    }
+
+} // anonymous namespace
+
+
+BOOST_AUTO_TEST_CASE(AsyncMatchesSynchronous)
+{
+    GridManager gm(7, 5, 2);
+    const UnstructuredGrid& grid = *gm.c_grid();
+    const boost::filesystem::path base =
+        boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    writeSteps(grid, base / "sync", 0);
+    writeSteps(grid, base / "async", 2);
+
+    const char* fields[] = { "pressure", "saturation", "velocity", "iterations" };
+    for (int step = 0; step < 6; ++step) {
+        std::ostringstream name;
+        name << std::setw(3) << std::setfill('0') << step;
+        for (int i = 0; i < 4; ++i) {
+            const std::string file = std::string(fields[i]) + "/" + name.str() + ".txt";
+            const std::string sync = readFile(base / "sync" / file);
+            BOOST_CHECK(!sync.empty());
+            BOOST_CHECK(sync == readFile(base / "async" / file));
+        }
+        const std::string vtu = "vtk_files/output-" + name.str() + ".vtu";
+        BOOST_CHECK(readFile(base / "sync" / vtu) == readFile(base / "async" / vtu));
+    }
+
+    // The first pressure written is that of step 0, not the
+    // overwritten values.
+    std::ifstream is((base / "async" / "pressure" / "000.txt").string().c_str());
+    double p0 = 0.0;
+    is >> p0;
+    BOOST_CHECK_EQUAL(p0, 1e5);
+
+    boost::filesystem::remove_all(base);
+}
+
+
+BOOST_AUTO_TEST_CASE(ErrorsAreReported)
+{
+    GridManager gm(3, 3);
+    const UnstructuredGrid& grid = *gm.c_grid();
+    const boost::filesystem::path base =
+        boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    boost::filesystem::create_directories(base);
+    // A file where the output directory should be.
+    std::ofstream((base / "pressure").string().c_str()) << "blocker";
+
+    TwophaseState state;
+    state.init(grid, 2);
+    AsyncOutputWriter writer(grid, base.string(), false, 2);
+    writer.write(0, state);
+    BOOST_CHECK_THROW(writer.flush(), std::runtime_error);
+    // The error is reported once.
+    writer.flush();
+
+    boost::filesystem::remove_all(base);
+}
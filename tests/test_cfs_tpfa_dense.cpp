@@ -0,0 +1,189 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+
+#if HAVE_DYNAMIC_BOOST_TEST
+#define BOOST_TEST_DYN_LINK
+#endif
+#define NVERBOSE // to suppress our messages when throwing
+
+#define BOOST_TEST_MODULE CfsTpfaDenseTest
+#include <boost/test/unit_test.hpp>
+
+#include <opm/core/pressure/tpfa/cfs_tpfa_dense.h>
+
+#include <random>
+#include <vector>
+
+namespace
+{
+
+    // Kernel set together with its factorisation storage.
+    struct Kernels
+    {
+        explicit Kernels(const int np, const bool generic)
+            : lu(np*np), ipiv(np)
+        {
+            d.lu = &lu[0];
+            d.ipiv = &ipiv[0];
+            if (generic) {
+                cfs_tpfa_dense_select_generic(&d);
+            } else {
+                cfs_tpfa_dense_select(np, &d);
+            }
+        }
+
+        std::vector<double> lu;
+        std::vector<MAT_SIZE_T> ipiv;
+        cfs_tpfa_dense d;
+    };
+
+    // Solve A X = B, for nrhs right-hand sides, using both the small and
+    // the LAPACK kernels. Returns the factorisation kind of the small
+    // kernels.
+    int solveBoth(const int np, const std::vector<double>& A,
+                  const int nrhs, const std::vector<double>& B,
+                  std::vector<double>& x, std::vector<double>& xref)
+    {
+        Kernels small(np, false);
+        Kernels lapack(np, true);
+        x = B;
+        xref = B;
+        small.d.factorise(np, &A[0], &small.d);
+        small.d.solve(np, nrhs, &small.d, &x[0]);
+        lapack.d.factorise(np, &A[0], &lapack.d);
+        lapack.d.solve(np, nrhs, &lapack.d, &xref[0]);
+        return small.d.is_lu;
+    }
+
+    std::vector<double> randomMatrix(std::mt19937& gen, const int nrow, const int ncol)
+    {
+        std::uniform_real_distribution<double> dist(-1.0, 1.0);
+        std::vector<double> A(nrow*ncol);
+        for (double& a : A) {
+            a = dist(gen);
+        }
+        return A;
+    }
+
+    // Random, diagonally dominant matrix.
+    std::vector<double> wellConditioned(std::mt19937& gen, const int np)
+    {
+        std::vector<double> A = randomMatrix(gen, np, np);
+        for (int i = 0; i < np; ++i) {
+            A[i + i*np] += (A[i + i*np] < 0.0 ? -1.0 : 1.0) * np;
+        }
+        return A;
+    }
+
+    // Random matrix whose last column is a perturbation of size eps of
+    // a combination of the others, so that cond(A) is roughly 1/eps.
+    std::vector<double> badlyConditioned(std::mt19937& gen, const int np, const double eps)
+    {
+        std::vector<double> A = wellConditioned(gen, np);
+        std::vector<double> P = randomMatrix(gen, np, 1);
+        for (int i = 0; i < np; ++i) {
+            double s = eps * (1.5 + 0.5*P[i]);
+            for (int j = 0; j < np - 1; ++j) {
+                s += A[i + j*np];
+            }
+            A[i + (np - 1)*np] = s;
+        }
+        return A;
+    }
+
+} // anonymous namespace
+
+
+BOOST_AUTO_TEST_CASE(WellConditionedMatchesLapack)
+{
+    std::mt19937 gen(1234);
+    const int nrhs = 4;
+    for (int np = 1; np <= 3; ++np) {
+        for (int sample = 0; sample < 50; ++sample) {
+            const std::vector<double> A = wellConditioned(gen, np);
+            const std::vector<double> B = randomMatrix(gen, np, nrhs);
+            std::vector<double> x, xref;
+            BOOST_CHECK_EQUAL(solveBoth(np, A, nrhs, B, x, xref), 0);
+            for (int i = 0; i < np*nrhs; ++i) {
+                BOOST_CHECK_SMALL(x[i] - xref[i], 1e-13);
+            }
+
+            // Products agree with BLAS.
+            Kernels small(np, false);
+            Kernels lapack(np, true);
+            std::vector<double> y(np), yref(np), C(np*nrhs), Cref(np*nrhs);
+            small.d.matvec(np, np, &A[0], &B[0], &y[0]);
+            lapack.d.matvec(np, np, &A[0], &B[0], &yref[0]);
+            small.d.matmat(np, nrhs, &A[0], &B[0], &C[0]);
+            lapack.d.matmat(np, nrhs, &A[0], &B[0], &Cref[0]);
+            for (int i = 0; i < np; ++i) {
+                BOOST_CHECK_SMALL(y[i] - yref[i], 1e-14);
+            }
+            for (int i = 0; i < np*nrhs; ++i) {
+                BOOST_CHECK_SMALL(C[i] - Cref[i], 1e-14);
+            }
+        }
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(BadlyConditionedMatchesLapack)
+{
+    std::mt19937 gen(4321);
+    const int nrhs = 3;
+    for (int np = 2; np <= 3; ++np) {
+        for (int sample = 0; sample < 50; ++sample) {
+            const std::vector<double> B = randomMatrix(gen, np, nrhs);
+            std::vector<double> x, xref;
+
+            // Moderately ill-conditioned: explicit inverse, accurate to
+            // about cond(A) times machine precision.
+            const std::vector<double> A1 = badlyConditioned(gen, np, 1e-4);
+            BOOST_CHECK_EQUAL(solveBoth(np, A1, nrhs, B, x, xref), 0);
+            for (int i = 0; i < np*nrhs; ++i) {
+                BOOST_CHECK_CLOSE(x[i], xref[i], 1e-6);
+            }
+
+            // Nearly singular: falls back to LU factorisation.
+            const std::vector<double> A2 = badlyConditioned(gen, np, 1e-12);
+            BOOST_CHECK_EQUAL(solveBoth(np, A2, nrhs, B, x, xref), 1);
+            for (int i = 0; i < np*nrhs; ++i) {
+                BOOST_CHECK_EQUAL(x[i], xref[i]);
+            }
+        }
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(FallbackIsReset)
+{
+    // A well-conditioned matrix factorised after a nearly singular one
+    // uses the explicit inverse again.
+    std::mt19937 gen(42);
+    const int np = 3;
+    Kernels small(np, false);
+    const std::vector<double> A1 = badlyConditioned(gen, np, 1e-14);
+    small.d.factorise(np, &A1[0], &small.d);
+    BOOST_CHECK_EQUAL(small.d.is_lu, 1);
+    const std::vector<double> A2 = wellConditioned(gen, np);
+    small.d.factorise(np, &A2[0], &small.d);
+    BOOST_CHECK_EQUAL(small.d.is_lu, 0);
+}
@@ -0,0 +1,184 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+
+#if HAVE_DYNAMIC_BOOST_TEST
+#define BOOST_TEST_DYN_LINK
+#endif
+#define NVERBOSE // to suppress our messages when throwing
+
+#define BOOST_TEST_MODULE CornerPointChopperTest
+#include <boost/test/unit_test.hpp>
+
+#include <opm/core/io/eclipse/CornerpointChopper.hpp>
+#include <opm/core/io/StateFile.hpp>
+#include <opm/core/grid/GridManager.hpp>
+#include <opm/core/grid.h>
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace Opm;
+
+namespace
+{
+
+    // Writes a deck with an nx x ny x nz grid of unit cubes, with
+    // PORO equal to the cartesian index of each cell.
+    void writeDeck(const std::string& filename, const int nx, const int ny, const int nz)
+    {
+        std::ofstream os(filename.c_str());
+        os << "SPECGRID\n" << nx << ' ' << ny << ' ' << nz << " 1 F\n/\n\n";
+        os << "COORD\n";
+        for (int j = 0; j <= ny; ++j) {
+            for (int i = 0; i <= nx; ++i) {
+                os << i << ' ' << j << " 0 " << i << ' ' << j << ' ' << nz << '\n';
+            }
+        }
+        os << "/\n\nZCORN\n";
+        for (int k = 0; k < nz; ++k) {
+            for (int top = 0; top < 2; ++top) {
+                for (int c = 0; c < 4*nx*ny; ++c) {
+                    os << k + top << ' ';
+                }
+                os << '\n';
+            }
+        }
+        os << "/\n\nPORO\n";
+        for (int c = 0; c < nx*ny*nz; ++c) {
+            os << c << ' ';
+        }
+        os << "\n/\n\n";
+    }
+
+    struct Deck
+    {
+        Deck()
+            : file(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path())
+        {
+            writeDeck(file.string(), 6, 5, 4);
+        }
+        ~Deck()
+        {
+            boost::filesystem::remove(file);
+        }
+        boost::filesystem::path file;
+    };
+
+    std::vector<CornerPointChopper::Window> windows()
+    {
+        std::vector<CornerPointChopper::Window> w;
+        w.push_back(CornerPointChopper::Window(0, 2, 0, 2, 0.0, 4.0));
+        w.push_back(CornerPointChopper::Window(1, 4, 2, 5, 1.0, 3.0));
+        w.push_back(CornerPointChopper::Window(3, 6, 0, 3, 0.5, 2.5));
+        return w;
+    }
+
+} // anonymous namespace
+
+
+
+BOOST_AUTO_TEST_CASE(ChopManyMatchesChop)
+{
+    Deck deck;
+    CornerPointChopper chopper(deck.file.string());
+    const std::vector<CornerPointChopper::Window> w = windows();
+    std::vector<CornerPointChopper::SubModel> subs;
+    chopper.chopMany(w, subs);
+    BOOST_REQUIRE_EQUAL(subs.size(), w.size());
+    for (std::size_t i = 0; i < w.size(); ++i) {
+        chopper.chop(w[i].imin, w[i].imax, w[i].jmin, w[i].jmax, w[i].zmin, w[i].zmax);
+        EclipseGridParser sp = chopper.subparser();
+        for (int dd = 0; dd < 3; ++dd) {
+            BOOST_CHECK_EQUAL(subs[i].dims[dd], chopper.newDimensions()[dd]);
+        }
+        const std::vector<double>& coord = sp.getFloatingPointValue("COORD");
+        const std::vector<double>& zcorn = sp.getFloatingPointValue("ZCORN");
+        const std::vector<double>& poro = sp.getFloatingPointValue("PORO");
+        BOOST_CHECK_EQUAL_COLLECTIONS(subs[i].COORD.begin(), subs[i].COORD.end(), coord.begin(), coord.end());
+        BOOST_CHECK_EQUAL_COLLECTIONS(subs[i].ZCORN.begin(), subs[i].ZCORN.end(), zcorn.begin(), zcorn.end());
+        BOOST_CHECK_EQUAL_COLLECTIONS(subs[i].PORO.begin(), subs[i].PORO.end(), poro.begin(), poro.end());
+        BOOST_CHECK(subs[i].PERMX.empty());
+        for (std::size_t c = 0; c < subs[i].new_to_old_cell.size(); ++c) {
+            BOOST_CHECK_EQUAL(subs[i].PORO[c], double(subs[i].new_to_old_cell[c]));
+        }
+    }
+    // Second window: 3 x 3 cells and layers 1 and 2.
+    BOOST_CHECK_EQUAL(subs[1].dims[0], 3);
+    BOOST_CHECK_EQUAL(subs[1].dims[1], 3);
+    BOOST_CHECK_EQUAL(subs[1].dims[2], 2);
+    BOOST_CHECK_EQUAL(subs[1].new_to_old_cell[0], 30 + 2*6 + 1);
+}
+
+
+
+BOOST_AUTO_TEST_CASE(ChopToGrids)
+{
+    Deck deck;
+    CornerPointChopper chopper(deck.file.string());
+    const std::vector<CornerPointChopper::Window> w = windows();
+    std::vector<std::shared_ptr<GridManager> > grids;
+    chopper.chopToGrids(w, grids);
+    BOOST_REQUIRE_EQUAL(grids.size(), w.size());
+    BOOST_CHECK_EQUAL(grids[0]->c_grid()->number_of_cells, 2*2*4);
+    BOOST_CHECK_EQUAL(grids[1]->c_grid()->number_of_cells, 3*3*2);
+    BOOST_CHECK_EQUAL(grids[2]->c_grid()->number_of_cells, 3*3*3);
+
+    // An empty window range is reported with its number.
+    std::vector<CornerPointChopper::Window> bad(w);
+    bad[1].zmin = bad[1].zmax = 10.0;
+    BOOST_CHECK_THROW(chopper.chopToGrids(bad, grids), std::runtime_error);
+}
+
+
+
+BOOST_AUTO_TEST_CASE(WriteAndReadBinary)
+{
+    Deck deck;
+    CornerPointChopper chopper(deck.file.string());
+    const std::vector<CornerPointChopper::Window> w = windows();
+    std::vector<CornerPointChopper::SubModel> subs;
+    chopper.chopMany(w, subs);
+
+    const boost::filesystem::path file =
+        boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    chopper.writeBinary(file.string(), w);
+    {
+        StateFileReader reader(file.string());
+        BOOST_CHECK_EQUAL(reader.steps("COORD").size(), w.size());
+        BOOST_CHECK(!reader.hasField("PERMX", 0));
+        for (std::size_t i = 0; i < w.size(); ++i) {
+            CornerPointChopper::SubModel sub;
+            CornerPointChopper::readBinary(reader, i, sub);
+            for (int dd = 0; dd < 3; ++dd) {
+                BOOST_CHECK_EQUAL(sub.dims[dd], subs[i].dims[dd]);
+            }
+            BOOST_CHECK(sub.COORD == subs[i].COORD);
+            BOOST_CHECK(sub.ZCORN == subs[i].ZCORN);
+            BOOST_CHECK(sub.PORO == subs[i].PORO);
+            BOOST_CHECK(sub.PERMX.empty());
+            const struct grdecl g = sub.grdecl();
+            GridManager grid(g);
+            BOOST_CHECK_EQUAL(grid.c_grid()->number_of_cells, sub.dims[0]*sub.dims[1]*sub.dims[2]);
+        }
+    }
+    boost::filesystem::remove(file);
+}
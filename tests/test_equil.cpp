@@ -0,0 +1,132 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+
+#if HAVE_DYNAMIC_BOOST_TEST
+#define BOOST_TEST_DYN_LINK
+#endif
+#define NVERBOSE // to suppress our messages when throwing
+
+#define BOOST_TEST_MODULE EquilTest
+#include <boost/test/unit_test.hpp>
+
+#include <opm/core/io/eclipse/EclipseGridParser.hpp>
+#include <opm/core/grid/GridManager.hpp>
+#include <opm/core/grid.h>
+#include <opm/core/props/BlackoilPropertiesFromDeck.hpp>
+#include <opm/core/simulator/BlackoilState.hpp>
+#include <opm/core/simulator/initState.hpp>
+#include <opm/core/utility/Units.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace Opm;
+
+namespace
+{
+    // Density of a phase at a pressure, phase 0 is water, 1 is oil.
+    double phaseDensity(const BlackoilPropertiesInterface& props,
+                        const double pressure, const int phase)
+    {
+        const double surfvol[2][2] = { { 1.0, 0.0 },
+                                       { 0.0, 1.0 } };
+        const int cell = 0;
+        double A[4] = { 0.0 };
+        props.matrix(1, &pressure, surfvol[phase], &cell, A, 0);
+        double rho[2] = { 0.0 };
+        props.density(1, A, rho);
+        return rho[phase];
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ReadMultipleRecords)
+{
+    const EclipseGridParser deck(std::string("testEquil.DATA"));
+    const EQUIL& equil = deck.getEQUIL();
+    BOOST_REQUIRE_EQUAL(equil.equil.size(), 2u);
+    BOOST_CHECK_CLOSE(equil.equil[0].datum_depth_, 2000.0, 1e-12);
+    BOOST_CHECK_CLOSE(equil.equil[0].datum_depth_pressure_, 200.0*unit::barsa, 1e-12);
+    BOOST_CHECK_CLOSE(equil.equil[0].water_oil_contact_depth_, 2030.0, 1e-12);
+    BOOST_CHECK_CLOSE(equil.equil[1].datum_depth_, 2100.0, 1e-12);
+    BOOST_CHECK_CLOSE(equil.equil[1].datum_depth_pressure_, 250.0*unit::barsa, 1e-12);
+    BOOST_CHECK_CLOSE(equil.equil[1].water_oil_contact_depth_, 2060.0, 1e-12);
+}
+
+BOOST_AUTO_TEST_CASE(EquilibrateRegions)
+{
+    const EclipseGridParser deck(std::string("testEquil.DATA"));
+    GridManager gm(deck);
+    const UnstructuredGrid& grid = *gm.c_grid();
+    BlackoilPropertiesFromDeck props(deck, grid, false);
+    BlackoilState state;
+    const double gravity = unit::gravity;
+    initStateFromDeck(grid, props, deck, gravity, state);
+
+    const int num_cells = grid.number_of_cells;
+    BOOST_REQUIRE_EQUAL(num_cells, 20);
+    const std::vector<double>& p = state.pressure();
+    const std::vector<double>& s = state.saturation();
+    const double woc[2] = { 2030.0, 2060.0 };
+    const double datum_z[2] = { 2000.0, 2100.0 };
+    const double datum_p[2] = { 200.0*unit::barsa, 250.0*unit::barsa };
+
+    for (int c = 0; c < num_cells; ++c) {
+        const int region = c < 10 ? 0 : 1;
+        const double z = grid.cell_centroids[3*c + 2];
+        // Water below the contact of the region, oil above.
+        if (z > woc[region]) {
+            BOOST_CHECK_CLOSE(s[2*c], 0.8, 1e-8);
+        } else {
+            BOOST_CHECK_CLOSE(s[2*c], 0.2, 1e-8);
+        }
+    }
+
+    // The datum lies on the top face of the first cell of region 1,
+    // and on the bottom face of the last cell of region 2.
+    const int datum_cell[2] = { 0, 19 };
+    for (int region = 0; region < 2; ++region) {
+        const int c = datum_cell[region];
+        const double z = grid.cell_centroids[3*c + 2];
+        const int phase = z > woc[region] ? 0 : 1;
+        const double rho = phaseDensity(props, 0.5*(p[c] + datum_p[region]), phase);
+        BOOST_CHECK_CLOSE(p[c] - datum_p[region],
+                          rho*gravity*(z - datum_z[region]), 1e-4);
+    }
+
+    // Neighbouring cells of the same region and phase are in
+    // hydrostatic equilibrium.
+    for (int c = 0; c < num_cells - 1; ++c) {
+        const int region = c < 10 ? 0 : 1;
+        if ((c + 1 < 10 ? 0 : 1) != region) {
+            continue;
+        }
+        const double z0 = grid.cell_centroids[3*c + 2];
+        const double z1 = grid.cell_centroids[3*(c + 1) + 2];
+        const int phase0 = z0 > woc[region] ? 0 : 1;
+        const int phase1 = z1 > woc[region] ? 0 : 1;
+        if (phase0 != phase1) {
+            BOOST_CHECK(p[c + 1] > p[c]);
+            continue;
+        }
+        const double rho = phaseDensity(props, 0.5*(p[c] + p[c + 1]), phase0);
+        BOOST_CHECK_CLOSE(p[c + 1] - p[c], rho*gravity*(z1 - z0), 1e-4);
+    }
+}
@@ -0,0 +1,244 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+
+#if HAVE_DYNAMIC_BOOST_TEST
+#define BOOST_TEST_DYN_LINK
+#endif
+#define NVERBOSE // to suppress our messages when throwing
+
+#define BOOST_TEST_MODULE IfsTpfaTest
+#include <boost/test/unit_test.hpp>
+
+#include <opm/core/pressure/tpfa/ifs_tpfa.h>
+#include <opm/core/pressure/tpfa/trans_tpfa.h>
+#include <opm/core/pressure/IncompTpfa.hpp>
+#include <opm/core/linalg/LinearSolverAmg.hpp>
+#include <opm/core/linalg/sparse_sys.h>
+#include <opm/core/props/IncompPropertiesBasic.hpp>
+#include <opm/core/simulator/TwophaseState.hpp>
+#include <opm/core/simulator/WellState.hpp>
+#include <opm/core/grid/GridManager.hpp>
+#include <opm/core/grid.h>
+#include <opm/core/wells.h>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+using namespace Opm;
+
+namespace
+{
+
+    // An injector with a rate and a bhp control, and a producer
+    // with a bhp and a rate control, in opposite corners.
+    std::shared_ptr<Wells> makeWells(const UnstructuredGrid& grid)
+    {
+        std::shared_ptr<Wells> W(create_wells(2, 2, 2), destroy_wells);
+        const int inj_cell = 0;
+        const int prod_cell = grid.number_of_cells - 1;
+        const double WI = 1e-12;
+        const double ifrac[] = { 1.0, 0.0 };
+        const double pfrac[] = { 1.0, 1.0 };
+        add_well(INJECTOR, 0.0, 1, ifrac, &inj_cell, &WI, "INJ", W.get());
+        add_well(PRODUCER, 0.0, 1, pfrac, &prod_cell, &WI, "PROD", W.get());
+        append_well_controls(RESERVOIR_RATE, 1e-3, ifrac, 0, W.get());
+        append_well_controls(BHP, 3e7, NULL, 0, W.get());
+        append_well_controls(BHP, 1e7, NULL, 1, W.get());
+        append_well_controls(RESERVOIR_RATE, -1e-3, pfrac, 1, W.get());
+        set_current_control(0, 0, W.get());
+        set_current_control(1, 0, W.get());
+        return W;
+    }
+
+    struct Setup
+    {
+        Setup(const UnstructuredGrid& g, const Wells& w)
+            : grid(const_cast<UnstructuredGrid*>(&g)),
+              trans(g.number_of_faces),
+              gpress(g.cell_facepos[g.number_of_cells], 0.0),
+              totmob(g.number_of_cells, 1.0),
+              wdp(w.well_connpos[w.number_of_wells], 0.0)
+        {
+            std::vector<double> perm(g.number_of_cells * g.dimensions * g.dimensions, 0.0);
+            for (int c = 0; c < g.number_of_cells; ++c) {
+                for (int d = 0; d < g.dimensions; ++d) {
+                    perm[c*g.dimensions*g.dimensions + d*(g.dimensions + 1)] = 1e-13;
+                }
+            }
+            std::vector<double> htrans(g.cell_facepos[g.number_of_cells]);
+            tpfa_htrans_compute(grid, &perm[0], &htrans[0]);
+            tpfa_trans_compute(grid, &htrans[0], &trans[0]);
+            forces.src = NULL;
+            forces.bc = NULL;
+            forces.W = &w;
+            forces.totmob = &totmob[0];
+            forces.wdp = &wdp[0];
+        }
+
+        // Check that an updated system equals a freshly assembled one.
+        void checkAgainstAssembled(const ifs_tpfa_data* updated)
+        {
+            ifs_tpfa_data* h = ifs_tpfa_construct(grid, const_cast<Wells*>(forces.W));
+            BOOST_REQUIRE(ifs_tpfa_assemble(grid, &forces, &trans[0], &gpress[0], h));
+            const std::size_t nnz = h->A->ia[h->A->m];
+            for (std::size_t j = 0; j < nnz; ++j) {
+                BOOST_CHECK(std::fabs(updated->A->sa[j] - h->A->sa[j])
+                            <= 1e-12 * std::fabs(h->A->sa[j]) + 1e-30);
+            }
+            for (std::size_t i = 0; i < h->A->m; ++i) {
+                BOOST_CHECK(std::fabs(updated->b[i] - h->b[i])
+                            <= 1e-12 * std::fabs(h->b[i]) + 1e-30);
+            }
+            ifs_tpfa_destroy(h);
+        }
+
+        UnstructuredGrid* grid;
+        std::vector<double> trans;
+        std::vector<double> gpress;
+        std::vector<double> totmob;
+        std::vector<double> wdp;
+        ifs_tpfa_forces forces;
+    };
+
+} // anonymous namespace
+
+
+BOOST_AUTO_TEST_CASE(UpdateWellControls)
+{
+    GridManager gm(8, 6);
+    const UnstructuredGrid& grid = *gm.c_grid();
+    std::shared_ptr<Wells> W = makeWells(grid);
+    Setup setup(grid, *W);
+
+    ifs_tpfa_data* h = ifs_tpfa_construct(setup.grid, W.get());
+    BOOST_REQUIRE(ifs_tpfa_assemble(setup.grid, &setup.forces, &setup.trans[0], &setup.gpress[0], h));
+
+    // Injector from rate to bhp control.
+    int nupdated = 0;
+    set_current_control(0, 1, W.get());
+    BOOST_REQUIRE(ifs_tpfa_update_well_controls(setup.grid, &setup.forces, h, &nupdated));
+    BOOST_CHECK_EQUAL(nupdated, 1);
+    setup.checkAgainstAssembled(h);
+
+    // New producer target, and producer to rate control.
+    W->ctrls[1]->target[0] = 2e7;
+    BOOST_REQUIRE(ifs_tpfa_update_well_controls(setup.grid, &setup.forces, h, &nupdated));
+    BOOST_CHECK_EQUAL(nupdated, 1);
+    setup.checkAgainstAssembled(h);
+    set_current_control(1, 1, W.get());
+    BOOST_REQUIRE(ifs_tpfa_update_well_controls(setup.grid, &setup.forces, h, &nupdated));
+    BOOST_CHECK_EQUAL(nupdated, 1);
+    setup.checkAgainstAssembled(h);
+
+    // Shut the producer, and open it again.
+    W->ctrls[1]->current = ~W->ctrls[1]->current;
+    BOOST_REQUIRE(ifs_tpfa_update_well_controls(setup.grid, &setup.forces, h, &nupdated));
+    setup.checkAgainstAssembled(h);
+    W->ctrls[1]->current = ~W->ctrls[1]->current;
+    BOOST_REQUIRE(ifs_tpfa_update_well_controls(setup.grid, &setup.forces, h, &nupdated));
+    setup.checkAgainstAssembled(h);
+
+    // Nothing changed.
+    BOOST_REQUIRE(ifs_tpfa_update_well_controls(setup.grid, &setup.forces, h, &nupdated));
+    BOOST_CHECK_EQUAL(nupdated, 0);
+
+    // All rate controls and no pressure conditions gives a singular
+    // system, which must be reassembled.
+    set_current_control(0, 0, W.get());
+    BOOST_CHECK(!ifs_tpfa_update_well_controls(setup.grid, &setup.forces, h, &nupdated));
+
+    ifs_tpfa_destroy(h);
+}
+
+
+namespace
+{
+
+    // Switches the injector to bhp control after the first solve.
+    class SwitchOnce : public IncompTpfa::WellControlCheck
+    {
+    public:
+        explicit SwitchOnce(Wells& wells) : wells_(wells), calls(0) {}
+        virtual bool conditionsMet(TwophaseState&, WellState&)
+        {
+            ++calls;
+            if (wells_.ctrls[0]->current == 0) {
+                set_current_control(0, 1, &wells_);
+                return false;
+            }
+            return true;
+        }
+    private:
+        Wells& wells_;
+    public:
+        int calls;
+    };
+
+    // Never satisfied.
+    class NeverMet : public IncompTpfa::WellControlCheck
+    {
+    public:
+        virtual bool conditionsMet(TwophaseState&, WellState&) { return false; }
+    };
+
+} // anonymous namespace
+
+
+BOOST_AUTO_TEST_CASE(SolveWithControlSwitching)
+{
+    GridManager gm(10, 10);
+    const UnstructuredGrid& grid = *gm.c_grid();
+    const int nc = grid.number_of_cells;
+    std::shared_ptr<Wells> W = makeWells(grid);
+
+    std::vector<double> rho(2, 1000.0);
+    std::vector<double> mu(2, 1e-3);
+    IncompPropertiesBasic props(2, SaturationPropsBasic::Linear, rho, mu,
+                                0.2, 1e-13, 2, nc);
+    const std::vector<double> src;
+    LinearSolverAmg linsolver;
+    linsolver.setTolerance(1e-12);
+    IncompTpfa psolver(grid, props, linsolver, NULL, W.get(), src, NULL);
+
+    TwophaseState state;
+    state.init(grid, 2);
+    WellState well_state;
+    well_state.init(W.get(), state);
+    SwitchOnce check(*W);
+    const int extra = psolver.solve(1.0, state, well_state, check, 5);
+    BOOST_CHECK_EQUAL(extra, 1);
+    BOOST_CHECK_EQUAL(check.calls, 2);
+
+    // Must match a solve with the final controls from scratch.
+    TwophaseState ref_state;
+    ref_state.init(grid, 2);
+    WellState ref_well_state;
+    ref_well_state.init(W.get(), ref_state);
+    psolver.solve(1.0, ref_state, ref_well_state);
+    for (int c = 0; c < nc; ++c) {
+        BOOST_CHECK_CLOSE(state.pressure()[c], ref_state.pressure()[c], 1e-6);
+    }
+    BOOST_CHECK_CLOSE(well_state.bhp()[0], 3e7, 1e-6);
+    BOOST_CHECK_CLOSE(well_state.bhp()[1], ref_well_state.bhp()[1], 1e-6);
+
+    NeverMet never;
+    BOOST_CHECK_THROW(psolver.solve(1.0, state, well_state, never, 3), std::runtime_error);
+}
@@ -0,0 +1,362 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+
+#if HAVE_DYNAMIC_BOOST_TEST
+#define BOOST_TEST_DYN_LINK
+#endif
+#define NVERBOSE // to suppress our messages when throwing
+
+#define BOOST_TEST_MODULE LinearSolverTest
+#include <boost/test/unit_test.hpp>
+
+#include <opm/core/linalg/LinearSolverFactory.hpp>
+#include <opm/core/linalg/LinearSolverAmg.hpp>
+#if HAVE_DUNE_ISTL
+#include <opm/core/linalg/LinearSolverIstl.hpp>
+#endif
+#include <opm/core/utility/parameters/ParameterGroup.hpp>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace Opm;
+
+namespace
+{
+
+    // Two-point discretisation of -div(k grad p) on an nx-by-ny
+    // grid, with a Dirichlet condition on the left boundary.
+    struct Poisson
+    {
+        Poisson(const int nx, const int ny, const std::vector<double>& k)
+            : n(nx*ny)
+        {
+            ia.push_back(0);
+            for (int j = 0; j < ny; ++j) {
+                for (int i = 0; i < nx; ++i) {
+                    const int c = i + nx*j;
+                    const int nb[4] = { i > 0      ? c - 1  : -1,
+                                        i < nx - 1 ? c + 1  : -1,
+                                        j > 0      ? c - nx : -1,
+                                        j < ny - 1 ? c + nx : -1 };
+                    double diag = (i == 0) ? 2.0*k[c] : 0.0;
+                    const int dpos = ja.size();
+                    ja.push_back(c);
+                    sa.push_back(0.0);
+                    for (int f = 0; f < 4; ++f) {
+                        if (nb[f] < 0) {
+                            continue;
+                        }
+                        const double t = 2.0 / (1.0/k[c] + 1.0/k[nb[f]]);
+                        ja.push_back(nb[f]);
+                        sa.push_back(-t);
+                        diag += t;
+                    }
+                    sa[dpos] = diag;
+                    ia.push_back(ja.size());
+                }
+            }
+        }
+
+        double residualNorm(const std::vector<double>& x, const std::vector<double>& b) const
+        {
+            double s = 0.0;
+            for (int i = 0; i < n; ++i) {
+                double r = b[i];
+                for (int p = ia[i]; p < ia[i + 1]; ++p) {
+                    r -= sa[p] * x[ja[p]];
+                }
+                s += r*r;
+            }
+            return std::sqrt(s);
+        }
+
+        int n;
+        std::vector<int> ia;
+        std::vector<int> ja;
+        std::vector<double> sa;
+    };
+
+    double norm(const std::vector<double>& v)
+    {
+        double s = 0.0;
+        for (std::size_t i = 0; i < v.size(); ++i) {
+            s += v[i]*v[i];
+        }
+        return std::sqrt(s);
+    }
+
+} // anonymous namespace
+
+
+BOOST_AUTO_TEST_CASE(AmgSolvesPoisson)
+{
+    const int nx = 60;
+    const int ny = 50;
+    const Poisson sys(nx, ny, std::vector<double>(nx*ny, 1.0));
+    std::vector<double> b(sys.n, 0.0);
+    b[sys.n - 1] = 1.0;
+    b[sys.n/2] = -0.5;
+
+    parameter::ParameterGroup param;
+    param.insertParameter("linsolver", "amg");
+    param.insertParameter("linsolver_residual_tolerance", "1e-10");
+    LinearSolverFactory solver(param);
+    std::vector<double> x(sys.n, 0.0);
+    const LinearSolverInterface::LinearSolverReport rep =
+        solver.solve(sys.n, sys.ia.back(), &sys.ia[0], &sys.ja[0], &sys.sa[0], &b[0], &x[0]);
+    BOOST_CHECK(rep.converged);
+    BOOST_CHECK(rep.iterations < 30);
+    BOOST_CHECK(rep.residual_reduction <= 1e-10);
+    BOOST_CHECK(sys.residualNorm(x, b) <= 1e-9 * norm(b));
+}
+
+
+BOOST_AUTO_TEST_CASE(AmgSolvesHeterogeneous)
+{
+    const int nx = 40;
+    const int ny = 40;
+    std::vector<double> k(nx*ny);
+    std::srand(2013);
+    for (int c = 0; c < nx*ny; ++c) {
+        k[c] = std::pow(10.0, 4.0*double(std::rand())/RAND_MAX - 2.0);
+    }
+    const Poisson sys(nx, ny, k);
+    std::vector<double> b(sys.n, 0.0);
+    b[sys.n - 1] = 1.0;
+
+    for (int smoother = 0; smoother < 2; ++smoother) {
+        parameter::ParameterGroup param;
+        param.insertParameter("linsolver_amg_smoother", smoother == 0 ? "0" : "1");
+        param.insertParameter("linsolver_amg_coarse_size", "50");
+        LinearSolverAmg solver(param);
+        std::vector<double> x(sys.n, 0.0);
+        const LinearSolverInterface::LinearSolverReport rep =
+            solver.solve(sys.n, sys.ia.back(), &sys.ia[0], &sys.ja[0], &sys.sa[0], &b[0], &x[0]);
+        BOOST_CHECK(rep.converged);
+        BOOST_CHECK(rep.iterations < 60);
+        BOOST_CHECK(sys.residualNorm(x, b) <= 1e-7 * norm(b));
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(AmgWarmStart)
+{
+    const int nx = 50;
+    const int ny = 50;
+    const Poisson sys(nx, ny, std::vector<double>(nx*ny, 1.0));
+    std::vector<double> b(sys.n, 0.0);
+    b[sys.n - 1] = 1.0;
+
+    parameter::ParameterGroup param;
+    param.insertParameter("linsolver_warm_start", "true");
+    LinearSolverAmg warm(param);
+    LinearSolverAmg cold;
+
+    std::vector<double> x(sys.n, 0.0);
+    cold.solve(sys.n, sys.ia.back(), &sys.ia[0], &sys.ja[0], &sys.sa[0], &b[0], &x[0]);
+
+    // A slightly modified right hand side, as from a slowly
+    // varying problem, started from the previous solution.
+    b[sys.n - 2] = 1e-3;
+    std::vector<double> x_cold(x);
+    const LinearSolverInterface::LinearSolverReport rep_cold =
+        cold.solve(sys.n, sys.ia.back(), &sys.ia[0], &sys.ja[0], &sys.sa[0], &b[0], &x_cold[0]);
+    std::vector<double> x_warm(x);
+    const LinearSolverInterface::LinearSolverReport rep_warm =
+        warm.solve(sys.n, sys.ia.back(), &sys.ia[0], &sys.ja[0], &sys.sa[0], &b[0], &x_warm[0]);
+    BOOST_CHECK(rep_cold.converged);
+    BOOST_CHECK(rep_warm.converged);
+    BOOST_CHECK(rep_warm.iterations < rep_cold.iterations);
+    BOOST_CHECK(sys.residualNorm(x_warm, b) <= 1e-8 * norm(b));
+
+    // The exact solution as guess needs no iterations.
+    const LinearSolverInterface::LinearSolverReport rep_exact =
+        warm.solve(sys.n, sys.ia.back(), &sys.ia[0], &sys.ja[0], &sys.sa[0], &b[0], &x_warm[0]);
+    BOOST_CHECK(rep_exact.converged);
+    BOOST_CHECK_EQUAL(rep_exact.iterations, 0);
+
+    // A guess worse than zero is discarded.
+    std::vector<double> x_bad(sys.n, 1e6);
+    const LinearSolverInterface::LinearSolverReport rep_bad =
+        warm.solve(sys.n, sys.ia.back(), &sys.ia[0], &sys.ja[0], &sys.sa[0], &b[0], &x_bad[0]);
+    BOOST_CHECK(rep_bad.converged);
+    BOOST_CHECK(rep_bad.iterations <= rep_cold.iterations);
+}
+
+
+namespace
+{
+
+    // Solver counting calls, to exercise the default solveMultiple().
+    class CountingSolver : public LinearSolverAmg
+    {
+    public:
+        CountingSolver() : calls(0) {}
+        using LinearSolverInterface::solveMultiple;
+        virtual LinearSolverReport solve(const int size, const int nonzeros,
+                                         const int* ia, const int* ja, const double* sa,
+                                         const double* rhs, double* solution) const
+        {
+            ++calls;
+            return LinearSolverAmg::solve(size, nonzeros, ia, ja, sa, rhs, solution);
+        }
+        virtual LinearSolverReport solveMultiple(const int size, const int nonzeros,
+                                                 const int* ia, const int* ja, const double* sa,
+                                                 const int nrhs, const double* rhs,
+                                                 double* solution) const
+        {
+            return LinearSolverInterface::solveMultiple(size, nonzeros, ia, ja, sa,
+                                                        nrhs, rhs, solution);
+        }
+        mutable int calls;
+    };
+
+} // anonymous namespace
+
+
+BOOST_AUTO_TEST_CASE(AmgMultipleRightHandSides)
+{
+    const int nx = 30;
+    const int ny = 30;
+    const Poisson sys(nx, ny, std::vector<double>(nx*ny, 1.0));
+    const int nrhs = 4;
+    std::vector<double> b(nrhs*sys.n, 0.0);
+    for (int k = 0; k < nrhs; ++k) {
+        b[k*sys.n + (k + 1)*sys.n/(nrhs + 1)] = 1.0;
+    }
+
+    parameter::ParameterGroup param;
+    param.insertParameter("linsolver", "amg");
+    LinearSolverFactory solver(param);
+    std::vector<double> x(nrhs*sys.n, 0.0);
+    const LinearSolverInterface::LinearSolverReport rep =
+        solver.solveMultiple(sys.n, sys.ia.back(), &sys.ia[0], &sys.ja[0], &sys.sa[0],
+                             nrhs, &b[0], &x[0]);
+    BOOST_CHECK(rep.converged);
+
+    // Must agree with separate solves, through the default
+    // implementation as well.
+    CountingSolver counting;
+    std::vector<double> y(nrhs*sys.n, 0.0);
+    const LinearSolverInterface::LinearSolverReport rep_default =
+        counting.solveMultiple(sys.n, sys.ia.back(), &sys.ia[0], &sys.ja[0], &sys.sa[0],
+                               nrhs, &b[0], &y[0]);
+    BOOST_CHECK(rep_default.converged);
+    BOOST_CHECK_EQUAL(counting.calls, nrhs);
+    BOOST_CHECK_EQUAL(rep.iterations, rep_default.iterations);
+    int single_iterations = 0;
+    for (int k = 0; k < nrhs; ++k) {
+        std::vector<double> bk(b.begin() + k*sys.n, b.begin() + (k + 1)*sys.n);
+        std::vector<double> xk(sys.n, 0.0);
+        const LinearSolverInterface::LinearSolverReport r =
+            solver.solve(sys.n, sys.ia.back(), &sys.ia[0], &sys.ja[0], &sys.sa[0], &bk[0], &xk[0]);
+        single_iterations += r.iterations;
+        for (int i = 0; i < sys.n; ++i) {
+            BOOST_CHECK_CLOSE(x[k*sys.n + i], xk[i], 1e-10);
+            BOOST_CHECK_CLOSE(y[k*sys.n + i], xk[i], 1e-10);
+        }
+        BOOST_CHECK(sys.residualNorm(xk, bk) <= 1e-8 * norm(bk));
+    }
+    BOOST_CHECK_EQUAL(rep.iterations, single_iterations);
+}
+
+
+BOOST_AUTO_TEST_CASE(AmgSinglePrecision)
+{
+    const int nx = 40;
+    const int ny = 40;
+    std::vector<double> k(nx*ny);
+    std::srand(2013);
+    for (int c = 0; c < nx*ny; ++c) {
+        k[c] = std::pow(10.0, 4.0*double(std::rand())/RAND_MAX - 2.0);
+    }
+    const Poisson sys(nx, ny, k);
+    std::vector<double> b(sys.n, 0.0);
+    b[sys.n - 1] = 1.0;
+
+    parameter::ParameterGroup param;
+    param.insertParameter("linsolver_residual_tolerance", "1e-10");
+    param.insertParameter("linsolver_single_precision_amg", "true");
+    param.insertParameter("linsolver_precision_comparison", "true");
+    LinearSolverAmg solver(param);
+    std::vector<double> x(sys.n, 0.0);
+    const LinearSolverInterface::LinearSolverReport rep =
+        solver.solve(sys.n, sys.ia.back(), &sys.ia[0], &sys.ja[0], &sys.sa[0], &b[0], &x[0]);
+    BOOST_CHECK(rep.converged);
+    BOOST_CHECK(rep.reference_iterations > 0);
+    BOOST_CHECK(rep.iterations <= rep.reference_iterations + 5);
+    // The outer iteration is in double precision, so single
+    // precision in the preconditioner does not limit accuracy.
+    BOOST_CHECK(rep.true_residual_reduction <= 1e-9);
+    BOOST_CHECK(sys.residualNorm(x, b) <= 1e-9 * norm(b));
+
+    // Without the comparison no reference solve is made.
+    parameter::ParameterGroup plain;
+    plain.insertParameter("linsolver_single_precision_amg", "true");
+    LinearSolverAmg single(plain);
+    std::vector<double> y(sys.n, 0.0);
+    const LinearSolverInterface::LinearSolverReport rep_plain =
+        single.solve(sys.n, sys.ia.back(), &sys.ia[0], &sys.ja[0], &sys.sa[0], &b[0], &y[0]);
+    BOOST_CHECK(rep_plain.converged);
+    BOOST_CHECK_EQUAL(rep_plain.reference_iterations, 0);
+}
+
+
+#if HAVE_DUNE_ISTL
+BOOST_AUTO_TEST_CASE(IstlSinglePrecisionAmg)
+{
+    const int nx = 40;
+    const int ny = 40;
+    std::vector<double> k(nx*ny);
+    std::srand(2013);
+    for (int c = 0; c < nx*ny; ++c) {
+        k[c] = std::pow(10.0, 4.0*double(std::rand())/RAND_MAX - 2.0);
+    }
+    const Poisson sys(nx, ny, k);
+
+    // Neither the right hand side nor the initial guess is exactly
+    // representable in single precision.
+    std::vector<double> b(sys.n), x0(sys.n);
+    for (int c = 0; c < sys.n; ++c) {
+        b[c] = 1.0 + double(std::rand())/RAND_MAX/3.0;
+        x0[c] = double(std::rand())/RAND_MAX/7.0;
+    }
+
+    parameter::ParameterGroup param;
+    param.insertParameter("linsolver_residual_tolerance", "1e-10");
+    param.insertParameter("linsolver_single_precision_amg", "true");
+    param.insertParameter("linsolver_precision_comparison", "true");
+    param.insertParameter("linsolver_warm_start", "true");
+    LinearSolverIstl solver(param);
+    std::vector<double> x(x0);
+    const LinearSolverInterface::LinearSolverReport rep =
+        solver.solve(sys.n, sys.ia.back(), &sys.ia[0], &sys.ja[0], &sys.sa[0], &b[0], &x[0]);
+    BOOST_CHECK(rep.converged);
+    BOOST_CHECK(rep.reference_iterations > 0);
+    BOOST_CHECK(rep.iterations <= rep.reference_iterations + 5);
+    // The preconditioner does not round the right hand side or the
+    // iterate of the double precision Krylov solver, so the solution
+    // is as accurate as with a double precision hierarchy.
+    BOOST_CHECK(sys.residualNorm(x, b) <= 1e-9 * norm(b));
+}
+#endif
@@ -0,0 +1,290 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+
+#if HAVE_DYNAMIC_BOOST_TEST
+#define BOOST_TEST_DYN_LINK
+#endif
+#define NVERBOSE // to suppress our messages when throwing
+
+#define BOOST_TEST_MODULE MsmfemTest
+#include <boost/test/unit_test.hpp>
+
+#include <opm/core/pressure/msmfem/ifsh_ms.h>
+#include <opm/core/pressure/msmfem/coarse_conn.h>
+#include <opm/core/pressure/msmfem/coarse_sys.h>
+#include <opm/core/pressure/msmfem/partition.h>
+#include <opm/core/linalg/sparse_sys.h>
+#include <opm/core/grid/GridManager.hpp>
+#include <opm/core/grid.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+
+    // Dense Gaussian elimination with partial pivoting.  The local
+    // systems are small, and this avoids depending on UMFPACK.
+    void denseSolve(CSRMatrix* A, double* b, double* x)
+    {
+        const int n = A->m;
+        std::vector<double> M(n*n, 0.0);
+        std::vector<double> r(b, b + n);
+        for (int i = 0; i < n; ++i) {
+            for (int k = A->ia[i]; k < A->ia[i + 1]; ++k) {
+                M[i*n + A->ja[k]] = A->sa[k];
+            }
+        }
+        for (int k = 0; k < n; ++k) {
+            int piv = k;
+            for (int i = k + 1; i < n; ++i) {
+                if (std::fabs(M[i*n + k]) > std::fabs(M[piv*n + k])) {
+                    piv = i;
+                }
+            }
+            if (piv != k) {
+                std::swap_ranges(&M[k*n], &M[k*n] + n, &M[piv*n]);
+                std::swap(r[k], r[piv]);
+            }
+            for (int i = k + 1; i < n; ++i) {
+                const double f = M[i*n + k] / M[k*n + k];
+                for (int j = k; j < n; ++j) {
+                    M[i*n + j] -= f * M[k*n + j];
+                }
+                r[i] -= f * r[k];
+            }
+        }
+        for (int i = n - 1; i >= 0; --i) {
+            double s = r[i];
+            for (int j = i + 1; j < n; ++j) {
+                s -= M[i*n + j] * x[j];
+            }
+            x[i] = s / M[i*n + i];
+        }
+    }
+
+} // anonymous namespace
+
+
+BOOST_AUTO_TEST_CASE(BasisUpdateMatchesConstruction)
+{
+    Opm::GridManager gm(12, 12);
+    UnstructuredGrid* grid = const_cast<UnstructuredGrid*>(gm.c_grid());
+    const int nc = grid->number_of_cells;
+
+    int fine_dims[2] = { 12, 12 };
+    int coarse_dims[2] = { 3, 3 };
+    std::vector<int> idx(nc), p(nc);
+    for (int c = 0; c < nc; ++c) {
+        idx[c] = c;
+    }
+    partition_unif_idx(2, nc, fine_dims, coarse_dims, &idx[0], &p[0]);
+
+    std::vector<double> perm(4*nc, 0.0), src(nc, 0.0), totmob(nc);
+    for (int c = 0; c < nc; ++c) {
+        perm[4*c + 0] = perm[4*c + 3] = 1.0 + 0.5*std::sin(double(c));
+        totmob[c] = 1.0 + 0.3*std::cos(0.7*c);
+    }
+    src[0] = 1.0;
+    src[nc - 1] = -1.0;
+
+    ifsh_ms_data* h = ifsh_ms_construct(grid, &p[0], &perm[0], &src[0],
+                                        &totmob[0], denseSolve);
+    BOOST_REQUIRE(h != 0);
+    BOOST_CHECK_EQUAL(ifsh_ms_update_basis(grid, &totmob[0], 1e-6,
+                                           denseSolve, h), 0);
+
+    // Change mobility in the centre block only.
+    for (int c = 0; c < nc; ++c) {
+        if (p[c] == 4) {
+            totmob[c] *= 3.0;
+        }
+    }
+    BOOST_CHECK_EQUAL(ifsh_ms_update_basis(grid, &totmob[0], 1e-6,
+                                           denseSolve, h), 1);
+    ifsh_ms_assemble(&src[0], &totmob[0], h);
+
+    ifsh_ms_data* ref = ifsh_ms_construct(grid, &p[0], &perm[0], &src[0],
+                                          &totmob[0], denseSolve);
+    BOOST_REQUIRE(ref != 0);
+    ifsh_ms_assemble(&src[0], &totmob[0], ref);
+
+    BOOST_REQUIRE_EQUAL(h->A->nnz, ref->A->nnz);
+    for (size_t i = 0; i < h->A->nnz; ++i) {
+        BOOST_CHECK_CLOSE(h->A->sa[i], ref->A->sa[i], 1e-10);
+    }
+    for (size_t i = 0; i < h->A->m; ++i) {
+        BOOST_CHECK_SMALL(h->b[i] - ref->b[i], 1e-12);
+    }
+
+    ifsh_ms_destroy(ref);
+    ifsh_ms_destroy(h);
+}
+
+
+BOOST_AUTO_TEST_CASE(BasisIgnoresMobilityOutsideSupport)
+{
+    // Each basis function is supported on the two blocks of its
+    // coarse face, and must not depend on the mobility elsewhere.
+    // Cell ordering is row-wise, so the cell before the first cell of
+    // each row of a block belongs to a different block.
+    Opm::GridManager gm(12, 12);
+    UnstructuredGrid* grid = const_cast<UnstructuredGrid*>(gm.c_grid());
+    const int nc = grid->number_of_cells;
+
+    int fine_dims[2] = { 12, 12 };
+    int coarse_dims[2] = { 3, 3 };
+    std::vector<int> idx(nc), p(nc);
+    for (int c = 0; c < nc; ++c) {
+        idx[c] = c;
+    }
+    partition_unif_idx(2, nc, fine_dims, coarse_dims, &idx[0], &p[0]);
+
+    std::vector<double> perm(4*nc, 0.0), src(nc, 0.0), totmob(nc, 1.0);
+    for (int c = 0; c < nc; ++c) {
+        perm[4*c + 0] = perm[4*c + 3] = 1.0;
+    }
+    src[0] = 1.0;
+    src[nc - 1] = -1.0;
+
+    coarse_topology* ct = coarse_topology_create(nc, grid->number_of_faces, 256,
+                                                 &p[0], grid->face_cells);
+    BOOST_REQUIRE(ct != 0);
+    coarse_sys* ref = coarse_sys_construct(grid, &p[0], ct, &perm[0], &src[0],
+                                           &totmob[0], denseSolve);
+    BOOST_REQUIRE(ref != 0);
+
+    // Vary the mobility within the centre block.  The basis functions
+    // of the corner block at the origin are for faces to blocks that
+    // do not touch the centre block.
+    const int centre = p[4*12 + 4];
+    const int corner = p[0];
+    for (int c = 0; c < nc; ++c) {
+        if (p[c] == centre) {
+            totmob[c] = 1.0 + (c % 5);
+        }
+    }
+    coarse_sys* sys = coarse_sys_construct(grid, &p[0], ct, &perm[0], &src[0],
+                                           &totmob[0], denseSolve);
+    BOOST_REQUIRE(sys != 0);
+
+    for (int i = ref->basis_pos[corner]; i < ref->basis_pos[corner + 1]; ++i) {
+        BOOST_CHECK_SMALL(sys->basis[i] - ref->basis[i], 1e-12);
+    }
+    double change = 0.0;
+    for (int i = ref->basis_pos[centre]; i < ref->basis_pos[centre + 1]; ++i) {
+        change = std::max(change, std::fabs(sys->basis[i] - ref->basis[i]));
+    }
+    BOOST_CHECK(change > 1e-3);
+
+    coarse_sys_destroy(sys);
+    coarse_sys_destroy(ref);
+    coarse_topology_destroy(ct);
+}
+
+
+namespace
+{
+
+    double cutWeight(const UnstructuredGrid& grid, const std::vector<double>& trans,
+                     const std::vector<int>& p)
+    {
+        double cut = 0.0;
+        for (int f = 0; f < grid.number_of_faces; ++f) {
+            const int c0 = grid.face_cells[2*f];
+            const int c1 = grid.face_cells[2*f + 1];
+            if (c0 >= 0 && c1 >= 0 && p[c0] != p[c1]) {
+                cut += trans[f];
+            }
+        }
+        return cut;
+    }
+
+} // anonymous namespace
+
+
+BOOST_AUTO_TEST_CASE(GraphPartitionFollowsTransmissibility)
+{
+    Opm::GridManager gm(40, 40);
+    UnstructuredGrid* grid = const_cast<UnstructuredGrid*>(gm.c_grid());
+    const int nc = grid->number_of_cells;
+    const int nf = grid->number_of_faces;
+
+    // Unit transmissibility, except across a nearly sealing barrier
+    // in the x direction between columns 23 and 24.
+    std::vector<double> trans(nf, 1.0);
+    for (int f = 0; f < nf; ++f) {
+        const int c0 = grid->face_cells[2*f];
+        const int c1 = grid->face_cells[2*f + 1];
+        if (c0 >= 0 && c1 >= 0 && c0 % 40 == 23 && c1 % 40 == 24) {
+            trans[f] = 1e-6;
+        }
+    }
+    std::vector<double> pv(nc, 1.0);
+    for (int c = 0; c < nc; ++c) {
+        if (c % 40 >= 24) {
+            pv[c] = 1.5;   // Balances the two sides of the barrier.
+        }
+    }
+
+    std::vector<int> p(nc, -1);
+    BOOST_REQUIRE_EQUAL(partition_graph(nc, nf, grid->face_cells, &trans[0], &pv[0],
+                                        2, 1.05, &p[0]), nc);
+    BOOST_CHECK(cutWeight(*grid, trans, p) < 1e-3);
+
+    // Unweighted partitioning is balanced and no worse than logical boxes.
+    const int nblk = 16;
+    const double ubfactor = 1.05;
+    BOOST_REQUIRE_EQUAL(partition_graph(nc, nf, grid->face_cells, 0, 0,
+                                        nblk, ubfactor, &p[0]), nc);
+    std::vector<int> count(nblk, 0);
+    for (int c = 0; c < nc; ++c) {
+        BOOST_REQUIRE(p[c] >= 0 && p[c] < nblk);
+        ++count[p[c]];
+    }
+    for (int b = 0; b < nblk; ++b) {
+        BOOST_CHECK(count[b] > 0);
+        BOOST_CHECK(count[b] <= ubfactor * nc / nblk);
+    }
+    std::vector<double> unit(nf, 1.0);
+    int fine_dims[2] = { 40, 40 };
+    int coarse_dims[2] = { 4, 4 };
+    std::vector<int> idx(nc), pbox(nc);
+    for (int c = 0; c < nc; ++c) {
+        idx[c] = c;
+    }
+    partition_unif_idx(2, nc, fine_dims, coarse_dims, &idx[0], &pbox[0]);
+    BOOST_CHECK(cutWeight(*grid, unit, p) <= 1.25 * cutWeight(*grid, unit, pbox));
+
+    // The result is usable for multiscale discretisation.
+    partition_split_disconnected(nc, nf, grid->face_cells, &p[0]);
+    partition_compress(nc, &p[0]);
+    std::vector<double> perm(4*nc, 0.0), src(nc, 0.0), totmob(nc, 1.0);
+    for (int c = 0; c < nc; ++c) {
+        perm[4*c + 0] = perm[4*c + 3] = 1.0;
+    }
+    src[0] = 1.0;
+    src[nc - 1] = -1.0;
+    ifsh_ms_data* h = ifsh_ms_construct(grid, &p[0], &perm[0], &src[0],
+                                        &totmob[0], denseSolve);
+    BOOST_CHECK(h != 0);
+    ifsh_ms_destroy(h);
+}
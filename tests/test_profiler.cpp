@@ -0,0 +1,128 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+
+#if HAVE_DYNAMIC_BOOST_TEST
+#define BOOST_TEST_DYN_LINK
+#endif
+#define NVERBOSE // to suppress our messages when throwing
+
+#define BOOST_TEST_MODULE ProfilerTest
+#include <boost/test/unit_test.hpp>
+
+#include <opm/core/utility/Profiler.hpp>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Opm;
+
+namespace
+{
+
+    const profiling::Entry* find(const std::vector<profiling::Entry>& entries,
+                                 const std::string& name)
+    {
+        for (std::size_t i = 0; i < entries.size(); ++i) {
+            if (entries[i].name == name) {
+                return &entries[i];
+            }
+        }
+        return 0;
+    }
+
+    void work(const int timer, const int counter, const int n)
+    {
+        profiling::Registry& reg = profiling::Registry::instance();
+        for (int i = 0; i < n; ++i) {
+            profiling::ScopedTimer t(timer);
+            reg.addCount(counter, 2);
+        }
+    }
+
+} // anonymous namespace
+
+
+BOOST_AUTO_TEST_CASE(AggregatesOverThreads)
+{
+    profiling::Registry& reg = profiling::Registry::instance();
+    reg.reset();
+    const int timer = reg.timerId("test/timer");
+    const int counter = reg.counterId("test/counter");
+    BOOST_CHECK_EQUAL(reg.timerId("test/timer"), timer);
+    BOOST_CHECK_THROW(reg.counterId("test/timer"), std::runtime_error);
+    reg.timerId("test/unused");
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.push_back(std::thread(work, timer, counter, 100 + t));
+    }
+    for (int t = 0; t < 4; ++t) {
+        threads[t].join();
+    }
+    work(timer, counter, 10);
+
+    const std::vector<profiling::Entry> entries = reg.entries();
+    BOOST_CHECK(find(entries, "test/unused") == 0);
+    const profiling::Entry* te = find(entries, "test/timer");
+    const profiling::Entry* ce = find(entries, "test/counter");
+    BOOST_REQUIRE(te != 0 && ce != 0);
+    BOOST_CHECK(ce < te); // Sorted by name.
+    BOOST_CHECK_EQUAL(te->kind, profiling::Timer);
+    BOOST_CHECK_EQUAL(te->calls, 416);
+    BOOST_CHECK_EQUAL(te->num_threads, 5);
+    BOOST_CHECK(te->min_seconds <= te->max_seconds);
+    BOOST_CHECK(te->max_thread_seconds <= te->total_seconds);
+    BOOST_CHECK_EQUAL(ce->kind, profiling::Counter);
+    BOOST_CHECK_EQUAL(ce->calls, 416);
+    BOOST_CHECK_EQUAL(ce->count, 832);
+
+    std::ostringstream json;
+    profiling::writeJson(json, entries);
+    BOOST_CHECK(json.str().find("\"name\": \"test/counter\", \"kind\": \"counter\", \"calls\": 416")
+                != std::string::npos);
+    std::ostringstream csv;
+    profiling::writeCsv(csv, entries);
+    BOOST_CHECK(csv.str().find("\ntest/counter,counter,416,5,832,") != std::string::npos);
+
+    reg.reset();
+    BOOST_CHECK(find(reg.entries(), "test/timer") == 0);
+}
+
+
+BOOST_AUTO_TEST_CASE(Macros)
+{
+    profiling::Registry::instance().reset();
+    for (int i = 0; i < 3; ++i) {
+        OPM_PROFILE_SCOPE("test/macro_scope");
+        OPM_PROFILE_COUNT("test/macro_count", i);
+    }
+    const std::vector<profiling::Entry> entries = profiling::Registry::instance().entries();
+    const profiling::Entry* te = find(entries, "test/macro_scope");
+    const profiling::Entry* ce = find(entries, "test/macro_count");
+    if (profiling::enabled()) {
+        BOOST_REQUIRE(te != 0 && ce != 0);
+        BOOST_CHECK_EQUAL(te->calls, 3);
+        BOOST_CHECK_EQUAL(ce->count, 3);
+    } else {
+        BOOST_CHECK(te == 0 && ce == 0);
+    }
+}
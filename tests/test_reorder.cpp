@@ -0,0 +1,497 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+
+#if HAVE_DYNAMIC_BOOST_TEST
+#define BOOST_TEST_DYN_LINK
+#endif
+#define NVERBOSE // to suppress our messages when throwing
+
+#define BOOST_TEST_MODULE ReorderTest
+#include <boost/test/unit_test.hpp>
+
+#include <opm/core/transport/reorder/ReorderSolverInterface.hpp>
+#include <opm/core/transport/reorder/reordersequence.h>
+#include <opm/core/transport/reorder/TransportSolverTwophaseReorder.hpp>
+#include <opm/core/props/IncompPropertiesBasic.hpp>
+#include <opm/core/simulator/TwophaseState.hpp>
+#include <opm/core/grid/GridManager.hpp>
+#include <opm/core/grid.h>
+#include <opm/core/utility/RootFinders.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <numeric>
+#include <vector>
+
+using namespace Opm;
+
+namespace
+{
+
+    // Records the order in which cells are visited.
+    class RecordingSolver : public ReorderSolverInterface
+    {
+    public:
+        void run(const UnstructuredGrid& grid, const double* flux)
+        {
+            order_.clear();
+            component_.assign(grid.number_of_cells, -1);
+            num_components_ = 0;
+            reorderAndTransport(grid, flux);
+        }
+        const std::vector<int>& seq() const { return sequence(); }
+        const std::vector<int>& comps() const { return components(); }
+        const std::vector<int>& levs() const { return levels(); }
+        std::vector<int> order_;
+        std::vector<int> component_;
+        int num_components_;
+    private:
+        virtual void solveSingleCell(const int cell)
+        {
+            solveMultiCell(1, &cell);
+        }
+        virtual void solveMultiCell(const int num_cells, const int* cells)
+        {
+            for (int i = 0; i < num_cells; ++i) {
+                order_.push_back(cells[i]);
+                component_[cells[i]] = num_components_;
+            }
+            ++num_components_;
+        }
+    };
+
+    // Check that all upwind neighbours of a cell are in an earlier
+    // or the same component.
+    void checkCausal(const UnstructuredGrid& grid, const std::vector<double>& flux,
+                     const RecordingSolver& solver)
+    {
+        BOOST_REQUIRE_EQUAL(int(solver.order_.size()), grid.number_of_cells);
+        for (int f = 0; f < grid.number_of_faces; ++f) {
+            const int c0 = grid.face_cells[2*f];
+            const int c1 = grid.face_cells[2*f + 1];
+            if (c0 < 0 || c1 < 0 || flux[f] == 0.0) {
+                continue;
+            }
+            const int up = flux[f] > 0.0 ? c0 : c1;
+            const int down = flux[f] > 0.0 ? c1 : c0;
+            BOOST_CHECK(solver.component_[up] <= solver.component_[down]);
+        }
+    }
+
+    // Check that a level-sorted sequence is a permutation, and that
+    // upwind cells are in a strictly lower level or in the same
+    // component.
+    void checkLevels(const UnstructuredGrid& grid, const std::vector<double>& flux,
+                     const std::vector<int>& sequence, const std::vector<int>& components,
+                     const std::vector<int>& levels)
+    {
+        const int nc = grid.number_of_cells;
+        const int ncomp = components.size() - 1;
+        const int nlevels = levels.size() - 1;
+        BOOST_REQUIRE_EQUAL(int(sequence.size()), nc);
+        std::vector<int> sorted(sequence);
+        std::sort(sorted.begin(), sorted.end());
+        for (int c = 0; c < nc; ++c) {
+            BOOST_REQUIRE_EQUAL(sorted[c], c);
+        }
+        BOOST_REQUIRE_EQUAL(levels[0], 0);
+        BOOST_REQUIRE_EQUAL(levels[nlevels], ncomp);
+        BOOST_REQUIRE_EQUAL(components[ncomp], nc);
+        std::vector<int> cell_level(nc), cell_comp(nc);
+        for (int l = 0; l < nlevels; ++l) {
+            for (int k = levels[l]; k < levels[l + 1]; ++k) {
+                for (int i = components[k]; i < components[k + 1]; ++i) {
+                    cell_level[sequence[i]] = l;
+                    cell_comp[sequence[i]] = k;
+                }
+            }
+        }
+        for (int f = 0; f < grid.number_of_faces; ++f) {
+            const int c0 = grid.face_cells[2*f];
+            const int c1 = grid.face_cells[2*f + 1];
+            if (c0 < 0 || c1 < 0 || flux[f] == 0.0) {
+                continue;
+            }
+            const int up = flux[f] > 0.0 ? c0 : c1;
+            const int down = flux[f] > 0.0 ? c1 : c0;
+            if (cell_comp[up] != cell_comp[down]) {
+                BOOST_CHECK(cell_level[up] < cell_level[down]);
+            }
+        }
+    }
+
+    // Set the flux across the face between cells from and to so that
+    // it flows from the first to the second.
+    void setFlow(const UnstructuredGrid& grid, const int from, const int to,
+                 std::vector<double>& flux)
+    {
+        for (int hf = grid.cell_facepos[from]; hf < grid.cell_facepos[from + 1]; ++hf) {
+            const int f = grid.cell_faces[hf];
+            if (grid.face_cells[2*f] == to || grid.face_cells[2*f + 1] == to) {
+                flux[f] = grid.face_cells[2*f] == from ? 1.0 : -1.0;
+            }
+        }
+    }
+
+    // Check that two sequences have the same strongly connected
+    // components, possibly in different order.
+    void checkSameComponents(const int nc,
+                             const std::vector<int>& sequence, const std::vector<int>& components,
+                             const std::vector<int>& ref_sequence, const std::vector<int>& ref_components)
+    {
+        BOOST_REQUIRE_EQUAL(components.size(), ref_components.size());
+        std::vector<int> ref_comp(nc);
+        for (int k = 0; k + 1 < int(ref_components.size()); ++k) {
+            for (int i = ref_components[k]; i < ref_components[k + 1]; ++i) {
+                ref_comp[ref_sequence[i]] = k;
+            }
+        }
+        for (int k = 0; k + 1 < int(components.size()); ++k) {
+            const int first = ref_comp[sequence[components[k]]];
+            BOOST_CHECK_EQUAL(components[k + 1] - components[k],
+                              ref_components[first + 1] - ref_components[first]);
+            for (int i = components[k]; i < components[k + 1]; ++i) {
+                BOOST_CHECK_EQUAL(ref_comp[sequence[i]], first);
+            }
+        }
+    }
+
+    // Two saturation function regions, with end points that vary
+    // from cell to cell. Relative permeabilities are powers of the
+    // water saturation normalised by the cell's saturation range.
+    class ScaledRegionProps : public IncompPropertiesBasic
+    {
+    public:
+        ScaledRegionProps(const std::vector<double>& rho, const std::vector<double>& mu,
+                          const int num_cells)
+            : IncompPropertiesBasic(2, SaturationPropsBasic::Linear, rho, mu,
+                                    0.2, 1e-13, 2, num_cells)
+        {
+        }
+        virtual void relperm(const int n, const double* s, const int* cells,
+                             double* kr, double* dkrds) const
+        {
+            for (int i = 0; i < n; ++i) {
+                const int c = cells[i];
+                const double range = swmax(c) - swmin(c);
+                const double t = std::min(std::max((s[2*i] - swmin(c))/range, 0.0), 1.0);
+                const double inside = (t > 0.0 && t < 1.0) ? 1.0 : 0.0;
+                const double p = 2.0 + region(c);
+                kr[2*i] = std::pow(t, p);
+                kr[2*i + 1] = (1.0 - t)*(1.0 - t);
+                if (dkrds) {
+                    double* d = dkrds + 4*i;
+                    d[0] = inside*p*std::pow(t, p - 1.0)/range;
+                    d[1] = 0.0;
+                    d[2] = 0.0;
+                    d[3] = inside*2.0*(1.0 - t)/range;
+                }
+            }
+        }
+        virtual void satRange(const int n, const int* cells,
+                              double* smin, double* smax) const
+        {
+            for (int i = 0; i < n; ++i) {
+                const int c = cells[i];
+                smin[2*i] = swmin(c);
+                smax[2*i] = swmax(c);
+                smin[2*i + 1] = 1.0 - swmax(c);
+                smax[2*i + 1] = 1.0 - swmin(c);
+            }
+        }
+        virtual void satRegion(const int n, const int* cells, int* regions) const
+        {
+            for (int i = 0; i < n; ++i) {
+                regions[i] = region(cells[i]);
+            }
+        }
+    private:
+        static int region(const int c) { return c % 2; }
+        static double swmin(const int c) { return 0.05*(c % 4); }
+        static double swmax(const int c) { return 1.0 - 0.05*(c % 3); }
+    };
+
+    // f(x) = (x - 1/2)^3. Newton iterates from above converge
+    // linearly and never bracket the zero.
+    struct Cubic
+    {
+        double operator()(const double x) const
+        {
+            return (x - 0.5)*(x - 0.5)*(x - 0.5);
+        }
+        double operator()(const double x, double& dfdx) const
+        {
+            dfdx = 3.0*(x - 0.5)*(x - 0.5);
+            return (*this)(x);
+        }
+    };
+
+} // anonymous namespace
+
+
+BOOST_AUTO_TEST_CASE(IncrementalMatchesFull)
+{
+    GridManager gm(12, 10);
+    const UnstructuredGrid& grid = *gm.c_grid();
+
+    // Start with a diagonal flow field, then flip a few faces per step.
+    std::vector<double> flux(grid.number_of_faces, 1.0);
+    std::srand(1234);
+    RecordingSolver incremental;
+    incremental.setIncrementalReordering(true, 0.5);
+    RecordingSolver full;
+    for (int step = 0; step < 20; ++step) {
+        for (int flip = 0; flip < 3; ++flip) {
+            const int f = std::rand() % grid.number_of_faces;
+            flux[f] = -flux[f];
+        }
+        incremental.run(grid, &flux[0]);
+        full.run(grid, &flux[0]);
+        checkCausal(grid, flux, incremental);
+        checkLevels(grid, flux, incremental.seq(), incremental.comps(), incremental.levs());
+        BOOST_CHECK(incremental.order_ == incremental.seq());
+        // Same number of strongly connected components means the
+        // incremental update did not leave merged blocks behind.
+        BOOST_CHECK_EQUAL(incremental.num_components_, full.num_components_);
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(SequenceLevels)
+{
+    GridManager gm(9, 7);
+    const UnstructuredGrid& grid = *gm.c_grid();
+    const int nc = grid.number_of_cells;
+
+    // Diagonal flow fields with a few circulating 2x2 blocks and
+    // flipped faces, creating loops with cells both upstream and
+    // downstream of them.
+    const int nx = grid.cartdims[0];
+    const int ny = grid.cartdims[1];
+    std::srand(4321);
+    for (int sample = 0; sample < 20; ++sample) {
+        std::vector<double> flux(grid.number_of_faces, 1.0);
+        for (int flip = 0; flip < sample; ++flip) {
+            const int f = std::rand() % grid.number_of_faces;
+            flux[f] = -flux[f];
+        }
+        for (int loop = 0; loop < 1 + sample % 3; ++loop) {
+            const int i = std::rand() % (nx - 1);
+            const int j = std::rand() % (ny - 1);
+            const int a = i + nx*j;
+            setFlow(grid, a, a + 1, flux);
+            setFlow(grid, a + 1, a + 1 + nx, flux);
+            setFlow(grid, a + 1 + nx, a + nx, flux);
+            setFlow(grid, a + nx, a, flux);
+        }
+
+        std::vector<int> sequence(nc), components(nc + 1), levels(nc + 1);
+        int ncomp = 0;
+        int nlevels = 0;
+        compute_sequence_levels(&grid, &flux[0], &sequence[0], &components[0], &ncomp,
+                                &levels[0], &nlevels);
+        components.resize(ncomp + 1);
+        levels.resize(nlevels + 1);
+
+        std::vector<int> ref_sequence(nc), ref_components(nc + 1);
+        int ref_ncomp = 0;
+        compute_sequence(&grid, &flux[0], &ref_sequence[0], &ref_components[0], &ref_ncomp);
+        ref_components.resize(ref_ncomp + 1);
+        BOOST_CHECK(ncomp < nc);
+
+        // Same strongly connected components as the tarjan() order.
+        checkLevels(grid, flux, sequence, components, levels);
+        checkSameComponents(nc, sequence, components, ref_sequence, ref_components);
+
+        // Regrouping the tarjan() order by level gives the same levels.
+        std::vector<int> sorted_levels(ref_ncomp + 1);
+        int sorted_nlevels = 0;
+        sort_sequence_levels(&grid, &flux[0], &ref_sequence[0], &ref_components[0], ref_ncomp,
+                             &sorted_levels[0], &sorted_nlevels);
+        sorted_levels.resize(sorted_nlevels + 1);
+        BOOST_CHECK_EQUAL(sorted_nlevels, nlevels);
+        checkLevels(grid, flux, ref_sequence, ref_components, sorted_levels);
+
+        // The solver visits components level by level.
+        RecordingSolver solver;
+        solver.run(grid, &flux[0]);
+        BOOST_CHECK(solver.order_ == sequence);
+        BOOST_CHECK(solver.levs() == levels);
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(NewtonMatchesRegulaFalsi)
+{
+    GridManager gm(20, 1);
+    const UnstructuredGrid& grid = *gm.c_grid();
+    const int nc = grid.number_of_cells;
+
+    std::vector<double> rho(2, 1000.0);
+    std::vector<double> mu(2, 1e-3);
+    mu[1] = 5e-3;
+    IncompPropertiesBasic props(2, SaturationPropsBasic::Quadratic, rho, mu,
+                                0.2, 1e-13, 2, nc);
+
+    // Water injected in the first cell, produced from the last.
+    const double q = 0.1;
+    std::vector<double> source(nc, 0.0);
+    source[0] = q;
+    source[nc - 1] = -q;
+    std::vector<double> porevol(nc, 1.0);
+
+    TwophaseState state_rf;
+    state_rf.init(grid, 2);
+    for (int f = 0; f < grid.number_of_faces; ++f) {
+        if (grid.face_cells[2*f] >= 0 && grid.face_cells[2*f + 1] >= 0) {
+            state_rf.faceflux()[f] = q;
+        }
+    }
+    TwophaseState state_newton = state_rf;
+
+    const double tol = 1e-12;
+    TransportSolverTwophaseReorder rf(grid, props, NULL, tol, 50);
+    TransportSolverTwophaseReorder newton(grid, props, NULL, tol, 50);
+    newton.setUseNewton(true);
+    int rf_iters = 0;
+    int newton_iters = 0;
+    for (int step = 0; step < 10; ++step) {
+        rf.solve(&porevol[0], &source[0], 1.0, state_rf);
+        newton.solve(&porevol[0], &source[0], 1.0, state_newton);
+        const std::vector<int>& rfi = rf.getReorderIterations();
+        const std::vector<int>& ni = newton.getReorderIterations();
+        rf_iters += std::accumulate(rfi.begin(), rfi.end(), 0);
+        newton_iters += std::accumulate(ni.begin(), ni.end(), 0);
+    }
+    for (int c = 0; c < nc; ++c) {
+        BOOST_CHECK(std::fabs(state_rf.saturation()[2*c] - state_newton.saturation()[2*c]) < 1e-9);
+    }
+    BOOST_CHECK(state_newton.saturation()[0] > 0.3);
+    BOOST_CHECK(newton_iters < rf_iters);
+}
+
+
+BOOST_AUTO_TEST_CASE(SafeguardedNewtonIterationBudget)
+{
+    typedef SafeguardedNewton<ContinueOnError> Newton;
+    const Cubic f;
+    int iters = 0;
+
+    // Newton uses the whole budget, leaving none for the fallback.
+    Newton::solve(f, 1.0, 0.0, 1.0, 10, 1e-12, iters);
+    BOOST_CHECK_EQUAL(iters, 11);
+
+    // With a sufficient budget, the method converges within it.
+    const double x = Newton::solve(f, 1.0, 0.0, 1.0, 100, 1e-12, iters);
+    BOOST_CHECK(iters <= 100);
+    BOOST_CHECK(std::fabs(f(x)) < 1e-12);
+}
+
+
+BOOST_AUTO_TEST_CASE(FracFlowTablesMatchDirect)
+{
+    GridManager gm(20, 1);
+    const UnstructuredGrid& grid = *gm.c_grid();
+    const int nc = grid.number_of_cells;
+
+    std::vector<double> rho(2, 1000.0);
+    std::vector<double> mu(2, 1e-3);
+    mu[1] = 5e-3;
+    IncompPropertiesBasic props(2, SaturationPropsBasic::Quadratic, rho, mu,
+                                0.2, 1e-13, 2, nc);
+
+    const double q = 0.1;
+    std::vector<double> source(nc, 0.0);
+    source[0] = q;
+    source[nc - 1] = -q;
+    std::vector<double> porevol(nc, 1.0);
+
+    TwophaseState state_direct;
+    state_direct.init(grid, 2);
+    for (int f = 0; f < grid.number_of_faces; ++f) {
+        if (grid.face_cells[2*f] >= 0 && grid.face_cells[2*f + 1] >= 0) {
+            state_direct.faceflux()[f] = q;
+        }
+    }
+    TwophaseState state_table = state_direct;
+
+    TransportSolverTwophaseReorder direct(grid, props, NULL, 1e-12, 50);
+    TransportSolverTwophaseReorder table(grid, props, NULL, 1e-12, 50);
+    table.setUseNewton(true);
+
+    // Finer tables must be more accurate.
+    const double coarse_error = table.setFractionalFlowTables(11);
+    const double fine_error = table.setFractionalFlowTables(201);
+    BOOST_CHECK(fine_error < coarse_error);
+    BOOST_CHECK(fine_error < 1e-6);
+
+    for (int step = 0; step < 10; ++step) {
+        direct.solve(&porevol[0], &source[0], 1.0, state_direct);
+        table.solve(&porevol[0], &source[0], 1.0, state_table);
+    }
+    for (int c = 0; c < nc; ++c) {
+        BOOST_CHECK(std::fabs(state_direct.saturation()[2*c] - state_table.saturation()[2*c]) < 1e-6);
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(FracFlowTablesScaledRegions)
+{
+    GridManager gm(24, 1);
+    const UnstructuredGrid& grid = *gm.c_grid();
+    const int nc = grid.number_of_cells;
+
+    std::vector<double> rho(2, 1000.0);
+    std::vector<double> mu(2, 1e-3);
+    mu[1] = 5e-3;
+    ScaledRegionProps props(rho, mu, nc);
+
+    const double q = 0.1;
+    std::vector<double> source(nc, 0.0);
+    source[0] = q;
+    source[nc - 1] = -q;
+    std::vector<double> porevol(nc, 1.0);
+
+    TwophaseState state_direct;
+    state_direct.init(grid, 2);
+    for (int f = 0; f < grid.number_of_faces; ++f) {
+        if (grid.face_cells[2*f] >= 0 && grid.face_cells[2*f + 1] >= 0) {
+            state_direct.faceflux()[f] = q;
+        }
+    }
+    TwophaseState state_table = state_direct;
+
+    TransportSolverTwophaseReorder direct(grid, props, NULL, 1e-12, 50);
+    TransportSolverTwophaseReorder table(grid, props, NULL, 1e-12, 50);
+    table.setUseNewton(true);
+
+    // One table per region serves all cells of the region, through
+    // each cell's own saturation range.
+    BOOST_CHECK(table.setFractionalFlowTables(401) < 1e-6);
+
+    for (int step = 0; step < 10; ++step) {
+        direct.solve(&porevol[0], &source[0], 1.0, state_direct);
+        table.solve(&porevol[0], &source[0], 1.0, state_table);
+    }
+    for (int c = 0; c < nc; ++c) {
+        BOOST_CHECK(std::fabs(state_direct.saturation()[2*c] - state_table.saturation()[2*c]) < 1e-5);
+    }
+}
@@ -0,0 +1,221 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+
+#if HAVE_DYNAMIC_BOOST_TEST
+#define BOOST_TEST_DYN_LINK
+#endif
+#define NVERBOSE // to suppress our messages when throwing
+
+#define BOOST_TEST_MODULE StateFileTest
+#include <boost/test/unit_test.hpp>
+
+#include <opm/core/io/StateFile.hpp>
+#include <opm/core/io/AsyncOutputWriter.hpp>
+#include <opm/core/simulator/TwophaseState.hpp>
+#include <opm/core/grid/GridManager.hpp>
+#include <opm/core/grid.h>
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace Opm;
+
+namespace
+{
+
+    std::vector<double> pressure(const int step, const int n)
+    {
+        std::vector<double> p(n);
+        for (int i = 0; i < n; ++i) {
+            p[i] = 1e7 + 1e5*step + 1e3*std::sin(0.1*i);
+        }
+        return p;
+    }
+
+    std::vector<int> iterations(const int step, const int n)
+    {
+        std::vector<int> it(n);
+        for (int i = 0; i < n; ++i) {
+            it[i] = (step + i) % 5;
+        }
+        return it;
+    }
+
+    void writeAndRead(const bool compress)
+    {
+        const boost::filesystem::path file =
+            boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+        const int n = 1000;
+        {
+            StateFileWriter writer(file.string(), compress);
+            for (int step = 0; step < 5; ++step) {
+                writer.write(step, "pressure", pressure(step, n));
+                // Odd sizes exercise the chunk alignment.
+                writer.write(step, "iterations", iterations(step, n - step));
+                if (step % 2 == 0) {
+                    writer.write(step, "empty", std::vector<double>());
+                }
+            }
+        }
+
+        StateFileReader reader(file.string());
+        const std::vector<std::string> names = reader.fieldNames();
+        BOOST_REQUIRE_EQUAL(names.size(), 3u);
+        BOOST_CHECK_EQUAL(names[0], "empty");
+        BOOST_CHECK_EQUAL(names[1], "iterations");
+        BOOST_CHECK_EQUAL(names[2], "pressure");
+        BOOST_CHECK_EQUAL(reader.steps("pressure").size(), 5u);
+        BOOST_CHECK_EQUAL(reader.steps("empty").size(), 3u);
+        BOOST_CHECK(reader.steps("nonexistent").empty());
+        BOOST_CHECK(reader.hasField("empty", 2));
+        BOOST_CHECK(!reader.hasField("empty", 3));
+        BOOST_CHECK(reader.isIntField("iterations"));
+        BOOST_CHECK(!reader.isIntField("pressure"));
+
+        std::vector<double> p;
+        std::vector<int> it;
+        for (int step = 0; step < 5; ++step) {
+            reader.read("pressure", step, p);
+            BOOST_CHECK(p == pressure(step, n));
+            reader.read("iterations", step, it);
+            BOOST_CHECK(it == iterations(step, n - step));
+        }
+        reader.read("empty", 4, p);
+        BOOST_CHECK(p.empty());
+        BOOST_CHECK_THROW(reader.read("pressure", 7, p), std::runtime_error);
+        BOOST_CHECK_THROW(reader.read("pressure", 0, it), std::runtime_error);
+        BOOST_CHECK_THROW(reader.read("nonexistent", 0, p), std::runtime_error);
+
+        {
+            // The mapping outlives the reader.
+            StateFileReader::MappedField<double> mp;
+            {
+                StateFileReader r(file.string());
+                mp = r.map<double>("pressure");
+                BOOST_CHECK_THROW(r.map<int>("pressure"), std::runtime_error);
+            }
+            BOOST_REQUIRE_EQUAL(mp.numSteps(), 5);
+            for (int i = 0; i < mp.numSteps(); ++i) {
+                BOOST_CHECK_EQUAL(mp.step(i), i);
+                BOOST_REQUIRE_EQUAL(mp.size(i), std::size_t(n));
+                const std::vector<double> expected = pressure(i, n);
+                BOOST_CHECK(std::equal(expected.begin(), expected.end(), mp.data(i)));
+            }
+        }
+        StateFileReader::MappedField<int> mi = reader.map<int>("iterations");
+        BOOST_REQUIRE_EQUAL(mi.numSteps(), 5);
+        for (int i = 0; i < mi.numSteps(); ++i) {
+            const std::vector<int> expected = iterations(i, n - i);
+            BOOST_REQUIRE_EQUAL(mi.size(i), expected.size());
+            BOOST_CHECK(std::equal(expected.begin(), expected.end(), mi.data(i)));
+        }
+
+        boost::filesystem::remove(file);
+    }
+
+} // anonymous namespace
+
+
+BOOST_AUTO_TEST_CASE(WriteAndRead)
+{
+    writeAndRead(false);
+}
+
+
+BOOST_AUTO_TEST_CASE(WriteAndReadCompressed)
+{
+    if (!StateFileWriter::compressionAvailable()) {
+        BOOST_CHECK_THROW(StateFileWriter("unused", true), std::runtime_error);
+        return;
+    }
+    writeAndRead(true);
+}
+
+
+BOOST_AUTO_TEST_CASE(FlushMakesReadable)
+{
+    const boost::filesystem::path file =
+        boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    StateFileWriter writer(file.string());
+    writer.write(0, "pressure", pressure(0, 10));
+    writer.flush();
+    {
+        StateFileReader reader(file.string());
+        BOOST_CHECK(reader.hasField("pressure", 0));
+        BOOST_CHECK(!reader.hasField("pressure", 1));
+    }
+    writer.write(1, "pressure", pressure(1, 10));
+    writer.close();
+    StateFileReader reader(file.string());
+    BOOST_CHECK(reader.hasField("pressure", 1));
+    std::vector<double> p;
+    reader.read("pressure", 0, p);
+    BOOST_CHECK(p == pressure(0, 10));
+    boost::filesystem::remove(file);
+
+    // Not a state file.
+    std::ofstream(file.string().c_str()) << "This is not a state file, just some text.";
+    BOOST_CHECK_THROW(StateFileReader r(file.string()), std::runtime_error);
+    boost::filesystem::remove(file);
+}
+
+
+BOOST_AUTO_TEST_CASE(AsyncWriterBinaryFormat)
+{
+    GridManager gm(4, 3);
+    const UnstructuredGrid& grid = *gm.c_grid();
+    const boost::filesystem::path dir =
+        boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    TwophaseState state;
+    state.init(grid, 2);
+    std::vector<int> it(grid.number_of_cells);
+    {
+        AsyncOutputWriter writer(grid, dir.string(), false, 2, AsyncOutputWriter::Binary);
+        for (int step = 0; step < 3; ++step) {
+            std::fill(state.pressure().begin(), state.pressure().end(), 1e5*step);
+            std::fill(it.begin(), it.end(), step);
+            writer.write(step, state, "iterations", it);
+        }
+    }
+    // No Matlab files are written.
+    BOOST_CHECK(!boost::filesystem::exists(dir / "pressure"));
+
+    StateFileReader reader((dir / "states.bin").string());
+    const std::vector<std::string> names = reader.fieldNames();
+    BOOST_REQUIRE_EQUAL(names.size(), 4u);
+    BOOST_CHECK_EQUAL(names[0], "iterations");
+    BOOST_CHECK_EQUAL(names[1], "pressure");
+    BOOST_CHECK_EQUAL(names[2], "saturation");
+    BOOST_CHECK_EQUAL(names[3], "velocity");
+    StateFileReader::MappedField<double> p = reader.map<double>("pressure");
+    BOOST_REQUIRE_EQUAL(p.numSteps(), 3);
+    for (int i = 0; i < 3; ++i) {
+        BOOST_REQUIRE_EQUAL(p.size(i), std::size_t(grid.number_of_cells));
+        BOOST_CHECK_EQUAL(p.data(i)[grid.number_of_cells - 1], 1e5*i);
+    }
+    std::vector<int> it2;
+    reader.read("iterations", 2, it2);
+    BOOST_CHECK(it2 == std::vector<int>(grid.number_of_cells, 2));
+    boost::filesystem::remove_all(dir);
+}
@@ -0,0 +1,183 @@
+/*
+  Copyright 2013 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+
+#if HAVE_DYNAMIC_BOOST_TEST
+#define BOOST_TEST_DYN_LINK
+#endif
+#define NVERBOSE // to suppress our messages when throwing
+
+#define BOOST_TEST_MODULE StreamlineTest
+#include <boost/test/unit_test.hpp>
+
+#include <opm/core/tof/StreamlineTracer.hpp>
+#include <opm/core/grid/GridManager.hpp>
+#include <opm/core/grid.h>
+#include <opm/core/utility/SparseTable.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace Opm;
+
+namespace
+{
+
+    // Flux of a uniform velocity (vx, vy), by default a unit
+    // velocity in the x direction.
+    std::vector<double> uniformFlux(const UnstructuredGrid& grid,
+                                    const double vx = 1.0,
+                                    const double vy = 0.0)
+    {
+        const int dim = grid.dimensions;
+        std::vector<double> flux(grid.number_of_faces);
+        for (int f = 0; f < grid.number_of_faces; ++f) {
+            flux[f] = vx*grid.face_normals[dim*f] + vy*grid.face_normals[dim*f + 1];
+        }
+        return flux;
+    }
+
+    // Boundary faces with flow into the grid.
+    SparseTable<int> inflowFaces(const UnstructuredGrid& grid,
+                                 const std::vector<double>& flux)
+    {
+        std::vector<int> faces;
+        for (int f = 0; f < grid.number_of_faces; ++f) {
+            if ((grid.face_cells[2*f] < 0 && flux[f] > 0.0)
+                || (grid.face_cells[2*f + 1] < 0 && flux[f] < 0.0)) {
+                faces.push_back(f);
+            }
+        }
+        SparseTable<int> table;
+        table.appendRow(faces.begin(), faces.end());
+        return table;
+    }
+
+} // anonymous namespace
+
+
+
+BOOST_AUTO_TEST_CASE(UniformFlow)
+{
+    const int nx = 5;
+    const int ny = 3;
+    GridManager gm(nx, ny);
+    const UnstructuredGrid& grid = *gm.c_grid();
+    const int nc = grid.number_of_cells;
+    const std::vector<double> flux = uniformFlux(grid);
+    const std::vector<double> porevol(nc, 0.5);
+
+    StreamlineTracer tracer(grid);
+    std::vector<StreamlineTracer::Seed> seeds;
+    tracer.seedsFromFaces(&flux[0], inflowFaces(grid, flux), 3, seeds);
+    BOOST_REQUIRE_EQUAL(seeds.size(), std::size_t(3*ny));
+
+    std::vector<StreamlineTracer::Streamline> lines;
+    tracer.trace(&flux[0], &porevol[0], 0, seeds, lines);
+    BOOST_REQUIRE_EQUAL(lines.size(), seeds.size());
+    for (std::size_t l = 0; l < lines.size(); ++l) {
+        const StreamlineTracer::Streamline& line = lines[l];
+        BOOST_REQUIRE_EQUAL(line.cells.size(), std::size_t(nx));
+        for (int i = 0; i < nx; ++i) {
+            BOOST_CHECK_EQUAL(line.cells[i] % nx, i);
+            BOOST_CHECK_CLOSE(line.tof_out[i], 0.5*(i + 1), 1e-8);
+            // Straight lines.
+            BOOST_CHECK_CLOSE(line.points[2*(i + 1) + 1], seeds[l].point[1], 1e-8);
+        }
+    }
+
+    std::vector<double> tof, tr;
+    tracer.mapToCells(lines, 1, tof, tr);
+    for (int c = 0; c < nc; ++c) {
+        BOOST_CHECK_CLOSE(tof[c], 0.5*(c % nx + 0.5), 1e-8);
+        BOOST_CHECK_CLOSE(tr[c], 1.0, 1e-12);
+    }
+
+    // Diagonal flow, entering at x = 0 and y = 0, gives the
+    // time-of-flight 0.5*min(x, y). Streamlines cut corners of the
+    // cells on the diagonal, where the cell average of min(x, y) is
+    // i + 1/3. Weighting the streamlines by flux instead of swept
+    // volume would give i + 1/4 there.
+    const int n = 4;
+    GridManager diag_gm(n, n);
+    const UnstructuredGrid& diag_grid = *diag_gm.c_grid();
+    const std::vector<double> diag_flux = uniformFlux(diag_grid, 1.0, 1.0);
+    const std::vector<double> diag_porevol(n*n, 0.5);
+    StreamlineTracer diag_tracer(diag_grid);
+    diag_tracer.seedsFromFaces(&diag_flux[0], inflowFaces(diag_grid, diag_flux), 20, seeds);
+    BOOST_REQUIRE_EQUAL(seeds.size(), std::size_t(2*20*n));
+    diag_tracer.trace(&diag_flux[0], &diag_porevol[0], 0, seeds, lines);
+    diag_tracer.mapToCells(lines, 1, tof, tr);
+    for (int j = 0; j < n; ++j) {
+        for (int i = 0; i < n; ++i) {
+            const int c = i + n*j;
+            const double expected = (i == j) ? i + 1.0/3.0 : std::min(i, j) + 0.5;
+            BOOST_CHECK_SMALL(tof[c] - 0.5*expected, 0.005);
+            BOOST_CHECK_CLOSE(tr[c], 1.0, 1e-12);
+        }
+    }
+}
+
+
+
+BOOST_AUTO_TEST_CASE(SourceAndSink)
+{
+    const int nx = 4;
+    const int ny = 1;
+    GridManager gm(nx, ny);
+    const UnstructuredGrid& grid = *gm.c_grid();
+    const int nc = grid.number_of_cells;
+
+    // Flow from the first to the last cell.
+    std::vector<double> flux(grid.number_of_faces, 0.0);
+    for (int f = 0; f < grid.number_of_faces; ++f) {
+        if (grid.face_cells[2*f] >= 0 && grid.face_cells[2*f + 1] >= 0) {
+            flux[f] = 1.0;
+        }
+    }
+    std::vector<double> source(nc, 0.0);
+    source[0] = 1.0;
+    source[nc - 1] = -1.0;
+    const std::vector<double> porevol(nc, 1.0);
+
+    StreamlineTracer tracer(grid);
+    SparseTable<int> heads;
+    const int first = 0;
+    heads.appendRow(&first, &first + 1);
+    std::vector<StreamlineTracer::Seed> seeds;
+    tracer.seedsFromCells(&flux[0], heads, 2, seeds);
+    BOOST_REQUIRE_EQUAL(seeds.size(), std::size_t(2));
+    BOOST_CHECK_EQUAL(seeds[0].cell, 1);
+    BOOST_CHECK_EQUAL(seeds[0].source_cell, 0);
+    BOOST_CHECK_CLOSE(seeds[0].flux, 0.5, 1e-12);
+
+    std::vector<StreamlineTracer::Streamline> lines;
+    tracer.trace(&flux[0], &porevol[0], &source[0], seeds, lines);
+    std::vector<double> tof, tr;
+    tracer.mapToCells(lines, 1, tof, tr);
+    BOOST_CHECK_CLOSE(tof[0], 0.0, 1e-12);
+    BOOST_CHECK_CLOSE(tof[1], 0.5, 1e-8);
+    BOOST_CHECK_CLOSE(tof[2], 1.5, 1e-8);
+    // The sink cell has the mean residence time of one pore volume.
+    BOOST_CHECK_CLOSE(tof[3], 2.5, 1e-8);
+    for (int c = 0; c < nc; ++c) {
+        BOOST_CHECK_CLOSE(tr[c], 1.0, 1e-12);
+    }
+}
@@ -0,0 +1,192 @@
+/*
+  Copyright 2012 SINTEF ICT, Applied Mathematics.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+
+#if HAVE_DYNAMIC_BOOST_TEST
+#define BOOST_TEST_DYN_LINK
+#endif
+#define NVERBOSE // to suppress our messages when throwing
+
+#define BOOST_TEST_MODULE TofTest
+#include <boost/test/unit_test.hpp>
+
+#include <opm/core/tof/TofReorder.hpp>
+#include <opm/core/tof/TofDiscGalReorder.hpp>
+#include <opm/core/utility/parameters/ParameterGroup.hpp>
+#include <opm/core/grid/GridManager.hpp>
+#include <opm/core/grid.h>
+#include <opm/core/utility/SparseTable.hpp>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <utility>
+#include <vector>
+
+using namespace Opm;
+
+BOOST_AUTO_TEST_CASE(ForwardBackwardMatchesSeparateSolves)
+{
+    GridManager gm(1, 6);
+    const UnstructuredGrid& grid = *gm.c_grid();
+    const int nc = grid.number_of_cells;
+
+    // One-dimensional flow from the first to the last cell.
+    std::vector<double> flux(grid.number_of_faces, 0.0);
+    for (int f = 0; f < grid.number_of_faces; ++f) {
+        if (grid.face_cells[2*f] >= 0 && grid.face_cells[2*f + 1] >= 0) {
+            flux[f] = 1.0;
+        }
+    }
+    std::vector<double> source(nc, 0.0);
+    source[0] = 1.0;
+    source[nc - 1] = -1.0;
+    std::vector<double> porevol(nc, 1.0);
+
+    SparseTable<int> injectors;
+    SparseTable<int> producers;
+    const int first = 0;
+    const int last = nc - 1;
+    injectors.appendRow(&first, &first + 1);
+    producers.appendRow(&last, &last + 1);
+
+    TofReorder solver(grid);
+    std::vector<double> ftof, ftracer, btof, btracer;
+    solver.solveTofTracerForwardBackward(&flux[0], &porevol[0], &source[0],
+                                         injectors, producers,
+                                         ftof, ftracer, btof, btracer);
+
+    std::vector<double> ftof_ref, ftracer_ref;
+    solver.solveTofTracer(&flux[0], &porevol[0], &source[0], injectors, ftof_ref, ftracer_ref);
+
+    std::vector<double> rflux(flux.size());
+    std::vector<double> rsource(source.size());
+    std::transform(flux.begin(), flux.end(), rflux.begin(), std::negate<double>());
+    std::transform(source.begin(), source.end(), rsource.begin(), std::negate<double>());
+    std::vector<double> btof_ref, btracer_ref;
+    solver.solveTofTracer(&rflux[0], &porevol[0], &rsource[0], producers, btof_ref, btracer_ref);
+
+    BOOST_REQUIRE_EQUAL(ftof.size(), std::size_t(nc));
+    BOOST_REQUIRE_EQUAL(btof.size(), std::size_t(nc));
+    BOOST_REQUIRE_EQUAL(ftracer.size(), std::size_t(nc));
+    BOOST_REQUIRE_EQUAL(btracer.size(), std::size_t(nc));
+    for (int c = 0; c < nc; ++c) {
+        BOOST_CHECK_CLOSE(ftof[c], ftof_ref[c], 1e-12);
+        BOOST_CHECK_CLOSE(btof[c], btof_ref[c], 1e-12);
+        BOOST_CHECK_CLOSE(ftracer[c], ftracer_ref[c], 1e-12);
+        BOOST_CHECK_CLOSE(btracer[c], btracer_ref[c], 1e-12);
+        // Forward tof grows downstream, backward tof grows upstream.
+        BOOST_CHECK_CLOSE(ftof[c], double(c + 1), 1e-12);
+        BOOST_CHECK_CLOSE(btof[c], double(nc - c), 1e-12);
+        BOOST_CHECK_CLOSE(ftracer[c], 1.0, 1e-12);
+        BOOST_CHECK_CLOSE(btracer[c], 1.0, 1e-12);
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(DiscGalForwardBackwardMatchesSeparateSolves)
+{
+    GridManager gm(3, 3);
+    const UnstructuredGrid& grid = *gm.c_grid();
+    const int nc = grid.number_of_cells;
+
+    // Unit flux in the +x and +y directions across all interior faces,
+    // plus a circulation around the cells 4 -> 5 -> 8 -> 7 -> 4, so that
+    // the upwind graph has a cycle. Keys are (lower, higher) cell index,
+    // values the flux from the lower to the higher cell.
+    std::map<std::pair<int, int>, double> flow;
+    flow[std::make_pair(4, 5)] = 3.0;
+    flow[std::make_pair(5, 8)] = 3.0;
+    flow[std::make_pair(7, 8)] = -1.0;
+    flow[std::make_pair(4, 7)] = -1.0;
+    std::vector<double> flux(grid.number_of_faces, 0.0);
+    std::vector<double> source(nc, 0.0);
+    for (int f = 0; f < grid.number_of_faces; ++f) {
+        const int c0 = grid.face_cells[2*f];
+        const int c1 = grid.face_cells[2*f + 1];
+        if (c0 < 0 || c1 < 0) {
+            continue;
+        }
+        const std::pair<int, int> key(std::min(c0, c1), std::max(c0, c1));
+        const double lo_to_hi = flow.count(key) ? flow[key] : 1.0;
+        flux[f] = c0 < c1 ? lo_to_hi : -lo_to_hi;
+        // Source balances the net outflow.
+        source[c0] += flux[f];
+        source[c1] -= flux[f];
+    }
+    std::vector<double> porevol(nc, 1.0);
+
+    // One tracer for the corner injector, one for the others, and
+    // likewise for producers.
+    SparseTable<int> injectors;
+    SparseTable<int> producers;
+    std::vector<int> inj_rest, prod_rest;
+    for (int c = 0; c < nc; ++c) {
+        if (source[c] > 0.0 && c != 0) {
+            inj_rest.push_back(c);
+        } else if (source[c] < 0.0 && c != nc - 1) {
+            prod_rest.push_back(c);
+        }
+    }
+    BOOST_REQUIRE(source[0] > 0.0 && source[nc - 1] < 0.0);
+    BOOST_REQUIRE(!inj_rest.empty() && !prod_rest.empty());
+    const int first = 0;
+    const int last = nc - 1;
+    injectors.appendRow(&first, &first + 1);
+    injectors.appendRow(inj_rest.begin(), inj_rest.end());
+    producers.appendRow(&last, &last + 1);
+    producers.appendRow(prod_rest.begin(), prod_rest.end());
+
+    parameter::ParameterGroup param;
+    param.insertParameter("dg_degree", "1");
+    param.insertParameter("gauss_seidel_tol", "1e-13");
+    TofDiscGalReorder solver(grid, param);
+    std::vector<double> ftof, ftracer, btof, btracer;
+    solver.solveTofTracerForwardBackward(&flux[0], &porevol[0], &source[0],
+                                         injectors, producers,
+                                         ftof, ftracer, btof, btracer);
+
+    std::vector<double> ftof_ref, ftracer_ref;
+    solver.solveTofTracer(&flux[0], &porevol[0], &source[0], injectors, ftof_ref, ftracer_ref);
+
+    std::vector<double> rflux(flux.size());
+    std::vector<double> rsource(source.size());
+    std::transform(flux.begin(), flux.end(), rflux.begin(), std::negate<double>());
+    std::transform(source.begin(), source.end(), rsource.begin(), std::negate<double>());
+    std::vector<double> btof_ref, btracer_ref;
+    solver.solveTofTracer(&rflux[0], &porevol[0], &rsource[0], producers, btof_ref, btracer_ref);
+
+    BOOST_REQUIRE_EQUAL(ftof.size(), ftof_ref.size());
+    BOOST_REQUIRE_EQUAL(btof.size(), btof_ref.size());
+    BOOST_REQUIRE_EQUAL(ftracer.size(), ftracer_ref.size());
+    BOOST_REQUIRE_EQUAL(btracer.size(), btracer_ref.size());
+    BOOST_REQUIRE_EQUAL(ftracer.size(), 2*ftof.size());
+    // The multi-cell block is solved by Gauss-Seidel iterations, and
+    // the backward solve visits its cells in another order, so the
+    // results agree to the iteration tolerance only.
+    const double tol = 1e-9;
+    for (std::size_t i = 0; i < ftof.size(); ++i) {
+        BOOST_CHECK_SMALL(ftof[i] - ftof_ref[i], tol);
+        BOOST_CHECK_SMALL(btof[i] - btof_ref[i], tol);
+    }
+    for (std::size_t i = 0; i < ftracer.size(); ++i) {
+        BOOST_CHECK_SMALL(ftracer[i] - ftracer_ref[i], tol);
+        BOOST_CHECK_SMALL(btracer[i] - btracer_ref[i], tol);
+    }
+}
@@ -485,3 +485,122 @@ BOOST_AUTO_TEST_CASE(test_VelocityInterpolationECVI)
 }
 
 
+
+
+namespace
+{
+
+    // Check that the batch methods give the same velocities as
+    // interpolate(), on a 3d grid with a non-uniform flux field.
+    template <class VelInterp>
+    void testBatchMatchesSingle()
+    {
+        GridManager gm(3, 2, 2, 1.0, 2.0, 0.5);
+        const UnstructuredGrid& grid = *gm.c_grid();
+        const int dim = grid.dimensions;
+        std::vector<double> flux(grid.number_of_faces);
+        for (int face = 0; face < grid.number_of_faces; ++face) {
+            flux[face] = std::sin(1.0 + face);
+        }
+        VelInterp vi(grid);
+        vi.setupFluxes(&flux[0]);
+
+        // Points between the centroid and the face centroids of each cell.
+        std::vector<int> cells;
+        std::vector<double> x;
+        for (int cell = 0; cell < grid.number_of_cells; ++cell) {
+            const double* cc = grid.cell_centroids + dim*cell;
+            for (int hface = grid.cell_facepos[cell]; hface < grid.cell_facepos[cell + 1]; ++hface) {
+                const double* fc = grid.face_centroids + dim*grid.cell_faces[hface];
+                cells.push_back(cell);
+                for (int dd = 0; dd < dim; ++dd) {
+                    x.push_back(0.3*cc[dd] + 0.7*fc[dd]);
+                }
+            }
+        }
+        const int num_points = cells.size();
+        std::vector<double> v_single(dim*num_points);
+        for (int pt = 0; pt < num_points; ++pt) {
+            vi.interpolate(cells[pt], &x[dim*pt], &v_single[dim*pt]);
+        }
+
+        std::vector<double> v_cells(dim*num_points);
+        vi.interpolateInCells(num_points, &cells[0], &x[0], &v_cells[0]);
+        std::vector<double> v_cell(dim*num_points);
+        for (int pt = 0; pt < num_points; ) {
+            int end = pt;
+            while (end < num_points && cells[end] == cells[pt]) {
+                ++end;
+            }
+            vi.interpolateInCell(cells[pt], end - pt, &x[dim*pt], &v_cell[dim*pt]);
+            pt = end;
+        }
+        for (int i = 0; i < dim*num_points; ++i) {
+            BOOST_CHECK_EQUAL(v_cells[i], v_single[i]);
+            BOOST_CHECK_EQUAL(v_cell[i], v_single[i]);
+        }
+    }
+
+    // Check that the batch methods reproduce a constant velocity
+    // field exactly, independently of interpolate().
+    template <class VelInterp>
+    void testBatchConstantVelRepro()
+    {
+        GridManager gm(3, 2, 2, 1.0, 2.0, 0.5);
+        const UnstructuredGrid& grid = *gm.c_grid();
+        const int dim = grid.dimensions;
+        std::vector<double> v(dim);
+        v[0] = 0.12345;
+        v[1] = -0.6789;
+        v[2] = 0.423;
+        std::vector<double> flux;
+        computeFlux(grid, v, flux);
+        VelInterp vi(grid);
+        vi.setupFluxes(&flux[0]);
+
+        // Points between the centroid and the nodes of each cell's faces.
+        std::vector<int> cells;
+        std::vector<double> x;
+        for (int cell = 0; cell < grid.number_of_cells; ++cell) {
+            const double* cc = grid.cell_centroids + dim*cell;
+            for (int hface = grid.cell_facepos[cell]; hface < grid.cell_facepos[cell + 1]; ++hface) {
+                const int face = grid.cell_faces[hface];
+                for (int fn = grid.face_nodepos[face]; fn < grid.face_nodepos[face + 1]; ++fn) {
+                    const double* nc = grid.node_coordinates + dim*grid.face_nodes[fn];
+                    cells.push_back(cell);
+                    for (int dd = 0; dd < dim; ++dd) {
+                        x.push_back(0.4*cc[dd] + 0.6*nc[dd]);
+                    }
+                }
+            }
+        }
+        const int num_points = cells.size();
+        std::vector<double> v_cells(dim*num_points);
+        vi.interpolateInCells(num_points, &cells[0], &x[0], &v_cells[0]);
+        std::vector<double> v_cell(dim*num_points);
+        for (int pt = 0; pt < num_points; ) {
+            int end = pt;
+            while (end < num_points && cells[end] == cells[pt]) {
+                ++end;
+            }
+            vi.interpolateInCell(cells[pt], end - pt, &x[dim*pt], &v_cell[dim*pt]);
+            pt = end;
+        }
+        for (int pt = 0; pt < num_points; ++pt) {
+            for (int dd = 0; dd < dim; ++dd) {
+                BOOST_CHECK(std::fabs(v_cells[dim*pt + dd] - v[dd]) < 1e-12);
+                BOOST_CHECK(std::fabs(v_cell[dim*pt + dd] - v[dd]) < 1e-12);
+            }
+        }
+    }
+
+} // anonymous namespace
+
+
+BOOST_AUTO_TEST_CASE(test_VelocityInterpolationBatch)
+{
+    testBatchMatchesSingle<VelocityInterpolationConstant>();
+    testBatchMatchesSingle<VelocityInterpolationECVI>();
+    testBatchConstantVelRepro<VelocityInterpolationConstant>();
+    testBatchConstantVelRepro<VelocityInterpolationECVI>();
+}
@@ -354,6 +354,72 @@ static void testIrregPrism()
 }
 
 
+// Compute barycentric coordinates of several points in one call, and
+// check that they sum to one and reproduce the points from the cell
+// vertices, as generalized barycentric coordinates must.
+static void checkBatchLinearPrecision(const UnstructuredGrid& grid,
+                                      const int cell,
+                                      const std::vector<double>& x)
+{
+    WachspressCoord bcmethod(grid);
+    const int dim = grid.dimensions;
+    const int num_points = x.size()/dim;
+    const int ncor = bcmethod.numCorners(cell);
+    std::vector<double> xb(num_points*ncor);
+    bcmethod.cartToBary(cell, num_points, &x[0], &xb[0]);
+    for (int pt = 0; pt < num_points; ++pt) {
+        double sum = 0.0;
+        std::vector<double> xr(dim, 0.0);
+        for (int cor = 0; cor < ncor; ++cor) {
+            const double w = xb[pt*ncor + cor];
+            const int vertex = bcmethod.cornerInfo()[cell][cor].vertex;
+            sum += w;
+            for (int dd = 0; dd < dim; ++dd) {
+                xr[dd] += w*grid.node_coordinates[dim*vertex + dd];
+            }
+        }
+        BOOST_CHECK(std::fabs(sum - 1.0) < 1e-12);
+        for (int dd = 0; dd < dim; ++dd) {
+            BOOST_CHECK(std::fabs(xr[dd] - x[dim*pt + dd]) < 1e-12);
+        }
+    }
+}
+
+static void testBatch()
+{
+    // Irregular 2d cell, points inside and at vertices.
+    {
+        UnstructuredGrid grid = makeIrreg2d();
+        const double pts[] = { 1.2345, 2.0123,   0.0, 0.0,   1.0, 3.0,   3.0, 1.0,   1.5, 1.5 };
+        checkBatchLinearPrecision(grid, 0, std::vector<double>(pts, pts + 10));
+    }
+    // Irregular prism.
+    {
+        UnstructuredGrid grid = makeIrregPrism();
+        const double pts[] = { 0.123, 0.0123, 0.213,   0.0, 0.0, 1.0,
+                               1.0, 0.0, 1.0,          0.5, 0.5, 0.5 };
+        checkBatchLinearPrecision(grid, 0, std::vector<double>(pts, pts + 12));
+    }
+    // Cartesian 3d grid, points between cell and face centroids.
+    {
+        GridManager gm(3, 2, 2, 1.0, 2.0, 0.5);
+        const UnstructuredGrid& grid = *gm.c_grid();
+        const int dim = grid.dimensions;
+        for (int cell = 0; cell < grid.number_of_cells; ++cell) {
+            std::vector<double> x;
+            const double* cc = grid.cell_centroids + dim*cell;
+            for (int hface = grid.cell_facepos[cell]; hface < grid.cell_facepos[cell + 1]; ++hface) {
+                const double* fc = grid.face_centroids + dim*grid.cell_faces[hface];
+                for (int dd = 0; dd < dim; ++dd) {
+                    x.push_back(0.3*cc[dd] + 0.7*fc[dd]);
+                }
+            }
+            checkBatchLinearPrecision(grid, cell, x);
+        }
+    }
+}
+
+
 BOOST_AUTO_TEST_CASE(test_WachspressCoord)
 {
     test2dCart();
@@ -361,3 +427,8 @@ BOOST_AUTO_TEST_CASE(test_WachspressCoord)
     testIrreg2d();
     testIrregPrism();
 }
+
+BOOST_AUTO_TEST_CASE(test_WachspressCoordBatch)
+{
+    testBatch();
+}